@@ -0,0 +1,133 @@
+/**
+ * @file budget.c
+ * @author Alary Dorian
+ * @brief Memory budget of the server, the bytes held in its buffers are counted against a limit
+ * @version 0.1
+ * @date 2022-08-16
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <stdlib.h>
+#include "budget.h"
+
+/*
+	The buffers are charged where they are allocated and released where they are freed,
+	by the event loop or by the threads of the worker : the counter is atomic.
+	Only the bytes of the data are counted with the size of their header, not the overhead of malloc.
+*/
+
+
+struct s_Budget {
+
+	size_t limit; /* 0 for no limit */
+	size_t held;
+};
+
+/*-----------------------------------------------------------------*/
+
+/**
+ * @brief Create a budget
+ *
+ * @param limit bytes which can be held, 0 for no limit
+ * @return Budget* pointer on budget
+ */
+Budget *budget_create(size_t limit)
+{
+	Budget *b = malloc(sizeof(Budget));
+
+	b->limit = limit;
+	b->held = 0;
+
+	return b;
+}
+
+
+/**
+ * @brief Count bytes held, can be called by any thread
+ *
+ * @param b pointer on budget, NULL if disabled
+ * @param bytes bytes allocated
+ */
+void budget_charge(Budget *b, size_t bytes)
+{
+	if(b != NULL)
+		__atomic_add_fetch(&b->held, bytes, __ATOMIC_RELAXED);
+}
+
+
+/**
+ * @brief Count bytes freed, can be called by any thread
+ *
+ * @param b pointer on budget, NULL if disabled
+ * @param bytes bytes freed
+ */
+void budget_release(Budget *b, size_t bytes)
+{
+	if(b != NULL)
+		__atomic_sub_fetch(&b->held, bytes, __ATOMIC_RELAXED);
+}
+
+
+/**
+ * @brief Count the change of a buffer whose size is measured before and after an operation
+ *
+ * @param b pointer on budget, NULL if disabled
+ * @param before size of the buffer before
+ * @param after size of the buffer after
+ */
+void budget_update(Budget *b, size_t before, size_t after)
+{
+	if(after > before)
+		budget_charge(b, after - before);
+	else
+		budget_release(b, before - after);
+}
+
+
+/**
+ * @brief Give the bytes held
+ *
+ * @param b pointer on budget
+ * @return size_t bytes held
+ */
+size_t budget_held(Budget *b)
+{
+	return __atomic_load_n(&b->held, __ATOMIC_RELAXED);
+}
+
+
+/**
+ * @brief Give the stage of the response to the memory held
+ *
+ * @param b pointer on budget, NULL if disabled
+ * @return BudgetStage stage, BUDGET_OK if there is no limit
+ */
+BudgetStage budget_stage(Budget *b)
+{
+	size_t held;
+
+	if(b == NULL || b->limit == 0)
+		return BUDGET_OK;
+
+	held = budget_held(b);
+	if(held >= b->limit)
+		return BUDGET_EVICTING;
+	if(held >= b->limit / 100 * BUDGET_SHED)
+		return BUDGET_SHEDDING;
+	if(held >= b->limit / 100 * BUDGET_PAUSE)
+		return BUDGET_READS_PAUSED;
+
+	return BUDGET_OK;
+}
+
+
+/**
+ * @brief Delete the budget
+ *
+ * @param b pointer on budget
+ */
+void budget_delete(Budget *b)
+{
+	free(b);
+}
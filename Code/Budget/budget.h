@@ -0,0 +1,108 @@
+/**
+ * @file budget.h
+ * @author Alary Dorian
+ * @brief Memory budget of the server, the bytes held in its buffers are counted against a limit
+ * @version 0.1
+ * @date 2022-08-16
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef __BUDGET_H__
+#define __BUDGET_H__
+
+#include <stddef.h>
+
+/*-----------------------------------------------------------------*/
+
+/* Default values */
+#define BUDGET_MEMORY (64 * 1024 * 1024) /* bytes held by the server in its buffers */
+#define BUDGET_CLIENT (1024 * 1024) /* bytes held for one connection, its reads are paused over it */
+#define BUDGET_PAUSE 60 /* percent of the limit from which no client is read */
+#define BUDGET_SHED 80 /* percent of the limit from which the messages of lowest priority are dropped */
+
+
+/**
+* @brief 	Opaque definition of type Budget.
+*/
+typedef struct s_Budget Budget;
+
+
+/**
+* @brief 	Stage of the response to the memory held, each stage does what the previous ones do.
+*/
+typedef enum e_BudgetStage {
+
+	BUDGET_OK, /* under BUDGET_PAUSE */
+	BUDGET_READS_PAUSED, /* the clients with messages waiting in the server are not read, no connection is accepted */
+	BUDGET_SHEDDING, /* the messages of lowest priority are dropped */
+	BUDGET_EVICTING /* over the limit : the connections which hold the most are closed */
+} BudgetStage;
+
+
+/*-----------------------------------------------------------------*/
+
+
+/**
+ * @brief Create a budget
+ *
+ * @param limit bytes which can be held, 0 for no limit
+ * @return Budget* pointer on budget
+ */
+Budget *budget_create(size_t limit);
+
+
+/**
+ * @brief Count bytes held, can be called by any thread
+ *
+ * @param b pointer on budget, NULL if disabled
+ * @param bytes bytes allocated
+ */
+void budget_charge(Budget *b, size_t bytes);
+
+
+/**
+ * @brief Count bytes freed, can be called by any thread
+ *
+ * @param b pointer on budget, NULL if disabled
+ * @param bytes bytes freed
+ */
+void budget_release(Budget *b, size_t bytes);
+
+
+/**
+ * @brief Count the change of a buffer whose size is measured before and after an operation
+ *
+ * @param b pointer on budget, NULL if disabled
+ * @param before size of the buffer before
+ * @param after size of the buffer after
+ */
+void budget_update(Budget *b, size_t before, size_t after);
+
+
+/**
+ * @brief Give the bytes held
+ *
+ * @param b pointer on budget
+ * @return size_t bytes held
+ */
+size_t budget_held(Budget *b);
+
+
+/**
+ * @brief Give the stage of the response to the memory held
+ *
+ * @param b pointer on budget, NULL if disabled
+ * @return BudgetStage stage, BUDGET_OK if there is no limit
+ */
+BudgetStage budget_stage(Budget *b);
+
+
+/**
+ * @brief Delete the budget
+ *
+ * @param b pointer on budget
+ */
+void budget_delete(Budget *b);
+
+#endif
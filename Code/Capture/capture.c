@@ -0,0 +1,232 @@
+/**
+ * @file capture.c
+ * @author Alary Dorian
+ * @brief Capture of the traffic received by the server in a compact binary file, to be replayed
+ * @version 0.1
+ * @date 2022-08-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "capture.h"
+
+/*
+	The records are written by the event loop only, in the order of the events.
+	The time is stored in nanoseconds as a delta with the previous record, the integers as varints :
+	a message of a busy connection costs about 6 bytes of header.
+*/
+
+
+struct s_Capture {
+
+	FILE *file;
+	char *buffer; /* buffer of the FILE */
+	int64_t first; /* time of the first record, 0 before it */
+	int64_t last; /* time of the last record */
+};
+
+
+struct s_CaptureReader {
+
+	FILE *file;
+	int64_t time; /* time of the last record read */
+};
+
+/*-----------------------------------------------------------------*/
+
+/**
+ * @brief Write an unsigned integer on 7 bits by byte, the high bit tells that a byte follows
+ *
+ * @param file file
+ * @param value value
+ */
+static void varint_write(FILE *file, uint64_t value)
+{
+	while(value >= 0x80)
+	{
+		fputc((value & 0x7f) | 0x80, file);
+		value >>= 7;
+	}
+	fputc(value, file);
+}
+
+
+/**
+ * @brief Read an unsigned integer written by varint_write
+ *
+ * @param file file
+ * @param value variable that stores the value
+ * @return int 0 on success, -1 at the end of the file
+ */
+static int varint_read(FILE *file, uint64_t *value)
+{
+	int shift, b;
+
+	*value = 0;
+	for(shift = 0 ; shift < 64 ; shift += 7)
+	{
+		if((b = fgetc(file)) == EOF)
+			return -1;
+		*value |= (uint64_t)(b & 0x7f) << shift;
+		if((b & 0x80) == 0)
+			return 0;
+	}
+
+	return -1;
+}
+
+/*-----------------------------------------------------------------*/
+
+/**
+ * @brief Create a capture file, an existing file is truncated
+ *
+ * @param path path of the file
+ * @return Capture* pointer on capture, NULL on error
+ */
+Capture *capture_open(const char *path)
+{
+	Capture *c = malloc(sizeof(Capture));
+
+	if((c->file = fopen(path, "wb")) == NULL)
+	{
+		fprintf(stderr, "Error : fopen()\n");
+		free(c);
+		return NULL;
+	}
+
+	/* written by blocks, the event loop does not make a syscall by message */
+	c->buffer = malloc(CAPTURE_BUFFER);
+	setvbuf(c->file, c->buffer, _IOFBF, CAPTURE_BUFFER);
+	fwrite(CAPTURE_MAGIC, 1, sizeof(CAPTURE_MAGIC), c->file);
+	c->first = 0;
+	c->last = 0;
+
+	return c;
+}
+
+
+/**
+ * @brief Record an event of a connection
+ *
+ * @param c pointer on capture, NULL if disabled
+ * @param type type of the event
+ * @param id id of the connection
+ * @param now time of the event in nanoseconds, of a monotonic clock
+ * @param data message of a CAPTURE_MESSAGE, NULL for the other events
+ * @param len len of the message
+ * @note A record is a type, then the time since the last record, the id and the len as varints, then the message.
+ */
+void capture_record(Capture *c, CaptureType type, int id, int64_t now, const void *data, size_t len)
+{
+	if(c == NULL)
+		return;
+
+	if(c->first == 0)
+		c->first = c->last = now;
+	/* the events of an iteration share the time of the loop, it never goes back */
+	now = (now > c->last) ? now : c->last;
+
+	fputc(type, c->file);
+	varint_write(c->file, now - c->last);
+	varint_write(c->file, id);
+	varint_write(c->file, (data != NULL) ? len : 0);
+	if(data != NULL)
+		fwrite(data, 1, len, c->file);
+	c->last = now;
+}
+
+
+/**
+ * @brief Write the records buffered and close the capture
+ *
+ * @param c pointer on capture
+ */
+void capture_close(Capture *c)
+{
+	if(fclose(c->file) != 0)
+		fprintf(stderr, "Error : fclose()\n");
+	free(c->buffer);
+	free(c);
+}
+
+/*-----------------------------------------------------------------*/
+
+/**
+ * @brief Open a capture file to read its records
+ *
+ * @param path path of the file
+ * @return CaptureReader* pointer on reader, NULL if the file is not a capture
+ */
+CaptureReader *captureReader_open(const char *path)
+{
+	CaptureReader *r = malloc(sizeof(CaptureReader));
+	char magic[sizeof(CAPTURE_MAGIC)];
+
+	if((r->file = fopen(path, "rb")) == NULL)
+	{
+		free(r);
+		return NULL;
+	}
+
+	if(fread(magic, 1, sizeof(magic), r->file) != sizeof(magic) || memcmp(magic, CAPTURE_MAGIC, sizeof(magic)) != 0)
+	{
+		fclose(r->file);
+		free(r);
+		return NULL;
+	}
+	r->time = 0;
+
+	return r;
+}
+
+
+/**
+ * @brief Read the next record
+ *
+ * @param r pointer on reader
+ * @param record variable that stores the record
+ * @param buffer variable that stores the message of a CAPTURE_MESSAGE
+ * @param len len of the buffer
+ * @return int 1 if a record is read, 0 at the end of the capture, -1 on error or if the buffer is too small
+ * @note A record cut by the end of the file (server killed) is the end of the capture.
+ */
+int captureReader_next(CaptureReader *r, CaptureRecord *record, void *buffer, size_t len)
+{
+	uint64_t delta, id, size;
+	int type;
+
+	if((type = fgetc(r->file)) == EOF)
+		return 0;
+	if(type < CAPTURE_CONNECT || type > CAPTURE_DISCONNECT)
+		return -1;
+
+	if(varint_read(r->file, &delta) < 0 || varint_read(r->file, &id) < 0 || varint_read(r->file, &size) < 0)
+		return 0;
+	if(size > len)
+		return -1;
+	if(size > 0 && fread(buffer, 1, size, r->file) != size)
+		return 0;
+
+	r->time += delta;
+	record->type = type;
+	record->id = id;
+	record->time = r->time;
+	record->len = size;
+
+	return 1;
+}
+
+
+/**
+ * @brief Close the reader
+ *
+ * @param r pointer on reader
+ */
+void captureReader_close(CaptureReader *r)
+{
+	fclose(r->file);
+	free(r);
+}
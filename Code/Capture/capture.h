@@ -0,0 +1,125 @@
+/**
+ * @file capture.h
+ * @author Alary Dorian
+ * @brief Capture of the traffic received by the server in a compact binary file, to be replayed
+ * @version 0.1
+ * @date 2022-08-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef __CAPTURE_H__
+#define __CAPTURE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*-----------------------------------------------------------------*/
+
+/* Default values */
+#define CAPTURE_BUFFER (256 * 1024) /* records buffered before a write in the file */
+#define CAPTURE_MAGIC "NCSCAP1" /* first bytes of a capture file, with its terminating 0 */
+
+
+/**
+* @brief 	Opaque definition of type Capture (writer side).
+*/
+typedef struct s_Capture Capture;
+
+
+/**
+* @brief 	Opaque definition of type CaptureReader.
+*/
+typedef struct s_CaptureReader CaptureReader;
+
+
+/**
+* @brief 	Event of a connection.
+*/
+typedef enum e_CaptureType {
+
+	CAPTURE_CONNECT = 1,
+	CAPTURE_MESSAGE = 2,
+	CAPTURE_DISCONNECT = 3
+} CaptureType;
+
+
+/**
+* @brief 	Record read in a capture.
+*/
+typedef struct s_CaptureRecord {
+
+	CaptureType type;
+	int id; /* id of the connection */
+	int64_t time; /* nanoseconds since the first record */
+	size_t len; /* len of the message, 0 for the other events */
+} CaptureRecord;
+
+
+/*-----------------------------------------------------------------*/
+
+
+/**
+ * @brief Create a capture file, an existing file is truncated
+ *
+ * @param path path of the file
+ * @return Capture* pointer on capture, NULL on error
+ */
+Capture *capture_open(const char *path);
+
+
+/**
+ * @brief Record an event of a connection
+ *
+ * @param c pointer on capture, NULL if disabled
+ * @param type type of the event
+ * @param id id of the connection
+ * @param now time of the event in nanoseconds, of a monotonic clock
+ * @param data message of a CAPTURE_MESSAGE, NULL for the other events
+ * @param len len of the message
+ * @note A record is a type, then the time since the last record, the id and the len as varints, then the message.
+ */
+void capture_record(Capture *c, CaptureType type, int id, int64_t now, const void *data, size_t len);
+
+
+/**
+ * @brief Write the records buffered and close the capture
+ *
+ * @param c pointer on capture
+ */
+void capture_close(Capture *c);
+
+
+/*-----------------------------------------------------------------*/
+
+
+/**
+ * @brief Open a capture file to read its records
+ *
+ * @param path path of the file
+ * @return CaptureReader* pointer on reader, NULL if the file is not a capture
+ */
+CaptureReader *captureReader_open(const char *path);
+
+
+/**
+ * @brief Read the next record
+ *
+ * @param r pointer on reader
+ * @param record variable that stores the record
+ * @param buffer variable that stores the message of a CAPTURE_MESSAGE
+ * @param len len of the buffer
+ * @return int 1 if a record is read, 0 at the end of the capture, -1 on error or if the buffer is too small
+ * @note A record cut by the end of the file (server killed) is the end of the capture.
+ */
+int captureReader_next(CaptureReader *r, CaptureRecord *record, void *buffer, size_t len);
+
+
+/**
+ * @brief Close the reader
+ *
+ * @param r pointer on reader
+ */
+void captureReader_close(CaptureReader *r);
+
+#endif
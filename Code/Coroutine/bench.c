@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include "coroutine.h"
+
+/* Benchmark of the coroutines : make bench, then ./bench_coroutine */
+
+#define SWITCHES 1000000 /* co_yield of the switch measure */
+#define HANDLERS 100000 /* coroutines alive at the same time */
+#define PAIRS 1000 /* connections of the echo measure, their two sockets go past FD_SETSIZE */
+#define ROUNDS 1000 /* messages by connection */
+
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+
+static void yielder(void *arg)
+{
+    int i;
+
+    for(i = 0 ; i < *(int *)arg ; i++)
+        co_yield();
+}
+
+
+/* handler of a connection, written as sequential code */
+static void echo(void *arg)
+{
+    int fd = (long)arg;
+    char buffer[64];
+    ssize_t n;
+
+    while((n = co_read(fd, buffer, sizeof(buffer))) > 0)
+        co_write(fd, buffer, n);
+    close(fd);
+}
+
+
+static void ping(void *arg)
+{
+    int fd = (long)arg;
+    char buffer[64];
+    int i;
+
+    for(i = 0 ; i < ROUNDS ; i++)
+    {
+        co_write(fd, "ping", 4);
+        co_read(fd, buffer, sizeof(buffer));
+    }
+    close(fd);
+}
+
+
+int main(void)
+{
+    Scheduler *s = scheduler_create(CO_STACK_SIZE);
+    struct rusage usage;
+    struct rlimit files;
+    int sv[2];
+    int rounds, i, pairs, last = -1;
+    double t;
+
+    /* two coroutines, each co_yield is a switch to the scheduler and a switch back */
+    rounds = SWITCHES;
+    co_spawn(s, yielder, &rounds);
+    co_spawn(s, yielder, &rounds);
+    t = now();
+    while(scheduler_run(s, 0) > 0);
+    printf("co_yield          : %8.2f ns (2 switches)\n", (now() - t) / (2 * SWITCHES));
+
+    /* many small handlers alive together */
+    rounds = 10;
+    t = now();
+    for(i = 0 ; i < HANDLERS && co_spawn(s, yielder, &rounds) != NULL ; i++);
+    printf("co_spawn          : %8.2f ns/op (%d coroutines)\n", (now() - t) / i, i);
+    if(i < HANDLERS)
+        printf("                    two mappings by stack, raise vm.max_map_count for %d coroutines\n", HANDLERS);
+    t = now();
+    while(scheduler_run(s, 0) > 0);
+    printf("co_yield %6d    : %8.2f ns/op\n", i, (now() - t) / ((double)i * (rounds + 1)));
+    getrusage(RUSAGE_SELF, &usage);
+    printf("max rss           : %8ld KB\n", usage.ru_maxrss);
+
+    /* echo over sockets, the coroutines wait in epoll */
+    getrlimit(RLIMIT_NOFILE, &files);
+    files.rlim_cur = files.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &files);
+    for(pairs = 0 ; pairs < PAIRS && socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, sv) == 0 ; pairs++)
+    {
+        co_spawn(s, echo, (void *)(long)sv[0]);
+        co_spawn(s, ping, (void *)(long)sv[1]);
+        last = sv[1];
+    }
+    t = now();
+    while(scheduler_run(s, -1) > 0);
+    printf("echo round trip   : %8.2f ns/op (%d connections, last fd %d)\n", (now() - t) / ((double)pairs * ROUNDS), pairs, last);
+
+    scheduler_delete(s);
+
+    return 0;
+}
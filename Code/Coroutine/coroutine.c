@@ -0,0 +1,613 @@
+/**
+ * @file coroutine.c
+ * @author Alary Dorian
+ * @brief Stackful coroutines driven by epoll, one by connection
+ * @version 0.1
+ * @date 2022-08-05
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/epoll.h>
+#include "coroutine.h"
+
+/*
+	A coroutine runs on its own stack until it waits or yields, then the scheduler gets the hand back.
+	The switch only saves the callee-saved registers and the stack pointer (x86-64),
+	other architectures use swapcontext, which also saves the signal mask with a system call.
+	A finished coroutine keeps its stack in a pool, so a new connection does not call mmap.
+*/
+
+#if defined(__x86_64__)
+
+typedef struct s_Context {
+
+	void *sp; /* stack pointer saved, the registers are pushed on the stack */
+} Context;
+
+/* save the registers of from on its stack, then restore the ones of to */
+void coroutine_switch(void **from, void *to);
+
+__asm__(
+	".text\n"
+	".globl coroutine_switch\n"
+	".hidden coroutine_switch\n"
+	".type coroutine_switch, @function\n"
+	"coroutine_switch:\n"
+	"	pushq %rbp\n"
+	"	pushq %rbx\n"
+	"	pushq %r12\n"
+	"	pushq %r13\n"
+	"	pushq %r14\n"
+	"	pushq %r15\n"
+	"	movq %rsp, (%rdi)\n"
+	"	movq %rsi, %rsp\n"
+	"	popq %r15\n"
+	"	popq %r14\n"
+	"	popq %r13\n"
+	"	popq %r12\n"
+	"	popq %rbx\n"
+	"	popq %rbp\n"
+	"	ret\n"
+	".size coroutine_switch, .-coroutine_switch\n"
+);
+
+#else
+
+#include <ucontext.h>
+
+typedef struct s_Context {
+
+	ucontext_t uc;
+} Context;
+
+#endif
+
+
+struct s_Coroutine {
+
+	Context context;
+	char *stack; /* mapping of the stack, the guard page first */
+	CoroutineFunctor f;
+	void *arg;
+	bool done;
+	Coroutine *next; /* link in the ready queue or in the pool */
+};
+
+
+struct s_Scheduler {
+
+	Context context; /* context of the thread which calls scheduler_run */
+	size_t stack_size;
+	size_t page;
+	Coroutine *current; /* coroutine running, NULL in the scheduler */
+	Coroutine *head, *tail; /* ready queue */
+	Coroutine *pool; /* coroutines finished, with their stack */
+	int pooled;
+	Coroutine **readers; /* coroutine waiting to read, by fd */
+	Coroutine **writers; /* coroutine waiting to write, by fd */
+	bool *registered; /* fd added to epoll, by fd */
+	int capacity; /* size of readers, writers and registered */
+	int epoll; /* sockets waited, any fd number */
+	int waiting; /* coroutines waiting for a socket */
+	int alive;
+};
+
+
+/* Scheduler running a coroutine on this thread, NULL outside of a coroutine */
+static __thread Scheduler *running = NULL;
+
+/*-----------------------------------------------------------------*/
+
+/**
+ * @brief First function of a coroutine, it executes the functor then goes back to the scheduler
+ *
+ */
+static void co_entry(void);
+
+
+#if defined(__x86_64__)
+
+/**
+ * @brief Prepare the context of a new coroutine : coroutine_switch returns in co_entry
+ *
+ * @param c pointer on context
+ * @param stack lowest address of the stack
+ * @param size size of the stack
+ */
+static void context_init(Context *c, char *stack, size_t size)
+{
+	void **sp = (void **)(((uintptr_t)stack + size) & ~(uintptr_t)15);
+	int i;
+
+	*--sp = NULL; /* return address of co_entry, which never returns : the stack is aligned as after a call */
+	*--sp = (void *)co_entry;
+	for(i = 0 ; i < 6 ; i++)
+		*--sp = NULL; /* rbp, rbx, r12 to r15 */
+	c->sp = sp;
+}
+
+
+/**
+ * @brief Save the current context in from and resume to
+ *
+ * @param from variable that stores the current context
+ * @param to context resumed
+ */
+static inline void context_switch(Context *from, Context *to)
+{
+	coroutine_switch(&from->sp, to->sp);
+}
+
+#else
+
+static void context_init(Context *c, char *stack, size_t size)
+{
+	getcontext(&c->uc);
+	c->uc.uc_stack.ss_sp = stack;
+	c->uc.uc_stack.ss_size = size;
+	c->uc.uc_link = NULL;
+	makecontext(&c->uc, co_entry, 0);
+}
+
+
+static inline void context_switch(Context *from, Context *to)
+{
+	swapcontext(&from->uc, &to->uc);
+}
+
+#endif
+
+
+static void co_entry(void)
+{
+	Scheduler *s = running;
+	Coroutine *c = s->current;
+
+	c->f(c->arg);
+	c->done = true;
+	context_switch(&c->context, &s->context);
+
+	/* a finished coroutine is never resumed */
+	abort();
+}
+
+
+/**
+ * @brief Append a coroutine to the ready queue
+ *
+ * @param s pointer on scheduler
+ * @param c pointer on coroutine
+ */
+static void ready_push(Scheduler *s, Coroutine *c)
+{
+	c->next = NULL;
+	if(s->tail != NULL)
+		s->tail->next = c;
+	else
+		s->head = c;
+	s->tail = c;
+}
+
+
+/**
+ * @brief Free a coroutine and unmap its stack
+ *
+ * @param s pointer on scheduler
+ * @param c pointer on coroutine
+ */
+static void co_destroy(Scheduler *s, Coroutine *c)
+{
+	munmap(c->stack, s->page + s->stack_size);
+	free(c);
+}
+
+
+/**
+ * @brief Resume a coroutine until it waits, yields or ends
+ *
+ * @param s pointer on scheduler
+ * @param c pointer on coroutine
+ */
+static void co_resume(Scheduler *s, Coroutine *c)
+{
+	Scheduler *previous = running;
+
+	running = s;
+	s->current = c;
+	context_switch(&s->context, &c->context);
+	s->current = NULL;
+	running = previous;
+
+	if(!c->done)
+		return;
+
+	s->alive--;
+	if(s->pooled < CO_STACK_POOL)
+	{
+		c->next = s->pool;
+		s->pool = c;
+		s->pooled++;
+	}
+	else
+	{
+		co_destroy(s, c);
+	}
+}
+
+
+/**
+ * @brief Register in epoll the directions waited on fd, for one event
+ *
+ * @param s pointer on scheduler
+ * @param fd file descriptor
+ * @return int 0 on success, -1 if epoll can not watch fd (a regular file)
+ */
+static int fd_arm(Scheduler *s, int fd)
+{
+	struct epoll_event ev;
+
+	ev.events = EPOLLONESHOT | ((s->readers[fd] != NULL) ? EPOLLIN : 0) | ((s->writers[fd] != NULL) ? EPOLLOUT : 0);
+	ev.data.fd = fd;
+
+	/* a closed fd leaves epoll, its number may come back with another socket */
+	if(s->registered[fd] && epoll_ctl(s->epoll, EPOLL_CTL_MOD, fd, &ev) == 0)
+		return 0;
+	if(epoll_ctl(s->epoll, EPOLL_CTL_ADD, fd, &ev) < 0 && (errno != EEXIST || epoll_ctl(s->epoll, EPOLL_CTL_MOD, fd, &ev) < 0))
+		return -1;
+	s->registered[fd] = true;
+
+	return 0;
+}
+
+
+/**
+ * @brief Suspend the current coroutine until fd is ready
+ *
+ * @param s scheduler of the coroutine
+ * @param fd file descriptor
+ * @param write true to wait until fd is writable, false until it is readable
+ * @return int 0 when fd is ready, -1 if epoll can not watch fd
+ */
+static int co_wait(Scheduler *s, int fd, bool write)
+{
+	Coroutine *c = s->current;
+	Coroutine **waiter = write ? &s->writers[fd] : &s->readers[fd];
+	int capacity = s->capacity;
+
+	if(fd >= capacity)
+	{
+		while(capacity <= fd)
+			capacity *= 2;
+		s->readers = realloc(s->readers, capacity * sizeof(Coroutine *));
+		s->writers = realloc(s->writers, capacity * sizeof(Coroutine *));
+		s->registered = realloc(s->registered, capacity * sizeof(bool));
+		memset(s->readers + s->capacity, 0, (capacity - s->capacity) * sizeof(Coroutine *));
+		memset(s->writers + s->capacity, 0, (capacity - s->capacity) * sizeof(Coroutine *));
+		memset(s->registered + s->capacity, 0, (capacity - s->capacity) * sizeof(bool));
+		s->capacity = capacity;
+		waiter = write ? &s->writers[fd] : &s->readers[fd];
+	}
+
+	*waiter = c;
+	if(fd_arm(s, fd) < 0)
+	{
+		*waiter = NULL;
+		return -1;
+	}
+	s->waiting++;
+
+	context_switch(&c->context, &s->context);
+
+	return 0;
+}
+
+
+/**
+ * @brief Wait until fd is ready : in the scheduler in a coroutine, in poll outside
+ *
+ * @param fd file descriptor
+ * @param write true to wait until fd is writable, false until it is readable
+ * @return int 0 when fd is ready, -1 if it can not be waited
+ */
+static int wait_fd(int fd, bool write)
+{
+	struct pollfd pfd = { fd, write ? POLLOUT : POLLIN, 0 };
+
+	if(running != NULL && running->current != NULL)
+		return co_wait(running, fd, write);
+
+	return (poll(&pfd, 1, -1) < 0 && errno != EINTR) ? -1 : 0;
+}
+
+/*-----------------------------------------------------------------*/
+
+/**
+ * @brief Create a scheduler
+ *
+ * @param stack_size size of the stack of each coroutine, rounded up to a page
+ * @return Scheduler* pointer on scheduler
+ */
+Scheduler *scheduler_create(size_t stack_size)
+{
+	Scheduler *s = malloc(sizeof(Scheduler));
+
+	s->page = sysconf(_SC_PAGESIZE);
+	s->stack_size = (stack_size + s->page - 1) / s->page * s->page;
+	s->current = NULL;
+	s->head = NULL;
+	s->tail = NULL;
+	s->pool = NULL;
+	s->pooled = 0;
+	s->capacity = 64;
+	s->readers = calloc(s->capacity, sizeof(Coroutine *));
+	s->writers = calloc(s->capacity, sizeof(Coroutine *));
+	s->registered = calloc(s->capacity, sizeof(bool));
+	s->epoll = epoll_create1(EPOLL_CLOEXEC);
+	s->waiting = 0;
+	s->alive = 0;
+
+	return s;
+}
+
+
+/**
+ * @brief Create a coroutine, it starts at the next scheduler_run
+ *
+ * @param s pointer on scheduler
+ * @param f functor executed by the coroutine
+ * @param arg argument of the functor
+ * @return Coroutine* pointer on coroutine, NULL if no stack can be allocated
+ * @note A stack with its guard page is two mappings : 100k coroutines need a vm.max_map_count over 200k.
+ */
+Coroutine *co_spawn(Scheduler *s, CoroutineFunctor f, void *arg)
+{
+	Coroutine *c = s->pool;
+
+	if(c != NULL)
+	{
+		s->pool = c->next;
+		s->pooled--;
+	}
+	else
+	{
+		c = malloc(sizeof(Coroutine));
+
+		/* the pages are given by the kernel when the coroutine touches them */
+		c->stack = mmap(NULL, s->page + s->stack_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+		if(c->stack == MAP_FAILED)
+		{
+			free(c);
+			return NULL;
+		}
+
+		/* an overflow faults on the guard page instead of writing in another stack,
+		   each guard page costs a mapping : see vm.max_map_count */
+		if(mprotect(c->stack, s->page, PROT_NONE) < 0)
+		{
+			co_destroy(s, c);
+			return NULL;
+		}
+	}
+
+	c->f = f;
+	c->arg = arg;
+	c->done = false;
+	context_init(&c->context, c->stack + s->page, s->stack_size);
+	ready_push(s, c);
+	s->alive++;
+
+	return c;
+}
+
+
+/**
+ * @brief Give the epoll of the sockets on which coroutines wait, to watch the scheduler from another loop
+ *
+ * @param s pointer on scheduler
+ * @return int file descriptor, readable when a coroutine waiting for a socket can be resumed
+ */
+int scheduler_fd(Scheduler *s)
+{
+	return s->epoll;
+}
+
+
+/**
+ * @brief Tell if coroutines can run without waiting : scheduler_run does not block
+ *
+ * @param s pointer on scheduler
+ * @return true coroutines are ready
+ * @return false every coroutine waits for a socket
+ */
+bool scheduler_ready(Scheduler *s)
+{
+	return s->head != NULL;
+}
+
+
+/**
+ * @brief Resume the coroutines whose socket is ready, and the coroutines which yielded
+ *
+ * @param s pointer on scheduler
+ * @param timeout milliseconds to wait for a socket when no coroutine is ready, -1 to block, 0 to only look
+ * @return int number of coroutines alive
+ */
+int scheduler_run(Scheduler *s, int timeout)
+{
+	struct epoll_event events[CO_EVENTS];
+	Coroutine *c, *last;
+	int count, i, fd;
+
+	/* no system call while every coroutine only yields */
+	if(s->waiting > 0)
+	{
+		count = epoll_wait(s->epoll, events, CO_EVENTS, (s->head != NULL) ? 0 : timeout);
+		for(i = 0 ; i < count ; i++)
+		{
+			/* an error or a hang up is seen by the read or the write */
+			fd = events[i].data.fd;
+			if(s->readers[fd] != NULL && (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)))
+			{
+				ready_push(s, s->readers[fd]);
+				s->readers[fd] = NULL;
+				s->waiting--;
+			}
+			if(s->writers[fd] != NULL && (events[i].events & (EPOLLOUT | EPOLLERR | EPOLLHUP)))
+			{
+				ready_push(s, s->writers[fd]);
+				s->writers[fd] = NULL;
+				s->waiting--;
+			}
+
+			/* one event by registration : the other direction is waited again */
+			if(s->readers[fd] != NULL || s->writers[fd] != NULL)
+				fd_arm(s, fd);
+		}
+	}
+
+	/* the coroutines which yield now run at the next call, after epoll_wait */
+	last = s->tail;
+	while(s->head != NULL)
+	{
+		c = s->head;
+		s->head = c->next;
+		if(s->head == NULL)
+			s->tail = NULL;
+
+		co_resume(s, c);
+		if(c == last)
+			break;
+	}
+
+	return s->alive;
+}
+
+
+/**
+ * @brief Delete the scheduler, the coroutines not finished are destroyed without being resumed
+ *
+ * @param s pointer on scheduler
+ */
+void scheduler_delete(Scheduler *s)
+{
+	Coroutine *c;
+	int fd;
+
+	while((c = s->head) != NULL)
+	{
+		s->head = c->next;
+		co_destroy(s, c);
+	}
+	while((c = s->pool) != NULL)
+	{
+		s->pool = c->next;
+		co_destroy(s, c);
+	}
+	for(fd = 0 ; fd < s->capacity ; fd++)
+	{
+		if(s->readers[fd] != NULL)
+			co_destroy(s, s->readers[fd]);
+		if(s->writers[fd] != NULL)
+			co_destroy(s, s->writers[fd]);
+	}
+
+	close(s->epoll);
+	free(s->readers);
+	free(s->writers);
+	free(s->registered);
+	free(s);
+}
+
+
+/**
+ * @brief Read data, the coroutine waits in the scheduler while nothing is ready
+ *
+ * @param fd non-blocking file descriptor
+ * @param buffer variable that stores the data
+ * @param len size of the buffer
+ * @return ssize_t number of bytes read, 0 at the end of the stream, -1 on error or if epoll can not watch fd
+ * @note Called outside of a coroutine, the thread waits in poll.
+ */
+ssize_t co_read(int fd, void *buffer, size_t len)
+{
+	ssize_t n;
+
+	while((n = read(fd, buffer, len)) < 0)
+	{
+		if(errno == EAGAIN || errno == EWOULDBLOCK)
+		{
+			if(wait_fd(fd, false) < 0)
+				return -1;
+		}
+		else if(errno != EINTR)
+		{
+			return -1;
+		}
+	}
+
+	return n;
+}
+
+
+/**
+ * @brief Write the whole data, the coroutine waits in the scheduler while the socket is full
+ *
+ * @param fd non-blocking file descriptor
+ * @param buffer data to write
+ * @param len len of the data
+ * @return ssize_t len, -1 on error or if epoll can not watch fd
+ * @note Called outside of a coroutine, the thread waits in poll.
+ */
+ssize_t co_write(int fd, const void *buffer, size_t len)
+{
+	const char *data = buffer;
+	size_t left = len;
+	ssize_t n;
+
+	while(left > 0)
+	{
+		if((n = write(fd, data, left)) < 0)
+		{
+			if(errno == EAGAIN || errno == EWOULDBLOCK)
+			{
+				if(wait_fd(fd, true) < 0)
+					return -1;
+			}
+			else if(errno != EINTR)
+			{
+				return -1;
+			}
+			continue;
+		}
+		data += n;
+		left -= n;
+	}
+
+	return len;
+}
+
+
+/**
+ * @brief Give the hand to the other coroutines, the coroutine is resumed at the next scheduler_run
+ *
+ */
+void co_yield(void)
+{
+	Scheduler *s = running;
+	Coroutine *c;
+
+	if(s == NULL || (c = s->current) == NULL)
+		return;
+
+	ready_push(s, c);
+	context_switch(&c->context, &s->context);
+}
@@ -0,0 +1,136 @@
+/**
+ * @file coroutine.h
+ * @author Alary Dorian
+ * @brief Stackful coroutines driven by epoll, one by connection
+ * @version 0.1
+ * @date 2022-08-05
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef __COROUTINE_H__
+#define __COROUTINE_H__
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+/*-----------------------------------------------------------------*/
+
+/* Default values */
+#define CO_STACK_SIZE (16 * 1024) /* stack of a coroutine, a guard page is added below it */
+#define CO_STACK_POOL 1024 /* stacks of finished coroutines kept to be reused */
+#define CO_EVENTS 64 /* events read by one epoll_wait */
+
+
+/**
+* @brief 	Opaque definition of type Scheduler : the coroutines of one thread.
+*/
+typedef struct s_Scheduler Scheduler;
+
+
+/**
+* @brief 	Opaque definition of type Coroutine.
+*/
+typedef struct s_Coroutine Coroutine;
+
+
+/**
+* @brief 	Functor executed by a coroutine, the coroutine ends when it returns.
+* @param	(void*) Opaque pointer to user provided data
+*/
+typedef void (*CoroutineFunctor)(void *);
+
+
+/*-----------------------------------------------------------------*/
+
+
+/**
+ * @brief Create a scheduler
+ *
+ * @param stack_size size of the stack of each coroutine, rounded up to a page
+ * @return Scheduler* pointer on scheduler
+ */
+Scheduler *scheduler_create(size_t stack_size);
+
+
+/**
+ * @brief Create a coroutine, it starts at the next scheduler_run
+ *
+ * @param s pointer on scheduler
+ * @param f functor executed by the coroutine
+ * @param arg argument of the functor
+ * @return Coroutine* pointer on coroutine, NULL if no stack can be allocated
+ * @note A stack with its guard page is two mappings : 100k coroutines need a vm.max_map_count over 200k.
+ */
+Coroutine *co_spawn(Scheduler *s, CoroutineFunctor f, void *arg);
+
+
+/**
+ * @brief Give the epoll of the sockets on which coroutines wait, to watch the scheduler from another loop
+ *
+ * @param s pointer on scheduler
+ * @return int file descriptor, readable when a coroutine waiting for a socket can be resumed
+ */
+int scheduler_fd(Scheduler *s);
+
+
+/**
+ * @brief Tell if coroutines can run without waiting : scheduler_run does not block
+ *
+ * @param s pointer on scheduler
+ * @return true coroutines are ready
+ * @return false every coroutine waits for a socket
+ */
+bool scheduler_ready(Scheduler *s);
+
+
+/**
+ * @brief Resume the coroutines whose socket is ready, and the coroutines which yielded
+ *
+ * @param s pointer on scheduler
+ * @param timeout milliseconds to wait for a socket when no coroutine is ready, -1 to block, 0 to only look
+ * @return int number of coroutines alive
+ */
+int scheduler_run(Scheduler *s, int timeout);
+
+
+/**
+ * @brief Delete the scheduler, the coroutines not finished are destroyed without being resumed
+ *
+ * @param s pointer on scheduler
+ */
+void scheduler_delete(Scheduler *s);
+
+
+/**
+ * @brief Read data, the coroutine waits in the scheduler while nothing is ready
+ *
+ * @param fd non-blocking file descriptor
+ * @param buffer variable that stores the data
+ * @param len size of the buffer
+ * @return ssize_t number of bytes read, 0 at the end of the stream, -1 on error or if epoll can not watch fd
+ * @note Called outside of a coroutine, the thread waits in poll.
+ */
+ssize_t co_read(int fd, void *buffer, size_t len);
+
+
+/**
+ * @brief Write the whole data, the coroutine waits in the scheduler while the socket is full
+ *
+ * @param fd non-blocking file descriptor
+ * @param buffer data to write
+ * @param len len of the data
+ * @return ssize_t len, -1 on error or if epoll can not watch fd
+ * @note Called outside of a coroutine, the thread waits in poll.
+ */
+ssize_t co_write(int fd, const void *buffer, size_t len);
+
+
+/**
+ * @brief Give the hand to the other coroutines, the coroutine is resumed at the next scheduler_run
+ *
+ */
+void co_yield(void);
+
+#endif
@@ -0,0 +1,226 @@
+/**
+ * @file handoff.c
+ * @author Alary Dorian
+ * @brief Transfer of file descriptors between two processes, over a UNIX socket (SCM_RIGHTS)
+ * @version 0.1
+ * @date 2022-07-25
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#define _GNU_SOURCE /* struct ucred */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include "handoff.h"
+
+/*
+	The sockets of the clients and the session key go through the UNIX socket :
+	only the user of the server may connect to it, and each side checks the user of the other one.
+*/
+
+
+/**
+ * @brief Fill the address of the UNIX socket path
+ *
+ * @param addr variable that stores the address
+ * @param path path of the UNIX socket
+ * @return int 0 on success, -1 if path is too long
+ */
+static int handoff_address(struct sockaddr_un *addr, const char *path)
+{
+	if(strlen(path) >= sizeof(addr->sun_path))
+		return -1;
+
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+	strcpy(addr->sun_path, path);
+
+	return 0;
+}
+
+
+/**
+ * @brief Look if the process at the other end of a UNIX socket runs as the same user
+ *
+ * @param sock connected UNIX socket
+ * @return true if the peer has the effective uid of the process
+ */
+static bool handoff_trusted(int sock)
+{
+	struct ucred cred;
+	socklen_t len = sizeof(cred);
+
+	if(getsockopt(sock, SOL_SOCKET, SO_PEERCRED, &cred, &len) < 0)
+		return false;
+
+	return cred.uid == geteuid();
+}
+
+
+/**
+ * @brief Listen on the UNIX socket path, an old file at path is removed
+ *
+ * @param path path of the UNIX socket
+ * @return int FD of socket, -1 on error
+ * @note The socket is readable and writable by its owner only.
+ */
+int handoff_listen(const char *path)
+{
+	struct sockaddr_un addr;
+	int sock;
+
+	if(handoff_address(&addr, path) < 0 || (sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0)
+		return -1;
+
+	unlink(path);
+	if(bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0 || chmod(path, 0600) < 0 || listen(sock, 1) < 0)
+	{
+		close(sock);
+		return -1;
+	}
+
+	return sock;
+}
+
+
+/**
+ * @brief Accept the connection of a new process on the UNIX socket
+ *
+ * @param sock UNIX socket which listens
+ * @return int FD of the connection, -1 on error or if the process does not run as the same user
+ */
+int handoff_accept(int sock)
+{
+	int new_sock = accept4(sock, NULL, NULL, SOCK_CLOEXEC);
+
+	if(new_sock < 0)
+		return -1;
+	if(!handoff_trusted(new_sock))
+	{
+		close(new_sock);
+		return -1;
+	}
+
+	return new_sock;
+}
+
+
+/**
+ * @brief Connect to the process which listens on the UNIX socket path
+ *
+ * @param path path of the UNIX socket
+ * @return int FD of socket, -1 if no process listens on path or if it does not run as the same user
+ */
+int handoff_connect(const char *path)
+{
+	struct sockaddr_un addr;
+	int sock;
+
+	if(handoff_address(&addr, path) < 0 || (sock = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0)
+		return -1;
+
+	if(connect(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0 || !handoff_trusted(sock))
+	{
+		close(sock);
+		return -1;
+	}
+
+	return sock;
+}
+
+
+/**
+ * @brief Send a message with file descriptors
+ *
+ * @param sock UNIX socket
+ * @param data message
+ * @param len len of the message, greater than 0
+ * @param fds file descriptors to send, they stay open in the sender
+ * @param count number of file descriptors, less than or equal to HANDOFF_MAX_FDS
+ * @return int 0 on success, -1 on error
+ */
+int handoff_send(int sock, const void *data, size_t len, const int *fds, int count)
+{
+	union {
+		char buffer[CMSG_SPACE(HANDOFF_MAX_FDS * sizeof(int))];
+		struct cmsghdr align;
+	} control;
+	struct iovec iov = { (void *)data, len };
+	struct msghdr msg;
+	struct cmsghdr *cmsg;
+	ssize_t n;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+
+	if(count > 0)
+	{
+		msg.msg_control = control.buffer;
+		msg.msg_controllen = CMSG_SPACE(count * sizeof(int));
+		cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(count * sizeof(int));
+		memcpy(CMSG_DATA(cmsg), fds, count * sizeof(int));
+	}
+
+	while((n = sendmsg(sock, &msg, MSG_NOSIGNAL)) < 0 && errno == EINTR);
+
+	return (n == (ssize_t)len) ? 0 : -1;
+}
+
+
+/**
+ * @brief Receive a message with file descriptors
+ *
+ * @param sock UNIX socket
+ * @param data variable that stores the message
+ * @param len len of the message expected
+ * @param fds variable that stores the file descriptors, HANDOFF_MAX_FDS elements
+ * @param count variable that stores the number of file descriptors received
+ * @return int len of the message, 0 if the sender is closed, -1 on error
+ */
+int handoff_recv(int sock, void *data, size_t len, int *fds, int *count)
+{
+	union {
+		char buffer[CMSG_SPACE(HANDOFF_MAX_FDS * sizeof(int))];
+		struct cmsghdr align;
+	} control;
+	struct iovec iov = { data, len };
+	struct msghdr msg;
+	struct cmsghdr *cmsg;
+	ssize_t n;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control.buffer;
+	msg.msg_controllen = sizeof(control.buffer);
+
+	/* the file descriptors come with the first byte of the message, the rest may follow */
+	while((n = recvmsg(sock, &msg, MSG_CMSG_CLOEXEC | MSG_WAITALL)) < 0 && errno == EINTR);
+	if(n <= 0)
+		return n;
+
+	*count = 0;
+	for(cmsg = CMSG_FIRSTHDR(&msg) ; cmsg != NULL ; cmsg = CMSG_NXTHDR(&msg, cmsg))
+	{
+		if(cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+		{
+			*count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+			memcpy(fds, CMSG_DATA(cmsg), *count * sizeof(int));
+		}
+	}
+
+	return (msg.msg_flags & MSG_CTRUNC) ? -1 : n;
+}
@@ -0,0 +1,78 @@
+/**
+ * @file handoff.h
+ * @author Alary Dorian
+ * @brief Transfer of file descriptors between two processes, over a UNIX socket (SCM_RIGHTS)
+ * @version 0.1
+ * @date 2022-07-25
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef __HANDOFF_H__
+#define __HANDOFF_H__
+
+#include <stddef.h>
+
+/*-----------------------------------------------------------------*/
+
+/* Values */
+#define HANDOFF_MAX_FDS 250 /* file descriptors sent by one message, less than SCM_MAX_FD */
+
+
+/*-----------------------------------------------------------------*/
+
+
+/**
+ * @brief Listen on the UNIX socket path, an old file at path is removed
+ *
+ * @param path path of the UNIX socket
+ * @return int FD of socket, -1 on error
+ * @note The socket is readable and writable by its owner only.
+ */
+int handoff_listen(const char *path);
+
+
+/**
+ * @brief Accept the connection of a new process on the UNIX socket
+ *
+ * @param sock UNIX socket which listens
+ * @return int FD of the connection, -1 on error or if the process does not run as the same user
+ */
+int handoff_accept(int sock);
+
+
+/**
+ * @brief Connect to the process which listens on the UNIX socket path
+ *
+ * @param path path of the UNIX socket
+ * @return int FD of socket, -1 if no process listens on path or if it does not run as the same user
+ */
+int handoff_connect(const char *path);
+
+
+/**
+ * @brief Send a message with file descriptors
+ *
+ * @param sock UNIX socket
+ * @param data message
+ * @param len len of the message, greater than 0
+ * @param fds file descriptors to send, they stay open in the sender
+ * @param count number of file descriptors, less than or equal to HANDOFF_MAX_FDS
+ * @return int 0 on success, -1 on error
+ */
+int handoff_send(int sock, const void *data, size_t len, const int *fds, int count);
+
+
+/**
+ * @brief Receive a message with file descriptors
+ *
+ * @param sock UNIX socket
+ * @param data variable that stores the message
+ * @param len len of the message expected
+ * @param fds variable that stores the file descriptors, HANDOFF_MAX_FDS elements
+ * @param count variable that stores the number of file descriptors received
+ * @return int len of the message, 0 if the sender is closed, -1 on error
+ */
+int handoff_recv(int sock, void *data, size_t len, int *fds, int *count);
+
+#endif
@@ -0,0 +1,212 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include "heap.h"
+
+/*
+   Timers : make bench, then ./bench_heap [timers].
+   "hold" pops the earliest deadline and pushes a later one, the size of the heap does not change.
+   "decrease" brings deadlines forward : the pairing heap moves them, the d-ary heap pushes them again
+   and skips the old ones when they come out (lazy deletion).
+*/
+
+#define TIMERS 100000 /* timers in the heap */
+#define OPERATIONS 2000000 /* operations by run */
+#define SPAN 1000000 /* deadlines are drawn in [now, now + SPAN[ */
+
+typedef struct {
+    int64_t deadline;
+    int64_t stamp; /* for the d-ary heap : deadline of the last push, an older copy is skipped */
+} Timer;
+
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+
+static int earliest(const void *a, const void *b)
+{
+    int64_t x = ((const Timer *)a)->deadline, y = ((const Timer *)b)->deadline;
+    return (x > y) - (x < y);
+}
+
+
+/* a value of the d-ary heap is a copy of a deadline with its timer, it may be out of date */
+typedef struct {
+    int64_t deadline;
+    Timer *timer;
+} Entry;
+
+
+static int earliestEntry(const void *a, const void *b)
+{
+    int64_t x = ((const Entry *)a)->deadline, y = ((const Entry *)b)->deadline;
+    return (x > y) - (x < y);
+}
+
+
+static Entry *entry(Timer *t)
+{
+    Entry *e = malloc(sizeof(Entry));
+    e->deadline = t->stamp = t->deadline;
+    e->timer = t;
+    return e;
+}
+
+
+static void holdHeap(Timer *timers, int n, int ops)
+{
+    Heap *h = heap_create(earliest);
+    Timer *t;
+    int64_t last = 0;
+    double start;
+    int i;
+
+    for(i = 0 ; i < n ; i++)
+        heap_push(h, &timers[i]);
+
+    start = now();
+    for(i = 0 ; i < ops ; i++)
+    {
+        t = heap_pop(h);
+        if(t->deadline < last)
+            fprintf(stderr, "Error : heap order\n");
+        last = t->deadline;
+        t->deadline += 1 + rand() % SPAN;
+        heap_push(h, t);
+    }
+    printf("hold      d-ary    %6.1f ns/op\n", (now() - start) / ops);
+    heap_delete(h);
+}
+
+
+static void holdPairing(Timer *timers, int n, int ops)
+{
+    PairingHeap *h = pairing_create(earliest);
+    Timer *t;
+    int64_t last = 0;
+    double start;
+    int i;
+
+    for(i = 0 ; i < n ; i++)
+        pairing_push(h, &timers[i]);
+
+    start = now();
+    for(i = 0 ; i < ops ; i++)
+    {
+        t = pairing_pop(h);
+        if(t->deadline < last)
+            fprintf(stderr, "Error : pairing order\n");
+        last = t->deadline;
+        t->deadline += 1 + rand() % SPAN;
+        pairing_push(h, t);
+    }
+    printf("hold      pairing  %6.1f ns/op\n", (now() - start) / ops);
+    pairing_delete(h);
+}
+
+
+/* one operation : a deadline brought forward, and one timer out of three fired */
+static void decreaseHeap(Timer *timers, int n, int ops)
+{
+    Heap *h = heap_create(earliestEntry);
+    Entry *e;
+    Timer *t;
+    double start;
+    int i;
+
+    for(i = 0 ; i < n ; i++)
+        heap_push(h, entry(&timers[i]));
+
+    start = now();
+    for(i = 0 ; i < ops ; i++)
+    {
+        t = &timers[rand() % n];
+        t->deadline -= rand() % (t->deadline / 2 + 1);
+        heap_push(h, entry(t));
+
+        if(i % 3 == 0)
+        {
+            /* the copies out of date come out before the timer, they are freed on the way */
+            for(e = heap_pop(h) ; e->deadline != e->timer->stamp ; e = heap_pop(h))
+                free(e);
+            t = e->timer;
+            free(e);
+            t->deadline += SPAN;
+            heap_push(h, entry(t));
+        }
+    }
+    printf("decrease  d-ary    %6.1f ns/op, %zu values for %d timers\n", (now() - start) / ops, heap_size(h), n);
+
+    while(!heap_empty(h))
+        free(heap_pop(h));
+    heap_delete(h);
+}
+
+
+static void decreasePairing(Timer *timers, int n, int ops)
+{
+    PairingHeap *h = pairing_create(earliest);
+    PairingNode **nodes = malloc(n * sizeof(PairingNode *));
+    Timer *t;
+    double start;
+    int i, k;
+
+    for(i = 0 ; i < n ; i++)
+        nodes[i] = pairing_push(h, &timers[i]);
+
+    start = now();
+    for(i = 0 ; i < ops ; i++)
+    {
+        k = rand() % n;
+        t = &timers[k];
+        t->deadline -= rand() % (t->deadline / 2 + 1);
+        pairing_decrease(h, nodes[k]);
+
+        if(i % 3 == 0)
+        {
+            t = pairing_pop(h);
+            t->deadline += SPAN;
+            nodes[t - timers] = pairing_push(h, t);
+        }
+    }
+    printf("decrease  pairing  %6.1f ns/op, %zu values for %d timers\n", (now() - start) / ops, pairing_size(h), n);
+
+    pairing_delete(h);
+    free(nodes);
+}
+
+
+static void draw(Timer *timers, int n)
+{
+    int i;
+
+    srand(1);
+    for(i = 0 ; i < n ; i++)
+        timers[i].deadline = rand() % SPAN;
+}
+
+
+int main(int argc, char *argv[])
+{
+    int n = (argc > 1) ? atoi(argv[1]) : TIMERS;
+    Timer *timers = malloc(n * sizeof(Timer));
+
+    printf("%d timers, %d operations, arity %d\n", n, OPERATIONS, HEAP_ARITY);
+    draw(timers, n);
+    holdHeap(timers, n, OPERATIONS);
+    draw(timers, n);
+    holdPairing(timers, n, OPERATIONS);
+    draw(timers, n);
+    decreaseHeap(timers, n, OPERATIONS);
+    draw(timers, n);
+    decreasePairing(timers, n, OPERATIONS);
+
+    free(timers);
+    return 0;
+}
@@ -0,0 +1,178 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "heap.h"
+
+/*
+   Behaviour of the heaps : make check, or
+      gcc -o check_heap Heap/check.c Heap/heap.c && ./check_heap
+   Random operations are done on a heap and on a plain array searched in full, both must give the same values.
+   The program ends with 1 if a check fails.
+*/
+
+#define ITEMS 1000 /* values which can be in a heap */
+#define OPERATIONS 200000
+#define KEYS 1000 /* keys are drawn in [0, KEYS[, with ties */
+
+#define CHECK(cond) do { if(!(cond)) { fprintf(stderr, "Error : %s:%d : %s\n", __FILE__, __LINE__, #cond); failures++; } } while(0)
+
+static int failures = 0;
+
+
+typedef struct s_Item {
+
+    int key;
+    bool in; /* the item is in the heap */
+    PairingNode *node; /* its handle in the pairing heap */
+} Item;
+
+
+static int order(const void *a, const void *b)
+{
+    return ((const Item *)a)->key - ((const Item *)b)->key;
+}
+
+
+/* the reference : the smallest key of the items in the heap, -1 if none */
+static int smallest(const Item *items)
+{
+    int i, key = -1;
+
+    for(i = 0 ; i < ITEMS ; i++)
+    {
+        if(items[i].in && (key < 0 || items[i].key < key))
+            key = items[i].key;
+    }
+    return key;
+}
+
+
+/* an item in the heap, or out of it, drawn at random, NULL if there is none */
+static Item *draw(Item *items, bool in)
+{
+    int i, start = rand() % ITEMS;
+
+    for(i = 0 ; i < ITEMS ; i++)
+    {
+        if(items[(start + i) % ITEMS].in == in)
+            return &items[(start + i) % ITEMS];
+    }
+    return NULL;
+}
+
+
+/* push, pop, decrease and remove anywhere */
+static void check_pairing(void)
+{
+    static Item items[ITEMS];
+    PairingHeap *h = pairing_create(order);
+    Item *item;
+    size_t size = 0;
+    int i;
+
+    srand(2);
+    for(i = 0 ; i < OPERATIONS ; i++)
+    {
+        switch(rand() % 5)
+        {
+            case 0:
+            case 1:
+                if((item = draw(items, false)) != NULL)
+                {
+                    item->key = rand() % KEYS;
+                    item->in = true;
+                    item->node = pairing_push(h, item);
+                    CHECK(pairing_value(item->node) == item);
+                    size++;
+                }
+                break;
+            case 2:
+                if(size > 0)
+                {
+                    item = pairing_pop(h);
+                    CHECK(item->in && item->key == smallest(items));
+                    item->in = false;
+                    size--;
+                }
+                break;
+            case 3:
+                if((item = draw(items, true)) != NULL)
+                {
+                    item->key -= rand() % (item->key + 1);
+                    pairing_decrease(h, item->node);
+                }
+                break;
+            default:
+                if((item = draw(items, true)) != NULL)
+                {
+                    CHECK(pairing_remove(h, item->node) == item);
+                    item->in = false;
+                    size--;
+                }
+                break;
+        }
+        CHECK(pairing_size(h) == size && pairing_empty(h) == (size == 0));
+        if(size > 0)
+            CHECK(((Item *)pairing_top(h))->key == smallest(items));
+        if(failures > 0)
+            break;
+    }
+
+    /* what is left comes out in order */
+    while(!pairing_empty(h))
+    {
+        item = pairing_pop(h);
+        CHECK(item->key == smallest(items));
+        item->in = false;
+    }
+    CHECK(smallest(items) < 0);
+
+    pairing_delete(h);
+}
+
+
+/* push and pop */
+static void check_heap(void)
+{
+    static Item items[ITEMS];
+    Heap *h = heap_create(order);
+    Item *item;
+    size_t size = 0;
+    int i;
+
+    srand(3);
+    for(i = 0 ; i < OPERATIONS ; i++)
+    {
+        if(rand() % 2 && (item = draw(items, false)) != NULL)
+        {
+            item->key = rand() % KEYS;
+            item->in = true;
+            heap_push(h, item);
+            size++;
+        }
+        else if(size > 0)
+        {
+            item = heap_pop(h);
+            CHECK(item->in && item->key == smallest(items));
+            item->in = false;
+            size--;
+        }
+        CHECK(heap_size(h) == size && heap_empty(h) == (size == 0));
+        if(size > 0)
+            CHECK(((Item *)heap_top(h))->key == smallest(items));
+        if(failures > 0)
+            break;
+    }
+
+    heap_delete(h);
+}
+
+
+int main(void)
+{
+    check_pairing();
+    check_heap();
+
+    printf("heap : %s\n", failures == 0 ? "ok" : "FAILED");
+
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,453 @@
+/**
+ * @file heap.c
+ * @author Alary Dorian
+ * @brief Priority queues : a d-ary heap in an array, and a pairing heap whose elements can be moved up
+ * @version 0.1
+ * @date 2022-08-22
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <stdlib.h>
+#include <assert.h>
+#include "heap.h"
+
+/*
+	d-ary heap : the children of the value at i are at HEAP_ARITY * i + 1 ... HEAP_ARITY * i + HEAP_ARITY,
+	the array holds only pointers, so a node and its children are contiguous.
+	Pairing heap : a tree whose root comes out first, a node knows its first child and its next sibling,
+	prev is its left sibling, or its parent if it is the first child. A pop merges the children of the root
+	by pairs left to right, then the pairs right to left.
+*/
+
+
+struct s_Heap {
+
+	void **values;
+	size_t size, capacity;
+	OrderFunctor order;
+};
+
+
+struct s_PairingNode {
+
+	void *value;
+	PairingNode *child; /* first child */
+	PairingNode *next; /* next sibling */
+	PairingNode *prev; /* left sibling, or parent of the first child, NULL for the root */
+};
+
+
+struct s_PairingHeap {
+
+	PairingNode *root;
+	size_t size;
+	OrderFunctor order;
+};
+
+/*-----------------------------------------------------------------*/
+
+/**
+* @brief 	Move a value up to its place.
+* @param h 	The heap
+* @param i 	Index of the value
+*/
+static void heap_up(Heap *h, size_t i)
+{
+	void *v = h->values[i];
+	size_t parent;
+
+	while(i > 0)
+	{
+		parent = (i - 1) / HEAP_ARITY;
+		if(h->order(v, h->values[parent]) >= 0)
+			break;
+		h->values[i] = h->values[parent];
+		i = parent;
+	}
+	h->values[i] = v;
+}
+
+
+/**
+* @brief 	Move a value down to its place.
+* @param h 	The heap
+* @param i 	Index of the value
+*/
+static void heap_down(Heap *h, size_t i)
+{
+	void *v = h->values[i];
+	size_t first, last, child, best;
+
+	while((first = HEAP_ARITY * i + 1) < h->size)
+	{
+		last = (first + HEAP_ARITY < h->size) ? first + HEAP_ARITY : h->size;
+		best = first;
+		for(child = first + 1 ; child < last ; child++)
+		{
+			if(h->order(h->values[child], h->values[best]) < 0)
+				best = child;
+		}
+		if(h->order(h->values[best], v) >= 0)
+			break;
+		h->values[i] = h->values[best];
+		i = best;
+	}
+	h->values[i] = v;
+}
+
+
+/**
+* @brief 	Make a tree of two trees : the root which comes out later becomes the first child of the other.
+* @param h 	The heap
+* @param a 	Root of a tree, without sibling
+* @param b 	Root of a tree, without sibling
+* @return 	The root of the tree.
+*/
+static PairingNode *pairing_meet(PairingHeap *h, PairingNode *a, PairingNode *b)
+{
+	PairingNode *t;
+
+	if(h->order(b->value, a->value) < 0)
+	{
+		t = a;
+		a = b;
+		b = t;
+	}
+
+	b->next = a->child;
+	if(a->child != NULL)
+		a->child->prev = b;
+	b->prev = a;
+	a->child = b;
+
+	return a;
+}
+
+
+/**
+* @brief 	Cut a node from its parent and its siblings, with its children.
+* @param n 	The node, not the root
+*/
+static void pairing_cut(PairingNode *n)
+{
+	if(n->prev->child == n)
+		n->prev->child = n->next;
+	else
+		n->prev->next = n->next;
+	if(n->next != NULL)
+		n->next->prev = n->prev;
+	n->next = NULL;
+	n->prev = NULL;
+}
+
+
+/**
+* @brief 	Merge siblings in one tree, by pairs left to right, then the pairs right to left.
+* @param h 	The heap
+* @param first 	The first sibling, NULL if none
+* @return 	The root of the tree, NULL if none.
+*/
+static PairingNode *pairing_combine(PairingHeap *h, PairingNode *first)
+{
+	PairingNode *a, *b, *pairs = NULL, *root;
+
+	if(first == NULL)
+		return NULL;
+
+	/* the pairs are stacked by their next field, the last one on the top */
+	while(first != NULL)
+	{
+		a = first;
+		b = a->next;
+		first = (b != NULL) ? b->next : NULL;
+		a->next = a->prev = NULL;
+		if(b != NULL)
+		{
+			b->next = b->prev = NULL;
+			a = pairing_meet(h, a, b);
+		}
+		a->next = pairs;
+		pairs = a;
+	}
+
+	root = pairs;
+	pairs = pairs->next;
+	root->next = NULL;
+	while(pairs != NULL)
+	{
+		a = pairs;
+		pairs = pairs->next;
+		a->next = NULL;
+		root = pairing_meet(h, root, a);
+	}
+
+	return root;
+}
+
+/*-----------------------------------------------------------------*/
+
+/** 
+* @brief	Constructor of a d-ary heap
+* @param order 	Functor which orders the values
+* @return	Heap
+*/
+Heap *heap_create(OrderFunctor order)
+{
+	Heap *h = malloc(sizeof(Heap));
+
+	h->values = malloc(HEAP_CAPACITY * sizeof(void *));
+	h->size = 0;
+	h->capacity = HEAP_CAPACITY;
+	h->order = order;
+
+	return h;
+}
+
+
+/** Destructor.
+* @brief 	Free ressources allocated by the heap, the values are not freed.
+* @param h 	The heap
+*/
+void heap_delete(Heap *h)
+{
+	free(h->values);
+	free(h);
+}
+
+
+/** 
+* @brief 	Add a value, O(log n).
+* @param h 	The heap to modify
+* @param v 	The value to add (void * type)
+*/
+void heap_push(Heap *h, void *v)
+{
+	if(h->size == h->capacity)
+	{
+		h->capacity *= 2;
+		h->values = realloc(h->values, h->capacity * sizeof(void *));
+	}
+	h->values[h->size] = v;
+	heap_up(h, h->size++);
+}
+
+
+/** 
+* @brief 	Acces to the first value, O(1).
+* @param h 	The heap
+* @return 	The value which comes out first.
+* @pre 		!heap_empty(h)
+*/
+void *heap_top(Heap *h)
+{
+	assert(h->size > 0);
+	return h->values[0];
+}
+
+
+/** 
+* @brief 	Remove the first value, O(log n).
+* @param h 	The heap to modify
+* @return 	The value removed.
+* @pre 		!heap_empty(h)
+*/
+void *heap_pop(Heap *h)
+{
+	void *v;
+
+	assert(h->size > 0);
+	v = h->values[0];
+	h->values[0] = h->values[--h->size];
+	if(h->size > 0)
+		heap_down(h, 0);
+
+	return v;
+}
+
+
+/** 
+* @brief 	Test if the heap is empty.
+* @param h 	The heap
+* @return 	true if the heap is empty.
+*/
+bool heap_empty(Heap *h)
+{
+	return h->size == 0;
+}
+
+
+/** 
+* @brief 	Give the number of values.
+* @param h 	The heap
+* @return 	The number of values.
+*/
+size_t heap_size(Heap *h)
+{
+	return h->size;
+}
+
+/*-----------------------------------------------------------------*/
+
+/** 
+* @brief	Constructor of a pairing heap
+* @param order 	Functor which orders the values
+* @return	PairingHeap
+*/
+PairingHeap *pairing_create(OrderFunctor order)
+{
+	PairingHeap *h = malloc(sizeof(PairingHeap));
+
+	h->root = NULL;
+	h->size = 0;
+	h->order = order;
+
+	return h;
+}
+
+
+/** Destructor.
+* @brief 	Free ressources allocated by the heap, its handles included, the values are not freed.
+* @param h 	The heap
+*/
+void pairing_delete(PairingHeap *h)
+{
+	PairingNode *stack = h->root, *n, *last;
+
+	/* the children of a node are stacked in its place : no recursion on a deep tree */
+	while(stack != NULL)
+	{
+		n = stack;
+		stack = n->next;
+		if(n->child != NULL)
+		{
+			for(last = n->child ; last->next != NULL ; last = last->next);
+			last->next = stack;
+			stack = n->child;
+		}
+		free(n);
+	}
+	free(h);
+}
+
+
+/** 
+* @brief 	Add a value, O(1).
+* @param h 	The heap to modify
+* @param v 	The value to add (void * type)
+* @return 	The handle of the value, valid until it is popped or removed.
+*/
+PairingNode *pairing_push(PairingHeap *h, void *v)
+{
+	PairingNode *n = malloc(sizeof(PairingNode));
+
+	n->value = v;
+	n->child = n->next = n->prev = NULL;
+	h->root = (h->root == NULL) ? n : pairing_meet(h, h->root, n);
+	h->size++;
+
+	return n;
+}
+
+
+/** 
+* @brief 	Acces to the first value, O(1).
+* @param h 	The heap
+* @return 	The value which comes out first.
+* @pre 		!pairing_empty(h)
+*/
+void *pairing_top(PairingHeap *h)
+{
+	assert(h->root != NULL);
+	return h->root->value;
+}
+
+
+/** 
+* @brief 	Remove the first value, O(log n) amortized.
+* @param h 	The heap to modify
+* @return 	The value removed, its handle is freed.
+* @pre 		!pairing_empty(h)
+*/
+void *pairing_pop(PairingHeap *h)
+{
+	assert(h->root != NULL);
+	return pairing_remove(h, h->root);
+}
+
+
+/** 
+* @brief 	Move a value towards the top after it has been changed to come out earlier, O(1) amortized.
+* @param h 	The heap to modify
+* @param n 	The handle of the value
+* @pre 		The value does not come out later than before its change.
+*/
+void pairing_decrease(PairingHeap *h, PairingNode *n)
+{
+	if(n == h->root)
+		return;
+
+	pairing_cut(n);
+	h->root = pairing_meet(h, h->root, n);
+}
+
+
+/** 
+* @brief 	Remove a value wherever it is, O(log n) amortized.
+* @param h 	The heap to modify
+* @param n 	The handle of the value, it is freed
+* @return 	The value removed.
+*/
+void *pairing_remove(PairingHeap *h, PairingNode *n)
+{
+	PairingNode *children;
+	void *v = n->value;
+
+	if(n == h->root)
+	{
+		h->root = pairing_combine(h, n->child);
+	}
+	else
+	{
+		pairing_cut(n);
+		if((children = pairing_combine(h, n->child)) != NULL)
+			h->root = pairing_meet(h, h->root, children);
+	}
+	free(n);
+	h->size--;
+
+	return v;
+}
+
+
+/** 
+* @brief 	Acces to the value of a handle.
+* @param n 	The handle
+* @return 	The value.
+*/
+void *pairing_value(PairingNode *n)
+{
+	return n->value;
+}
+
+
+/** 
+* @brief 	Test if the heap is empty.
+* @param h 	The heap
+* @return 	true if the heap is empty.
+*/
+bool pairing_empty(PairingHeap *h)
+{
+	return h->root == NULL;
+}
+
+
+/** 
+* @brief 	Give the number of values.
+* @param h 	The heap
+* @return 	The number of values.
+*/
+size_t pairing_size(PairingHeap *h)
+{
+	return h->size;
+}
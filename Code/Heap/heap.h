@@ -0,0 +1,199 @@
+/**
+ * @file heap.h
+ * @author Alary Dorian
+ * @brief Priority queues : a d-ary heap in an array, and a pairing heap whose elements can be moved up
+ * @version 0.1
+ * @date 2022-08-22
+ * @note The d-ary heap is the default one, the pairing heap is for the elements whose priority changes
+ * 		 (a deadline brought forward) : pairing_decrease is O(1) amortized, and an element can be removed.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef __HEAP_H__
+#define __HEAP_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*-----------------------------------------------------------------*/
+
+/* Default values */
+#define HEAP_ARITY 4 /* children of a node : a pop reads them in one or two cache lines, for half the levels of a binary heap */
+#define HEAP_CAPACITY 64 /* elements of a new heap, the array doubles when it is full */
+
+
+/** 
+* @brief 	Opaque definition of type Heap : d-ary heap.
+*/
+typedef struct s_Heap Heap;
+
+
+/** 
+* @brief 	Opaque definition of type PairingHeap.
+*/
+typedef struct s_PairingHeap PairingHeap;
+
+
+/** 
+* @brief 	Opaque definition of type PairingNode : handle of an element of a PairingHeap.
+*/
+typedef struct s_PairingNode PairingNode;
+
+
+/** 
+* @brief 	Functor which orders the elements of a heap.
+* @param	(const void*) First value
+* @param	(const void*) Second value
+* @return 	(int) < 0 if the first value comes out before the second, 0 if they are equal, > 0 otherwise
+*/
+typedef int (*OrderFunctor)(const void *, const void *);
+
+
+/*-----------------------------------------------------------------*/
+
+
+/** 
+* @brief	Constructor of a d-ary heap
+* @param order 	Functor which orders the values
+* @return	Heap
+*/
+Heap *heap_create(OrderFunctor order);
+
+
+/** Destructor.
+* @brief 	Free ressources allocated by the heap, the values are not freed.
+* @param h 	The heap
+*/
+void heap_delete(Heap *h);
+
+
+/** 
+* @brief 	Add a value, O(log n).
+* @param h 	The heap to modify
+* @param v 	The value to add (void * type)
+*/
+void heap_push(Heap *h, void *v);
+
+
+/** 
+* @brief 	Acces to the first value, O(1).
+* @param h 	The heap
+* @return 	The value which comes out first.
+* @pre 		!heap_empty(h)
+*/
+void *heap_top(Heap *h);
+
+
+/** 
+* @brief 	Remove the first value, O(log n).
+* @param h 	The heap to modify
+* @return 	The value removed.
+* @pre 		!heap_empty(h)
+*/
+void *heap_pop(Heap *h);
+
+
+/** 
+* @brief 	Test if the heap is empty.
+* @param h 	The heap
+* @return 	true if the heap is empty.
+*/
+bool heap_empty(Heap *h);
+
+
+/** 
+* @brief 	Give the number of values.
+* @param h 	The heap
+* @return 	The number of values.
+*/
+size_t heap_size(Heap *h);
+
+
+/*-----------------------------------------------------------------*/
+
+
+/** 
+* @brief	Constructor of a pairing heap
+* @param order 	Functor which orders the values
+* @return	PairingHeap
+*/
+PairingHeap *pairing_create(OrderFunctor order);
+
+
+/** Destructor.
+* @brief 	Free ressources allocated by the heap, its handles included, the values are not freed.
+* @param h 	The heap
+*/
+void pairing_delete(PairingHeap *h);
+
+
+/** 
+* @brief 	Add a value, O(1).
+* @param h 	The heap to modify
+* @param v 	The value to add (void * type)
+* @return 	The handle of the value, valid until it is popped or removed.
+*/
+PairingNode *pairing_push(PairingHeap *h, void *v);
+
+
+/** 
+* @brief 	Acces to the first value, O(1).
+* @param h 	The heap
+* @return 	The value which comes out first.
+* @pre 		!pairing_empty(h)
+*/
+void *pairing_top(PairingHeap *h);
+
+
+/** 
+* @brief 	Remove the first value, O(log n) amortized.
+* @param h 	The heap to modify
+* @return 	The value removed, its handle is freed.
+* @pre 		!pairing_empty(h)
+*/
+void *pairing_pop(PairingHeap *h);
+
+
+/** 
+* @brief 	Move a value towards the top after it has been changed to come out earlier, O(1) amortized.
+* @param h 	The heap to modify
+* @param n 	The handle of the value
+* @pre 		The value does not come out later than before its change.
+*/
+void pairing_decrease(PairingHeap *h, PairingNode *n);
+
+
+/** 
+* @brief 	Remove a value wherever it is, O(log n) amortized.
+* @param h 	The heap to modify
+* @param n 	The handle of the value, it is freed
+* @return 	The value removed.
+*/
+void *pairing_remove(PairingHeap *h, PairingNode *n);
+
+
+/** 
+* @brief 	Acces to the value of a handle.
+* @param n 	The handle
+* @return 	The value.
+*/
+void *pairing_value(PairingNode *n);
+
+
+/** 
+* @brief 	Test if the heap is empty.
+* @param h 	The heap
+* @return 	true if the heap is empty.
+*/
+bool pairing_empty(PairingHeap *h);
+
+
+/** 
+* @brief 	Give the number of values.
+* @param h 	The heap
+* @return 	The number of values.
+*/
+size_t pairing_size(PairingHeap *h);
+
+#endif
@@ -0,0 +1,34 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "journal.h"
+
+
+/* Replay the journal of dir from an offset : ./example journal_dir [offset] */
+int main(int argc, char const *argv[])
+{
+    char buffer[JOURNAL_SEGMENT_SIZE / 1024];
+    uint64_t offset = 0;
+    int n;
+
+    if(argc < 2)
+    {
+        printf("Usage : %s [journal_dir] [offset]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    JournalReader *r = journalReader_create(argv[1], (argc > 2) ? strtoull(argv[2], NULL, 10) : 0);
+    if(r == NULL)
+    {
+        fprintf(stderr, "Error : journalReader_create()\n");
+        return EXIT_FAILURE;
+    }
+
+    while((n = journalReader_next(r, buffer, sizeof(buffer), &offset)) > 0)
+    {
+        printf("%llu : %.*s", (unsigned long long)offset, n, buffer);
+    }
+
+    journalReader_delete(r);
+
+    return 0;
+}
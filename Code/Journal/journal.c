@@ -0,0 +1,441 @@
+/**
+ * @file journal.c
+ * @author Alary Dorian
+ * @brief Append-only message journal, written through a memory-mapped segment
+ * @version 0.1
+ * @date 2022-07-20
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "journal.h"
+
+/*
+	A segment file is named by the offset of its first record ("%020llu.log").
+	A record is a 32 bits length followed by the data, padded to RECORD_ALIGN.
+	The unused part of a segment is filled by zero, so a length of 0 is the end of the segment.
+	A full segment is truncated to its used size before the next one is opened.
+*/
+
+#define RECORD_HEADER sizeof(uint32_t)
+#define RECORD_ALIGN 8
+#define RECORD_SIZE(len) (((RECORD_HEADER + (len)) + RECORD_ALIGN - 1) & ~((size_t)RECORD_ALIGN - 1))
+
+
+struct s_Journal {
+
+	char *dir; /* directory of segments */
+	size_t segment_size; /* capacity of a segment */
+	size_t commit_bytes; /* bytes window of the group commit */
+	int commit_ms; /* time window of the group commit */
+
+	uint64_t base; /* offset of the first record of the current segment */
+	int fd; /* file of the current segment */
+	char *map; /* mapping of the current segment */
+	size_t used; /* write position in the current segment */
+	size_t synced; /* position up to which the segment is flushed */
+	struct timespec first_unsynced; /* append time of the oldest unflushed record */
+};
+
+
+struct s_JournalReader {
+
+	char *dir; /* directory of segments */
+	uint64_t base; /* offset of the first record of the current segment */
+	int fd; /* file of the current segment */
+	size_t pos; /* read position in the current segment */
+};
+
+/*-----------------------------------------------------------------*/
+
+/**
+ * @brief Build the path of the segment which begins at offset base
+ *
+ * @param path variable that stores the path
+ * @param dir directory of segments
+ * @param base offset of the first record of the segment
+ */
+static void segment_path(char *path, const char *dir, uint64_t base)
+{
+	snprintf(path, PATH_MAX, "%s/%020" PRIu64 ".log", dir, base);
+}
+
+
+/**
+ * @brief Find the segment which contains offset
+ *
+ * @param dir directory of segments
+ * @param offset offset searched, UINT64_MAX for the last segment
+ * @param base variable that stores the offset of the first record of the segment
+ * @return int 0 if a segment is found, -1 otherwise
+ */
+static int segment_find(const char *dir, uint64_t offset, uint64_t *base)
+{
+	DIR *d = opendir(dir);
+	struct dirent *entry;
+	uint64_t value;
+	int found = -1;
+	char end;
+
+	if(d == NULL)
+		return -1;
+
+	while((entry = readdir(d)) != NULL)
+	{
+		if(sscanf(entry->d_name, "%" SCNu64 ".lo%c", &value, &end) == 2 && end == 'g' && value <= offset && (found == -1 || value > *base))
+		{
+			*base = value;
+			found = 0;
+		}
+	}
+	closedir(d);
+
+	return found;
+}
+
+
+/**
+ * @brief Milliseconds elapsed since t
+ *
+ * @param t time of reference (CLOCK_MONOTONIC)
+ * @return long milliseconds elapsed
+ */
+static long elapsed_ms(const struct timespec *t)
+{
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - t->tv_sec) * 1000 + (now.tv_nsec - t->tv_nsec) / 1000000;
+}
+
+
+/**
+ * @brief Open and map the segment which begins at j->base, and find the write position
+ *
+ * @param j pointer on journal
+ * @return int 0 on success, -1 on error
+ */
+static int segment_open(Journal *j)
+{
+	char path[PATH_MAX];
+	struct stat st;
+	uint32_t len;
+
+	segment_path(path, j->dir, j->base);
+	if((j->fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644)) < 0)
+	{
+		fprintf(stderr, "Error : open()\n");
+		return -1;
+	}
+
+	/* never shrink a segment written with a bigger segment size */
+	if(fstat(j->fd, &st) == 0 && (size_t)st.st_size > j->segment_size)
+		j->segment_size = st.st_size;
+
+	if(ftruncate(j->fd, j->segment_size) < 0)
+	{
+		fprintf(stderr, "Error : ftruncate()\n");
+		close(j->fd);
+		return -1;
+	}
+
+	j->map = mmap(NULL, j->segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, j->fd, 0);
+	if(j->map == MAP_FAILED)
+	{
+		fprintf(stderr, "Error : mmap()\n");
+		close(j->fd);
+		return -1;
+	}
+
+	/* skip records written before a restart */
+	j->used = 0;
+	while(j->used + RECORD_HEADER <= j->segment_size)
+	{
+		memcpy(&len, j->map + j->used, RECORD_HEADER);
+		if(len == 0 || j->used + RECORD_SIZE(len) > j->segment_size)
+			break;
+		j->used += RECORD_SIZE(len);
+	}
+	j->synced = j->used;
+
+	return 0;
+}
+
+
+/**
+ * @brief Flush, unmap and truncate the current segment
+ *
+ * @param j pointer on journal
+ */
+static void segment_close(Journal *j)
+{
+	journal_sync(j);
+	munmap(j->map, j->segment_size);
+	if(ftruncate(j->fd, j->used) < 0)
+		fprintf(stderr, "Error : ftruncate()\n");
+	fsync(j->fd);
+	close(j->fd);
+}
+
+/*-----------------------------------------------------------------*/
+
+/**
+ * @brief Open (or create) the journal stored in the directory dir
+ *
+ * @param dir directory of segment files, it must exist
+ * @param segment_size size of a segment file, a new segment is opened when the current one is full
+ * @param commit_bytes number of unflushed bytes which triggers a group commit
+ * @param commit_ms maximal age in milliseconds of an unflushed record
+ * @return Journal* pointer on journal, NULL on error
+ * @note The last segment is reopened and records are appended after the last valid record.
+ */
+Journal *journal_open(const char *dir, size_t segment_size, size_t commit_bytes, int commit_ms)
+{
+	Journal *j = malloc(sizeof(Journal));
+	long page = sysconf(_SC_PAGESIZE);
+
+	j->dir = strdup(dir);
+	j->segment_size = (segment_size + page - 1) / page * page;
+	j->commit_bytes = commit_bytes;
+	j->commit_ms = commit_ms;
+
+	if(segment_find(dir, UINT64_MAX, &j->base) < 0)
+		j->base = 0;
+
+	if(segment_open(j) < 0)
+	{
+		free(j->dir);
+		free(j);
+		return NULL;
+	}
+
+	return j;
+}
+
+
+/**
+ * @brief Append a record to the journal
+ *
+ * @param j pointer on journal
+ * @param data record to copy
+ * @param len len of the record, greater than 0
+ * @return int64_t offset of the record in the journal, -1 on error
+ * @note The record is copied in the mapped segment, it is not flushed to the disk.
+ * 		 The flush is done by group commit when the bytes or time window is reached.
+ */
+int64_t journal_append(Journal *j, const void *data, size_t len)
+{
+	uint32_t header = len;
+	int64_t offset;
+
+	if(len == 0 || RECORD_SIZE(len) > j->segment_size)
+		return -1;
+
+	/* roll the segment */
+	if(j->used + RECORD_SIZE(len) > j->segment_size)
+	{
+		segment_close(j);
+		j->base += j->used;
+		if(segment_open(j) < 0)
+			return -1;
+	}
+
+	if(j->used == j->synced)
+		clock_gettime(CLOCK_MONOTONIC, &j->first_unsynced);
+
+	/* the length is written last, a reader never sees a partial record */
+	memcpy(j->map + j->used + RECORD_HEADER, data, len);
+	memcpy(j->map + j->used, &header, RECORD_HEADER);
+	offset = j->base + j->used;
+	j->used += RECORD_SIZE(len);
+
+	if(j->used - j->synced >= j->commit_bytes || elapsed_ms(&j->first_unsynced) >= j->commit_ms)
+		journal_sync(j);
+
+	return offset;
+}
+
+
+/**
+ * @brief Flush to the disk every record appended since the last commit
+ *
+ * @param j pointer on journal
+ * @return int 0 on success, -1 on error
+ */
+int journal_sync(Journal *j)
+{
+	long page = sysconf(_SC_PAGESIZE);
+	size_t begin = j->synced / page * page;
+
+	if(j->used == j->synced)
+		return 0;
+
+	if(msync(j->map + begin, j->used - begin, MS_SYNC) < 0)
+	{
+		fprintf(stderr, "Error : msync()\n");
+		return -1;
+	}
+	j->synced = j->used;
+
+	return 0;
+}
+
+
+/**
+ * @brief Group commit if the time window of the oldest unflushed record is elapsed
+ *
+ * @param j pointer on journal
+ * @note To be called by the event loop, after each wakeup.
+ */
+void journal_tick(Journal *j)
+{
+	if(j->used != j->synced && elapsed_ms(&j->first_unsynced) >= j->commit_ms)
+		journal_sync(j);
+}
+
+
+/**
+ * @brief Give the time before the next group commit
+ *
+ * @param j pointer on journal
+ * @return int milliseconds before the next commit, -1 if nothing is waiting
+ */
+int journal_timeout(Journal *j)
+{
+	long left;
+
+	if(j->used == j->synced)
+		return -1;
+
+	left = j->commit_ms - elapsed_ms(&j->first_unsynced);
+	return (left > 0) ? (int)left : 0;
+}
+
+
+/**
+ * @brief Flush and close the journal
+ *
+ * @param j pointer on journal
+ */
+void journal_close(Journal *j)
+{
+	journal_sync(j);
+	munmap(j->map, j->segment_size);
+	close(j->fd);
+	free(j->dir);
+	free(j);
+}
+
+/*-----------------------------------------------------------------*/
+
+/**
+ * @brief Open the segment which begins at r->base
+ *
+ * @param r pointer on reader
+ * @return int 0 on success, -1 if the segment does not exist
+ */
+static int reader_open(JournalReader *r)
+{
+	char path[PATH_MAX];
+
+	segment_path(path, r->dir, r->base);
+	r->fd = open(path, O_RDONLY | O_CLOEXEC);
+	return (r->fd < 0) ? -1 : 0;
+}
+
+
+/**
+ * @brief Create a reader which streams records of the journal stored in dir
+ *
+ * @param dir directory of segment files
+ * @param offset offset of the first record to read (0 or a value returned by journal_append)
+ * @return JournalReader* pointer on reader, NULL if no segment contains offset
+ */
+JournalReader *journalReader_create(const char *dir, uint64_t offset)
+{
+	JournalReader *r = malloc(sizeof(JournalReader));
+
+	r->dir = strdup(dir);
+	if(segment_find(dir, offset, &r->base) < 0 || reader_open(r) < 0)
+	{
+		free(r->dir);
+		free(r);
+		return NULL;
+	}
+	r->pos = offset - r->base;
+
+	return r;
+}
+
+
+/**
+ * @brief Read the next record
+ *
+ * @param r pointer on reader
+ * @param buffer variable that stores the record
+ * @param len len of the buffer
+ * @param offset if not NULL, stores the offset of the record
+ * @return int len of the record, 0 if the end of the journal is reached, -1 on error or if the buffer is too small
+ * @note When the end is reached, the reader can be called again later to read new records.
+ */
+int journalReader_next(JournalReader *r, void *buffer, size_t len, uint64_t *offset)
+{
+	uint32_t header = 0;
+	ssize_t n = pread(r->fd, &header, RECORD_HEADER, r->pos);
+	int next_fd;
+
+	if(n < 0)
+		return -1;
+
+	/* end of segment, go to the next one if it exists */
+	if(n < (ssize_t)RECORD_HEADER || header == 0)
+	{
+		next_fd = r->fd;
+		r->base += r->pos;
+		if(reader_open(r) < 0)
+		{
+			/* the current segment is still the last one */
+			r->base -= r->pos;
+			r->fd = next_fd;
+			return 0;
+		}
+		close(next_fd);
+		r->pos = 0;
+		return journalReader_next(r, buffer, len, offset);
+	}
+
+	if(header > len)
+		return -1;
+
+	if(pread(r->fd, buffer, header, r->pos + RECORD_HEADER) < (ssize_t)header)
+		return -1;
+
+	if(offset != NULL)
+		*offset = r->base + r->pos;
+	r->pos += RECORD_SIZE(header);
+
+	return header;
+}
+
+
+/**
+ * @brief Delete the reader
+ *
+ * @param r pointer on reader
+ */
+void journalReader_delete(JournalReader *r)
+{
+	close(r->fd);
+	free(r->dir);
+	free(r);
+}
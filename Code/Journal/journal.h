@@ -0,0 +1,134 @@
+/**
+ * @file journal.h
+ * @author Alary Dorian
+ * @brief Append-only message journal, written through a memory-mapped segment
+ * @version 0.1
+ * @date 2022-07-20
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef __JOURNAL_H__
+#define __JOURNAL_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*-----------------------------------------------------------------*/
+
+/* Default values */
+#define JOURNAL_SEGMENT_SIZE (64 * 1024 * 1024) /* a segment is rolled when this size is reached */
+#define JOURNAL_COMMIT_BYTES (256 * 1024) /* group commit when this many bytes are not flushed */
+#define JOURNAL_COMMIT_MS 10 /* group commit when the oldest unflushed record is this old */
+
+
+/**
+* @brief 	Opaque definition of type Journal (writer side).
+*/
+typedef struct s_Journal Journal;
+
+
+/**
+* @brief 	Opaque definition of type JournalReader.
+*/
+typedef struct s_JournalReader JournalReader;
+
+
+/*-----------------------------------------------------------------*/
+
+
+/**
+ * @brief Open (or create) the journal stored in the directory dir
+ *
+ * @param dir directory of segment files, it must exist
+ * @param segment_size size of a segment file, a new segment is opened when the current one is full
+ * @param commit_bytes number of unflushed bytes which triggers a group commit
+ * @param commit_ms maximal age in milliseconds of an unflushed record
+ * @return Journal* pointer on journal, NULL on error
+ * @note The last segment is reopened and records are appended after the last valid record.
+ */
+Journal *journal_open(const char *dir, size_t segment_size, size_t commit_bytes, int commit_ms);
+
+
+/**
+ * @brief Append a record to the journal
+ *
+ * @param j pointer on journal
+ * @param data record to copy
+ * @param len len of the record, greater than 0
+ * @return int64_t offset of the record in the journal, -1 on error
+ * @note The record is copied in the mapped segment, it is not flushed to the disk.
+ * 		 The flush is done by group commit when the bytes or time window is reached.
+ */
+int64_t journal_append(Journal *j, const void *data, size_t len);
+
+
+/**
+ * @brief Flush to the disk every record appended since the last commit
+ *
+ * @param j pointer on journal
+ * @return int 0 on success, -1 on error
+ */
+int journal_sync(Journal *j);
+
+
+/**
+ * @brief Group commit if the time window of the oldest unflushed record is elapsed
+ *
+ * @param j pointer on journal
+ * @note To be called by the event loop, after each wakeup.
+ */
+void journal_tick(Journal *j);
+
+
+/**
+ * @brief Give the time before the next group commit
+ *
+ * @param j pointer on journal
+ * @return int milliseconds before the next commit, -1 if nothing is waiting
+ */
+int journal_timeout(Journal *j);
+
+
+/**
+ * @brief Flush and close the journal
+ *
+ * @param j pointer on journal
+ */
+void journal_close(Journal *j);
+
+
+/*-----------------------------------------------------------------*/
+
+
+/**
+ * @brief Create a reader which streams records of the journal stored in dir
+ *
+ * @param dir directory of segment files
+ * @param offset offset of the first record to read (0 or a value returned by journal_append)
+ * @return JournalReader* pointer on reader, NULL if no segment contains offset
+ */
+JournalReader *journalReader_create(const char *dir, uint64_t offset);
+
+
+/**
+ * @brief Read the next record
+ *
+ * @param r pointer on reader
+ * @param buffer variable that stores the record
+ * @param len len of the buffer
+ * @param offset if not NULL, stores the offset of the record
+ * @return int len of the record, 0 if the end of the journal is reached, -1 on error or if the buffer is too small
+ * @note When the end is reached, the reader can be called again later to read new records.
+ */
+int journalReader_next(JournalReader *r, void *buffer, size_t len, uint64_t *offset);
+
+
+/**
+ * @brief Delete the reader
+ *
+ * @param r pointer on reader
+ */
+void journalReader_delete(JournalReader *r);
+
+#endif
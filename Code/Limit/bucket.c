@@ -0,0 +1,102 @@
+/**
+ * @file bucket.c
+ * @author Alary Dorian
+ * @brief Token bucket, to limit the rate of a client
+ * @version 0.1
+ * @date 2022-08-08
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <time.h>
+#include "bucket.h"
+
+/*-----------------------------------------------------------------*/
+
+/**
+ * @brief Add the tokens earned since the last refill
+ *
+ * @param b pointer on bucket
+ * @param now current time in nanoseconds
+ */
+static void bucket_refill(TokenBucket *b, int64_t now)
+{
+	if(now <= b->last)
+		return;
+
+	b->tokens += b->rate * (now - b->last) / 1e9;
+	if(b->tokens > b->burst)
+		b->tokens = b->burst;
+	b->last = now;
+}
+
+/*-----------------------------------------------------------------*/
+
+/**
+ * @brief Initialise a full bucket
+ *
+ * @param b pointer on bucket
+ * @param rate tokens added by second, 0 for no limit
+ * @param burst max tokens
+ * @param now current time in nanoseconds (bucket_now)
+ */
+void bucket_init(TokenBucket *b, double rate, double burst, int64_t now)
+{
+	b->tokens = burst;
+	b->rate = rate;
+	b->burst = burst;
+	b->last = now;
+}
+
+
+/**
+ * @brief Give the current time of the monotonic clock
+ *
+ * @return int64_t time in nanoseconds
+ */
+int64_t bucket_now(void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (int64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+
+/**
+ * @brief Take tokens, the bucket can go in debt
+ *
+ * @param b pointer on bucket
+ * @param tokens tokens taken
+ * @param now current time in nanoseconds
+ */
+void bucket_take(TokenBucket *b, double tokens, int64_t now)
+{
+	if(b->rate <= 0)
+		return;
+
+	bucket_refill(b, now);
+	b->tokens -= tokens;
+}
+
+
+/**
+ * @brief Give the time before tokens are available
+ *
+ * @param b pointer on bucket
+ * @param tokens tokens wanted
+ * @param now current time in nanoseconds
+ * @return int milliseconds to wait, 0 if the tokens are available
+ */
+int bucket_delay(TokenBucket *b, double tokens, int64_t now)
+{
+	if(b->rate <= 0)
+		return 0;
+
+	bucket_refill(b, now);
+	if(b->tokens >= tokens)
+		return 0;
+
+	/* rounded up : the client is not woken before it can be read */
+	return (int)((tokens - b->tokens) * 1000 / b->rate) + 1;
+}
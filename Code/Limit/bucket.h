@@ -0,0 +1,75 @@
+/**
+ * @file bucket.h
+ * @author Alary Dorian
+ * @brief Token bucket, to limit the rate of a client
+ * @version 0.1
+ * @date 2022-08-08
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef __BUCKET_H__
+#define __BUCKET_H__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*-----------------------------------------------------------------*/
+
+
+/**
+* @brief 	Token bucket, embedded in the structure of the client.
+* @note 	The tokens can be negative : the cost of a read is known after it, the client pays its debt before the next one.
+*/
+typedef struct s_TokenBucket {
+
+	double tokens; /* tokens available */
+	double rate; /* tokens added by second, 0 for no limit */
+	double burst; /* max tokens */
+	int64_t last; /* time of the last refill, in nanoseconds */
+} TokenBucket;
+
+
+/*-----------------------------------------------------------------*/
+
+
+/**
+ * @brief Initialise a full bucket
+ *
+ * @param b pointer on bucket
+ * @param rate tokens added by second, 0 for no limit
+ * @param burst max tokens
+ * @param now current time in nanoseconds (bucket_now)
+ */
+void bucket_init(TokenBucket *b, double rate, double burst, int64_t now);
+
+
+/**
+ * @brief Give the current time of the monotonic clock
+ *
+ * @return int64_t time in nanoseconds
+ */
+int64_t bucket_now(void);
+
+
+/**
+ * @brief Take tokens, the bucket can go in debt
+ *
+ * @param b pointer on bucket
+ * @param tokens tokens taken
+ * @param now current time in nanoseconds
+ */
+void bucket_take(TokenBucket *b, double tokens, int64_t now);
+
+
+/**
+ * @brief Give the time before tokens are available
+ *
+ * @param b pointer on bucket
+ * @param tokens tokens wanted
+ * @param now current time in nanoseconds
+ * @return int milliseconds to wait, 0 if the tokens are available
+ */
+int bucket_delay(TokenBucket *b, double tokens, int64_t now);
+
+#endif
@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "list.h"
+#include "../Pool/pool.h"
+
+/* Benchmark of the List backend it is linked with : make bench, then ./bench_list_linked and ./bench_list_array */
+
+#define N 100000 /* size of the list */
+#define AT 10000 /* number of random list_at */
+#define MIDDLE 1000 /* number of insert and remove in the middle */
+
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+
+static void *increment(void *v)
+{
+    return (void *)((long)v + 1);
+}
+
+
+static void sum(void *v, void *userData)
+{
+    *(long *)userData += (long)v;
+}
+
+
+static void combine(void *userData, void *partial)
+{
+    *(long *)userData += *(long *)partial;
+}
+
+
+/* a transform which costs some CPU, as a parsing or a checksum */
+static void *heavy(void *v)
+{
+    long x = (long)v;
+    int i;
+
+    for(i = 0 ; i < 200 ; i++)
+        x = x * 6364136223846793005L + 1442695040888963407L;
+    return (void *)x;
+}
+
+
+int main(void)
+{
+    List *l = list_create();
+    ListIterator *it;
+    long total = 0;
+    double t;
+    int i;
+
+    t = now();
+    for(i = 0 ; i < N ; i++)
+        list_push_back(l, (void *)(long)i);
+    printf("list_push_back    : %8.2f ns/op\n", (now() - t) / N);
+
+    t = now();
+    it = listIterator_create(l, FORWARD_ITERATOR);
+    for(it = listIterator_begin(it) ; !listIterator_end(it) ; it = listIterator_next(it))
+        total += (long)listIterator_value(it);
+    listIterator_delete(it);
+    printf("listIterator      : %8.2f ns/op\n", (now() - t) / N);
+
+    t = now();
+    list_map(l, increment);
+    printf("list_map          : %8.2f ns/op\n", (now() - t) / N);
+
+    t = now();
+    list_reduce(l, sum, &total);
+    printf("list_reduce       : %8.2f ns/op\n", (now() - t) / N);
+
+    t = now();
+    list_map(l, heavy);
+    printf("list_map heavy    : %8.2f ns/op\n", (now() - t) / N);
+
+    pool_default(); /* threads started out of the measure */
+    t = now();
+    list_map_parallel(l, heavy);
+    printf("map_parallel heavy: %8.2f ns/op (%d threads)\n", (now() - t) / N, pool_size(pool_default()));
+
+    t = now();
+    list_reduce_parallel(l, sum, combine, &total, &(long){0}, sizeof(long));
+    printf("reduce_parallel   : %8.2f ns/op\n", (now() - t) / N);
+
+    srand(1);
+    t = now();
+    for(i = 0 ; i < AT ; i++)
+        total += (long)list_at(l, rand() % N);
+    printf("list_at           : %8.2f ns/op\n", (now() - t) / AT);
+
+    t = now();
+    for(i = 0 ; i < MIDDLE ; i++)
+        list_insert_at(l, list_size(l) / 2, NULL);
+    for(i = 0 ; i < MIDDLE ; i++)
+        list_remove_at(l, list_size(l) / 2);
+    printf("insert/remove mid : %8.2f ns/op\n", (now() - t) / (2 * MIDDLE));
+
+    t = now();
+    while(!list_is_empty(l))
+        list_pop_front(l);
+    printf("list_pop_front    : %8.2f ns/op\n", (now() - t) / N);
+
+    list_delete(l);
+    printf("(checksum %ld)\n", total);
+
+    return 0;
+}
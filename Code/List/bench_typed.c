@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "list.h"
+#include "tlist.h"
+
+/*
+   A list of small structures, as the clients of the server were (a socket and an id) : make bench, then ./bench_list_typed.
+   The generic List holds a pointer on each value allocated apart, DEFINE_LIST(Peer) holds the values in place.
+*/
+
+#define N 1000000 /* size of the list */
+#define FIND 1000 /* number of list_Peer_find */
+
+typedef struct {
+    int sock;
+    int id;
+} Peer;
+
+DEFINE_LIST(Peer)
+
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+
+/* the functors of the generic list */
+
+static void *renumber(void *v)
+{
+    ((Peer *)v)->id++;
+    return v;
+}
+
+
+static void sum(void *v, void *userData)
+{
+    *(long *)userData += ((Peer *)v)->id;
+}
+
+
+/* the functors of the typed list, inlined in its loops */
+
+static void renumberPeer(Peer *p)
+{
+    p->id++;
+}
+
+
+static void sumPeer(const Peer *p, void *userData)
+{
+    *(long *)userData += p->id;
+}
+
+
+static bool hasId(const Peer *p, const void *key)
+{
+    return p->id == *(const int *)key;
+}
+
+
+static long generic(void)
+{
+    List *l = list_create();
+    ListIterator *it;
+    Peer *p;
+    long total = 0;
+    double t;
+    int i;
+
+    t = now();
+    for(i = 0 ; i < N ; i++)
+    {
+        p = malloc(sizeof(Peer));
+        p->sock = i;
+        p->id = i;
+        list_push_back(l, p);
+    }
+    printf("generic push_back : %8.2f ns/op\n", (now() - t) / N);
+
+    t = now();
+    list_map(l, renumber);
+    printf("generic map       : %8.2f ns/op\n", (now() - t) / N);
+
+    t = now();
+    list_reduce(l, sum, &total);
+    printf("generic reduce    : %8.2f ns/op\n", (now() - t) / N);
+
+    t = now();
+    for(i = 0 ; i < FIND ; i++)
+    {
+        it = listIterator_create(l, FORWARD_ITERATOR);
+        for(it = listIterator_begin(it) ; !listIterator_end(it) ; it = listIterator_next(it))
+        {
+            if(((Peer *)listIterator_value(it))->id == N - i)
+            {
+                total += ((Peer *)listIterator_value(it))->sock;
+                break;
+            }
+        }
+        listIterator_delete(it);
+    }
+    printf("generic find      : %8.2f ns/value\n", (now() - t) / ((double)FIND * N));
+
+    t = now();
+    while(!list_is_empty(l))
+    {
+        free(list_front(l));
+        list_pop_front(l);
+    }
+    printf("generic pop_front : %8.2f ns/op\n", (now() - t) / N);
+
+    list_delete(l);
+    return total;
+}
+
+
+static long typed(void)
+{
+    List_Peer *l = list_Peer_create();
+    Peer *p;
+    long total = 0;
+    double t;
+    int i, id;
+
+    t = now();
+    for(i = 0 ; i < N ; i++)
+        list_Peer_push_back(l, (Peer){ i, i });
+    printf("typed push_back   : %8.2f ns/op\n", (now() - t) / N);
+
+    t = now();
+    list_Peer_map(l, renumberPeer);
+    printf("typed map         : %8.2f ns/op\n", (now() - t) / N);
+
+    t = now();
+    list_Peer_reduce(l, sumPeer, &total);
+    printf("typed reduce      : %8.2f ns/op\n", (now() - t) / N);
+
+    t = now();
+    for(i = 0 ; i < FIND ; i++)
+    {
+        id = N - i;
+        if((p = list_Peer_find(l, hasId, &id)) != NULL)
+            total += p->sock;
+    }
+    printf("typed find        : %8.2f ns/value\n", (now() - t) / ((double)FIND * N));
+
+    t = now();
+    while(!list_Peer_is_empty(l))
+        list_Peer_pop_front(l);
+    printf("typed pop_front   : %8.2f ns/op\n", (now() - t) / N);
+
+    list_Peer_delete(l);
+    return total;
+}
+
+
+int main(void)
+{
+    long a = generic(), b = typed();
+
+    if(a != b)
+        fprintf(stderr, "Error : checksums %ld and %ld\n", a, b);
+    printf("(checksum %ld)\n", b);
+
+    return 0;
+}
@@ -0,0 +1,258 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "list.h"
+
+/*
+   Behaviour of a List backend : make check, or
+      gcc -o check_list_linked List/check.c List/list.c List/list_parallel.c Pool/pool.c -pthread && ./check_list_linked
+      gcc -o check_list_array List/check.c List/list_array.c List/list_parallel.c Pool/pool.c -pthread && ./check_list_array
+   Random operations are done on a list and on a plain array, both must hold the same values.
+   The program ends with 1 if a check fails.
+*/
+
+#define OPERATIONS 200000
+#define MAX_SIZE 100 /* the array backend wraps around its array and grows */
+#define PARALLEL_SIZE (4 * LIST_PARALLEL_GRAIN + 3) /* large enough to be split by the pool */
+
+#define CHECK(cond) do { if(!(cond)) { fprintf(stderr, "Error : %s:%d : %s\n", __FILE__, __LINE__, #cond); failures++; } } while(0)
+
+/* the values are integers stored in the pointers */
+#define ELEMENT(v) ((void *)(intptr_t)(v))
+#define VALUE(e) ((int)(intptr_t)(e))
+
+static int failures = 0;
+
+
+/* the reference : a plain array */
+typedef struct s_Model {
+
+    int values[4 * MAX_SIZE];
+    int size;
+} Model;
+
+
+static void model_insert(Model *m, int p, int v)
+{
+    memmove(m->values + p + 1, m->values + p, (m->size - p) * sizeof(int));
+    m->values[p] = v;
+    m->size++;
+}
+
+
+static void model_remove(Model *m, int p)
+{
+    memmove(m->values + p, m->values + p + 1, (m->size - p - 1) * sizeof(int));
+    m->size--;
+}
+
+
+static bool same(List *l, const Model *m)
+{
+    int i;
+
+    if(list_size(l) != m->size || list_is_empty(l) != (m->size == 0))
+        return false;
+    for(i = 0 ; i < m->size ; i++)
+    {
+        if(VALUE(list_at(l, i)) != m->values[i])
+            return false;
+    }
+    return true;
+}
+
+
+/* the operations by position, each end and the middle */
+static void check_positions(void)
+{
+    List *l = list_create();
+    Model m = { .size = 0 };
+    int i, p, v;
+
+    srand(1);
+    for(i = 0 ; i < OPERATIONS ; i++)
+    {
+        v = rand();
+        switch(rand() % 6)
+        {
+            case 0:
+                if(m.size < MAX_SIZE)
+                {
+                    list_push_back(l, ELEMENT(v));
+                    model_insert(&m, m.size, v);
+                }
+                break;
+            case 1:
+                if(m.size < MAX_SIZE)
+                {
+                    list_push_front(l, ELEMENT(v));
+                    model_insert(&m, 0, v);
+                }
+                break;
+            case 2:
+                if(m.size < MAX_SIZE)
+                {
+                    p = rand() % (m.size + 1);
+                    list_insert_at(l, p, ELEMENT(v));
+                    model_insert(&m, p, v);
+                }
+                break;
+            case 3:
+                if(m.size > 0)
+                {
+                    p = rand() % m.size;
+                    list_remove_at(l, p);
+                    model_remove(&m, p);
+                }
+                break;
+            case 4:
+                if(m.size > 0)
+                {
+                    CHECK(VALUE(list_front(l)) == m.values[0]);
+                    list_pop_front(l);
+                    model_remove(&m, 0);
+                }
+                break;
+            default:
+                if(m.size > 0)
+                {
+                    CHECK(VALUE(list_back(l)) == m.values[m.size - 1]);
+                    list_pop_back(l);
+                    model_remove(&m, m.size - 1);
+                }
+                break;
+        }
+        if(!same(l, &m))
+        {
+            CHECK(same(l, &m));
+            break;
+        }
+    }
+
+    list_delete(l);
+}
+
+
+static void *twice(void *v)
+{
+    return ELEMENT(2 * VALUE(v));
+}
+
+
+static void sum(void *v, void *userData)
+{
+    *(long *)userData += VALUE(v);
+}
+
+
+static void combine(void *result, void *part)
+{
+    *(long *)result += *(long *)part;
+}
+
+
+/* a walk which removes the odd values and inserts the opposite of the others before them */
+static void check_iterator(int direction)
+{
+    List *l = list_create();
+    ListIterator *it;
+    Model m = { .size = 0 };
+    int i, p, v, seen = 0;
+
+    for(i = 0 ; i < MAX_SIZE ; i++)
+    {
+        /* the values start in the middle of the array, the walk crosses its end */
+        if(i % 2)
+            list_push_back(l, ELEMENT(i));
+        else
+            list_push_front(l, ELEMENT(i));
+    }
+    for(i = 0 ; i < MAX_SIZE ; i++)
+        m.values[i] = VALUE(list_at(l, i));
+    m.size = MAX_SIZE;
+
+    it = listIterator_create(l, direction);
+    p = (direction == FORWARD_ITERATOR) ? 0 : m.size - 1;
+    while(!listIterator_end(it))
+    {
+        v = VALUE(listIterator_value(it));
+        CHECK(v == m.values[p]);
+        seen++;
+        if(v % 2)
+        {
+            listIterator_remove(it);
+            model_remove(&m, p);
+            p -= (direction != FORWARD_ITERATOR);
+            continue;
+        }
+        listIterator_insert(it, ELEMENT(-v));
+        if(direction == FORWARD_ITERATOR)
+        {
+            model_insert(&m, p, -v);
+            p += 2;
+        }
+        else
+        {
+            model_insert(&m, p + 1, -v);
+            p--;
+        }
+        listIterator_next(it);
+    }
+    CHECK(seen == MAX_SIZE);
+    CHECK(same(l, &m));
+
+    /* at the end, the value goes at the end in the direction of the iterator */
+    listIterator_insert(it, ELEMENT(1000));
+    CHECK(VALUE((direction == FORWARD_ITERATOR) ? list_back(l) : list_front(l)) == 1000);
+
+    /* the walk again, every value removed */
+    for(it = listIterator_begin(it) ; !listIterator_end(it) ; )
+        listIterator_remove(it);
+    CHECK(list_is_empty(l));
+
+    listIterator_delete(it);
+    list_delete(l);
+}
+
+
+/* map and reduce, in order and on the pool */
+static void check_map_reduce(void)
+{
+    List *l = list_create();
+    long total = 0, identity = 0;
+    int i;
+
+    for(i = 0 ; i < PARALLEL_SIZE ; i++)
+        list_push_front(l, ELEMENT(PARALLEL_SIZE - 1 - i));
+
+    list_map(l, twice);
+    list_reduce(l, sum, &total);
+    CHECK(total == (long)PARALLEL_SIZE * (PARALLEL_SIZE - 1));
+
+    list_map_parallel(l, twice);
+    for(i = 0 ; i < PARALLEL_SIZE && VALUE(list_at(l, i)) == 4 * i ; i++);
+    CHECK(i == PARALLEL_SIZE);
+
+    total = 0;
+    list_reduce_parallel(l, sum, combine, &total, &identity, sizeof(long));
+    CHECK(total == 2L * PARALLEL_SIZE * (PARALLEL_SIZE - 1));
+
+    list_delete(l);
+}
+
+
+int main(int argc, char **argv)
+{
+    /* the name of the program tells the backend */
+    const char *name = (argc > 0 && strrchr(argv[0], '/') != NULL) ? strrchr(argv[0], '/') + 1 : "list";
+
+    check_positions();
+    check_iterator(FORWARD_ITERATOR);
+    check_iterator(BACKWARD_ITERATOR);
+    check_map_reduce();
+
+    printf("%s : %s\n", name, failures == 0 ? "ok" : "FAILED");
+
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,199 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "tlist.h"
+
+/*
+   Behaviour of DEFINE_LIST : make check, or
+      gcc -o check_list_typed List/check_typed.c && ./check_list_typed
+   Random operations are done on a list and on a plain array, both must hold the same values.
+   The program ends with 1 if a check fails.
+*/
+
+#define OPERATIONS 200000
+#define MAX_SIZE 100 /* the list wraps around its array and grows */
+
+#define CHECK(cond) do { if(!(cond)) { fprintf(stderr, "Error : %s:%d : %s\n", __FILE__, __LINE__, #cond); failures++; } } while(0)
+
+DEFINE_LIST(int)
+
+static int failures = 0;
+
+
+/* the reference : a plain array */
+typedef struct s_Model {
+
+    int values[4 * MAX_SIZE];
+    int size;
+} Model;
+
+
+static void model_insert(Model *m, int p, int v)
+{
+    memmove(m->values + p + 1, m->values + p, (m->size - p) * sizeof(int));
+    m->values[p] = v;
+    m->size++;
+}
+
+
+static void model_remove(Model *m, int p)
+{
+    memmove(m->values + p, m->values + p + 1, (m->size - p - 1) * sizeof(int));
+    m->size--;
+}
+
+
+static bool same(List_int *l, const Model *m)
+{
+    int i;
+
+    if(list_int_size(l) != m->size)
+        return false;
+    for(i = 0 ; i < m->size ; i++)
+    {
+        if(*list_int_at(l, i) != m->values[i])
+            return false;
+    }
+    return true;
+}
+
+
+/* the operations by position, each end and the middle */
+static void check_positions(void)
+{
+    List_int *l = list_int_create();
+    Model m = { .size = 0 };
+    int i, p, v;
+
+    srand(1);
+    for(i = 0 ; i < OPERATIONS ; i++)
+    {
+        v = rand();
+        switch(rand() % 6)
+        {
+            case 0:
+                if(m.size < MAX_SIZE)
+                {
+                    list_int_push_back(l, v);
+                    model_insert(&m, m.size, v);
+                }
+                break;
+            case 1:
+                if(m.size < MAX_SIZE)
+                {
+                    list_int_push_front(l, v);
+                    model_insert(&m, 0, v);
+                }
+                break;
+            case 2:
+                if(m.size < MAX_SIZE)
+                {
+                    p = rand() % (m.size + 1);
+                    list_int_insert_at(l, p, v);
+                    model_insert(&m, p, v);
+                }
+                break;
+            case 3:
+                if(m.size > 0)
+                {
+                    p = rand() % m.size;
+                    list_int_remove_at(l, p);
+                    model_remove(&m, p);
+                }
+                break;
+            case 4:
+                if(m.size > 0)
+                {
+                    CHECK(*list_int_front(l) == m.values[0]);
+                    list_int_pop_front(l);
+                    model_remove(&m, 0);
+                }
+                break;
+            default:
+                if(m.size > 0)
+                {
+                    CHECK(*list_int_back(l) == m.values[m.size - 1]);
+                    list_int_pop_back(l);
+                    model_remove(&m, m.size - 1);
+                }
+                break;
+        }
+        if(!same(l, &m))
+        {
+            CHECK(same(l, &m));
+            break;
+        }
+    }
+
+    list_int_delete(l);
+}
+
+
+/* a walk which removes the odd values and inserts a copy of the others before them */
+static void check_iterator(int direction)
+{
+    List_int *l = list_int_create();
+    ListIterator_int *it;
+    Model m = { .size = 0 };
+    int i, p, seen = 0;
+
+    for(i = 0 ; i < MAX_SIZE ; i++)
+    {
+        /* the values start in the middle of the array, the walk crosses its end */
+        if(i % 2)
+            list_int_push_back(l, i);
+        else
+            list_int_push_front(l, i);
+    }
+    for(i = 0 ; i < MAX_SIZE ; i++)
+        m.values[i] = *list_int_at(l, i);
+    m.size = MAX_SIZE;
+
+    it = listIterator_int_create(l, direction);
+    p = (direction == FORWARD_ITERATOR) ? 0 : m.size - 1;
+    while(!listIterator_int_end(it))
+    {
+        CHECK(*listIterator_int_value(it) == m.values[p]);
+        seen++;
+        if(*listIterator_int_value(it) % 2)
+        {
+            listIterator_int_remove(it);
+            model_remove(&m, p);
+            p -= (direction != FORWARD_ITERATOR);
+            continue;
+        }
+        listIterator_int_insert(it, -*listIterator_int_value(it));
+        if(direction == FORWARD_ITERATOR)
+        {
+            model_insert(&m, p, -m.values[p]);
+            p += 2;
+        }
+        else
+        {
+            model_insert(&m, p + 1, -m.values[p]);
+            p--;
+        }
+        listIterator_int_next(it);
+    }
+    CHECK(seen == MAX_SIZE);
+    CHECK(same(l, &m));
+
+    /* at the end, the value goes at the end in the direction of the iterator */
+    listIterator_int_insert(it, 1000);
+    CHECK(*((direction == FORWARD_ITERATOR) ? list_int_back(l) : list_int_front(l)) == 1000);
+
+    listIterator_int_delete(it);
+    list_int_delete(l);
+}
+
+
+int main(void)
+{
+    check_positions();
+    check_iterator(FORWARD_ITERATOR);
+    check_iterator(BACKWARD_ITERATOR);
+
+    printf("list typed : %s\n", failures == 0 ? "ok" : "FAILED");
+
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,169 @@
+/**
+ * @file ilist.c
+ * @author Alary Dorian
+ * @brief Intrusive list : the element embeds its own links, the list allocates nothing
+ * @version 0.1
+ * @date 2022-07-27
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <stdlib.h>
+#include <assert.h>
+#include "ilist.h"
+
+
+/**
+* @brief	Initialise an embedded list.
+* @param l 	The list to initialise.
+*/
+void ilist_init(IntrusiveList *l)
+{
+	l->sentinel.previous = l->sentinel.next = &l->sentinel;
+	l->size = 0;
+}
+
+
+/**
+* @brief	Specification of the the constructor
+* @return	IntrusiveList
+*/
+IntrusiveList *ilist_create()
+{
+	IntrusiveList *l = malloc(sizeof(IntrusiveList));
+	ilist_init(l);
+
+	return l;
+}
+
+
+/** Destructor.
+* @brief 	Free the list created by ilist_create.
+* @param l 	The adress of the list.
+* @note 	The elements are not freed, they belong to the caller.
+ */
+void ilist_delete(IntrusiveList *l)
+{
+	free(l);
+}
+
+
+/**
+* @brief 	Add a node at the front of the list.
+* @param l 	The list to modify
+* @param n 	The node embedded in the element to add
+* @return 	The modified list
+* @pre 		n is not in a list
+*/
+IntrusiveList *ilist_push_front(IntrusiveList *l, ListNode *n)
+{
+	n->previous = &l->sentinel;
+	n->next = l->sentinel.next;
+	n->next->previous = n;
+	l->sentinel.next = n;
+	l->size++;
+
+	return l;
+}
+
+
+/**
+* @brief 	Add a node at the end of the list.
+* @param l 	The list to modify
+* @param n 	The node embedded in the element to add
+* @return 	The modified list
+* @pre 		n is not in a list
+*/
+IntrusiveList *ilist_push_back(IntrusiveList *l, ListNode *n)
+{
+	n->next = &l->sentinel;
+	n->previous = l->sentinel.previous;
+	n->previous->next = n;
+	l->sentinel.previous = n;
+	l->size++;
+
+	return l;
+}
+
+
+/**
+* @brief 	Remove a node from the list, in O(1).
+* @param l 	The list to modify
+* @param n 	The node to remove
+* @return 	The modified list
+* @pre 		n is in l
+*/
+IntrusiveList *ilist_remove(IntrusiveList *l, ListNode *n)
+{
+	assert(!ilist_is_empty(l) && n != &l->sentinel);
+
+	n->previous->next = n->next;
+	n->next->previous = n->previous;
+	n->previous = n->next = NULL;
+	l->size--;
+
+	return l;
+}
+
+
+/**
+* @brief 	Rotate the list so that n becomes its front, in O(1) : the nodes before n go at the end.
+* @param l 	The list to modify
+* @param n 	The node which becomes the front
+* @return 	The modified list
+* @pre 		n is in l
+*/
+IntrusiveList *ilist_rotate(IntrusiveList *l, ListNode *n)
+{
+	ListNode *s = &l->sentinel;
+
+	assert(n != s);
+
+	/* the sentinel is moved just before n */
+	s->previous->next = s->next;
+	s->next->previous = s->previous;
+	s->previous = n->previous;
+	s->next = n;
+	n->previous->next = s;
+	n->previous = s;
+
+	return l;
+}
+
+
+/**
+* @brief 	Acces to the node at begining of the list.
+* @pre 		!ilist_is_empty(l)
+*/
+ListNode *ilist_front(IntrusiveList *l)
+{
+	return l->sentinel.next;
+}
+
+
+/**
+* @brief 	Acces to the node at end of the list.
+* @pre 		!ilist_is_empty(l)
+*/
+ListNode *ilist_back(IntrusiveList *l)
+{
+	return l->sentinel.previous;
+}
+
+
+/**
+* @brief 	Test if a list is empty.
+*/
+bool ilist_is_empty(IntrusiveList *l)
+{
+	return l->size == 0;
+}
+
+
+/**
+* @brief 	Give the number of elements of the list.
+*/
+int ilist_size(IntrusiveList *l)
+{
+	return l->size;
+}
@@ -0,0 +1,156 @@
+/**
+ * @file ilist.h
+ * @author Alary Dorian
+ * @brief Intrusive list : the element embeds its own links, the list allocates nothing
+ * @version 0.1
+ * @date 2022-07-27
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef __ILIST_H__
+#define __ILIST_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/*-----------------------------------------------------------------*/
+
+
+/**
+* @brief 	Links of an element, to be embedded in the structure of the element.
+*/
+typedef struct s_ListNode {
+
+	struct s_ListNode *previous;
+	struct s_ListNode *next;
+} ListNode;
+
+
+/**
+* @brief 	Definition of type IntrusiveList, it can be embedded in a structure or created by ilist_create.
+*/
+typedef struct s_IntrusiveList {
+
+	ListNode sentinel;
+	int size;
+} IntrusiveList;
+
+
+/*-----------------------------------------------------------------*/
+
+
+/**
+* @brief 	Give the element which embeds a node.
+* @param n 	Pointer on the node.
+* @param type 	Type of the element.
+* @param member Name of the ListNode field in the element.
+*/
+#define ilist_entry(n, type, member) ((type *)((char *)(n) - offsetof(type, member)))
+
+
+/**
+* @brief 	Loop on each node of the list, from the beginning to the end.
+* @note 	The current node must not be removed, use ilist_for_each_safe.
+*/
+#define ilist_for_each(n, l) for((n) = (l)->sentinel.next ; (n) != &(l)->sentinel ; (n) = (n)->next)
+
+
+/**
+* @brief 	Loop on each node of the list, the current node can be removed.
+* @param tmp 	ListNode pointer used to keep the next node.
+*/
+#define ilist_for_each_safe(n, tmp, l) for((n) = (l)->sentinel.next, (tmp) = (n)->next ; (n) != &(l)->sentinel ; (n) = (tmp), (tmp) = (n)->next)
+
+
+/*-----------------------------------------------------------------*/
+
+
+/**
+* @brief	Initialise an embedded list.
+* @param l 	The list to initialise.
+*/
+void ilist_init(IntrusiveList *l);
+
+
+/**
+* @brief	Specification of the the constructor
+* @return	IntrusiveList
+*/
+IntrusiveList *ilist_create();
+
+
+/** Destructor.
+* @brief 	Free the list created by ilist_create.
+* @param l 	The adress of the list.
+* @note 	The elements are not freed, they belong to the caller.
+ */
+void ilist_delete(IntrusiveList *l);
+
+
+/**
+* @brief 	Add a node at the front of the list.
+* @param l 	The list to modify
+* @param n 	The node embedded in the element to add
+* @return 	The modified list
+* @pre 		n is not in a list
+*/
+IntrusiveList *ilist_push_front(IntrusiveList *l, ListNode *n);
+
+
+/**
+* @brief 	Add a node at the end of the list.
+* @param l 	The list to modify
+* @param n 	The node embedded in the element to add
+* @return 	The modified list
+* @pre 		n is not in a list
+*/
+IntrusiveList *ilist_push_back(IntrusiveList *l, ListNode *n);
+
+
+/**
+* @brief 	Remove a node from the list, in O(1).
+* @param l 	The list to modify
+* @param n 	The node to remove
+* @return 	The modified list
+* @pre 		n is in l
+*/
+IntrusiveList *ilist_remove(IntrusiveList *l, ListNode *n);
+
+
+/**
+* @brief 	Rotate the list so that n becomes its front, in O(1) : the nodes before n go at the end.
+* @param l 	The list to modify
+* @param n 	The node which becomes the front
+* @return 	The modified list
+* @pre 		n is in l
+*/
+IntrusiveList *ilist_rotate(IntrusiveList *l, ListNode *n);
+
+
+/**
+* @brief 	Acces to the node at begining of the list.
+* @pre 		!ilist_is_empty(l)
+*/
+ListNode *ilist_front(IntrusiveList *l);
+
+
+/**
+* @brief 	Acces to the node at end of the list.
+* @pre 		!ilist_is_empty(l)
+*/
+ListNode *ilist_back(IntrusiveList *l);
+
+
+/**
+* @brief 	Test if a list is empty.
+*/
+bool ilist_is_empty(IntrusiveList *l);
+
+
+/**
+* @brief 	Give the number of elements of the list.
+*/
+int ilist_size(IntrusiveList *l);
+
+#endif
@@ -11,6 +11,7 @@
 #include <stdlib.h>
 #include <assert.h>
 #include "list.h"
+#include "list_range.h"
 
 typedef struct s_LinkedElement {
 
@@ -309,8 +310,80 @@ List *list_reduce(List *l, ReduceFunctor f, void *userData)
 
 /*-----------------------------------------------------------------*/
 
-/* 	If a value are remove in the list during a loop on the list with the iterator, program crash.
-	The solution is to begin a loop, remove a value, break the loop, and begin a new loop.
+/**
+ * @brief Split the list in consecutive ranges of the same size
+ *
+ * @param l the list
+ * @param range array of ranges, filled by the function
+ * @param parts number of ranges, at most the size of the list
+ * @note The first ranges take the rest of the division.
+ */
+void list_split(List *l, ListRange *range, int parts)
+{
+	LinkedElement *e = l->sentinel->next;
+	int i, j, start = 0;
+
+	/* one walk on the list */
+	for (i = 0; i < parts; i++) 
+	{
+		range[i].first = e;
+		range[i].start = start;
+		range[i].count = l->size / parts + (i < l->size % parts);
+		for (j = 0; j < range[i].count; j++) 
+		{
+			e = e->next;
+		}
+		start += range[i].count;
+	}
+}
+
+
+/**
+ * @brief Apply the operator on each element of a range, the value returned replaces the element
+ *
+ * @param l the list
+ * @param r the range
+ * @param f the operator
+ */
+void list_range_map(List *l, const ListRange *r, SimpleFunctor f)
+{
+	LinkedElement *e = r->first;
+	int i;
+
+	(void)l;
+
+	for (i = 0; i < r->count; i++, e = e->next) 
+	{
+		e->value = f(e->value);
+	}
+}
+
+
+/**
+ * @brief Apply the operator on each element of a range with a user data, in the order of the list
+ *
+ * @param l the list
+ * @param r the range
+ * @param f the operator
+ * @param userData the environment of the operator
+ */
+void list_range_reduce(List *l, const ListRange *r, ReduceFunctor f, void *userData)
+{
+	LinkedElement *e = r->first;
+	int i;
+
+	(void)l;
+
+	for (i = 0; i < r->count; i++, e = e->next) 
+	{
+		f(e->value, userData);
+	}
+}
+
+/*-----------------------------------------------------------------*/
+
+/* 	A value is removed during a loop on the list with listIterator_remove, which leaves the iterator on the next value :
+	list_remove_at or a removal by another iterator makes the iterator not valid.
 */
 
 struct s_ListIterator {
@@ -424,6 +497,51 @@ void *listIterator_value(ListIterator *it)
 	return it->current->value;
 }
 
+/**
+ * @brief Remove the current element, the iterator goes on the next element
+ * 
+ * @param it pointer on iterator
+ * @return ListIterator* pointer on iterator
+ * @pre !listIterator_end(it)
+ * @note O(1) in list.c, list_array.c moves the shortest side of the array. The other iterators of the list are not valid anymore.
+ */
+ListIterator *listIterator_remove(ListIterator *it)
+{
+	LinkedElement *supp = it->current;
+
+	assert(supp != it->collection->sentinel);
+	it->current = it->next(supp);
+	supp->previous->next = supp->next;
+	supp->next->previous = supp->previous;
+	free(supp);
+	it->collection->size--;
+	return it;
+}
+
+
+/**
+ * @brief Insert a value before the current element, in the direction of the iterator : the iterator stays on the current element and does not see the value
+ * 
+ * @param it pointer on iterator
+ * @param v the value to add
+ * @return ListIterator* pointer on iterator
+ * @note At the end of the list, the value is added at the end in the direction of the iterator. The other iterators of the list are not valid anymore.
+ */
+ListIterator *listIterator_insert(ListIterator *it, void *v)
+{
+	LinkedElement *e = malloc(sizeof(LinkedElement));
+
+	/* before in the direction of a backward iterator is after in the list */
+	e->value = v;
+	e->next = (it->next == goto_next) ? it->current : it->current->next;
+	e->previous = e->next->previous;
+	e->previous->next = e;
+	e->next->previous = e;
+	it->collection->size++;
+	return it;
+}
+
+
 /**
  * @brief Delete the iterator
  * 
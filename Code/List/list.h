@@ -3,6 +3,9 @@
  * @author Alary Dorian
  * @version 0.1
  * @date 2022-07-06
+ * @note Two implementations : list.c (doubly linked list) and list_array.c (circular array, O(1) list_at).
+ * 		 The implementation is chosen at build time, make LIST=array for list_array.c.
+ * 		 list_map_parallel and list_reduce_parallel are in list_parallel.c, which needs Pool/pool.c and -pthread.
  * 
  * @copyright Copyright (c) 2022
  * 
@@ -11,6 +14,7 @@
 #define __LIST_H__
 
 #include <stdbool.h>
+#include <stddef.h>
 
 /*-----------------------------------------------------------------*/
 
@@ -46,6 +50,18 @@ typedef void *(*SimpleFunctor)(void *);
 typedef void(*ReduceFunctor)(void *, void *);
 
 
+/** 
+* @brief 	Functor to be used with the list_reduce_parallel operator, to merge a partial result in the result.
+* @param	(void*) Result of the elements before the part
+* @param	(void*) Partial result of a part of the list
+*/
+typedef void(*CombineFunctor)(void *, void *);
+
+
+/* Elements by part under which the parallel operators run sequentially */
+#define LIST_PARALLEL_GRAIN 4096
+
+
 /*-----------------------------------------------------------------*/
 
 
@@ -197,6 +213,38 @@ List * list_map(List *l, SimpleFunctor f);
 List *list_reduce(List *l, ReduceFunctor f, void *userData);
 
 
+/** 
+* @brief 	Apply the same operator on each element of the list, in parallel on the threads of pool_default().
+* @param l 	The list to process.
+* @param f 	The operator (function) to apply to each element, it must be thread-safe
+* @see 		SimpleFunctor
+* @return 	The eventually modified list
+* @note 	The list is split in consecutive parts executed by the pool, the function returns when every part is done.
+			As with list_map, the value returned by the operator when called on an element replaces this element,
+			but the operator is not called in the order of the list.
+			A list smaller than 2 * LIST_PARALLEL_GRAIN is processed by list_map.
+*/
+List *list_map_parallel(List *l, SimpleFunctor f);
+
+
+/** 
+* @brief 	Reduce the list in parallel on the threads of pool_default().
+* @param l 	The list to process.
+* @param f 	The operator (function) to apply to each element with the partial result of its part, it must be thread-safe
+* @param combine The operator which merges the partial result of a part in userData
+* @param userData The environment used to call the operator f, it stores the result.
+* @param identity Initial value of the partial result of a part, size bytes are copied.
+* @param size Size of the environment.
+* @see 		ReduceFunctor, CombineFunctor
+* @return 	The list
+* @note 	The list is split in consecutive parts, f is called on each element of a part in the order of the list.
+			The partial results are combined in userData in the order of the list, 
+			so an associative operator gives the same result as list_reduce.
+			A list smaller than 2 * LIST_PARALLEL_GRAIN is processed by list_reduce.
+*/
+List *list_reduce_parallel(List *l, ReduceFunctor f, CombineFunctor combine, void *userData, const void *identity, size_t size);
+
+
 /*-----------------------------------------------------------------*/
 
 
@@ -256,6 +304,28 @@ ListIterator *listIterator_next(ListIterator *it);
 void *listIterator_value(ListIterator *it);
 
 
+/**
+ * @brief Remove the current element, the iterator goes on the next element
+ * 
+ * @param it pointer on iterator
+ * @return ListIterator* pointer on iterator
+ * @pre !listIterator_end(it)
+ * @note O(1) in list.c, list_array.c moves the shortest side of the array. The other iterators of the list are not valid anymore.
+ */
+ListIterator *listIterator_remove(ListIterator *it);
+
+
+/**
+ * @brief Insert a value before the current element, in the direction of the iterator : the iterator stays on the current element and does not see the value
+ * 
+ * @param it pointer on iterator
+ * @param v the value to add
+ * @return ListIterator* pointer on iterator
+ * @note At the end of the list, the value is added at the end in the direction of the iterator. The other iterators of the list are not valid anymore.
+ */
+ListIterator *listIterator_insert(ListIterator *it, void *v);
+
+
 /**
  * @brief Delete the iterator
  * 
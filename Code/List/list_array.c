@@ -0,0 +1,551 @@
+/**
+ * @file list_array.c
+ * @author Alary Dorian
+ * @brief Implementation of list.h in a contiguous growable circular array
+ * @version 0.1
+ * @date 2022-07-28
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "list.h"
+#include "list_range.h"
+
+/*
+	The values are stored in a circular array, value p is at (head + p) & (capacity - 1).
+	Both ends are O(1), list_at is O(1), list_insert_at and list_remove_at move
+	the shortest side of the array. The capacity is a power of 2 and doubles when full.
+*/
+
+#define LIST_ARRAY_CAPACITY 16 /* capacity of a new list */
+
+
+struct s_List {
+
+	void **values; /* circular array */
+	int capacity; /* number of slots, power of 2 */
+	int head; /* slot of the first value */
+	int size;
+};
+
+/*-----------------------------------------------------------------*/
+
+/**
+ * @brief Slot of the value at position p
+ *
+ * @param l the list
+ * @param p position in the list, -1 <= p <= capacity
+ * @return int slot in the array
+ */
+static int list_slot(List *l, int p)
+{
+	return (l->head + p) & (l->capacity - 1);
+}
+
+
+/**
+ * @brief Double the capacity when the array is full, the values are copied to the beginning of the new array
+ *
+ * @param l the list
+ */
+static void list_grow(List *l)
+{
+	void **values;
+	int first;
+
+	if(l->size < l->capacity)
+		return;
+
+	values = malloc(2 * l->capacity * sizeof(void *));
+	first = l->capacity - l->head;
+	memcpy(values, l->values + l->head, first * sizeof(void *));
+	memcpy(values + first, l->values, l->head * sizeof(void *));
+	free(l->values);
+
+	l->values = values;
+	l->capacity *= 2;
+	l->head = 0;
+}
+
+
+/**
+ * @brief Move count values from position src to position dst, one by one as the array is circular
+ *
+ * @param l the list
+ * @param dst destination position
+ * @param src source position
+ * @param count number of values
+ */
+static void list_move(List *l, int dst, int src, int count)
+{
+	int i;
+
+	if(dst < src)
+	{
+		for(i = 0 ; i < count ; i++)
+			l->values[list_slot(l, dst + i)] = l->values[list_slot(l, src + i)];
+	}
+	else
+	{
+		for(i = count - 1 ; i >= 0 ; i--)
+			l->values[list_slot(l, dst + i)] = l->values[list_slot(l, src + i)];
+	}
+}
+
+/*-----------------------------------------------------------------*/
+
+/**
+* @brief	Specification of the the constructor
+* @return	List
+*/
+List *list_create()
+{
+	List *l = malloc(sizeof(List));
+	l->values = malloc(LIST_ARRAY_CAPACITY * sizeof(void *));
+	l->capacity = LIST_ARRAY_CAPACITY;
+	l->head = 0;
+	l->size = 0;
+
+	return l;
+}
+
+
+/** Specification of the the constructor \c push_back
+* @brief 	Add the value v at the end of the list l.
+* @param l 	The list to modify
+* @param v 	The value to add
+* @return 	The modified list
+* @note 	This function acts by side effect on the parameter l.
+			The returned value is the same as the parameter l that is modified by the function.
+*/
+List *list_push_back(List *l, void *v)
+{
+	list_grow(l);
+	l->values[list_slot(l, l->size)] = v;
+	l->size++;
+
+	return l;
+}
+
+
+/** Destructor.
+* @brief 	Free ressources allocated by constructors.
+* @param l 	The adress of the list.
+* @note 	After calling this function, the list l becomes NULL.
+ */
+void list_delete(List *l)
+{
+	free(l->values);
+	free(l);
+}
+
+
+/**
+* @brief 	Add an element at the front of the list.
+* @param l 	The list to modify
+* @param v 	The value to add (void * type)
+* @return 	The modified list
+* @note 	The returned value is the same as the parameter l that is modified by the function.
+ */
+List *list_push_front(List *l, void *v)
+{
+	list_grow(l);
+	l->head = list_slot(l, -1);
+	l->values[l->head] = v;
+	l->size++;
+
+	return l;
+}
+
+
+/**
+* @brief 	Acces to the element at begining of the list.
+* @return 	The value of the front element of l.
+* @pre 		!empty(l)
+*/
+void *list_front(List *l)
+{
+	return l->values[l->head];
+}
+
+
+/**
+* @brief 	Acces to the element at end of the list.
+* @return 	The value of the back element of l.
+* @pre 		!empty(l)
+*/
+void *list_back(List *l)
+{
+	return l->values[list_slot(l, l->size - 1)];
+}
+
+
+/**
+* @brief 	Remove the element at begining of the list.
+* @return 	The modified list
+* @note		This function acts by side effect on the parameter l. The returned value is the same as the parameter l that is modified by the function.
+* @pre 		!empty(l)
+*/
+List *list_pop_front(List *l)
+{
+	assert(!list_is_empty(l));
+
+	l->head = list_slot(l, 1);
+	l->size--;
+
+	return l;
+}
+
+
+/**
+* @brief 	Remove the element at end of the list.
+* @return 	The modified list
+* @note 	This function acts by side effect on the parameter l. The returned value is the same as the parameter l that is modified by the function.
+* @pre 		!empty(l)
+*/
+List *list_pop_back(List *l)
+{
+	assert(!list_is_empty(l));
+
+	l->size--;
+
+	return l;
+}
+
+
+/**
+* @brief 	Insert an element at a given position.
+* @param l 	The list to modify.
+* @param p 	The position to insert.
+* @param v 	The value to add.
+* @return	The modified list.
+* @pre 		0 <= p <= list_size(l)
+* @note 	This function acts by side effect on the parameter l.
+			The returned value is the same as the parameter l that is modified by the function.
+*/
+List *list_insert_at(List *l, int p, void *v)
+{
+	list_grow(l);
+
+	/* the shortest side is moved */
+	if(p < l->size - p)
+	{
+		l->head = list_slot(l, -1);
+		list_move(l, 0, 1, p);
+	}
+	else
+	{
+		list_move(l, p + 1, p, l->size - p);
+	}
+	l->values[list_slot(l, p)] = v;
+	l->size++;
+
+	return l;
+}
+
+
+/**
+* @brief 	Remove an element at a given position.
+* @param l 	The list to modify.
+* @param p 	The position of the element to be removed.
+* @return 	The modified list.
+* @pre 		0 <= p < list_size(l)
+* @note 	This function acts by side effect on the parameter l.
+ 			The returned value is the same as the parameter l that is modified by the function.
+*/
+List *list_remove_at(List *l, int p)
+{
+	assert(0 <= p && p < l->size);
+
+	/* the shortest side is moved */
+	if(p < l->size - 1 - p)
+	{
+		list_move(l, 1, 0, p);
+		l->head = list_slot(l, 1);
+	}
+	else
+	{
+		list_move(l, p, p + 1, l->size - 1 - p);
+	}
+	l->size--;
+
+	return l;
+}
+
+
+/**
+* @brief 	Acces to an element at a given position.
+* @param l 	The list to acces.
+* @param p 	The position to acces.
+* @return 	The value of the element at position p.
+* @pre 		0 <= p < list_size(l)
+*/
+void *list_at(List *l, int p)
+{
+	return l->values[list_slot(l, p)];
+}
+
+
+/**
+* @brief 	Test if a list is empty.
+*/
+bool list_is_empty(List *l)
+{
+	return l->size == 0;
+}
+
+
+/**
+* @brief 	Give the number of elements of the list.
+*/
+int list_size(List *l)
+{
+	return l->size;
+}
+
+
+/**
+* @brief 	Apply the same operator on each element of the list.
+* @param l 	The list to process.
+* @param f 	The operator (function) to apply to each element
+* @see 		SimpleFunctor
+* @return 	The eventually modified list
+* @note 	If the elements are modified by the operator f, this function acts by side effect on the parameter l.
+			The returned value is the same as the parameter l that is modified bye the function.
+ 			This function sequentially apply the operator f on each element of the list,
+			starting from the beginning of the list until the end.
+			The value reurned by the operator when called on an element will replace the element.
+*/
+List * list_map(List *l, SimpleFunctor f)
+{
+	/* two contiguous runs : from head to the end of the array, then from the beginning */
+	int first = (l->head + l->size > l->capacity) ? l->capacity - l->head : l->size;
+	int i;
+
+	for(i = 0 ; i < first ; i++)
+		l->values[l->head + i] = f(l->values[l->head + i]);
+	for(i = 0 ; i < l->size - first ; i++)
+		l->values[i] = f(l->values[i]);
+
+	return l;
+}
+
+
+/**
+* @brief 	Apply the same operator on each element of the list gieven a user define environment.
+* @param l 	The list to process.
+* @param f 	The operator (function) to apply to each element
+* @param userData The environment used to call the operator f together with each list element.
+* @see 		ReduceFunctor
+* @return 	The eventually modified list
+* @note 	If the elements are modified by the operator f, this function acts by side effect on the parameter l.
+			The returned value is the same as the parameter l that is modified bye the function.
+ 			This function sequentially apply the operator f on each element of the list with the user supplied environment defined by the abstract pointer userData.
+			The operator is applied starting from the beginning of the list until the end.
+			The value reurned by the operator when called on an element will replace the element.
+*/
+List *list_reduce(List *l, ReduceFunctor f, void *userData)
+{
+	int first = (l->head + l->size > l->capacity) ? l->capacity - l->head : l->size;
+	int i;
+
+	for(i = 0 ; i < first ; i++)
+		f(l->values[l->head + i], userData);
+	for(i = 0 ; i < l->size - first ; i++)
+		f(l->values[i], userData);
+
+	return l;
+}
+
+/*-----------------------------------------------------------------*/
+
+/**
+ * @brief Split the list in consecutive ranges of the same size
+ *
+ * @param l the list
+ * @param range array of ranges, filled by the function
+ * @param parts number of ranges, at most the size of the list
+ * @note The first ranges take the rest of the division.
+ */
+void list_split(List *l, ListRange *range, int parts)
+{
+	int i, start = 0;
+
+	for(i = 0 ; i < parts ; i++)
+	{
+		range[i].first = NULL;
+		range[i].start = start;
+		range[i].count = l->size / parts + (i < l->size % parts);
+		start += range[i].count;
+	}
+}
+
+
+/**
+ * @brief Apply the operator on each element of a range, the value returned replaces the element
+ *
+ * @param l the list
+ * @param r the range
+ * @param f the operator
+ */
+void list_range_map(List *l, const ListRange *r, SimpleFunctor f)
+{
+	int i;
+
+	for(i = r->start ; i < r->start + r->count ; i++)
+		l->values[list_slot(l, i)] = f(l->values[list_slot(l, i)]);
+}
+
+
+/**
+ * @brief Apply the operator on each element of a range with a user data, in the order of the list
+ *
+ * @param l the list
+ * @param r the range
+ * @param f the operator
+ * @param userData the environment of the operator
+ */
+void list_range_reduce(List *l, const ListRange *r, ReduceFunctor f, void *userData)
+{
+	int i;
+
+	for(i = r->start ; i < r->start + r->count ; i++)
+		f(l->values[list_slot(l, i)], userData);
+}
+
+/*-----------------------------------------------------------------*/
+
+/* 	A value is removed during a loop on the list with listIterator_remove, which leaves the iterator on the next value :
+	list_remove_at or a removal by another iterator makes the iterator not valid.
+*/
+
+struct s_ListIterator {
+
+	List *collection; /* the collection the iterator is attached to */
+	int current; /* the position of the current element */
+	int step; /* +1 for a forward iterator, -1 for a backward iterator */
+};
+
+
+/**
+ * @brief create an iterator for a collection
+ *
+ * @param collection list
+ * @param direction reffered to define FORWARD_ITERATOR and BACKWARD_ITERATOR, tail to head and head to tail
+ * @return ListIterator* pointer on iterator
+ */
+ListIterator *listIterator_create(List *collection, int direction)
+{
+	ListIterator *it = malloc(sizeof(ListIterator));
+	it->collection = collection;
+	it->step = (direction == FORWARD_ITERATOR) ? 1 : -1;
+
+	return listIterator_begin(it);
+}
+
+
+/**
+ * @brief set the value of iterator on the begin of list
+ *
+ * @param i pointer on iterator
+ * @return ListIterator* pointer on iterator
+ */
+ListIterator *listIterator_begin(ListIterator *it)
+{
+	it->current = (it->step > 0) ? 0 : it->collection->size - 1;
+	return it;
+}
+
+
+/**
+ * @brief look if the value of iterator is the end of list
+ *
+ * @param i pointer on iterator
+ * @return true iterator is the end of list
+ * @return false iterator is not the end of list
+ */
+bool listIterator_end(ListIterator *it)
+{
+	return it->current < 0 || it->current >= it->collection->size;
+}
+
+
+/**
+ * @brief set iterator on the next element of the list
+ *
+ * @param i pointer on iterator
+ * @return ListIterator* pointer on iterator
+ */
+ListIterator *listIterator_next(ListIterator *it)
+{
+	it->current += it->step;
+	return it;
+}
+
+
+/**
+ * @brief return the value the iterator
+ *
+ * @param i pointer on iterator
+ * @return void * pointer on the current element
+ */
+void *listIterator_value(ListIterator *it)
+{
+	return list_at(it->collection, it->current);
+}
+
+/**
+ * @brief Remove the current element, the iterator goes on the next element
+ *
+ * @param it pointer on iterator
+ * @return ListIterator* pointer on iterator
+ * @pre !listIterator_end(it)
+ * @note O(1) in list.c, list_array.c moves the shortest side of the array. The other iterators of the list are not valid anymore.
+ */
+ListIterator *listIterator_remove(ListIterator *it)
+{
+	list_remove_at(it->collection, it->current);
+
+	/* forward, the next element takes the position of the current one */
+	if(it->step < 0)
+		it->current--;
+	return it;
+}
+
+
+/**
+ * @brief Insert a value before the current element, in the direction of the iterator : the iterator stays on the current element and does not see the value
+ *
+ * @param it pointer on iterator
+ * @param v the value to add
+ * @return ListIterator* pointer on iterator
+ * @note At the end of the list, the value is added at the end in the direction of the iterator. The other iterators of the list are not valid anymore.
+ */
+ListIterator *listIterator_insert(ListIterator *it, void *v)
+{
+	if(it->step > 0)
+	{
+		list_insert_at(it->collection, it->current, v);
+		it->current++;
+	}
+	else
+	{
+		list_insert_at(it->collection, it->current + 1, v);
+	}
+	return it;
+}
+
+
+/**
+ * @brief Delete the iterator
+ *
+ * @param it pointer on iterator
+ */
+void listIterator_delete(ListIterator *it)
+{
+	free(it);
+}
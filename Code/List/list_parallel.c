@@ -0,0 +1,189 @@
+/**
+ * @file list_parallel.c
+ * @author Alary Dorian
+ * @brief Parallel operators of list.h on the thread pool, for both implementations of the list
+ * @version 0.1
+ * @date 2022-08-01
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "list.h"
+#include "list_range.h"
+#include "../Pool/pool.h"
+
+/*
+	list.c and list_array.c do not depend on the pool : a program which uses
+	list_map_parallel or list_reduce_parallel links this file and Pool/pool.c.
+*/
+
+/* Consecutive part of a list processed by a thread of the pool */
+typedef struct s_ListPart {
+
+	List *collection; /* the list of the part */
+	ListRange range; /* elements of the part */
+	SimpleFunctor map; /* operator of list_map_parallel */
+	ReduceFunctor reduce; /* operator of list_reduce_parallel */
+	void *userData; /* partial result of the part */
+} ListPart;
+
+/*-----------------------------------------------------------------*/
+
+/**
+ * @brief Give the number of parts for a parallel operator
+ *
+ * @param l the list
+ * @return int number of parts, less than 2 if the list is processed sequentially
+ */
+static int list_parts(List *l)
+{
+	int parts = 4 * pool_size(pool_default()); /* more parts than threads, a thread which ends first steals a part */
+
+	if(list_size(l) / LIST_PARALLEL_GRAIN < parts)
+		parts = list_size(l) / LIST_PARALLEL_GRAIN;
+
+	return parts;
+}
+
+
+/**
+ * @brief Split the list in parts of the same size
+ *
+ * @param l the list
+ * @param parts number of parts
+ * @return ListPart* array of parts, to be freed
+ */
+static ListPart *list_parts_create(List *l, int parts)
+{
+	ListPart *part = malloc(parts * sizeof(ListPart));
+	ListRange *range = malloc(parts * sizeof(ListRange));
+	int i;
+
+	list_split(l, range, parts);
+	for(i = 0 ; i < parts ; i++)
+	{
+		part[i].collection = l;
+		part[i].range = range[i];
+	}
+	free(range);
+
+	return part;
+}
+
+
+/**
+ * @brief Task of list_map_parallel
+ *
+ * @param arg pointer on the part
+ */
+static void list_part_map(void *arg)
+{
+	ListPart *part = arg;
+
+	list_range_map(part->collection, &part->range, part->map);
+}
+
+
+/**
+ * @brief Task of list_reduce_parallel
+ *
+ * @param arg pointer on the part
+ */
+static void list_part_reduce(void *arg)
+{
+	ListPart *part = arg;
+
+	list_range_reduce(part->collection, &part->range, part->reduce, part->userData);
+}
+
+/*-----------------------------------------------------------------*/
+
+/**
+* @brief 	Apply the same operator on each element of the list, in parallel on the threads of pool_default().
+* @param l 	The list to process.
+* @param f 	The operator (function) to apply to each element, it must be thread-safe
+* @see 		SimpleFunctor
+* @return 	The eventually modified list
+* @note 	The list is split in consecutive parts executed by the pool, the function returns when every part is done.
+			As with list_map, the value returned by the operator when called on an element replaces this element,
+			but the operator is not called in the order of the list.
+			A list smaller than 2 * LIST_PARALLEL_GRAIN is processed by list_map.
+*/
+List *list_map_parallel(List *l, SimpleFunctor f)
+{
+	int parts = list_parts(l);
+	ListPart *part;
+	void **args;
+	int i;
+
+	if(parts < 2)
+		return list_map(l, f);
+
+	part = list_parts_create(l, parts);
+	args = malloc(parts * sizeof(void *));
+	for(i = 0 ; i < parts ; i++)
+	{
+		part[i].map = f;
+		args[i] = &part[i];
+	}
+
+	pool_run(pool_default(), list_part_map, args, parts);
+
+	free(args);
+	free(part);
+
+	return l;
+}
+
+
+/**
+* @brief 	Reduce the list in parallel on the threads of pool_default().
+* @param l 	The list to process.
+* @param f 	The operator (function) to apply to each element with the partial result of its part, it must be thread-safe
+* @param combine The operator which merges the partial result of a part in userData
+* @param userData The environment used to call the operator f, it stores the result.
+* @param identity Initial value of the partial result of a part, size bytes are copied.
+* @param size Size of the environment.
+* @see 		ReduceFunctor, CombineFunctor
+* @return 	The list
+* @note 	The list is split in consecutive parts, f is called on each element of a part in the order of the list.
+			The partial results are combined in userData in the order of the list,
+			so an associative operator gives the same result as list_reduce.
+			A list smaller than 2 * LIST_PARALLEL_GRAIN is processed by list_reduce.
+*/
+List *list_reduce_parallel(List *l, ReduceFunctor f, CombineFunctor combine, void *userData, const void *identity, size_t size)
+{
+	int parts = list_parts(l);
+	ListPart *part;
+	char *partials;
+	void **args;
+	int i;
+
+	if(parts < 2)
+		return list_reduce(l, f, userData);
+
+	part = list_parts_create(l, parts);
+	partials = malloc(parts * size);
+	args = malloc(parts * sizeof(void *));
+	for(i = 0 ; i < parts ; i++)
+	{
+		memcpy(partials + i * size, identity, size);
+		part[i].reduce = f;
+		part[i].userData = partials + i * size;
+		args[i] = &part[i];
+	}
+
+	pool_run(pool_default(), list_part_reduce, args, parts);
+
+	/* in the order of the list */
+	for(i = 0 ; i < parts ; i++)
+		combine(userData, part[i].userData);
+
+	free(args);
+	free(partials);
+	free(part);
+
+	return l;
+}
@@ -0,0 +1,64 @@
+/**
+ * @file list_range.h
+ * @author Alary Dorian
+ * @brief Consecutive ranges of a list, given by the implementation of list.h to list_parallel.c
+ * @version 0.1
+ * @date 2022-08-01
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef __LIST_RANGE_H__
+#define __LIST_RANGE_H__
+
+#include "list.h"
+
+/*-----------------------------------------------------------------*/
+
+
+/**
+* @brief 	Consecutive elements of a list, processed by a thread of the pool.
+*/
+typedef struct s_ListRange {
+
+	void *first; /* first element of the range in list.c, unused in list_array.c */
+	int start; /* position of the first element */
+	int count; /* number of elements of the range */
+} ListRange;
+
+
+/*-----------------------------------------------------------------*/
+
+
+/**
+ * @brief Split the list in consecutive ranges of the same size
+ *
+ * @param l the list
+ * @param range array of ranges, filled by the function
+ * @param parts number of ranges, at most the size of the list
+ * @note The first ranges take the rest of the division.
+ */
+void list_split(List *l, ListRange *range, int parts);
+
+
+/**
+ * @brief Apply the operator on each element of a range, the value returned replaces the element
+ *
+ * @param l the list
+ * @param r the range
+ * @param f the operator
+ */
+void list_range_map(List *l, const ListRange *r, SimpleFunctor f);
+
+
+/**
+ * @brief Apply the operator on each element of a range with a user data, in the order of the list
+ *
+ * @param l the list
+ * @param r the range
+ * @param f the operator
+ * @param userData the environment of the operator
+ */
+void list_range_reduce(List *l, const ListRange *r, ReduceFunctor f, void *userData);
+
+#endif
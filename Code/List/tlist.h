@@ -0,0 +1,324 @@
+/**
+ * @file tlist.h
+ * @author Alary Dorian
+ * @brief Typed list : DEFINE_LIST(T) generates a list of T whose values are stored in place, without void *
+ * @version 0.1
+ * @date 2022-08-24
+ * @note The list is the circular array of list_array.c, with the values instead of pointers on them :
+ * 		 no allocation by value and no pointer to follow. Everything is static inline, so a functor given
+ * 		 to list_T_map or list_T_reduce is known at compile time and inlined in the loop.
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef __TLIST_H__
+#define __TLIST_H__
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+
+/* Default values */
+#define TLIST_CAPACITY 16 /* capacity of a new list, a power of 2 which doubles when full */
+
+/* Directions of the iterators, the same as list.h */
+#ifndef FORWARD_ITERATOR
+#define FORWARD_ITERATOR 1
+#define BACKWARD_ITERATOR 0
+#endif
+
+
+/**
+* @brief 	Generate the type List_T and its functions, once by type in a translation unit.
+* @param T 	Type of the values, one identifier (a typedef for "unsigned int" or "struct s_x").
+*
+*	List_T *list_T_create(void)
+*	void list_T_delete(List_T *l)
+*	void list_T_push_back(List_T *l, T v)
+*	void list_T_push_front(List_T *l, T v)
+*	void list_T_pop_front(List_T *l)					@pre !list_T_is_empty(l)
+*	void list_T_pop_back(List_T *l)						@pre !list_T_is_empty(l)
+*	T *list_T_front(List_T *l)							@pre !list_T_is_empty(l)
+*	T *list_T_back(List_T *l)							@pre !list_T_is_empty(l)
+*	T *list_T_at(List_T *l, int p)						O(1), @pre 0 <= p < list_T_size(l)
+*	void list_T_insert_at(List_T *l, int p, T v)		the shortest side moves, @pre 0 <= p <= list_T_size(l)
+*	void list_T_remove_at(List_T *l, int p)				the shortest side moves, @pre 0 <= p < list_T_size(l)
+*	bool list_T_is_empty(List_T *l)
+*	int list_T_size(List_T *l)
+*	void list_T_map(List_T *l, void (*f)(T *))			f modifies each value in place
+*	void list_T_reduce(List_T *l, void (*f)(const T *, void *), void *userData)
+*	T *list_T_find(List_T *l, bool (*match)(const T *, const void *), const void *key)	first value matched, NULL if none
+*
+*	ListIterator_T *listIterator_T_create(List_T *l, int direction)	FORWARD_ITERATOR or BACKWARD_ITERATOR
+*	ListIterator_T *listIterator_T_begin(ListIterator_T *it)
+*	bool listIterator_T_end(ListIterator_T *it)
+*	ListIterator_T *listIterator_T_next(ListIterator_T *it)
+*	T *listIterator_T_value(ListIterator_T *it)			@pre !listIterator_T_end(it)
+*	ListIterator_T *listIterator_T_remove(ListIterator_T *it)	the iterator goes on the next value, @pre !listIterator_T_end(it)
+*	ListIterator_T *listIterator_T_insert(ListIterator_T *it, T v)	before the current value in the direction of the iterator, which does not see it
+*	void listIterator_T_delete(ListIterator_T *it)
+*
+* @note 	A pointer given by front, back, at, find or an iterator is valid until the list is modified.
+*			The iterators follow list_array.c : an insertion or a removal makes the other iterators of the list not valid.
+*			list_map_parallel and list_reduce_parallel have no typed version : the functors of list_T_map and list_T_reduce
+*			are inlined in a loop the compiler can vectorize, the pool of threads is for the generic list.
+*/
+#define DEFINE_LIST(T) \
+ \
+typedef struct s_List_##T { \
+ \
+	T *values; /* circular array */ \
+	int capacity; /* number of slots, power of 2 */ \
+	int head; /* slot of the first value */ \
+	int size; \
+} List_##T; \
+ \
+static inline int list_##T##_slot(List_##T *l, int p) \
+{ \
+	return (l->head + p) & (l->capacity - 1); \
+} \
+ \
+static inline void list_##T##_grow(List_##T *l) \
+{ \
+	T *values; \
+	int i; \
+ \
+	if(l->size < l->capacity) \
+		return; \
+	values = malloc(2 * l->capacity * sizeof(T)); \
+	for(i = 0 ; i < l->size ; i++) \
+		values[i] = l->values[list_##T##_slot(l, i)]; \
+	free(l->values); \
+	l->values = values; \
+	l->capacity *= 2; \
+	l->head = 0; \
+} \
+ \
+static inline List_##T *list_##T##_create(void) \
+{ \
+	List_##T *l = malloc(sizeof(List_##T)); \
+	l->values = malloc(TLIST_CAPACITY * sizeof(T)); \
+	l->capacity = TLIST_CAPACITY; \
+	l->head = 0; \
+	l->size = 0; \
+	return l; \
+} \
+ \
+static inline void list_##T##_delete(List_##T *l) \
+{ \
+	free(l->values); \
+	free(l); \
+} \
+ \
+static inline void list_##T##_push_back(List_##T *l, T v) \
+{ \
+	list_##T##_grow(l); \
+	l->values[list_##T##_slot(l, l->size)] = v; \
+	l->size++; \
+} \
+ \
+static inline void list_##T##_push_front(List_##T *l, T v) \
+{ \
+	list_##T##_grow(l); \
+	l->head = list_##T##_slot(l, -1); \
+	l->values[l->head] = v; \
+	l->size++; \
+} \
+ \
+static inline void list_##T##_pop_front(List_##T *l) \
+{ \
+	assert(l->size > 0); \
+	l->head = list_##T##_slot(l, 1); \
+	l->size--; \
+} \
+ \
+static inline void list_##T##_pop_back(List_##T *l) \
+{ \
+	assert(l->size > 0); \
+	l->size--; \
+} \
+ \
+static inline T *list_##T##_at(List_##T *l, int p) \
+{ \
+	assert(0 <= p && p < l->size); \
+	return &l->values[list_##T##_slot(l, p)]; \
+} \
+ \
+static inline T *list_##T##_front(List_##T *l) \
+{ \
+	return list_##T##_at(l, 0); \
+} \
+ \
+static inline T *list_##T##_back(List_##T *l) \
+{ \
+	return list_##T##_at(l, l->size - 1); \
+} \
+ \
+static inline bool list_##T##_is_empty(List_##T *l) \
+{ \
+	return l->size == 0; \
+} \
+ \
+static inline int list_##T##_size(List_##T *l) \
+{ \
+	return l->size; \
+} \
+ \
+/* the values are in two runs of the array at most, each run is a plain loop the compiler can vectorize */ \
+static inline void list_##T##_map(List_##T *l, void (*f)(T *)) \
+{ \
+	int first = (l->size < l->capacity - l->head) ? l->size : l->capacity - l->head; \
+	T *run = l->values + l->head; \
+	int i; \
+ \
+	for(i = 0 ; i < first ; i++) \
+		f(&run[i]); \
+	for(i = 0 ; i < l->size - first ; i++) \
+		f(&l->values[i]); \
+} \
+ \
+static inline void list_##T##_reduce(List_##T *l, void (*f)(const T *, void *), void *userData) \
+{ \
+	int first = (l->size < l->capacity - l->head) ? l->size : l->capacity - l->head; \
+	T *run = l->values + l->head; \
+	int i; \
+ \
+	for(i = 0 ; i < first ; i++) \
+		f(&run[i], userData); \
+	for(i = 0 ; i < l->size - first ; i++) \
+		f(&l->values[i], userData); \
+} \
+ \
+static inline T *list_##T##_find(List_##T *l, bool (*match)(const T *, const void *), const void *key) \
+{ \
+	int i; \
+ \
+	for(i = 0 ; i < l->size ; i++) \
+	{ \
+		if(match(&l->values[list_##T##_slot(l, i)], key)) \
+			return &l->values[list_##T##_slot(l, i)]; \
+	} \
+	return NULL; \
+} \
+ \
+/* count values from position src to position dst, one by one as the array is circular */ \
+static inline void list_##T##_move(List_##T *l, int dst, int src, int count) \
+{ \
+	int i; \
+ \
+	if(dst < src) \
+	{ \
+		for(i = 0 ; i < count ; i++) \
+			l->values[list_##T##_slot(l, dst + i)] = l->values[list_##T##_slot(l, src + i)]; \
+	} \
+	else \
+	{ \
+		for(i = count - 1 ; i >= 0 ; i--) \
+			l->values[list_##T##_slot(l, dst + i)] = l->values[list_##T##_slot(l, src + i)]; \
+	} \
+} \
+ \
+static inline void list_##T##_insert_at(List_##T *l, int p, T v) \
+{ \
+	assert(0 <= p && p <= l->size); \
+	list_##T##_grow(l); \
+ \
+	/* the shortest side is moved */ \
+	if(p < l->size - p) \
+	{ \
+		l->head = list_##T##_slot(l, -1); \
+		list_##T##_move(l, 0, 1, p); \
+	} \
+	else \
+	{ \
+		list_##T##_move(l, p + 1, p, l->size - p); \
+	} \
+	l->values[list_##T##_slot(l, p)] = v; \
+	l->size++; \
+} \
+ \
+static inline void list_##T##_remove_at(List_##T *l, int p) \
+{ \
+	assert(0 <= p && p < l->size); \
+ \
+	/* the shortest side is moved */ \
+	if(p < l->size - 1 - p) \
+	{ \
+		list_##T##_move(l, 1, 0, p); \
+		l->head = list_##T##_slot(l, 1); \
+	} \
+	else \
+	{ \
+		list_##T##_move(l, p, p + 1, l->size - 1 - p); \
+	} \
+	l->size--; \
+} \
+ \
+typedef struct s_ListIterator_##T { \
+ \
+	List_##T *collection; /* the collection the iterator is attached to */ \
+	int current; /* position of the current value, -1 or size at the end */ \
+	int step; /* 1 forward, -1 backward */ \
+} ListIterator_##T; \
+ \
+static inline ListIterator_##T *listIterator_##T##_begin(ListIterator_##T *it) \
+{ \
+	it->current = (it->step > 0) ? 0 : it->collection->size - 1; \
+	return it; \
+} \
+ \
+static inline ListIterator_##T *listIterator_##T##_create(List_##T *l, int direction) \
+{ \
+	ListIterator_##T *it = malloc(sizeof(ListIterator_##T)); \
+ \
+	it->collection = l; \
+	it->step = (direction == FORWARD_ITERATOR) ? 1 : -1; \
+	return listIterator_##T##_begin(it); \
+} \
+ \
+static inline bool listIterator_##T##_end(ListIterator_##T *it) \
+{ \
+	return it->current < 0 || it->current >= it->collection->size; \
+} \
+ \
+static inline ListIterator_##T *listIterator_##T##_next(ListIterator_##T *it) \
+{ \
+	it->current += it->step; \
+	return it; \
+} \
+ \
+static inline T *listIterator_##T##_value(ListIterator_##T *it) \
+{ \
+	return list_##T##_at(it->collection, it->current); \
+} \
+ \
+static inline ListIterator_##T *listIterator_##T##_remove(ListIterator_##T *it) \
+{ \
+	list_##T##_remove_at(it->collection, it->current); \
+ \
+	/* forward, the next value takes the position of the current one */ \
+	if(it->step < 0) \
+		it->current--; \
+	return it; \
+} \
+ \
+static inline ListIterator_##T *listIterator_##T##_insert(ListIterator_##T *it, T v) \
+{ \
+	if(it->step > 0) \
+	{ \
+		list_##T##_insert_at(it->collection, it->current, v); \
+		it->current++; \
+	} \
+	else \
+	{ \
+		list_##T##_insert_at(it->collection, it->current + 1, v); \
+	} \
+	return it; \
+} \
+ \
+static inline void listIterator_##T##_delete(ListIterator_##T *it) \
+{ \
+	free(it); \
+}
+
+#endif
@@ -0,0 +1,185 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include "mux.h"
+#include "../Trace/histogram.h"
+
+/*
+   Head-of-line blocking of a multiplexed connection : make bench, then
+      ./server -H echo > /dev/null
+   and ./bench_mux [count]. A bulk transfer runs on the stream 1 of the connection, the pings run
+   on their own stream 2, then on the stream 1 behind the bulk data.
+*/
+
+#define PORT 27000
+#define COUNT 1000 /* pings measured in each mode */
+#define BULK MUX_FRAME_MAX /* message of the bulk transfer */
+#define BULK_QUEUED MUX_WINDOW /* bulk data kept queued in the mux, the stream 1 never runs dry */
+#define BULK_STREAM 1
+#define PING_STREAM 2
+
+
+typedef struct s_Bench {
+
+    Mux *mux;
+    size_t received[PING_STREAM + 1]; /* bytes echoed by stream, the line "#stream id" not counted */
+    size_t written[PING_STREAM + 1];
+    bool opened[PING_STREAM + 1];
+} Bench;
+
+
+static long long now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+
+static void frame(uint32_t stream, const char *data, size_t len, void *context)
+{
+    Bench *b = context;
+    const char *eol;
+
+    if(data == NULL || stream > PING_STREAM)
+        return;
+
+    /* the server gives its id to the client of a new stream first */
+    mux_consumed(b->mux, stream, len);
+    if(!b->opened[stream] && (eol = memchr(data, '\n', len)) != NULL)
+    {
+        b->opened[stream] = true;
+        len -= eol + 1 - data;
+    }
+    b->received[stream] += len;
+}
+
+
+static int connection(void)
+{
+    struct sockaddr_in sin;
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    char c, line[64];
+    size_t n = 0;
+
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    sin.sin_port = htons(PORT);
+    if(connect(sock, (struct sockaddr *)&sin, sizeof(sin)) < 0)
+    {
+        fprintf(stderr, "Error : connect()\n");
+        exit(EXIT_FAILURE);
+    }
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    /* the lines before "#mux" (a session) are skipped, the frames start after it */
+    send(sock, "#mux\n", 5, 0);
+    while(recv(sock, &c, 1, 0) == 1)
+    {
+        line[n++ % sizeof(line)] = c;
+        if(c != '\n')
+            continue;
+        if(n == 5 && strncmp(line, "#mux\n", 5) == 0)
+            return sock;
+        n = 0;
+    }
+
+    fprintf(stderr, "Error : the server is not multiplexed\n");
+    exit(EXIT_FAILURE);
+}
+
+
+/* frames sent as the credits allow, then one read of the echoes */
+static void exchange(int sock, Bench *b)
+{
+    static char buffer[MUX_HEADER + MUX_FRAME_MAX];
+    ssize_t n;
+
+    while((n = mux_output(b->mux, buffer, sizeof(buffer))) > 0)
+        send(sock, buffer, n, 0);
+
+    if(poll(&(struct pollfd){ sock, POLLIN, 0 }, 1, 100) > 0)
+    {
+        if((n = recv(sock, buffer, sizeof(buffer), 0)) <= 0 || mux_input(b->mux, buffer, n, frame, b) < 0)
+        {
+            fprintf(stderr, "Error : recv()\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+
+static void run(int count, uint32_t ping_stream, const char *name)
+{
+    static char bulk[BULK];
+    const char ping[] = "ping\n";
+    Bench b;
+    Histogram *h = histogram_create();
+    int sock = connection();
+    size_t expected = 0;
+    long long t = 0, start = now();
+    int pings = 0;
+
+    memset(&b, 0, sizeof(b));
+    memset(bulk, 'x', sizeof(bulk) - 1);
+    bulk[sizeof(bulk) - 1] = '\n';
+    b.mux = mux_create(MUX_WINDOW);
+
+    while(pings < count)
+    {
+        /* the stream 1 always has data to send */
+        while(mux_held(b.mux) < BULK_QUEUED)
+        {
+            mux_write(b.mux, BULK_STREAM, bulk, sizeof(bulk));
+            b.written[BULK_STREAM] += sizeof(bulk);
+        }
+
+        /* one ping at a time, it is back when every byte written before it on its stream is back */
+        if(expected == 0)
+        {
+            mux_write(b.mux, ping_stream, ping, sizeof(ping) - 1);
+            b.written[ping_stream] += sizeof(ping) - 1;
+            expected = b.written[ping_stream];
+            t = now();
+        }
+
+        exchange(sock, &b);
+
+        if(expected > 0 && b.received[ping_stream] >= expected)
+        {
+            histogram_record(h, now() - t);
+            expected = 0;
+            pings++;
+        }
+    }
+
+    /* the echoes are read before the close, the server would write on a closed connection */
+    while(b.received[BULK_STREAM] < b.written[BULK_STREAM] || b.received[PING_STREAM] < b.written[PING_STREAM])
+        exchange(sock, &b);
+
+    printf("%s : bulk %.1f MB/s\n", name, b.received[BULK_STREAM] / ((now() - start) / 1e3));
+    histogram_print(h, name);
+    histogram_delete(h);
+    mux_delete(b.mux);
+    close(sock);
+}
+
+
+int main(int argc, char **argv)
+{
+    int count = (argc > 1) ? atoi(argv[1]) : COUNT;
+
+    run(count, PING_STREAM, "ping on its own stream");
+    run(count, BULK_STREAM, "ping behind the bulk");
+
+    return EXIT_SUCCESS;
+}
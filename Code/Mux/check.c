@@ -0,0 +1,305 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include "mux.h"
+
+/*
+   Behaviour of the mux : make check, or
+      gcc -o check_mux Mux/check.c Mux/mux.c && ./check_mux
+   The frames written by one side are read by the other, the program ends with 1 if a check fails.
+*/
+
+#define GUARD 64 /* bytes after the output buffer which must stay untouched */
+#define MARK 0x5a
+
+#define CHECK(cond) do { if(!(cond)) { fprintf(stderr, "Error : %s:%d : %s\n", __FILE__, __LINE__, #cond); failures++; } } while(0)
+
+static int failures = 0;
+
+
+typedef struct s_Peer {
+
+    char data[4 * MUX_WINDOW]; /* bytes received on the stream 1 */
+    size_t len;
+    int frames;
+    int closed; /* number of CLOSE received */
+} Peer;
+
+
+static void receive(uint32_t stream, const char *data, size_t len, void *context)
+{
+    Peer *p = context;
+
+    if(data == NULL)
+    {
+        p->closed++;
+        return;
+    }
+    if(stream == 1 && p->len + len <= sizeof(p->data))
+        memcpy(p->data + p->len, data, len);
+    p->len += len;
+    p->frames++;
+}
+
+
+static bool untouched(const char *guard)
+{
+    int i;
+
+    for(i = 0 ; i < GUARD ; i++)
+    {
+        if((unsigned char)guard[i] != MARK)
+            return false;
+    }
+    return true;
+}
+
+
+/* the last DATA frame fills the buffer : the CLOSE frame waits for the next call */
+static void check_close_full(void)
+{
+    static char data[MUX_FRAME_MAX], out[MUX_HEADER + MUX_FRAME_MAX + GUARD];
+    Mux *m = mux_create(MUX_WINDOW), *peer = mux_create(MUX_WINDOW);
+    Peer p = { .len = 0 };
+    size_t n;
+
+    memset(data, 'a', sizeof(data));
+    memset(out, MARK, sizeof(out));
+    mux_write(m, 1, data, MUX_FRAME_MAX);
+    mux_close(m, 1);
+
+    n = mux_output(m, out, MUX_HEADER + MUX_FRAME_MAX);
+    CHECK(n == MUX_HEADER + MUX_FRAME_MAX);
+    CHECK(untouched(out + MUX_HEADER + MUX_FRAME_MAX));
+    CHECK(mux_input(peer, out, n, receive, &p) == 0);
+    CHECK(p.len == MUX_FRAME_MAX && p.closed == 0);
+
+    n = mux_output(m, out, MUX_HEADER + MUX_FRAME_MAX);
+    CHECK(n == MUX_HEADER);
+    CHECK(mux_input(peer, out, n, receive, &p) == 0);
+    CHECK(p.closed == 1);
+    CHECK(mux_output(m, out, MUX_HEADER + MUX_FRAME_MAX) == 0);
+
+    mux_delete(m);
+    mux_delete(peer);
+}
+
+
+/* a buffer smaller than a header gets nothing, not even the CLOSE of an empty stream */
+static void check_small_buffer(void)
+{
+    char out[MUX_HEADER + GUARD];
+    Mux *m = mux_create(MUX_WINDOW);
+
+    memset(out, MARK, sizeof(out));
+    mux_write(m, 1, "", 0);
+    mux_close(m, 1);
+    CHECK(mux_output(m, out, MUX_HEADER - 1) == 0);
+    CHECK(untouched(out));
+    CHECK(mux_output(m, out, MUX_HEADER) == MUX_HEADER);
+    CHECK(untouched(out + MUX_HEADER));
+
+    mux_delete(m);
+}
+
+
+/* the data over the credits waits for the CREDIT frames of the peer, which are never cut */
+static void check_credits(void)
+{
+    static char data[3 * MUX_WINDOW], out[MUX_HEADER + MUX_FRAME_MAX + GUARD];
+    Mux *m = mux_create(MUX_WINDOW), *peer = mux_create(MUX_WINDOW);
+    Peer p = { .len = 0 };
+    size_t n, i, consumed;
+
+    for(i = 0 ; i < sizeof(data) ; i++)
+        data[i] = i % 251;
+    mux_write(m, 1, data, sizeof(data));
+
+    /* the window is sent, then nothing */
+    while((n = mux_output(m, out, MUX_HEADER + MUX_FRAME_MAX)) > 0)
+        CHECK(mux_input(peer, out, n, receive, &p) == 0);
+    CHECK(p.len == MUX_WINDOW);
+
+    /* the peer consumes : its credits come back and the rest of the data is sent */
+    for(consumed = 0 ; p.len > consumed ; )
+    {
+        mux_consumed(peer, 1, p.len - consumed);
+        consumed = p.len;
+        memset(out, MARK, sizeof(out));
+        /* a buffer of 7 bytes can not hold a CREDIT frame : nothing is cut */
+        CHECK(mux_output(peer, out, 7) == 0);
+        CHECK(untouched(out));
+        n = mux_output(peer, out, sizeof(out) - GUARD);
+        CHECK(n > 0 && n % (MUX_HEADER + 4) == 0);
+        CHECK(mux_input(m, out, n, receive, &p) == 0);
+        while((n = mux_output(m, out, MUX_HEADER + MUX_FRAME_MAX)) > 0)
+            CHECK(mux_input(peer, out, n, receive, &p) == 0);
+    }
+    CHECK(p.len == sizeof(data));
+    CHECK(memcmp(p.data, data, sizeof(data)) == 0);
+
+    mux_delete(m);
+    mux_delete(peer);
+}
+
+
+/* the frames cut in any place are read whole */
+static void check_cut(void)
+{
+    static char data[2 * MUX_FRAME_MAX + 100], out[2 * (MUX_HEADER + MUX_FRAME_MAX)];
+    Mux *m = mux_create(MUX_WINDOW), *peer = mux_create(MUX_WINDOW);
+    Peer p = { .len = 0 };
+    size_t n, i;
+
+    for(i = 0 ; i < sizeof(data) ; i++)
+        data[i] = i % 239;
+    mux_write(m, 1, data, sizeof(data));
+    mux_close(m, 1);
+    while((n = mux_output(m, out, sizeof(out))) > 0)
+    {
+        for(i = 0 ; i < n ; i += 3)
+            CHECK(mux_input(peer, out + i, (n - i < 3) ? n - i : 3, receive, &p) == 0);
+    }
+    CHECK(p.len == sizeof(data));
+    CHECK(p.frames == 3);
+    CHECK(p.closed == 1);
+    CHECK(memcmp(p.data, data, sizeof(data)) == 0);
+    CHECK(mux_held(peer) == 0);
+
+    mux_delete(m);
+    mux_delete(peer);
+}
+
+
+/* the streams share the buffer in turn */
+static void check_fair(void)
+{
+    static char data[MUX_FRAME_MAX], out[2 * (MUX_HEADER + MUX_FRAME_MAX)];
+    Mux *m = mux_create(MUX_WINDOW);
+    uint32_t first, second;
+    uint16_t len;
+
+    memset(data, 'b', sizeof(data));
+    mux_write(m, 1, data, sizeof(data));
+    mux_write(m, 1, data, sizeof(data));
+    mux_write(m, 2, data, 10);
+    CHECK(mux_output(m, out, sizeof(out)) > 2 * MUX_HEADER + MUX_FRAME_MAX);
+    memcpy(&first, out, 4);
+    memcpy(&len, out + 6, 2);
+    memcpy(&second, out + MUX_HEADER + ntohs(len), 4);
+    CHECK(ntohl(first) != ntohl(second));
+
+    mux_delete(m);
+}
+
+
+/* a mux saved and loaded goes on where it was : data queued, frame cut, close pending */
+static void check_save(void)
+{
+    static char data[MUX_WINDOW + 100], out[2 * (MUX_HEADER + MUX_FRAME_MAX)];
+    Mux *m = mux_create(MUX_WINDOW), *peer = mux_create(MUX_WINDOW), *loaded;
+    Peer p = { .len = 0 };
+    char *state;
+    size_t len, n, i;
+
+    for(i = 0 ; i < sizeof(data) ; i++)
+        data[i] = i % 241;
+    mux_write(m, 1, data, sizeof(data));
+    mux_close(m, 1);
+
+    /* the peer has the first frame and half of the second */
+    n = mux_output(m, out, MUX_HEADER + MUX_FRAME_MAX);
+    CHECK(mux_input(peer, out, n, receive, &p) == 0);
+    n = mux_output(m, out, MUX_HEADER + MUX_FRAME_MAX);
+    CHECK(mux_input(peer, out, n / 2, receive, &p) == 0);
+
+    state = mux_save(peer, &len);
+    loaded = mux_load(state, len);
+    CHECK(loaded != NULL && mux_held(loaded) == mux_held(peer));
+    CHECK(mux_load(state, len - 1) == NULL);
+    mux_delete(peer);
+    free(state);
+
+    state = mux_save(m, &len);
+    mux_delete(m);
+    m = mux_load(state, len);
+    free(state);
+    CHECK(m != NULL);
+    if(m == NULL || loaded == NULL)
+        return;
+
+    CHECK(mux_input(loaded, out + n / 2, n - n / 2, receive, &p) == 0);
+    while((n = mux_output(m, out, sizeof(out))) > 0)
+        CHECK(mux_input(loaded, out, n, receive, &p) == 0);
+    mux_consumed(loaded, 1, p.len);
+    while((n = mux_output(loaded, out, sizeof(out))) > 0)
+        CHECK(mux_input(m, out, n, receive, &p) == 0);
+    while((n = mux_output(m, out, sizeof(out))) > 0)
+        CHECK(mux_input(loaded, out, n, receive, &p) == 0);
+    CHECK(p.len == sizeof(data));
+    CHECK(p.closed == 1);
+    CHECK(memcmp(p.data, data, sizeof(data)) == 0);
+
+    mux_delete(m);
+    mux_delete(loaded);
+}
+
+
+/* a peer which breaks the protocol is detected */
+static void check_bad_frames(void)
+{
+    char frame[MUX_HEADER + 4];
+    static char data[MUX_HEADER + MUX_WINDOW];
+    Mux *m = mux_create(1024);
+    Peer p = { .len = 0 };
+    uint32_t stream = htonl(1);
+    uint16_t len;
+
+    /* unknown type */
+    memset(frame, 0, sizeof(frame));
+    memcpy(frame, &stream, 4);
+    frame[4] = 42;
+    CHECK(mux_input(m, frame, MUX_HEADER, receive, &p) < 0);
+    mux_delete(m);
+
+    /* CREDIT frame of a bad len */
+    m = mux_create(1024);
+    frame[4] = MUX_CREDIT;
+    len = htons(2);
+    memcpy(frame + 6, &len, 2);
+    CHECK(mux_input(m, frame, MUX_HEADER + 2, receive, &p) < 0);
+    mux_delete(m);
+
+    /* frame bigger than the max */
+    m = mux_create(1024);
+    frame[4] = MUX_DATA;
+    len = htons(MUX_FRAME_MAX + 1);
+    memcpy(frame + 6, &len, 2);
+    CHECK(mux_input(m, frame, MUX_HEADER, receive, &p) < 0);
+    mux_delete(m);
+
+    /* data over the credits given */
+    m = mux_create(1024);
+    memcpy(data, frame, MUX_HEADER);
+    len = htons(1025);
+    memcpy(data + 6, &len, 2);
+    CHECK(mux_input(m, data, MUX_HEADER + 1025, receive, &p) < 0);
+    mux_delete(m);
+}
+
+
+int main(void)
+{
+    check_close_full();
+    check_small_buffer();
+    check_credits();
+    check_cut();
+    check_fair();
+    check_save();
+    check_bad_frames();
+
+    printf("mux : %s\n", failures == 0 ? "ok" : "FAILED");
+
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,595 @@
+/**
+ * @file mux.c
+ * @author Alary Dorian
+ * @brief Logical streams multiplexed on one connection, each stream with its own flow control by credits
+ * @version 0.1
+ * @date 2022-08-19
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+#include "mux.h"
+
+/*
+	A stream may send as many bytes as the credits given by the peer, MUX_WINDOW at its opening.
+	The peer gives credits back when its application has consumed the data, so a stream whose reader
+	is slow stops without blocking the other streams of the connection, and the memory of the peer is bounded.
+	The big messages are cut in frames sent in turn with the frames of the other streams.
+*/
+
+
+typedef struct s_MuxStream {
+
+	uint32_t id;
+	size_t credit; /* bytes which can be sent to the peer */
+	size_t window; /* bytes which the peer can still send */
+	size_t consumed; /* bytes consumed whose credits are not given back yet */
+	char *out; /* data queued, from off to len */
+	size_t off, len, capacity;
+	bool closing; /* a CLOSE frame is sent after the data */
+} MuxStream;
+
+
+/* Fixed part of a stream in a state of mux_save, its data queued follows */
+typedef struct s_MuxStreamState {
+
+	uint32_t id;
+	size_t credit, window, consumed;
+	size_t len; /* data queued not sent */
+	bool closing;
+} MuxStreamState;
+
+
+/* Fixed part of a state of mux_save, followed by the control frames, the frame cut and the streams */
+typedef struct s_MuxState {
+
+	size_t window;
+	int count, next;
+	size_t control_len, in_len;
+} MuxState;
+
+
+struct s_Mux {
+
+	size_t window;
+	MuxStream **streams;
+	int count, capacity;
+	int next; /* stream which sends the first frame of the next round */
+	char *control; /* CREDIT and CLOSE frames, sent before the data */
+	size_t control_len, control_capacity;
+	char in[MUX_HEADER + MUX_FRAME_MAX]; /* frame cut between two reads */
+	size_t in_len;
+	size_t held; /* bytes of data queued */
+};
+
+/*-----------------------------------------------------------------*/
+
+/**
+ * @brief Append bytes to a buffer which grows
+ *
+ * @param buffer variable that stores the buffer
+ * @param len variable that stores the len of the buffer
+ * @param capacity variable that stores the capacity of the buffer
+ * @param data bytes to copy
+ * @param n number of bytes
+ */
+static void buffer_append(char **buffer, size_t *len, size_t *capacity, const void *data, size_t n)
+{
+	if(n == 0)
+		return;
+	if(*len + n > *capacity)
+	{
+		*capacity = (*len + n > 2 * *capacity) ? *len + n : 2 * *capacity;
+		*buffer = realloc(*buffer, *capacity);
+	}
+	memcpy(*buffer + *len, data, n);
+	*len += n;
+}
+
+
+/**
+ * @brief Write the header of a frame
+ *
+ * @param header variable that stores the header, MUX_HEADER bytes
+ * @param stream stream
+ * @param type type of the frame
+ * @param len len of the payload
+ */
+static void frame_header(char *header, uint32_t stream, MuxType type, size_t len)
+{
+	uint32_t id = htonl(stream);
+	uint16_t size = htons(len);
+
+	memcpy(header, &id, 4);
+	header[4] = type;
+	header[5] = 0;
+	memcpy(header + 6, &size, 2);
+}
+
+
+/**
+ * @brief Queue a control frame
+ *
+ * @param m pointer on mux
+ * @param stream stream
+ * @param type MUX_CREDIT or MUX_CLOSE
+ * @param credit credits of a MUX_CREDIT frame
+ */
+static void frame_control(Mux *m, uint32_t stream, MuxType type, uint32_t credit)
+{
+	char frame[MUX_HEADER + 4];
+
+	credit = htonl(credit);
+	frame_header(frame, stream, type, (type == MUX_CREDIT) ? 4 : 0);
+	memcpy(frame + MUX_HEADER, &credit, 4);
+	buffer_append(&m->control, &m->control_len, &m->control_capacity, frame, MUX_HEADER + ((type == MUX_CREDIT) ? 4 : 0));
+}
+
+
+/**
+ * @brief Find a stream
+ *
+ * @param m pointer on mux
+ * @param stream stream
+ * @return int index of the stream, -1 if it is not open
+ */
+static int stream_find(Mux *m, uint32_t stream)
+{
+	int i;
+
+	for(i = 0 ; i < m->count ; i++)
+	{
+		if(m->streams[i]->id == stream)
+			return i;
+	}
+
+	return -1;
+}
+
+
+/**
+ * @brief Find a stream, it is opened if it is not
+ *
+ * @param m pointer on mux
+ * @param stream stream
+ * @return MuxStream* pointer on stream
+ */
+static MuxStream *stream_get(Mux *m, uint32_t stream)
+{
+	MuxStream *s;
+	int i = stream_find(m, stream);
+
+	if(i >= 0)
+		return m->streams[i];
+
+	if(m->count == m->capacity)
+	{
+		m->capacity = (m->capacity > 0) ? 2 * m->capacity : 8;
+		m->streams = realloc(m->streams, m->capacity * sizeof(MuxStream *));
+	}
+
+	s = calloc(1, sizeof(MuxStream));
+	s->id = stream;
+	s->credit = m->window;
+	s->window = m->window;
+	m->streams[m->count++] = s;
+
+	return s;
+}
+
+
+/**
+ * @brief Free a stream and its data not sent
+ *
+ * @param m pointer on mux
+ * @param i index of the stream
+ */
+static void stream_remove(Mux *m, int i)
+{
+	MuxStream *s = m->streams[i];
+
+	m->held -= s->len - s->off;
+	free(s->out);
+	free(s);
+	m->streams[i] = m->streams[--m->count];
+}
+
+
+/**
+ * @brief Handle a whole frame received
+ *
+ * @param m pointer on mux
+ * @param frame header and payload
+ * @param handler functor called for the data and the closing
+ * @param context user provided data of the handler
+ * @return int 0 on success, -1 if the frame breaks the protocol
+ */
+static int frame_receive(Mux *m, const char *frame, MuxHandler handler, void *context)
+{
+	uint32_t stream, credit;
+	uint16_t len;
+	MuxStream *s;
+	int i;
+
+	memcpy(&stream, frame, 4);
+	memcpy(&len, frame + 6, 2);
+	stream = ntohl(stream);
+	len = ntohs(len);
+
+	switch(frame[4])
+	{
+		case MUX_DATA:
+			/* the peer can not send more than the credits it got */
+			s = stream_get(m, stream);
+			if(len > s->window)
+				return -1;
+			s->window -= len;
+			handler(stream, frame + MUX_HEADER, len, context);
+			return 0;
+
+		case MUX_CREDIT:
+			if(len != 4)
+				return -1;
+			memcpy(&credit, frame + MUX_HEADER, 4);
+			stream_get(m, stream)->credit += ntohl(credit);
+			return 0;
+
+		case MUX_CLOSE:
+			if((i = stream_find(m, stream)) >= 0)
+				stream_remove(m, i);
+			handler(stream, NULL, 0, context);
+			return 0;
+
+		default:
+			return -1;
+	}
+}
+
+/*-----------------------------------------------------------------*/
+
+/**
+ * @brief Create the streams of a connection
+ *
+ * @param window credits of a stream at its opening, in each direction, the same on both sides
+ * @return Mux* pointer on mux
+ */
+Mux *mux_create(size_t window)
+{
+	Mux *m = calloc(1, sizeof(Mux));
+
+	m->window = window;
+
+	return m;
+}
+
+
+/**
+ * @brief Queue data on a stream, the stream is opened if it is not
+ *
+ * @param m pointer on mux
+ * @param stream stream
+ * @param data data to copy
+ * @param len len of the data
+ */
+void mux_write(Mux *m, uint32_t stream, const void *data, size_t len)
+{
+	MuxStream *s = stream_get(m, stream);
+
+	/* the data already sent is dropped before the buffer grows */
+	if(s->off > 0 && s->len + len > s->capacity)
+	{
+		memmove(s->out, s->out + s->off, s->len - s->off);
+		s->len -= s->off;
+		s->off = 0;
+	}
+	buffer_append(&s->out, &s->len, &s->capacity, data, len);
+	m->held += len;
+}
+
+
+/**
+ * @brief Close a stream, a CLOSE frame is sent after its data queued
+ *
+ * @param m pointer on mux
+ * @param stream stream
+ */
+void mux_close(Mux *m, uint32_t stream)
+{
+	stream_get(m, stream)->closing = true;
+}
+
+
+/**
+ * @brief Give back credits to the peer for data of a stream consumed by the application
+ *
+ * @param m pointer on mux
+ * @param stream stream
+ * @param len bytes consumed
+ */
+void mux_consumed(Mux *m, uint32_t stream, size_t len)
+{
+	int i = stream_find(m, stream);
+	MuxStream *s;
+
+	if(i < 0)
+		return;
+
+	/* by quarter of window, not a frame by message */
+	s = m->streams[i];
+	s->consumed += len;
+	if(s->consumed >= m->window / 4)
+	{
+		s->window += s->consumed;
+		frame_control(m, stream, MUX_CREDIT, s->consumed);
+		s->consumed = 0;
+	}
+}
+
+
+/**
+ * @brief Fill a buffer with the frames ready to be sent, one frame by stream in turn so a stream does not block the others
+ *
+ * @param m pointer on mux
+ * @param buffer variable that stores the frames
+ * @param len len of the buffer, at least MUX_HEADER + MUX_FRAME_MAX to send the biggest frames
+ * @return size_t bytes of frames written in buffer, 0 if nothing can be sent
+ * @note The data of a stream without credits waits for a CREDIT frame of the peer. A frame is never cut :
+ *       the frames which do not fit, a CLOSE included, wait for the next call.
+ */
+size_t mux_output(Mux *m, char *buffer, size_t len)
+{
+	MuxStream *s;
+	size_t n, payload;
+	uint16_t size;
+	bool progress = true;
+	int i, k;
+
+	/* the credits first, they unblock the peer, by whole frames */
+	n = 0;
+	while(n + MUX_HEADER <= m->control_len)
+	{
+		memcpy(&size, m->control + n + 6, 2);
+		if(len - n < MUX_HEADER + (size_t)ntohs(size))
+			break;
+		n += MUX_HEADER + ntohs(size);
+	}
+	if(n > 0)
+	{
+		memcpy(buffer, m->control, n);
+		memmove(m->control, m->control + n, m->control_len - n);
+		m->control_len -= n;
+	}
+
+	while(progress && m->count > 0)
+	{
+		progress = false;
+		for(k = 0 ; k < m->count && len - n >= MUX_HEADER ; k++)
+		{
+			i = (m->next + k) % m->count;
+			s = m->streams[i];
+
+			payload = s->len - s->off;
+			payload = (payload < s->credit) ? payload : s->credit;
+			payload = (payload < MUX_FRAME_MAX) ? payload : MUX_FRAME_MAX;
+			payload = (payload < len - n - MUX_HEADER) ? payload : len - n - MUX_HEADER;
+			if(payload > 0)
+			{
+				frame_header(buffer + n, s->id, MUX_DATA, payload);
+				memcpy(buffer + n + MUX_HEADER, s->out + s->off, payload);
+				n += MUX_HEADER + payload;
+				s->off += payload;
+				s->credit -= payload;
+				m->held -= payload;
+				progress = true;
+			}
+
+			/* every data is sent : the stream ends, in the next buffer if the header does not fit */
+			if(s->closing && s->off == s->len && len - n >= MUX_HEADER)
+			{
+				frame_header(buffer + n, s->id, MUX_CLOSE, 0);
+				n += MUX_HEADER;
+				stream_remove(m, i);
+				progress = true;
+				break;
+			}
+		}
+		m->next = (m->count > 0) ? (m->next + 1) % m->count : 0;
+	}
+
+	return n;
+}
+
+
+/**
+ * @brief Read the frames of bytes received, a frame cut between two reads is kept until its end
+ *
+ * @param m pointer on mux
+ * @param data bytes received
+ * @param len len of the bytes
+ * @param handler functor called for each frame of data and for each stream closed
+ * @param context user provided data of the handler
+ * @return int 0 on success, -1 if the peer breaks the protocol (bad frame, data over its credits)
+ */
+int mux_input(Mux *m, const char *data, size_t len, MuxHandler handler, void *context)
+{
+	uint16_t size;
+	size_t frame, take;
+
+	while(len > 0)
+	{
+		/* whole frames are read in place, without copy */
+		if(m->in_len == 0 && len >= MUX_HEADER)
+		{
+			memcpy(&size, data + 6, 2);
+			frame = MUX_HEADER + ntohs(size);
+			if(frame > sizeof(m->in))
+				return -1;
+			if(len >= frame)
+			{
+				if(frame_receive(m, data, handler, context) < 0)
+					return -1;
+				data += frame;
+				len -= frame;
+				continue;
+			}
+		}
+
+		/* the header, then the payload of a frame cut */
+		take = (m->in_len < MUX_HEADER) ? MUX_HEADER - m->in_len : 0;
+		if(take == 0)
+		{
+			memcpy(&size, m->in + 6, 2);
+			frame = MUX_HEADER + ntohs(size);
+			if(frame > sizeof(m->in))
+				return -1;
+			take = frame - m->in_len;
+		}
+		take = (take < len) ? take : len;
+		memcpy(m->in + m->in_len, data, take);
+		m->in_len += take;
+		data += take;
+		len -= take;
+
+		if(m->in_len >= MUX_HEADER)
+		{
+			memcpy(&size, m->in + 6, 2);
+			if(m->in_len == MUX_HEADER + (size_t)ntohs(size))
+			{
+				m->in_len = 0;
+				if(frame_receive(m, m->in, handler, context) < 0)
+					return -1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+
+/**
+ * @brief Save the state of the mux : its streams with their credits and their data queued, its frames not sent and its frame cut
+ *
+ * @param m pointer on mux
+ * @param len variable that stores the len of the state
+ * @return char* state, to be freed
+ * @note The state is read by mux_load in a process of the same build, the connection goes on where it was.
+ */
+char *mux_save(Mux *m, size_t *len)
+{
+	MuxState state = { m->window, m->count, m->next, m->control_len, m->in_len };
+	MuxStreamState stream;
+	MuxStream *st;
+	char *data = NULL;
+	size_t capacity = 0;
+	int i;
+
+	*len = 0;
+	buffer_append(&data, len, &capacity, &state, sizeof(state));
+	buffer_append(&data, len, &capacity, m->control, m->control_len);
+	buffer_append(&data, len, &capacity, m->in, m->in_len);
+	for(i = 0 ; i < m->count ; i++)
+	{
+		st = m->streams[i];
+		memset(&stream, 0, sizeof(stream));
+		stream.id = st->id;
+		stream.credit = st->credit;
+		stream.window = st->window;
+		stream.consumed = st->consumed;
+		stream.len = st->len - st->off;
+		stream.closing = st->closing;
+		buffer_append(&data, len, &capacity, &stream, sizeof(stream));
+		buffer_append(&data, len, &capacity, st->out + st->off, stream.len);
+	}
+
+	return data;
+}
+
+
+/**
+ * @brief Create a mux from a state saved by mux_save
+ *
+ * @param data state
+ * @param len len of the state
+ * @return Mux* pointer on mux, NULL if the state is not valid
+ */
+Mux *mux_load(const char *data, size_t len)
+{
+	MuxState state;
+	MuxStreamState stream;
+	MuxStream *st;
+	Mux *m;
+	size_t pos = sizeof(state);
+	int i;
+
+	if(len < sizeof(state))
+		return NULL;
+	memcpy(&state, data, sizeof(state));
+	if(state.count < 0 || state.in_len > sizeof(m->in) || state.control_len > len - pos || state.in_len > len - pos - state.control_len)
+		return NULL;
+
+	m = mux_create(state.window);
+	buffer_append(&m->control, &m->control_len, &m->control_capacity, data + pos, state.control_len);
+	pos += state.control_len;
+	memcpy(m->in, data + pos, state.in_len);
+	m->in_len = state.in_len;
+	pos += state.in_len;
+
+	for(i = 0 ; i < state.count ; i++)
+	{
+		if(len - pos < sizeof(stream))
+			break;
+		memcpy(&stream, data + pos, sizeof(stream));
+		pos += sizeof(stream);
+		if(stream.len > len - pos)
+			break;
+
+		st = stream_get(m, stream.id);
+		st->credit = stream.credit;
+		st->window = stream.window;
+		st->consumed = stream.consumed;
+		st->closing = stream.closing;
+		buffer_append(&st->out, &st->len, &st->capacity, data + pos, stream.len);
+		m->held += stream.len;
+		pos += stream.len;
+	}
+
+	/* a state cut or with bytes after its streams is not the one of mux_save */
+	if(i < state.count || pos != len)
+	{
+		mux_delete(m);
+		return NULL;
+	}
+	m->next = (state.next >= 0 && state.next < m->count) ? state.next : 0;
+
+	return m;
+}
+
+
+/**
+ * @brief Give the bytes held by the mux : data queued and frame being received
+ *
+ * @param m pointer on mux, NULL for none
+ * @return size_t bytes held
+ */
+size_t mux_held(Mux *m)
+{
+	return (m != NULL) ? m->held + m->control_len + m->in_len : 0;
+}
+
+
+/**
+ * @brief Delete the mux and its streams
+ *
+ * @param m pointer on mux
+ */
+void mux_delete(Mux *m)
+{
+	while(m->count > 0)
+		stream_remove(m, m->count - 1);
+	free(m->streams);
+	free(m->control);
+	free(m);
+}
@@ -0,0 +1,158 @@
+/**
+ * @file mux.h
+ * @author Alary Dorian
+ * @brief Logical streams multiplexed on one connection, each stream with its own flow control by credits
+ * @version 0.1
+ * @date 2022-08-19
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef __MUX_H__
+#define __MUX_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*-----------------------------------------------------------------*/
+
+/* Values */
+#define MUX_HEADER 8 /* stream (4 bytes), type (1), unused (1), len (2), in network order */
+#define MUX_FRAME_MAX (16 * 1024) /* max payload of a frame, a bigger message is sent in several frames */
+#define MUX_WINDOW (64 * 1024) /* credits of a stream at its opening : bytes which can be sent before the peer consumes them */
+
+
+/**
+* @brief 	Opaque definition of type Mux : the streams of one connection.
+*/
+typedef struct s_Mux Mux;
+
+
+/**
+* @brief 	Type of a frame.
+*/
+typedef enum e_MuxType {
+
+	MUX_DATA = 0, /* payload of the stream */
+	MUX_CREDIT = 1, /* payload : 4 bytes, credits given back to the sender of the stream */
+	MUX_CLOSE = 2 /* no payload, the stream is closed, sent after its data */
+} MuxType;
+
+
+/**
+* @brief 	Functor called for each frame of data received.
+* @param	(uint32_t) Stream of the frame
+* @param	(const char*) Payload, NULL when the stream is closed by the peer
+* @param	(size_t) Len of the payload
+* @param	(void*) Opaque pointer to user provided data
+*/
+typedef void (*MuxHandler)(uint32_t, const char *, size_t, void *);
+
+
+/*-----------------------------------------------------------------*/
+
+
+/**
+ * @brief Create the streams of a connection
+ *
+ * @param window credits of a stream at its opening, in each direction, the same on both sides
+ * @return Mux* pointer on mux
+ */
+Mux *mux_create(size_t window);
+
+
+/**
+ * @brief Queue data on a stream, the stream is opened if it is not
+ *
+ * @param m pointer on mux
+ * @param stream stream
+ * @param data data to copy
+ * @param len len of the data
+ */
+void mux_write(Mux *m, uint32_t stream, const void *data, size_t len);
+
+
+/**
+ * @brief Close a stream, a CLOSE frame is sent after its data queued
+ *
+ * @param m pointer on mux
+ * @param stream stream
+ */
+void mux_close(Mux *m, uint32_t stream);
+
+
+/**
+ * @brief Give back credits to the peer for data of a stream consumed by the application
+ *
+ * @param m pointer on mux
+ * @param stream stream
+ * @param len bytes consumed
+ */
+void mux_consumed(Mux *m, uint32_t stream, size_t len);
+
+
+/**
+ * @brief Fill a buffer with the frames ready to be sent, one frame by stream in turn so a stream does not block the others
+ *
+ * @param m pointer on mux
+ * @param buffer variable that stores the frames
+ * @param len len of the buffer, at least MUX_HEADER + MUX_FRAME_MAX to send the biggest frames
+ * @return size_t bytes of frames written in buffer, 0 if nothing can be sent
+ * @note The data of a stream without credits waits for a CREDIT frame of the peer. A frame is never cut :
+ *       the frames which do not fit, a CLOSE included, wait for the next call.
+ */
+size_t mux_output(Mux *m, char *buffer, size_t len);
+
+
+/**
+ * @brief Read the frames of bytes received, a frame cut between two reads is kept until its end
+ *
+ * @param m pointer on mux
+ * @param data bytes received
+ * @param len len of the bytes
+ * @param handler functor called for each frame of data and for each stream closed
+ * @param context user provided data of the handler
+ * @return int 0 on success, -1 if the peer breaks the protocol (bad frame, data over its credits)
+ */
+int mux_input(Mux *m, const char *data, size_t len, MuxHandler handler, void *context);
+
+
+/**
+ * @brief Save the state of the mux : its streams with their credits and their data queued, its frames not sent and its frame cut
+ *
+ * @param m pointer on mux
+ * @param len variable that stores the len of the state
+ * @return char* state, to be freed
+ * @note The state is read by mux_load in a process of the same build, the connection goes on where it was.
+ */
+char *mux_save(Mux *m, size_t *len);
+
+
+/**
+ * @brief Create a mux from a state saved by mux_save
+ *
+ * @param data state
+ * @param len len of the state
+ * @return Mux* pointer on mux, NULL if the state is not valid
+ */
+Mux *mux_load(const char *data, size_t len);
+
+
+/**
+ * @brief Give the bytes held by the mux : data queued and frame being received
+ *
+ * @param m pointer on mux, NULL for none
+ * @return size_t bytes held
+ */
+size_t mux_held(Mux *m);
+
+
+/**
+ * @brief Delete the mux and its streams
+ *
+ * @param m pointer on mux
+ */
+void mux_delete(Mux *m);
+
+#endif
@@ -0,0 +1,302 @@
+/**
+ * @file numa.c
+ * @author Alary Dorian
+ * @brief NUMA topology, memory allocated on a node and pools of buffers by node
+ * @version 0.1
+ * @date 2022-08-12
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "numa.h"
+
+/*
+	No libnuma : the topology comes from sysfs and the memory policy is set with the mbind system call.
+	A pool of buffers takes its memory by slabs, the free buffers are linked through their first bytes.
+*/
+
+#define MPOL_PREFERRED 1 /* linux/mempolicy.h : pages on the node while it has free memory */
+#define NODE_PATH "/sys/devices/system/node/node%d/cpulist"
+
+
+typedef struct s_Free {
+
+	struct s_Free *next;
+} Free;
+
+
+struct s_BufferPool {
+
+	size_t size; /* size of a buffer */
+	int node;
+	pthread_mutex_t mutex;
+	Free *free; /* buffers given back */
+	char **slabs; /* memory allocated */
+	int count; /* number of slabs */
+	size_t used; /* bytes taken in the last slab */
+};
+
+
+/* Topology, read once */
+static int nodes = 1;
+static int cpu_node[NUMA_MAX_CPUS];
+
+/*-----------------------------------------------------------------*/
+
+/**
+ * @brief Read the topology in sysfs, called once
+ *
+ */
+static void numa_init(void)
+{
+	char path[64];
+	FILE *f;
+	int node, first, last, cpu, c;
+
+	for(cpu = 0 ; cpu < NUMA_MAX_CPUS ; cpu++)
+		cpu_node[cpu] = -1;
+
+	for(node = 0 ; node < NUMA_MAX_NODES ; node++)
+	{
+		snprintf(path, sizeof(path), NODE_PATH, node);
+		if((f = fopen(path, "r")) == NULL)
+			break;
+
+		/* "0-3,8-11" */
+		while(fscanf(f, "%d", &first) == 1)
+		{
+			last = first;
+			if((c = fgetc(f)) == '-')
+			{
+				if(fscanf(f, "%d", &last) != 1)
+					break;
+				c = fgetc(f);
+			}
+			for(cpu = first ; cpu <= last && cpu < NUMA_MAX_CPUS ; cpu++)
+				cpu_node[cpu] = node;
+			if(c != ',')
+				break;
+		}
+		fclose(f);
+	}
+
+	nodes = (node > 0) ? node : 1;
+}
+
+
+/**
+ * @brief Read the topology at the first call
+ *
+ */
+static void numa_topology(void)
+{
+	static pthread_once_t once = PTHREAD_ONCE_INIT;
+
+	pthread_once(&once, numa_init);
+}
+
+/*-----------------------------------------------------------------*/
+
+/**
+ * @brief Give the number of nodes
+ *
+ * @return int number of nodes, 1 if the system gives no NUMA information
+ * @note The topology is read once in /sys/devices/system/node.
+ */
+int numa_nodes(void)
+{
+	numa_topology();
+	return nodes;
+}
+
+
+/**
+ * @brief Give the node of a CPU
+ *
+ * @param cpu number of the CPU
+ * @return int node of the CPU, -1 if it is unknown
+ */
+int numa_node_of_cpu(int cpu)
+{
+	numa_topology();
+	return (cpu >= 0 && cpu < NUMA_MAX_CPUS) ? cpu_node[cpu] : -1;
+}
+
+
+/**
+ * @brief Give the CPUs of a node
+ *
+ * @param node number of the node
+ * @param cpus variable that stores the CPUs
+ * @param max number of elements of cpus
+ * @return int number of CPUs stored
+ */
+int numa_cpus(int node, int *cpus, int max)
+{
+	int cpu, count = 0;
+
+	numa_topology();
+	for(cpu = 0 ; cpu < NUMA_MAX_CPUS && count < max ; cpu++)
+	{
+		if(cpu_node[cpu] == node)
+			cpus[count++] = cpu;
+	}
+
+	return count;
+}
+
+
+/**
+ * @brief Allocate memory whose pages are taken on a node
+ *
+ * @param size size of the memory
+ * @param node number of the node, -1 for the node of the first thread which touches a page
+ * @return void* memory, NULL on error
+ */
+void *numa_alloc(size_t size, int node)
+{
+	unsigned long mask[NUMA_MAX_NODES / (8 * sizeof(unsigned long)) + 1];
+	void *memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+	if(memory == MAP_FAILED)
+		return NULL;
+
+	/* the pages are not touched yet, the policy decides where they go */
+	if(node >= 0 && node < NUMA_MAX_NODES)
+	{
+		memset(mask, 0, sizeof(mask));
+		mask[node / (8 * sizeof(unsigned long))] = 1UL << (node % (8 * sizeof(unsigned long)));
+		if(syscall(SYS_mbind, memory, size, MPOL_PREFERRED, mask, NUMA_MAX_NODES + 1, 0) < 0)
+			fprintf(stderr, "Error : mbind()\n");
+	}
+
+	return memory;
+}
+
+
+/**
+ * @brief Free memory allocated by numa_alloc
+ *
+ * @param memory memory
+ * @param size size given to numa_alloc
+ */
+void numa_free(void *memory, size_t size)
+{
+	munmap(memory, size);
+}
+
+
+/**
+ * @brief Create a pool of buffers
+ *
+ * @param size size of a buffer
+ * @param node node of the memory of the buffers, -1 for none
+ * @return BufferPool* pointer on pool
+ * @note The buffers can be taken and given back by any thread.
+ */
+BufferPool *bufferPool_create(size_t size, int node)
+{
+	BufferPool *p = malloc(sizeof(BufferPool));
+
+	/* a buffer holds the link of the free list, and is aligned for any type */
+	size = (size < sizeof(Free)) ? sizeof(Free) : size;
+	p->size = (size + 15) & ~(size_t)15;
+	p->node = node;
+	p->free = NULL;
+	p->slabs = NULL;
+	p->count = 0;
+	p->used = NUMA_SLAB;
+	pthread_mutex_init(&p->mutex, NULL);
+
+	return p;
+}
+
+
+/**
+ * @brief Give the size of the buffers of the pool
+ *
+ * @param p pointer on pool
+ * @return size_t size of a buffer
+ */
+size_t bufferPool_size(BufferPool *p)
+{
+	return p->size;
+}
+
+
+/**
+ * @brief Take a buffer
+ *
+ * @param p pointer on pool
+ * @return void* buffer, NULL if no memory can be allocated
+ */
+void *bufferPool_get(BufferPool *p)
+{
+	void *buffer = NULL;
+	char *slab;
+
+	pthread_mutex_lock(&p->mutex);
+	if(p->free != NULL)
+	{
+		buffer = p->free;
+		p->free = p->free->next;
+	}
+	else
+	{
+		if(p->used + p->size > NUMA_SLAB && p->size <= NUMA_SLAB && (slab = numa_alloc(NUMA_SLAB, p->node)) != NULL)
+		{
+			p->slabs = realloc(p->slabs, (p->count + 1) * sizeof(char *));
+			p->slabs[p->count++] = slab;
+			p->used = 0;
+		}
+		if(p->used + p->size <= NUMA_SLAB)
+		{
+			buffer = p->slabs[p->count - 1] + p->used;
+			p->used += p->size;
+		}
+	}
+	pthread_mutex_unlock(&p->mutex);
+
+	return buffer;
+}
+
+
+/**
+ * @brief Give back a buffer taken in the pool
+ *
+ * @param p pointer on pool
+ * @param buffer buffer
+ */
+void bufferPool_put(BufferPool *p, void *buffer)
+{
+	Free *f = buffer;
+
+	pthread_mutex_lock(&p->mutex);
+	f->next = p->free;
+	p->free = f;
+	pthread_mutex_unlock(&p->mutex);
+}
+
+
+/**
+ * @brief Delete the pool and its memory, every buffer must have been given back
+ *
+ * @param p pointer on pool
+ */
+void bufferPool_delete(BufferPool *p)
+{
+	int i;
+
+	for(i = 0 ; i < p->count ; i++)
+		numa_free(p->slabs[i], NUMA_SLAB);
+	free(p->slabs);
+	pthread_mutex_destroy(&p->mutex);
+	free(p);
+}
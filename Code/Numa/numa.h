@@ -0,0 +1,126 @@
+/**
+ * @file numa.h
+ * @author Alary Dorian
+ * @brief NUMA topology, memory allocated on a node and pools of buffers by node
+ * @version 0.1
+ * @date 2022-08-12
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef __NUMA_H__
+#define __NUMA_H__
+
+#include <stddef.h>
+
+/*-----------------------------------------------------------------*/
+
+/* Values */
+#define NUMA_MAX_CPUS 1024 /* CPUs known by the topology */
+#define NUMA_MAX_NODES 64 /* nodes known by the topology */
+#define NUMA_SLAB (256 * 1024) /* memory allocated at once by a pool of buffers */
+
+
+/**
+* @brief 	Opaque definition of type BufferPool : buffers of one size, in the memory of one node.
+*/
+typedef struct s_BufferPool BufferPool;
+
+
+/*-----------------------------------------------------------------*/
+
+
+/**
+ * @brief Give the number of nodes
+ *
+ * @return int number of nodes, 1 if the system gives no NUMA information
+ * @note The topology is read once in /sys/devices/system/node.
+ */
+int numa_nodes(void);
+
+
+/**
+ * @brief Give the node of a CPU
+ *
+ * @param cpu number of the CPU
+ * @return int node of the CPU, -1 if it is unknown
+ */
+int numa_node_of_cpu(int cpu);
+
+
+/**
+ * @brief Give the CPUs of a node
+ *
+ * @param node number of the node
+ * @param cpus variable that stores the CPUs
+ * @param max number of elements of cpus
+ * @return int number of CPUs stored
+ */
+int numa_cpus(int node, int *cpus, int max);
+
+
+/**
+ * @brief Allocate memory whose pages are taken on a node
+ *
+ * @param size size of the memory
+ * @param node number of the node, -1 for the node of the first thread which touches a page
+ * @return void* memory, NULL on error
+ */
+void *numa_alloc(size_t size, int node);
+
+
+/**
+ * @brief Free memory allocated by numa_alloc
+ *
+ * @param memory memory
+ * @param size size given to numa_alloc
+ */
+void numa_free(void *memory, size_t size);
+
+
+/**
+ * @brief Create a pool of buffers
+ *
+ * @param size size of a buffer
+ * @param node node of the memory of the buffers, -1 for none
+ * @return BufferPool* pointer on pool
+ * @note The buffers can be taken and given back by any thread.
+ */
+BufferPool *bufferPool_create(size_t size, int node);
+
+
+/**
+ * @brief Give the size of the buffers of the pool
+ *
+ * @param p pointer on pool
+ * @return size_t size of a buffer
+ */
+size_t bufferPool_size(BufferPool *p);
+
+
+/**
+ * @brief Take a buffer
+ *
+ * @param p pointer on pool
+ * @return void* buffer, NULL if no memory can be allocated
+ */
+void *bufferPool_get(BufferPool *p);
+
+
+/**
+ * @brief Give back a buffer taken in the pool
+ *
+ * @param p pointer on pool
+ * @param buffer buffer
+ */
+void bufferPool_put(BufferPool *p, void *buffer);
+
+
+/**
+ * @brief Delete the pool and its memory, every buffer must have been given back
+ *
+ * @param p pointer on pool
+ */
+void bufferPool_delete(BufferPool *p);
+
+#endif
@@ -0,0 +1,463 @@
+/**
+ * @file pool.c
+ * @author Alary Dorian
+ * @brief Reusable pool of threads with work stealing
+ * @version 0.1
+ * @date 2022-08-01
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#define _GNU_SOURCE /* pthread_setaffinity_np */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#include "pool.h"
+
+/*
+	Each thread owns a deque : the owner pushes and pops at the bottom (the newest task, still in cache),
+	the thieves take at the top (the oldest task, usually the biggest part of the work left).
+	The threads sleep on one condition when no task is queued in any deque.
+*/
+
+#define DEQUE_CAPACITY 64 /* capacity of a new deque */
+
+
+/* Counter of the tasks of pool_run which are not done */
+typedef struct s_Latch {
+
+	int remaining;
+	pthread_mutex_t mutex;
+	pthread_cond_t done;
+} Latch;
+
+
+typedef struct s_Task {
+
+	TaskFunctor f;
+	void *arg;
+	Latch *latch; /* NULL for pool_submit */
+} Task;
+
+
+typedef struct s_Deque {
+
+	pthread_mutex_t mutex;
+	Task *tasks; /* circular array */
+	int capacity; /* power of 2 */
+	int top; /* slot of the oldest task */
+	int size;
+} Deque;
+
+
+struct s_Pool {
+
+	int threads;
+	pthread_t *ids;
+	int *cpus; /* CPU of each thread, NULL if the threads are not pinned */
+	Deque *deques; /* one by thread */
+	int next; /* deque which receives the next task submitted from outside the pool */
+
+	pthread_mutex_t mutex;
+	pthread_cond_t work; /* signaled when a task is queued */
+	int pending; /* tasks queued and not taken */
+	bool stop;
+};
+
+
+/* Thread of the pool executing the code, -1 outside of a pool */
+static __thread Pool *current_pool = NULL;
+static __thread int current_index = -1;
+
+/*-----------------------------------------------------------------*/
+
+/**
+ * @brief Push a task at the bottom of a deque
+ *
+ * @param d pointer on deque
+ * @param t task to copy
+ */
+static void deque_push(Deque *d, const Task *t)
+{
+	Task *tasks;
+	int i;
+
+	pthread_mutex_lock(&d->mutex);
+	if(d->size == d->capacity)
+	{
+		tasks = malloc(2 * d->capacity * sizeof(Task));
+		for(i = 0 ; i < d->size ; i++)
+			tasks[i] = d->tasks[(d->top + i) & (d->capacity - 1)];
+		free(d->tasks);
+		d->tasks = tasks;
+		d->capacity *= 2;
+		d->top = 0;
+	}
+	d->tasks[(d->top + d->size) & (d->capacity - 1)] = *t;
+	d->size++;
+	pthread_mutex_unlock(&d->mutex);
+}
+
+
+/**
+ * @brief Take a task in a deque
+ *
+ * @param d pointer on deque
+ * @param t variable that stores the task
+ * @param bottom true for the owner (newest task), false for a thief (oldest task)
+ * @return true a task is taken
+ * @return false the deque is empty
+ */
+static bool deque_take(Deque *d, Task *t, bool bottom)
+{
+	bool taken = false;
+
+	pthread_mutex_lock(&d->mutex);
+	if(d->size > 0)
+	{
+		if(bottom)
+		{
+			*t = d->tasks[(d->top + d->size - 1) & (d->capacity - 1)];
+		}
+		else
+		{
+			*t = d->tasks[d->top];
+			d->top = (d->top + 1) & (d->capacity - 1);
+		}
+		d->size--;
+		taken = true;
+	}
+	pthread_mutex_unlock(&d->mutex);
+
+	return taken;
+}
+
+
+/**
+ * @brief Take a task : in the own deque first, then in the others from the next one
+ *
+ * @param p pointer on pool
+ * @param self index of the thread, -1 for a thread outside of the pool
+ * @param t variable that stores the task
+ * @return true a task is taken
+ * @return false every deque is empty
+ */
+static bool pool_take(Pool *p, int self, Task *t)
+{
+	int i;
+
+	if(self >= 0 && deque_take(&p->deques[self], t, true))
+		return true;
+
+	for(i = 1 ; i <= p->threads ; i++)
+	{
+		if(deque_take(&p->deques[(self + i + p->threads) % p->threads], t, false))
+			return true;
+	}
+
+	return false;
+}
+
+
+/**
+ * @brief Execute a task and count it down in its latch
+ *
+ * @param p pointer on pool
+ * @param t task taken
+ */
+static void task_execute(Pool *p, Task *t)
+{
+	__atomic_sub_fetch(&p->pending, 1, __ATOMIC_RELAXED);
+	t->f(t->arg);
+
+	if(t->latch != NULL)
+	{
+		pthread_mutex_lock(&t->latch->mutex);
+		if(--t->latch->remaining == 0)
+			pthread_cond_signal(&t->latch->done);
+		pthread_mutex_unlock(&t->latch->mutex);
+	}
+}
+
+
+/**
+ * @brief Queue a task in the deque of the current thread, or in the next deque from outside of the pool
+ *
+ * @param p pointer on pool
+ * @param t task to copy
+ */
+static void pool_push(Pool *p, const Task *t)
+{
+	int index = (current_pool == p) ? current_index : __atomic_fetch_add(&p->next, 1, __ATOMIC_RELAXED) % p->threads;
+
+	deque_push(&p->deques[index], t);
+
+	pthread_mutex_lock(&p->mutex);
+	__atomic_add_fetch(&p->pending, 1, __ATOMIC_RELAXED);
+	pthread_cond_signal(&p->work);
+	pthread_mutex_unlock(&p->mutex);
+}
+
+
+/**
+ * @brief Loop of a thread of the pool
+ *
+ * @param arg pointer on pool
+ * @return void* NULL
+ */
+static void *pool_thread(void *arg)
+{
+	Pool *p = arg;
+	cpu_set_t set;
+	Task t;
+
+	pthread_mutex_lock(&p->mutex);
+	current_pool = p;
+	current_index = __atomic_fetch_add(&p->next, 1, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&p->mutex);
+
+	if(p->cpus != NULL)
+	{
+		CPU_ZERO(&set);
+		CPU_SET(p->cpus[current_index], &set);
+		if(pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+			fprintf(stderr, "Error : pthread_setaffinity_np()\n");
+	}
+
+	while(true)
+	{
+		if(pool_take(p, current_index, &t))
+		{
+			task_execute(p, &t);
+			continue;
+		}
+
+		pthread_mutex_lock(&p->mutex);
+		while(__atomic_load_n(&p->pending, __ATOMIC_RELAXED) <= 0 && !p->stop)
+			pthread_cond_wait(&p->work, &p->mutex);
+		if(p->stop && __atomic_load_n(&p->pending, __ATOMIC_RELAXED) <= 0)
+		{
+			pthread_mutex_unlock(&p->mutex);
+			break;
+		}
+		pthread_mutex_unlock(&p->mutex);
+	}
+
+	return NULL;
+}
+
+/*-----------------------------------------------------------------*/
+
+/* Pool returned by pool_default */
+static Pool *shared_pool = NULL;
+
+
+/**
+ * @brief Create the pool returned by pool_default, called once
+ *
+ */
+static void pool_default_create(void)
+{
+	shared_pool = pool_create(0);
+}
+
+
+/**
+ * @brief Create a pool and start its threads
+ *
+ * @param cpus CPU of each thread, NULL if the threads are not pinned
+ * @param threads number of threads
+ * @return Pool* pointer on pool
+ */
+static Pool *pool_start(const int *cpus, int threads)
+{
+	Pool *p = malloc(sizeof(Pool));
+	int i;
+
+	p->threads = threads;
+	p->ids = malloc(threads * sizeof(pthread_t));
+	p->deques = malloc(threads * sizeof(Deque));
+	p->cpus = NULL;
+	p->next = 0;
+	p->pending = 0;
+	p->stop = false;
+	pthread_mutex_init(&p->mutex, NULL);
+	pthread_cond_init(&p->work, NULL);
+
+	if(cpus != NULL)
+	{
+		p->cpus = malloc(threads * sizeof(int));
+		memcpy(p->cpus, cpus, threads * sizeof(int));
+	}
+
+	for(i = 0 ; i < threads ; i++)
+	{
+		pthread_mutex_init(&p->deques[i].mutex, NULL);
+		p->deques[i].tasks = malloc(DEQUE_CAPACITY * sizeof(Task));
+		p->deques[i].capacity = DEQUE_CAPACITY;
+		p->deques[i].top = 0;
+		p->deques[i].size = 0;
+	}
+
+	/* each thread takes its index in p->next */
+	pthread_mutex_lock(&p->mutex);
+	for(i = 0 ; i < threads ; i++)
+		pthread_create(&p->ids[i], NULL, pool_thread, p);
+	pthread_mutex_unlock(&p->mutex);
+
+	/* wait for the indexes before p->next is used for the submissions */
+	while(__atomic_load_n(&p->next, __ATOMIC_ACQUIRE) < threads)
+		sched_yield();
+
+	return p;
+}
+
+
+/**
+ * @brief Create a pool and start its threads
+ *
+ * @param threads number of threads, 0 for one thread by online processor
+ * @return Pool* pointer on pool
+ * @note Each thread has its own deque of tasks : it takes the last task it pushed,
+ * 		 and when its deque is empty it steals the oldest task of another thread.
+ */
+Pool *pool_create(int threads)
+{
+	if(threads <= 0 && (threads = sysconf(_SC_NPROCESSORS_ONLN)) <= 0)
+		threads = 1;
+
+	return pool_start(NULL, threads);
+}
+
+
+/**
+ * @brief Create a pool whose threads are pinned, one by CPU of the array
+ *
+ * @param cpus CPU of each thread, copied
+ * @param threads number of threads
+ * @return Pool* pointer on pool
+ * @note The memory allocated by a thread is taken on its node (first touch).
+ */
+Pool *pool_create_pinned(const int *cpus, int threads)
+{
+	return pool_start(cpus, threads);
+}
+
+
+/**
+ * @brief Give the pool shared by the whole program, created at the first call
+ *
+ * @return Pool* pointer on pool, one thread by online processor
+ */
+Pool *pool_default(void)
+{
+	static pthread_once_t once = PTHREAD_ONCE_INIT;
+
+	pthread_once(&once, pool_default_create);
+
+	return shared_pool;
+}
+
+
+/**
+ * @brief Give the number of threads of the pool
+ *
+ * @param p pointer on pool
+ * @return int number of threads
+ */
+int pool_size(Pool *p)
+{
+	return p->threads;
+}
+
+
+/**
+ * @brief Submit a task, the function returns without waiting the task
+ *
+ * @param p pointer on pool
+ * @param f functor to execute
+ * @param arg argument of the functor
+ * @note Called by a thread of the pool, the task goes in the deque of this thread.
+ */
+void pool_submit(Pool *p, TaskFunctor f, void *arg)
+{
+	Task t = { f, arg, NULL };
+	pool_push(p, &t);
+}
+
+
+/**
+ * @brief Execute count tasks and wait until all are done (fork-join)
+ *
+ * @param p pointer on pool
+ * @param f functor to execute
+ * @param args arguments of the functor, one by task
+ * @param count number of tasks
+ * @note The calling thread executes tasks too while it waits, so it can be a thread of the pool.
+ */
+void pool_run(Pool *p, TaskFunctor f, void **args, int count)
+{
+	Latch latch;
+	Task t;
+	int i;
+
+	latch.remaining = count;
+	pthread_mutex_init(&latch.mutex, NULL);
+	pthread_cond_init(&latch.done, NULL);
+
+	for(i = 0 ; i < count ; i++)
+	{
+		t.f = f;
+		t.arg = args[i];
+		t.latch = &latch;
+		pool_push(p, &t);
+	}
+
+	/* help while tasks are queued, then every task left is running */
+	while(pool_take(p, (current_pool == p) ? current_index : -1, &t))
+		task_execute(p, &t);
+
+	pthread_mutex_lock(&latch.mutex);
+	while(latch.remaining > 0)
+		pthread_cond_wait(&latch.done, &latch.mutex);
+	pthread_mutex_unlock(&latch.mutex);
+
+	pthread_mutex_destroy(&latch.mutex);
+	pthread_cond_destroy(&latch.done);
+}
+
+
+/**
+ * @brief Wait the end of the running tasks, stop the threads and delete the pool
+ *
+ * @param p pointer on pool
+ * @note Tasks not started are executed before the threads stop.
+ */
+void pool_delete(Pool *p)
+{
+	int i;
+
+	pthread_mutex_lock(&p->mutex);
+	p->stop = true;
+	pthread_cond_broadcast(&p->work);
+	pthread_mutex_unlock(&p->mutex);
+
+	for(i = 0 ; i < p->threads ; i++)
+	{
+		pthread_join(p->ids[i], NULL);
+		pthread_mutex_destroy(&p->deques[i].mutex);
+		free(p->deques[i].tasks);
+	}
+
+	pthread_mutex_destroy(&p->mutex);
+	pthread_cond_destroy(&p->work);
+	free(p->deques);
+	free(p->ids);
+	free(p->cpus);
+	free(p);
+}
@@ -0,0 +1,103 @@
+/**
+ * @file pool.h
+ * @author Alary Dorian
+ * @brief Reusable pool of threads with work stealing
+ * @version 0.1
+ * @date 2022-08-01
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef __POOL_H__
+#define __POOL_H__
+
+/*-----------------------------------------------------------------*/
+
+
+/**
+* @brief 	Opaque definition of type Pool.
+*/
+typedef struct s_Pool Pool;
+
+
+/**
+* @brief 	Functor executed by a thread of the pool.
+* @param	(void*) Opaque pointer to user provided data
+*/
+typedef void (*TaskFunctor)(void *);
+
+
+/*-----------------------------------------------------------------*/
+
+
+/**
+ * @brief Create a pool and start its threads
+ *
+ * @param threads number of threads, 0 for one thread by online processor
+ * @return Pool* pointer on pool
+ * @note Each thread has its own deque of tasks : it takes the last task it pushed,
+ * 		 and when its deque is empty it steals the oldest task of another thread.
+ */
+Pool *pool_create(int threads);
+
+
+/**
+ * @brief Create a pool whose threads are pinned, one by CPU of the array
+ *
+ * @param cpus CPU of each thread, copied
+ * @param threads number of threads
+ * @return Pool* pointer on pool
+ * @note The memory allocated by a thread is taken on its node (first touch).
+ */
+Pool *pool_create_pinned(const int *cpus, int threads);
+
+
+/**
+ * @brief Give the pool shared by the whole program, created at the first call
+ *
+ * @return Pool* pointer on pool, one thread by online processor
+ */
+Pool *pool_default(void);
+
+
+/**
+ * @brief Give the number of threads of the pool
+ *
+ * @param p pointer on pool
+ * @return int number of threads
+ */
+int pool_size(Pool *p);
+
+
+/**
+ * @brief Submit a task, the function returns without waiting the task
+ *
+ * @param p pointer on pool
+ * @param f functor to execute
+ * @param arg argument of the functor
+ * @note Called by a thread of the pool, the task goes in the deque of this thread.
+ */
+void pool_submit(Pool *p, TaskFunctor f, void *arg);
+
+
+/**
+ * @brief Execute count tasks and wait until all are done (fork-join)
+ *
+ * @param p pointer on pool
+ * @param f functor to execute
+ * @param args arguments of the functor, one by task
+ * @param count number of tasks
+ * @note The calling thread executes tasks too while it waits, so it can be a thread of the pool.
+ */
+void pool_run(Pool *p, TaskFunctor f, void **args, int count);
+
+
+/**
+ * @brief Wait the end of the running tasks, stop the threads and delete the pool
+ *
+ * @param p pointer on pool
+ * @note Tasks not started are executed before the threads stop.
+ */
+void pool_delete(Pool *p);
+
+#endif
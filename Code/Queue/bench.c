@@ -0,0 +1,179 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include <sched.h>
+#include <pthread.h>
+#include "queue.h"
+#include "bqueue.h"
+
+/*
+   Producers and one consumer : make bench, then ./bench_queue [count].
+   "polled" is a Queue under a mutex which the consumer checks in a loop, as the pipelines did,
+   "pop" and "batch" are a BoundedQueue read one element or BATCH elements at a time.
+*/
+
+#define COUNT 2000000 /* elements by run */
+#define PRODUCERS 2
+#define CAPACITY 1024
+#define BATCH 64
+
+typedef struct {
+    int count;
+    Queue *polled;
+    pthread_mutex_t lock;
+    BoundedQueue *bounded;
+    pthread_t producers[PRODUCERS];
+} Pipe;
+
+
+static long long now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+
+static void *producePolled(void *arg)
+{
+    Pipe *p = arg;
+    intptr_t i;
+
+    for(i = 1 ; i <= p->count / PRODUCERS ; i++)
+    {
+        pthread_mutex_lock(&p->lock);
+        pushQueue(p->polled, (void *)i);
+        pthread_mutex_unlock(&p->lock);
+    }
+
+    return NULL;
+}
+
+
+static void *produceBounded(void *arg)
+{
+    Pipe *p = arg;
+    intptr_t i;
+
+    for(i = 1 ; i <= p->count / PRODUCERS ; i++)
+        pushBoundedQueue(p->bounded, (void *)i);
+
+    return NULL;
+}
+
+
+static long consumePolled(Pipe *p, int total)
+{
+    long sum = 0;
+    int n = 0;
+    void *e;
+
+    while(n < total)
+    {
+        pthread_mutex_lock(&p->lock);
+        if(isEmptyQueue(p->polled))
+        {
+            pthread_mutex_unlock(&p->lock);
+            sched_yield();
+            continue;
+        }
+        e = topQueue(p->polled);
+        popQueue(p->polled);
+        pthread_mutex_unlock(&p->lock);
+        sum += (intptr_t)e;
+        n++;
+    }
+
+    return sum;
+}
+
+
+static long consumeBounded(Pipe *p, int batch)
+{
+    void *out[BATCH];
+    long sum = 0;
+    int n, i;
+
+    while(1)
+    {
+        if(batch > 1)
+            n = popQueueBatch(p->bounded, out, batch);
+        else
+            n = ((out[0] = popBoundedQueue(p->bounded)) != NULL);
+        if(n == 0)
+            break;
+        for(i = 0 ; i < n ; i++)
+            sum += (intptr_t)out[i];
+    }
+
+    return sum;
+}
+
+
+/* joins the producers then closes the queue, the consumer ends on it */
+static void *closeWhenDone(void *arg)
+{
+    Pipe *p = arg;
+    int i;
+
+    for(i = 0 ; i < PRODUCERS ; i++)
+        pthread_join(p->producers[i], NULL);
+    closeBoundedQueue(p->bounded);
+
+    return NULL;
+}
+
+
+static void run(const char *name, int count, int mode)
+{
+    pthread_t closer;
+    Pipe p;
+    long long start, stop;
+    long sum, per = count / PRODUCERS;
+    int i;
+
+    p.count = count;
+    p.polled = createQueue();
+    pthread_mutex_init(&p.lock, NULL);
+    p.bounded = createBoundedQueue(CAPACITY);
+
+    start = now();
+    for(i = 0 ; i < PRODUCERS ; i++)
+        pthread_create(&p.producers[i], NULL, (mode == 0) ? producePolled : produceBounded, &p);
+
+    if(mode == 0)
+    {
+        sum = consumePolled(&p, PRODUCERS * per);
+        for(i = 0 ; i < PRODUCERS ; i++)
+            pthread_join(p.producers[i], NULL);
+    }
+    else
+    {
+        pthread_create(&closer, NULL, closeWhenDone, &p);
+        sum = consumeBounded(&p, (mode == 1) ? 1 : BATCH);
+        pthread_join(closer, NULL);
+    }
+    stop = now();
+
+    if(sum != PRODUCERS * per * (per + 1) / 2)
+        fprintf(stderr, "Error : %s lost elements\n", name);
+    printf("%-8s %10.0f elements/s\n", name, PRODUCERS * per * 1e9 / (stop - start));
+
+    deleteQueue(p.polled);
+    pthread_mutex_destroy(&p.lock);
+    deleteBoundedQueue(p.bounded);
+}
+
+
+int main(int argc, char *argv[])
+{
+    int count = (argc > 1) ? atoi(argv[1]) : COUNT;
+
+    printf("%d elements, %d producers, capacity %d\n", count, PRODUCERS, CAPACITY);
+    run("polled", count, 0);
+    run("pop", count, 1);
+    run("batch", count, 2);
+
+    return 0;
+}
@@ -0,0 +1,351 @@
+/**
+@author ALARY Dorian
+@brief Implementation of type BoundedQueue
+@date 08 / 2022
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "bqueue.h"
+
+/*
+  The elements are in a ring of capacity slots, under one mutex.
+  A thread which would wait first spins on the gauge, without the lock : a producer and a consumer
+  on two CPUs exchange elements without sleeping. Then it sleeps on a condition, and a thread signals
+  only when another one sleeps. A batch pop frees many slots in one lock and wakes the producers once.
+*/
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CPU_RELAX() __builtin_ia32_pause()
+#else
+#define CPU_RELAX() __asm__ __volatile__("" ::: "memory")
+#endif
+
+
+struct s_bounded_queue{
+  void **items;
+  int capacity;
+  int head; /* oldest element */
+  int gauge; /* number of elements, read without the lock by the threads which spin */
+  bool closed;
+  bool spin; /* more than one CPU : a thread spins before it sleeps */
+  int pushers; /* threads which sleep while the queue is full */
+  int poppers; /* threads which sleep while the queue is empty */
+  pthread_mutex_t mutex;
+  pthread_cond_t not_full;
+  pthread_cond_t not_empty;
+};
+
+
+/**
+* @brief    Tell if a thread can go on : a slot is free for a push, an element is there for a pop
+* @param q  Pointer on BoundedQueue
+* @param push  true for a push, false for a pop
+* @return   Boolean
+*/
+static bool readyBoundedQueue(BoundedQueue *q, bool push){
+
+  int gauge = __atomic_load_n(&q->gauge, __ATOMIC_ACQUIRE);
+
+  return push ? gauge < q->capacity : gauge > 0;
+}
+
+
+/**
+* @brief    Spin a while before the lock is taken, until the queue is ready or closed
+* @param q  Pointer on BoundedQueue
+* @param push  true for a push, false for a pop
+*/
+static void spinBoundedQueue(BoundedQueue *q, bool push){
+
+  int i;
+
+  if(!q->spin)
+    return;
+
+  for(i = 0 ; i < BQUEUE_SPIN && !readyBoundedQueue(q, push) && !__atomic_load_n(&q->closed, __ATOMIC_RELAXED) ; i++)
+    CPU_RELAX();
+}
+
+
+/**
+* @brief    Wait with the lock held until the queue is ready, closed, or the time is over
+* @param q  Pointer on BoundedQueue
+* @param push  true for a push, false for a pop
+* @param ms Milliseconds to wait, 0 for no wait, -1 for no limit
+* @return   true if the thread can go on
+*/
+static bool waitBoundedQueue(BoundedQueue *q, bool push, int ms){
+
+  pthread_cond_t *cond = push ? &q->not_full : &q->not_empty;
+  int *sleepers = push ? &q->pushers : &q->poppers;
+  struct timespec deadline;
+  int status = 0;
+
+  if(ms > 0){
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += ms / 1000;
+    deadline.tv_nsec += (ms % 1000) * 1000000L;
+    if(deadline.tv_nsec >= 1000000000L){
+      deadline.tv_sec++;
+      deadline.tv_nsec -= 1000000000L;
+    }
+  }
+
+  while(!readyBoundedQueue(q, push) && !q->closed && ms != 0 && status != ETIMEDOUT){
+    (*sleepers)++;
+    status = (ms < 0) ? pthread_cond_wait(cond, &q->mutex) : pthread_cond_timedwait(cond, &q->mutex, &deadline);
+    (*sleepers)--;
+  }
+
+  /* a closed queue takes no element, but gives the ones left */
+  return readyBoundedQueue(q, push) && !(push && q->closed);
+}
+
+
+/**
+* @brief    Push an element, wait at most ms
+* @param q  Pointer on BoundedQueue
+* @param e  Pointer on new element
+* @param ms Milliseconds to wait, 0 for no wait, -1 for no limit
+* @return   true on success
+*/
+static bool pushWaitBoundedQueue(BoundedQueue *q, void *e, int ms){
+
+  bool ok;
+
+  if(ms != 0)
+    spinBoundedQueue(q, true);
+
+  pthread_mutex_lock(&q->mutex);
+  if((ok = waitBoundedQueue(q, true, ms))){
+    q->items[(q->head + q->gauge) % q->capacity] = e;
+    __atomic_store_n(&q->gauge, q->gauge + 1, __ATOMIC_RELEASE);
+    if(q->poppers > 0)
+      pthread_cond_signal(&q->not_empty);
+  }
+  pthread_mutex_unlock(&q->mutex);
+
+  return ok;
+}
+
+
+/**
+* @brief    Pop elements in one lock, wait at most ms for the first one
+* @param q    Pointer on BoundedQueue
+* @param out  Array which stores the elements
+* @param max  Size of out
+* @param ms   Milliseconds to wait, 0 for no wait, -1 for no limit
+* @return   int number of elements popped
+*/
+static int popWaitBoundedQueue(BoundedQueue *q, void **out, int max, int ms){
+
+  int n = 0;
+
+  if(ms != 0)
+    spinBoundedQueue(q, false);
+
+  pthread_mutex_lock(&q->mutex);
+  if(waitBoundedQueue(q, false, ms)){
+    for(n = 0 ; n < max && n < q->gauge ; n++)
+      out[n] = q->items[(q->head + n) % q->capacity];
+    q->head = (q->head + n) % q->capacity;
+    __atomic_store_n(&q->gauge, q->gauge - n, __ATOMIC_RELEASE);
+
+    /* one slot freed wakes one producer, more slots wake all of them */
+    if(q->pushers > 0 && n > 1)
+      pthread_cond_broadcast(&q->not_full);
+    else if(q->pushers > 0)
+      pthread_cond_signal(&q->not_full);
+  }
+  pthread_mutex_unlock(&q->mutex);
+
+  return n;
+}
+
+
+/**
+* @brief    Constructor : create and initialise BoundedQueue
+* @param capacity  Max number of elements, a producer waits when it is reached
+* @return   Pointer to BoundedQueue
+*/
+BoundedQueue *createBoundedQueue(int capacity){
+
+  BoundedQueue *q = malloc(sizeof(struct s_bounded_queue));
+  pthread_condattr_t attr;
+
+  q->items = malloc(capacity * sizeof(void *));
+  q->capacity = capacity;
+  q->head = 0;
+  q->gauge = 0;
+  q->closed = false;
+  q->spin = sysconf(_SC_NPROCESSORS_ONLN) > 1;
+  q->pushers = 0;
+  q->poppers = 0;
+  pthread_mutex_init(&q->mutex, NULL);
+
+  /* the timed waits are not moved by a change of the clock */
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&q->not_full, &attr);
+  pthread_cond_init(&q->not_empty, &attr);
+  pthread_condattr_destroy(&attr);
+
+  return q;
+}
+
+
+/**
+* @brief    Destructor : Delete queue and its elements
+* @param q  Pointer on BoundedQueue
+* @pre      No thread waits on the queue
+*/
+void deleteBoundedQueue(BoundedQueue *q){
+
+  void *elem;
+
+  while((elem = tryPopBoundedQueue(q)) != NULL)
+    free(elem);
+
+  pthread_cond_destroy(&q->not_full);
+  pthread_cond_destroy(&q->not_empty);
+  pthread_mutex_destroy(&q->mutex);
+  free(q->items);
+  free(q);
+}
+
+
+/**
+* @brief    Operator : close the queue, the threads which wait are woken up
+* @param q  Pointer on BoundedQueue
+* @note     A push fails after it, a pop takes the elements left then fails.
+*/
+void closeBoundedQueue(BoundedQueue *q){
+
+  pthread_mutex_lock(&q->mutex);
+  __atomic_store_n(&q->closed, true, __ATOMIC_RELAXED);
+  pthread_cond_broadcast(&q->not_full);
+  pthread_cond_broadcast(&q->not_empty);
+  pthread_mutex_unlock(&q->mutex);
+}
+
+
+/**
+* @brief    Constructor : Push a new element, wait while the queue is full
+* @param q  Pointer on BoundedQueue
+* @param e  Pointer on new element (whatever the type), not NULL
+* @return   true on success, false if the queue is closed
+*/
+bool pushBoundedQueue(BoundedQueue *q, void *e){
+
+  return pushWaitBoundedQueue(q, e, -1);
+}
+
+
+/**
+* @brief    Constructor : Push a new element if the queue is not full
+* @param q  Pointer on BoundedQueue
+* @param e  Pointer on new element (whatever the type), not NULL
+* @return   true on success, false if the queue is full or closed
+*/
+bool tryPushBoundedQueue(BoundedQueue *q, void *e){
+
+  return pushWaitBoundedQueue(q, e, 0);
+}
+
+
+/**
+* @brief    Constructor : Push a new element, wait at most ms while the queue is full
+* @param q  Pointer on BoundedQueue
+* @param e  Pointer on new element (whatever the type), not NULL
+* @param ms Milliseconds to wait
+* @return   true on success, false if the queue is still full or closed
+*/
+bool timedPushBoundedQueue(BoundedQueue *q, void *e, int ms){
+
+  return pushWaitBoundedQueue(q, e, (ms > 0) ? ms : 0);
+}
+
+
+/**
+* @brief    Operator : pop the oldest element, wait while the queue is empty
+* @param q  Pointer on BoundedQueue
+* @return   Pointer on element, NULL if the queue is closed and empty
+*/
+void *popBoundedQueue(BoundedQueue *q){
+
+  void *e = NULL;
+
+  popWaitBoundedQueue(q, &e, 1, -1);
+  return e;
+}
+
+
+/**
+* @brief    Operator : pop the oldest element if the queue is not empty
+* @param q  Pointer on BoundedQueue
+* @return   Pointer on element, NULL if the queue is empty
+*/
+void *tryPopBoundedQueue(BoundedQueue *q){
+
+  void *e = NULL;
+
+  popWaitBoundedQueue(q, &e, 1, 0);
+  return e;
+}
+
+
+/**
+* @brief    Operator : pop the oldest element, wait at most ms while the queue is empty
+* @param q  Pointer on BoundedQueue
+* @param ms Milliseconds to wait
+* @return   Pointer on element, NULL if the queue is still empty or closed and empty
+*/
+void *timedPopBoundedQueue(BoundedQueue *q, int ms){
+
+  void *e = NULL;
+
+  popWaitBoundedQueue(q, &e, 1, (ms > 0) ? ms : 0);
+  return e;
+}
+
+
+/**
+* @brief    Operator : pop the oldest elements in one lock, wait while the queue is empty
+* @param q    Pointer on BoundedQueue
+* @param out  Array which stores the elements, oldest first
+* @param max  Size of out
+* @return   int number of elements popped, from 1 to max, 0 if the queue is closed and empty
+*/
+int popQueueBatch(BoundedQueue *q, void **out, int max){
+
+  return popWaitBoundedQueue(q, out, max, -1);
+}
+
+
+/**
+* @brief    Operator : pop the oldest elements in one lock, without waiting
+* @param q    Pointer on BoundedQueue
+* @param out  Array which stores the elements, oldest first
+* @param max  Size of out
+* @return   int number of elements popped, 0 if the queue is empty
+*/
+int tryPopQueueBatch(BoundedQueue *q, void **out, int max){
+
+  return popWaitBoundedQueue(q, out, max, 0);
+}
+
+
+/**
+* @brief    Return size of BoundedQueue
+* @param q  Pointer on BoundedQueue
+* @return   int size of BoundedQueue, it may change at once
+*/
+int sizeBoundedQueue(BoundedQueue *q){
+
+  return __atomic_load_n(&q->gauge, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,124 @@
+/**
+@author ALARY Dorian
+@brief Interface of type BoundedQueue : a Queue of fixed capacity shared by threads
+@date 08 / 2022
+*/
+
+#ifndef __BQUEUE_H__
+#define __BQUEUE_H__
+
+#include <stdbool.h>
+
+/* Values */
+#define BQUEUE_SPIN 200 /* checks of the queue before a thread sleeps on it, when there is more than one CPU */
+
+
+/** Opaque definition of type BoundedQueue */
+typedef struct s_bounded_queue BoundedQueue;
+
+
+/**
+* @brief    Constructor : create and initialise BoundedQueue
+* @param capacity  Max number of elements, a producer waits when it is reached
+* @return   Pointer to BoundedQueue
+*/
+BoundedQueue *createBoundedQueue(int capacity);
+
+
+/**
+* @brief    Destructor : Delete queue and its elements
+* @param q  Pointer on BoundedQueue
+* @pre      No thread waits on the queue
+*/
+void deleteBoundedQueue(BoundedQueue *q);
+
+
+/**
+* @brief    Operator : close the queue, the threads which wait are woken up
+* @param q  Pointer on BoundedQueue
+* @note     A push fails after it, a pop takes the elements left then fails.
+*/
+void closeBoundedQueue(BoundedQueue *q);
+
+
+/**
+* @brief    Constructor : Push a new element, wait while the queue is full
+* @param q  Pointer on BoundedQueue
+* @param e  Pointer on new element (whatever the type), not NULL
+* @return   true on success, false if the queue is closed
+*/
+bool pushBoundedQueue(BoundedQueue *q, void *e);
+
+
+/**
+* @brief    Constructor : Push a new element if the queue is not full
+* @param q  Pointer on BoundedQueue
+* @param e  Pointer on new element (whatever the type), not NULL
+* @return   true on success, false if the queue is full or closed
+*/
+bool tryPushBoundedQueue(BoundedQueue *q, void *e);
+
+
+/**
+* @brief    Constructor : Push a new element, wait at most ms while the queue is full
+* @param q  Pointer on BoundedQueue
+* @param e  Pointer on new element (whatever the type), not NULL
+* @param ms Milliseconds to wait
+* @return   true on success, false if the queue is still full or closed
+*/
+bool timedPushBoundedQueue(BoundedQueue *q, void *e, int ms);
+
+
+/**
+* @brief    Operator : pop the oldest element, wait while the queue is empty
+* @param q  Pointer on BoundedQueue
+* @return   Pointer on element, NULL if the queue is closed and empty
+*/
+void *popBoundedQueue(BoundedQueue *q);
+
+
+/**
+* @brief    Operator : pop the oldest element if the queue is not empty
+* @param q  Pointer on BoundedQueue
+* @return   Pointer on element, NULL if the queue is empty
+*/
+void *tryPopBoundedQueue(BoundedQueue *q);
+
+
+/**
+* @brief    Operator : pop the oldest element, wait at most ms while the queue is empty
+* @param q  Pointer on BoundedQueue
+* @param ms Milliseconds to wait
+* @return   Pointer on element, NULL if the queue is still empty or closed and empty
+*/
+void *timedPopBoundedQueue(BoundedQueue *q, int ms);
+
+
+/**
+* @brief    Operator : pop the oldest elements in one lock, wait while the queue is empty
+* @param q    Pointer on BoundedQueue
+* @param out  Array which stores the elements, oldest first
+* @param max  Size of out
+* @return   int number of elements popped, from 1 to max, 0 if the queue is closed and empty
+*/
+int popQueueBatch(BoundedQueue *q, void **out, int max);
+
+
+/**
+* @brief    Operator : pop the oldest elements in one lock, without waiting
+* @param q    Pointer on BoundedQueue
+* @param out  Array which stores the elements, oldest first
+* @param max  Size of out
+* @return   int number of elements popped, 0 if the queue is empty
+*/
+int tryPopQueueBatch(BoundedQueue *q, void **out, int max);
+
+
+/**
+* @brief    Return size of BoundedQueue
+* @param q  Pointer on BoundedQueue
+* @return   int size of BoundedQueue, it may change at once
+*/
+int sizeBoundedQueue(BoundedQueue *q);
+
+#endif
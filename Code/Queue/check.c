@@ -0,0 +1,248 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "bqueue.h"
+
+/*
+   Behaviour of the BoundedQueue : make check, or
+      gcc -o check_queue Queue/check.c Queue/queue.c Queue/bqueue.c -pthread && ./check_queue
+   The program ends with 1 if a check fails.
+*/
+
+#define CAPACITY 8
+#define PRODUCERS 4
+#define CONSUMERS 3
+#define COUNT 200000 /* elements by producer */
+#define BATCH 16
+#define WAIT_MS 50
+
+#define CHECK(cond) do { if(!(cond)) { fprintf(stderr, "Error : %s:%d : %s\n", __FILE__, __LINE__, #cond); failures++; } } while(0)
+
+/* an element is never NULL : the value is stored plus one */
+#define ELEMENT(v) ((void *)(intptr_t)((v) + 1))
+#define VALUE(e) ((int)(intptr_t)(e) - 1)
+
+static int failures = 0;
+
+
+typedef struct s_Shared {
+
+    BoundedQueue *q;
+    int producer; /* id of a producer */
+    char seen[PRODUCERS * COUNT]; /* elements popped, each once */
+    int last[CONSUMERS][PRODUCERS]; /* last element of each producer seen by each consumer */
+    pthread_mutex_t lock;
+    int errors;
+} Shared;
+
+typedef struct s_Consumer {
+
+    Shared *shared;
+    int id;
+} Consumer;
+
+
+static long long now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000LL + t.tv_nsec / 1000000;
+}
+
+
+static void sleepMs(int ms)
+{
+    struct timespec t = { ms / 1000, (ms % 1000) * 1000000L };
+    nanosleep(&t, NULL);
+}
+
+
+/* alone, the queue is a FIFO of CAPACITY elements */
+static void check_fifo(void)
+{
+    BoundedQueue *q = createBoundedQueue(CAPACITY);
+    void *out[CAPACITY];
+    int i, n;
+
+    CHECK(tryPopBoundedQueue(q) == NULL);
+    for(i = 0 ; i < CAPACITY ; i++)
+        CHECK(tryPushBoundedQueue(q, ELEMENT(i)));
+    CHECK(!tryPushBoundedQueue(q, ELEMENT(CAPACITY)));
+    CHECK(sizeBoundedQueue(q) == CAPACITY);
+
+    CHECK(VALUE(popBoundedQueue(q)) == 0);
+    CHECK(VALUE(tryPopBoundedQueue(q)) == 1);
+    n = tryPopQueueBatch(q, out, 3);
+    CHECK(n == 3 && VALUE(out[0]) == 2 && VALUE(out[2]) == 4);
+
+    /* the ring wraps around */
+    for(i = 0 ; i < 5 ; i++)
+        CHECK(tryPushBoundedQueue(q, ELEMENT(CAPACITY + i)));
+    CHECK(!tryPushBoundedQueue(q, ELEMENT(0)));
+    n = popQueueBatch(q, out, CAPACITY);
+    CHECK(n == CAPACITY);
+    for(i = 0 ; i < n ; i++)
+        CHECK(VALUE(out[i]) == 5 + i);
+    CHECK(tryPopQueueBatch(q, out, CAPACITY) == 0);
+
+    deleteBoundedQueue(q);
+}
+
+
+/* the timed operations give up after their delay */
+static void check_timed(void)
+{
+    BoundedQueue *q = createBoundedQueue(1);
+    long long start;
+
+    start = now();
+    CHECK(timedPopBoundedQueue(q, WAIT_MS) == NULL);
+    CHECK(now() - start >= WAIT_MS - 1);
+
+    CHECK(timedPushBoundedQueue(q, ELEMENT(1), WAIT_MS));
+    start = now();
+    CHECK(!timedPushBoundedQueue(q, ELEMENT(2), WAIT_MS));
+    CHECK(now() - start >= WAIT_MS - 1);
+    CHECK(VALUE(timedPopBoundedQueue(q, WAIT_MS)) == 1);
+
+    deleteBoundedQueue(q);
+}
+
+
+static void *popUntilClosed(void *arg)
+{
+    return popBoundedQueue(arg);
+}
+
+
+static void *pushUntilClosed(void *arg)
+{
+    return pushBoundedQueue(arg, ELEMENT(2)) ? ELEMENT(0) : NULL;
+}
+
+
+/* close wakes up the threads which wait, the elements left are still popped */
+static void check_close(void)
+{
+    BoundedQueue *q = createBoundedQueue(1);
+    pthread_t t;
+    void *result;
+
+    pthread_create(&t, NULL, popUntilClosed, q);
+    sleepMs(WAIT_MS);
+    closeBoundedQueue(q);
+    pthread_join(t, &result);
+    CHECK(result == NULL);
+    deleteBoundedQueue(q);
+
+    q = createBoundedQueue(1);
+    CHECK(pushBoundedQueue(q, ELEMENT(1)));
+    pthread_create(&t, NULL, pushUntilClosed, q);
+    sleepMs(WAIT_MS);
+    closeBoundedQueue(q);
+    pthread_join(t, &result);
+    CHECK(result == NULL);
+
+    CHECK(!pushBoundedQueue(q, ELEMENT(3)));
+    CHECK(!tryPushBoundedQueue(q, ELEMENT(3)));
+    CHECK(VALUE(popBoundedQueue(q)) == 1);
+    CHECK(popBoundedQueue(q) == NULL);
+    deleteBoundedQueue(q);
+}
+
+
+static void *produce(void *arg)
+{
+    Shared *s = arg;
+    int id, i;
+
+    pthread_mutex_lock(&s->lock);
+    id = s->producer++;
+    pthread_mutex_unlock(&s->lock);
+
+    for(i = 0 ; i < COUNT ; i++)
+        pushBoundedQueue(s->q, ELEMENT(id * COUNT + i));
+
+    return NULL;
+}
+
+
+static void *consume(void *arg)
+{
+    Consumer *c = arg;
+    Shared *s = c->shared;
+    void *out[BATCH];
+    int n, i, v, errors = 0;
+
+    while((n = popQueueBatch(s->q, out, BATCH)) > 0)
+    {
+        for(i = 0 ; i < n ; i++)
+        {
+            v = VALUE(out[i]);
+
+            /* the elements of a producer come out in the order of their push */
+            if(v % COUNT <= s->last[c->id][v / COUNT])
+                errors++;
+            s->last[c->id][v / COUNT] = v % COUNT;
+            if(s->seen[v]++ != 0)
+                errors++;
+        }
+    }
+
+    pthread_mutex_lock(&s->lock);
+    s->errors += errors;
+    pthread_mutex_unlock(&s->lock);
+
+    return NULL;
+}
+
+
+/* producers and consumers : every element is popped once, in order by producer */
+static void check_threads(void)
+{
+    static Shared s;
+    Consumer consumers[CONSUMERS];
+    pthread_t producers[PRODUCERS], threads[CONSUMERS];
+    int i;
+
+    s.q = createBoundedQueue(CAPACITY);
+    pthread_mutex_init(&s.lock, NULL);
+    memset(s.last, -1, sizeof(s.last));
+    for(i = 0 ; i < CONSUMERS ; i++)
+    {
+        consumers[i].shared = &s;
+        consumers[i].id = i;
+        pthread_create(&threads[i], NULL, consume, &consumers[i]);
+    }
+    for(i = 0 ; i < PRODUCERS ; i++)
+        pthread_create(&producers[i], NULL, produce, &s);
+
+    for(i = 0 ; i < PRODUCERS ; i++)
+        pthread_join(producers[i], NULL);
+    closeBoundedQueue(s.q);
+    for(i = 0 ; i < CONSUMERS ; i++)
+        pthread_join(threads[i], NULL);
+
+    CHECK(s.errors == 0);
+    for(i = 0 ; i < PRODUCERS * COUNT && s.seen[i] == 1 ; i++);
+    CHECK(i == PRODUCERS * COUNT);
+
+    pthread_mutex_destroy(&s.lock);
+    deleteBoundedQueue(s.q);
+}
+
+
+int main(void)
+{
+    check_fifo();
+    check_timed();
+    check_close();
+    check_threads();
+
+    printf("bqueue : %s\n", failures == 0 ? "ok" : "FAILED");
+
+    return failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include "rpc.h"
+#include "../Trace/histogram.h"
+
+/*
+   Calls pipelined on one connection against stop-and-wait : make bench, then
+      ./server > /dev/null
+   and ./bench_rpc [count]. The calls are "echo", a depth of 1 waits for each return before the next call.
+*/
+
+#define PORT 27000
+#define COUNT 100000 /* calls by depth */
+#define LINE 64 /* max len of a call or of a return */
+
+static const int depths[] = { 1, 16, 256, RPC_INFLIGHT };
+
+
+static long long now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+
+static int connection(void)
+{
+    struct sockaddr_in sin;
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    sin.sin_port = htons(PORT);
+    if(connect(sock, (struct sockaddr *)&sin, sizeof(sin)) < 0)
+    {
+        fprintf(stderr, "Error : connect()\n");
+        exit(EXIT_FAILURE);
+    }
+    setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    send(sock, "#rpc\n", 5, 0);
+
+    return sock;
+}
+
+
+static void run(int count, int depth)
+{
+    static char out[RPC_INFLIGHT * LINE], in[64 * 1024];
+    char name[64];
+    Histogram *h = histogram_create();
+    RpcTable *t = rpc_create(depth);
+    RpcCall call;
+    int sock = connection();
+    uint64_t id = 1;
+    size_t len, kept = 0;
+    ssize_t n;
+    char *line, *eol;
+    long long start = now();
+    int done = 0;
+
+    while(done < count)
+    {
+        /* the calls which the depth allows, in one write */
+        for(len = 0 ; id <= (uint64_t)count && rpc_count(t) < (size_t)depth ; id++)
+        {
+            rpc_insert(t, id, now(), 0);
+            len += snprintf(out + len, LINE, "#call %" PRIu64 " echo 0 x\n", id);
+        }
+        if(len > 0)
+            send(sock, out, len, 0);
+
+        if((n = recv(sock, in + kept, sizeof(in) - kept - 1, 0)) <= 0)
+        {
+            fprintf(stderr, "Error : recv()\n");
+            exit(EXIT_FAILURE);
+        }
+        in[kept + n] = '\0';
+
+        /* the other lines (a session) are skipped, the end of a line cut is kept for the next read */
+        for(line = in ; (eol = strchr(line, '\n')) != NULL ; line = eol + 1)
+        {
+            if(strncmp(line, "#ret ", 5) == 0 && rpc_remove(t, strtoull(line + 5, NULL, 10), &call))
+            {
+                histogram_record(h, now() - call.start);
+                done++;
+            }
+        }
+        kept = kept + n - (line - in);
+        memmove(in, line, kept);
+    }
+
+    snprintf(name, sizeof(name), "depth %d", depth);
+    printf("%s : %.0f calls/s\n", name, count / ((now() - start) / 1e9));
+    histogram_print(h, name);
+    histogram_delete(h);
+    rpc_delete(t);
+    close(sock);
+}
+
+
+int main(int argc, char **argv)
+{
+    int count = (argc > 1) ? atoi(argv[1]) : COUNT;
+    int i;
+
+    for(i = 0 ; i < (int)(sizeof(depths) / sizeof(depths[0])) ; i++)
+        run(count, depths[i]);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,284 @@
+/**
+ * @file rpc.c
+ * @author Alary Dorian
+ * @brief Calls in flight on a connection, matched with their returns by correlation id, with their deadlines
+ * @version 0.1
+ * @date 2022-08-20
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <stdlib.h>
+#include "rpc.h"
+
+/*
+	The calls are in a slot array of a power of two, at least twice the max number of calls,
+	by open addressing with linear probing : a return is matched in one or two probes without allocation.
+	A slot freed is filled by the next calls of its run (backward shift), so there is no tombstone.
+*/
+
+
+struct s_RpcTable {
+
+	RpcCall *slots;
+	size_t mask; /* number of slots - 1 */
+	size_t max;
+	size_t count;
+	int64_t next; /* earliest deadline, 0 if none : it may be the one of a call removed */
+};
+
+/*-----------------------------------------------------------------*/
+
+/**
+ * @brief Give the first slot of an id
+ *
+ * @param t pointer on table
+ * @param id correlation id
+ * @return size_t index of the slot
+ */
+static size_t rpc_slot(RpcTable *t, uint64_t id)
+{
+	/* the ids are often consecutive : Fibonacci hashing spreads them */
+	return (id * 0x9e3779b97f4a7c15ULL >> 32) & t->mask;
+}
+
+
+/**
+ * @brief Free a slot, the calls after it in its run are moved back
+ *
+ * @param t pointer on table
+ * @param i index of the slot
+ */
+static void rpc_free(RpcTable *t, size_t i)
+{
+	size_t j = i, home;
+
+	while(1)
+	{
+		j = (j + 1) & t->mask;
+		if(t->slots[j].id == 0)
+			break;
+
+		/* a call whose first slot is cyclically in ]i, j] stays */
+		home = rpc_slot(t, t->slots[j].id);
+		if(((j - home) & t->mask) < ((j - i) & t->mask))
+			continue;
+
+		t->slots[i] = t->slots[j];
+		i = j;
+	}
+
+	t->slots[i].id = 0;
+	t->count--;
+}
+
+/*-----------------------------------------------------------------*/
+
+/**
+ * @brief Create a table of calls in flight
+ *
+ * @param max max number of calls in flight
+ * @return RpcTable* pointer on table
+ */
+RpcTable *rpc_create(size_t max)
+{
+	RpcTable *t = malloc(sizeof(RpcTable));
+	size_t size = 16;
+
+	while(size < 2 * max)
+		size *= 2;
+
+	t->slots = calloc(size, sizeof(RpcCall));
+	t->mask = size - 1;
+	t->max = max;
+	t->count = 0;
+	t->next = 0;
+
+	return t;
+}
+
+
+/**
+ * @brief Add a call in flight
+ *
+ * @param t pointer on table
+ * @param id correlation id, not 0
+ * @param start time of the call, in nanoseconds
+ * @param deadline time of its timeout, in nanoseconds, 0 for none
+ * @return int 0 on success, -1 if the table is full or if the id is 0 or already in flight
+ */
+int rpc_insert(RpcTable *t, uint64_t id, int64_t start, int64_t deadline)
+{
+	size_t i;
+
+	if(id == 0 || t->count == t->max)
+		return -1;
+
+	for(i = rpc_slot(t, id) ; t->slots[i].id != 0 ; i = (i + 1) & t->mask)
+	{
+		if(t->slots[i].id == id)
+			return -1;
+	}
+
+	t->slots[i].id = id;
+	t->slots[i].start = start;
+	t->slots[i].deadline = deadline;
+	t->count++;
+	if(deadline != 0 && (t->next == 0 || deadline < t->next))
+		t->next = deadline;
+
+	return 0;
+}
+
+
+/**
+ * @brief Remove a call from the table : its return has come, or it is cancelled
+ *
+ * @param t pointer on table
+ * @param id correlation id
+ * @param call variable that stores the call, NULL if not needed
+ * @return true if the call was in flight
+ * @return false if it is unknown : a late return of a call expired or cancelled
+ */
+bool rpc_remove(RpcTable *t, uint64_t id, RpcCall *call)
+{
+	size_t i;
+
+	if(id == 0)
+		return false;
+
+	for(i = rpc_slot(t, id) ; t->slots[i].id != 0 ; i = (i + 1) & t->mask)
+	{
+		if(t->slots[i].id == id)
+		{
+			if(call != NULL)
+				*call = t->slots[i];
+			rpc_free(t, i);
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+/**
+ * @brief Give the number of calls in flight
+ *
+ * @param t pointer on table
+ * @return size_t number of calls
+ */
+size_t rpc_count(RpcTable *t)
+{
+	return t->count;
+}
+
+
+/**
+ * @brief Copy the calls in flight, to give them to another process
+ *
+ * @param t pointer on table
+ * @param calls variable that stores the calls, rpc_count(t) elements
+ * @return size_t number of calls copied
+ */
+size_t rpc_calls(RpcTable *t, RpcCall *calls)
+{
+	size_t i, n = 0;
+
+	for(i = 0 ; i <= t->mask ; i++)
+	{
+		if(t->slots[i].id != 0)
+			calls[n++] = t->slots[i];
+	}
+
+	return n;
+}
+
+
+/**
+ * @brief Give the time before the next deadline, for the timeout of the event loop
+ *
+ * @param t pointer on table
+ * @param now current time in nanoseconds
+ * @return int milliseconds to wait, rounded up, 0 if a deadline is past, -1 if no call has a deadline
+ * @note The earliest deadline is kept, a call removed before it only makes the loop wake up once for nothing.
+ */
+int rpc_timeout(RpcTable *t, int64_t now)
+{
+	if(t->next == 0)
+		return -1;
+	if(t->next <= now)
+		return 0;
+
+	return (t->next - now + 999999) / 1000000;
+}
+
+
+/**
+ * @brief Remove the calls whose deadline is past
+ *
+ * @param t pointer on table
+ * @param now current time in nanoseconds
+ * @param f functor called for each call expired
+ * @param context user provided data of the functor
+ * @return int number of calls expired
+ * @note The table is scanned only when its earliest deadline is past.
+ */
+int rpc_expire(RpcTable *t, int64_t now, RpcExpired f, void *context)
+{
+	RpcCall call;
+	size_t i = 0;
+	int expired = 0;
+
+	if(t->next == 0 || t->next > now)
+		return 0;
+
+	t->next = 0;
+	while(i <= t->mask)
+	{
+		call = t->slots[i];
+		if(call.id == 0 || call.deadline == 0)
+		{
+			i++;
+		}
+		else if(call.deadline <= now)
+		{
+			/* the slot gets the next call of its run, it is checked again */
+			rpc_free(t, i);
+			f(&call, context);
+			expired++;
+		}
+		else
+		{
+			if(t->next == 0 || call.deadline < t->next)
+				t->next = call.deadline;
+			i++;
+		}
+	}
+
+	return expired;
+}
+
+
+/**
+ * @brief Give the bytes held by the table
+ *
+ * @param t pointer on table
+ * @return size_t bytes held
+ */
+size_t rpc_memory(RpcTable *t)
+{
+	return sizeof(RpcTable) + (t->mask + 1) * sizeof(RpcCall);
+}
+
+
+/**
+ * @brief Delete the table
+ *
+ * @param t pointer on table
+ */
+void rpc_delete(RpcTable *t)
+{
+	free(t->slots);
+	free(t);
+}
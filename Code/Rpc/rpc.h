@@ -0,0 +1,166 @@
+/**
+ * @file rpc.h
+ * @author Alary Dorian
+ * @brief Calls in flight on a connection, matched with their returns by correlation id, with their deadlines
+ * @version 0.1
+ * @date 2022-08-20
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef __RPC_H__
+#define __RPC_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*-----------------------------------------------------------------*/
+
+/*
+	Lines of the protocol, after "#rpc" on the connection :
+		"#call id method timeout_ms args"   a call, timeout 0 for no deadline
+		"#cancel id"                        the call is dropped, its return is "cancelled"
+		"#ret id status result"             status : ok, error, timeout or cancelled
+	The id is chosen by the caller, not 0, unique among its calls in flight : the returns come in any order.
+*/
+
+/* Default values */
+#define RPC_INFLIGHT 4096 /* calls in flight by connection */
+#define RPC_TIMEOUT_MS 5000 /* deadline of a call */
+#define RPC_METHOD_SIZE 32 /* max len of a method name with its terminating 0 */
+
+
+/**
+* @brief 	Opaque definition of type RpcTable : the calls in flight of one connection.
+*/
+typedef struct s_RpcTable RpcTable;
+
+
+/**
+* @brief 	A call in flight.
+*/
+typedef struct s_RpcCall {
+
+	uint64_t id; /* correlation id, 0 for a free slot */
+	int64_t start; /* time of the call, in nanoseconds */
+	int64_t deadline; /* time of its timeout, in nanoseconds, 0 for none */
+} RpcCall;
+
+
+/**
+* @brief 	Functor called for each call whose deadline is past, it is already out of the table.
+* @param	(const RpcCall*) Call expired
+* @param	(void*) Opaque pointer to user provided data
+*/
+typedef void (*RpcExpired)(const RpcCall *, void *);
+
+
+/**
+* @brief 	Method which can be called.
+* @param	(const char*) Arguments, terminated by 0
+* @param	(char*) Variable that stores the result, terminated by 0
+* @param	(size_t) Size of the result
+* @param	(int*) Variable that stores the delay of the return in milliseconds, 0 if it is sent at once
+* @return	(bool) true on success, false if the result is an error
+* @note 	A method never waits on the thread of the pool : a delay is given to the event loop, which keeps the return until then.
+*/
+typedef bool (*RpcMethod)(const char *, char *, size_t, int *);
+
+
+/*-----------------------------------------------------------------*/
+
+
+/**
+ * @brief Create a table of calls in flight
+ *
+ * @param max max number of calls in flight
+ * @return RpcTable* pointer on table
+ */
+RpcTable *rpc_create(size_t max);
+
+
+/**
+ * @brief Add a call in flight
+ *
+ * @param t pointer on table
+ * @param id correlation id, not 0
+ * @param start time of the call, in nanoseconds
+ * @param deadline time of its timeout, in nanoseconds, 0 for none
+ * @return int 0 on success, -1 if the table is full or if the id is 0 or already in flight
+ */
+int rpc_insert(RpcTable *t, uint64_t id, int64_t start, int64_t deadline);
+
+
+/**
+ * @brief Remove a call from the table : its return has come, or it is cancelled
+ *
+ * @param t pointer on table
+ * @param id correlation id
+ * @param call variable that stores the call, NULL if not needed
+ * @return true if the call was in flight
+ * @return false if it is unknown : a late return of a call expired or cancelled
+ */
+bool rpc_remove(RpcTable *t, uint64_t id, RpcCall *call);
+
+
+/**
+ * @brief Give the number of calls in flight
+ *
+ * @param t pointer on table
+ * @return size_t number of calls
+ */
+size_t rpc_count(RpcTable *t);
+
+
+/**
+ * @brief Copy the calls in flight, to give them to another process
+ *
+ * @param t pointer on table
+ * @param calls variable that stores the calls, rpc_count(t) elements
+ * @return size_t number of calls copied
+ */
+size_t rpc_calls(RpcTable *t, RpcCall *calls);
+
+
+/**
+ * @brief Give the time before the next deadline, for the timeout of the event loop
+ *
+ * @param t pointer on table
+ * @param now current time in nanoseconds
+ * @return int milliseconds to wait, rounded up, 0 if a deadline is past, -1 if no call has a deadline
+ * @note The earliest deadline is kept, a call removed before it only makes the loop wake up once for nothing.
+ */
+int rpc_timeout(RpcTable *t, int64_t now);
+
+
+/**
+ * @brief Remove the calls whose deadline is past
+ *
+ * @param t pointer on table
+ * @param now current time in nanoseconds
+ * @param f functor called for each call expired
+ * @param context user provided data of the functor
+ * @return int number of calls expired
+ * @note The table is scanned only when its earliest deadline is past.
+ */
+int rpc_expire(RpcTable *t, int64_t now, RpcExpired f, void *context);
+
+
+/**
+ * @brief Give the bytes held by the table
+ *
+ * @param t pointer on table
+ * @return size_t bytes held
+ */
+size_t rpc_memory(RpcTable *t);
+
+
+/**
+ * @brief Delete the table
+ *
+ * @param t pointer on table
+ */
+void rpc_delete(RpcTable *t);
+
+#endif
@@ -0,0 +1,132 @@
+/**
+ * @file session.c
+ * @author Alary Dorian
+ * @brief Session tokens : a client which reconnects gets back its id without state kept by the server
+ * @version 0.1
+ * @date 2022-08-18
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <stdio.h>
+#include <string.h>
+#include <sys/random.h>
+#include "session.h"
+
+/*
+	A token is the id and its MAC by SipHash-2-4 with the key of the server : "0000002a.1f2e3d4c5b6a7988".
+	Nothing is stored by client, so a storm of reconnections costs one hash by client,
+	and the tokens survive a handoff because the key is handed off.
+*/
+
+#define ROTL(x, b) (((x) << (b)) | ((x) >> (64 - (b))))
+
+/*-----------------------------------------------------------------*/
+
+/**
+ * @brief Round of SipHash
+ *
+ * @param v state
+ */
+static void sip_round(uint64_t v[4])
+{
+	v[0] += v[1]; v[1] = ROTL(v[1], 13); v[1] ^= v[0]; v[0] = ROTL(v[0], 32);
+	v[2] += v[3]; v[3] = ROTL(v[3], 16); v[3] ^= v[2];
+	v[0] += v[3]; v[3] = ROTL(v[3], 21); v[3] ^= v[0];
+	v[2] += v[1]; v[1] = ROTL(v[1], 17); v[1] ^= v[2]; v[2] = ROTL(v[2], 32);
+}
+
+
+/**
+ * @brief SipHash-2-4 of one word of 8 bytes
+ *
+ * @param key key
+ * @param m word
+ * @return uint64_t hash
+ */
+static uint64_t siphash(const SessionKey *key, uint64_t m)
+{
+	uint64_t v[4] = { key->k0 ^ 0x736f6d6570736575ULL, key->k1 ^ 0x646f72616e646f6dULL,
+		key->k0 ^ 0x6c7967656e657261ULL, key->k1 ^ 0x7465646279746573ULL };
+	uint64_t last = (uint64_t)8 << 56; /* len of the message in the last block, no byte left */
+
+	v[3] ^= m;
+	sip_round(v);
+	sip_round(v);
+	v[0] ^= m;
+
+	v[3] ^= last;
+	sip_round(v);
+	sip_round(v);
+	v[0] ^= last;
+
+	v[2] ^= 0xff;
+	sip_round(v);
+	sip_round(v);
+	sip_round(v);
+	sip_round(v);
+
+	return v[0] ^ v[1] ^ v[2] ^ v[3];
+}
+
+/*-----------------------------------------------------------------*/
+
+/**
+ * @brief Draw a random key
+ *
+ * @param key variable that stores the key
+ * @return int 0 on success, -1 if the system has no random source
+ */
+int session_key(SessionKey *key)
+{
+	if(getrandom(key, sizeof(SessionKey), 0) != sizeof(SessionKey))
+	{
+		fprintf(stderr, "Error : getrandom()\n");
+		return -1;
+	}
+
+	return 0;
+}
+
+
+/**
+ * @brief Give the token of an id
+ *
+ * @param key key of the server
+ * @param id id of the client
+ * @param token variable that stores the token, SESSION_TOKEN_SIZE bytes
+ */
+void session_token(const SessionKey *key, int id, char *token)
+{
+	snprintf(token, SESSION_TOKEN_SIZE, "%08x.%016llx", (unsigned int)id, (unsigned long long)siphash(key, (uint32_t)id));
+}
+
+
+/**
+ * @brief Check a token presented by a client
+ *
+ * @param key key of the server
+ * @param token token, it ends with a 0, a space or a new line
+ * @return int id of the token, -1 if the token is not signed by the key
+ */
+int session_resume(const SessionKey *key, const char *token)
+{
+	char expected[SESSION_TOKEN_SIZE];
+	unsigned int id;
+	size_t len;
+	unsigned char diff = 0;
+
+	if(sscanf(token, "%8x.", &id) != 1 || (int)id < 0)
+		return -1;
+
+	len = strcspn(token, " \r\n");
+	session_token(key, id, expected);
+	if(len != strlen(expected))
+		return -1;
+
+	/* compared in constant time, the MAC can not be guessed byte after byte */
+	while(len-- > 0)
+		diff |= token[len] ^ expected[len];
+
+	return (diff == 0) ? (int)id : -1;
+}
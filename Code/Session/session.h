@@ -0,0 +1,64 @@
+/**
+ * @file session.h
+ * @author Alary Dorian
+ * @brief Session tokens : a client which reconnects gets back its id without state kept by the server
+ * @version 0.1
+ * @date 2022-08-18
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef __SESSION_H__
+#define __SESSION_H__
+
+#include <stdint.h>
+
+/*-----------------------------------------------------------------*/
+
+/* Values */
+#define SESSION_TOKEN_SIZE 32 /* size of a token with its terminating 0 : "id.mac" in hexadecimal */
+
+
+/**
+* @brief 	Secret key of the server, the tokens are signed with it.
+* @note 	It is given to the new server at a handoff, the tokens stay valid.
+*/
+typedef struct s_SessionKey {
+
+	uint64_t k0;
+	uint64_t k1;
+} SessionKey;
+
+
+/*-----------------------------------------------------------------*/
+
+
+/**
+ * @brief Draw a random key
+ *
+ * @param key variable that stores the key
+ * @return int 0 on success, -1 if the system has no random source
+ */
+int session_key(SessionKey *key);
+
+
+/**
+ * @brief Give the token of an id
+ *
+ * @param key key of the server
+ * @param id id of the client
+ * @param token variable that stores the token, SESSION_TOKEN_SIZE bytes
+ */
+void session_token(const SessionKey *key, int id, char *token);
+
+
+/**
+ * @brief Check a token presented by a client
+ *
+ * @param key key of the server
+ * @param token token, it ends with a 0, a space or a new line
+ * @return int id of the token, -1 if the token is not signed by the key
+ */
+int session_resume(const SessionKey *key, const char *token);
+
+#endif
@@ -0,0 +1,616 @@
+/**
+ * @file spool.c
+ * @author Alary Dorian
+ * @brief Store-and-forward queues of messages waiting for a disconnected client
+ * @version 0.1
+ * @date 2022-07-22
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include "spool.h"
+#include "../List/list.h"
+#include "../Queue/queue.h"
+
+/*
+	A recipient has an entry only while some of its messages are in memory.
+	Its spill file holds messages older than the ones in memory, so the file is sent first.
+	A record of a spill file is a 32 bits length followed by the message.
+	A recipient which gets no message for the ttl is expired : its entry and its spill file are removed,
+	the time of its last message is the time of the entry, or the mtime of the file when it has no entry.
+*/
+
+#define RECORD_HEADER sizeof(uint32_t)
+#define SPOOL_IOV 64 /* messages by batch : one writev to a spill file, one call of the writer */
+#define SPOOL_EXPIRE_INTERVAL 1 /* seconds between two scans of the spill files by spool_expire */
+
+
+typedef struct s_Message {
+
+	size_t len;
+	char data[];
+} Message;
+
+
+typedef struct s_Entry {
+
+	int id; /* id of the recipient */
+	Queue *messages; /* Queue of Message, oldest first */
+	size_t bytes; /* bytes of messages in the queue */
+	time_t last; /* time of the last message */
+} Entry;
+
+
+struct s_Spool {
+
+	char *dir; /* directory of spill files */
+	size_t memory; /* budget of every entry */
+	size_t recipient_memory; /* budget of one entry */
+	size_t bytes; /* bytes of messages in memory */
+	size_t file_limit; /* bytes of a spill file, 0 for no limit */
+	int ttl; /* seconds without message before a recipient is expired, 0 for never */
+	time_t next_expiry; /* time of the next scan of spool_expire */
+	List *entries; /* List of Entry, newest first */
+};
+
+/*-----------------------------------------------------------------*/
+
+/**
+ * @brief Build the path of the spill file of a recipient
+ *
+ * @param path variable that stores the path
+ * @param dir directory of spill files
+ * @param id id of the recipient
+ */
+static void spill_path(char *path, const char *dir, int id)
+{
+	snprintf(path, PATH_MAX, "%s/%d.spool", dir, id);
+}
+
+
+/**
+ * @brief Give the id of the recipient of a spill file
+ *
+ * @param name name of a file of the directory
+ * @return int id of the recipient, -1 if the file is not a spill file
+ */
+static int spill_id(const char *name)
+{
+	int id, end = 0;
+
+	if(sscanf(name, "%d.spool%n", &id, &end) != 1 || end == 0 || name[end] != 0 || id < 0)
+		return -1;
+
+	return id;
+}
+
+
+/**
+ * @brief Write every iovec, even if the kernel takes them in several times
+ *
+ * @param fd spill file
+ * @param iov vector to write, modified by the function
+ * @param count number of iovec
+ * @return int 0 on success, -1 on error
+ */
+static int writev_all(int fd, struct iovec *iov, int count)
+{
+	ssize_t n;
+
+	while(count > 0)
+	{
+		if((n = writev(fd, iov, count)) < 0)
+		{
+			if(errno == EINTR)
+				continue;
+			return -1;
+		}
+
+		/* skip what is written */
+		while(count > 0 && (size_t)n >= iov->iov_len)
+		{
+			n -= iov->iov_len;
+			iov++;
+			count--;
+		}
+		if(count > 0)
+		{
+			iov->iov_base = (char *)iov->iov_base + n;
+			iov->iov_len -= n;
+		}
+	}
+
+	return 0;
+}
+
+
+/**
+ * @brief Find the entry of a recipient
+ *
+ * @param s pointer on spool
+ * @param id id of the recipient
+ * @return ListIterator* iterator on the entry, at the end of the list if the recipient has nothing in memory
+ */
+static ListIterator *entry_find(Spool *s, int id)
+{
+	ListIterator *it = listIterator_create(s->entries, FORWARD_ITERATOR);
+
+	for(it = listIterator_begin(it) ; !listIterator_end(it) ; it = listIterator_next(it))
+	{
+		if(((Entry *)listIterator_value(it))->id == id)
+			break;
+	}
+
+	return it;
+}
+
+
+/**
+ * @brief Delete an entry and its queue
+ *
+ * @param s pointer on spool
+ * @param e pointer on entry, already out of the list
+ */
+static void entry_delete(Spool *s, Entry *e)
+{
+	s->bytes -= e->bytes;
+	deleteQueue(e->messages);
+	free(e);
+}
+
+
+/**
+ * @brief Remove the spill files of the recipients without entry, whose last message is older than a time
+ *
+ * @param s pointer on spool
+ * @param before time of the last message under which a file is removed
+ * @param all true to remove every spill file, whatever its time
+ */
+static void spill_remove(Spool *s, time_t before, bool all)
+{
+	char path[PATH_MAX];
+	struct dirent *d;
+	struct stat st;
+	ListIterator *it;
+	DIR *dir;
+	int id;
+	bool kept;
+
+	if((dir = opendir(s->dir)) == NULL)
+	{
+		fprintf(stderr, "Error : opendir()\n");
+		return;
+	}
+
+	while((d = readdir(dir)) != NULL)
+	{
+		if((id = spill_id(d->d_name)) < 0)
+			continue;
+
+		/* the entry of the recipient is newer than its file */
+		it = entry_find(s, id);
+		kept = !listIterator_end(it);
+		listIterator_delete(it);
+
+		spill_path(path, s->dir, id);
+		if(all || (!kept && stat(path, &st) == 0 && st.st_mtime < before))
+			unlink(path);
+	}
+	closedir(dir);
+}
+
+
+/**
+ * @brief Move the oldest messages of an entry to its spill file, with batched writev
+ *
+ * @param s pointer on spool
+ * @param e pointer on entry
+ * @param bytes bytes to release at least, or 0 to spill the whole entry
+ * @return int 0 on success, -1 on error
+ */
+static int entry_spill(Spool *s, Entry *e, size_t bytes)
+{
+	struct iovec iov[2 * SPOOL_IOV];
+	uint32_t headers[SPOOL_IOV];
+	Message *batch[SPOOL_IOV];
+	char path[PATH_MAX];
+	struct stat st;
+	size_t released = 0, size;
+	Message *m;
+	int count, i, fd;
+	int status = 0;
+
+	spill_path(path, s->dir, e->id);
+	if((fd = open(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0600)) < 0 || fstat(fd, &st) < 0)
+	{
+		fprintf(stderr, "Error : open()\n");
+		if(fd >= 0)
+			close(fd);
+		return -1;
+	}
+	size = st.st_size;
+
+	while(status == 0 && !isEmptyQueue(e->messages) && (bytes == 0 || released < bytes))
+	{
+		count = 0;
+		while(count < SPOOL_IOV && !isEmptyQueue(e->messages) && (bytes == 0 || released < bytes))
+		{
+			m = topQueue(e->messages);
+			popQueue(e->messages);
+			released += m->len;
+
+			/* the file of a recipient which does not come back stops growing, its newest messages are lost */
+			if(s->file_limit > 0 && size + RECORD_HEADER + m->len > s->file_limit)
+			{
+				e->bytes -= m->len;
+				s->bytes -= m->len;
+				free(m);
+				continue;
+			}
+			size += RECORD_HEADER + m->len;
+
+			batch[count] = m;
+			headers[count] = m->len;
+			iov[2 * count].iov_base = &headers[count];
+			iov[2 * count].iov_len = RECORD_HEADER;
+			iov[2 * count + 1].iov_base = m->data;
+			iov[2 * count + 1].iov_len = m->len;
+			count++;
+		}
+
+		if(writev_all(fd, iov, 2 * count) < 0)
+		{
+			fprintf(stderr, "Error : writev()\n");
+			status = -1;
+		}
+
+		for(i = 0 ; i < count ; i++)
+		{
+			e->bytes -= batch[i]->len;
+			s->bytes -= batch[i]->len;
+			free(batch[i]);
+		}
+	}
+	close(fd);
+
+	return status;
+}
+
+
+/**
+ * @brief Give the spill file of a recipient to a writer and remove it
+ *
+ * @param s pointer on spool
+ * @param id id of the recipient
+ * @param writer functor which writes a batch of messages to the recipient
+ * @param context user provided data of the writer
+ * @return int number of messages written, -1 on error
+ */
+static int spill_drain(Spool *s, int id, SpoolWriter writer, void *context)
+{
+	struct iovec iov[SPOOL_IOV];
+	char path[PATH_MAX];
+	char *chunk;
+	size_t filled = 0, pos;
+	uint32_t len;
+	ssize_t n;
+	int count, sent = 0, fd;
+
+	spill_path(path, s->dir, id);
+	if((fd = open(path, O_RDONLY | O_CLOEXEC)) < 0)
+		return (errno == ENOENT) ? 0 : -1;
+
+	chunk = malloc(SPOOL_CHUNK);
+	while(sent >= 0 && (n = read(fd, chunk + filled, SPOOL_CHUNK - filled)) > 0)
+	{
+		filled += n;
+
+		/* every complete record of the chunk goes to the writer, by batches of SPOOL_IOV */
+		pos = 0;
+		count = 0;
+		while(pos + RECORD_HEADER <= filled)
+		{
+			memcpy(&len, chunk + pos, RECORD_HEADER);
+			if(pos + RECORD_HEADER + len > filled)
+				break;
+			if(count == SPOOL_IOV)
+			{
+				if(writer(iov, count, context) < 0)
+				{
+					sent = -1;
+					break;
+				}
+				count = 0;
+			}
+			iov[count].iov_base = chunk + pos + RECORD_HEADER;
+			iov[count].iov_len = len;
+			count++;
+			sent++;
+			pos += RECORD_HEADER + len;
+		}
+		if(sent >= 0 && writer(iov, count, context) < 0)
+			sent = -1;
+
+		/* keep the beginning of a record which is cut by the chunk */
+		memmove(chunk, chunk + pos, filled - pos);
+		filled -= pos;
+	}
+	free(chunk);
+	close(fd);
+	unlink(path);
+
+	return sent;
+}
+
+/*-----------------------------------------------------------------*/
+
+/**
+ * @brief Create the spool
+ *
+ * @param dir directory of spill files, it must exist
+ * @param memory bytes of messages kept in memory for every recipient
+ * @param recipient_memory bytes of messages kept in memory for one recipient
+ * @param file_limit bytes of the spill file of one recipient, 0 for no limit
+ * @param ttl seconds after the last message of a recipient before its messages are dropped, 0 to keep them
+ * @return Spool* pointer on spool
+ * @note The most recent messages of a recipient are kept in a Queue,
+ * 		 the oldest are spilled to the file "dir/<id>.spool" when a budget is exceeded.
+ * 		 A message which would make the spill file larger than file_limit is dropped.
+ */
+Spool *spool_create(const char *dir, size_t memory, size_t recipient_memory, size_t file_limit, int ttl)
+{
+	Spool *s = malloc(sizeof(Spool));
+
+	s->dir = strdup(dir);
+	s->memory = memory;
+	s->recipient_memory = recipient_memory;
+	s->bytes = 0;
+	s->file_limit = file_limit;
+	s->ttl = ttl;
+	s->next_expiry = 0;
+	s->entries = list_create();
+
+	return s;
+}
+
+
+/**
+ * @brief Add a message to the queue of a recipient
+ *
+ * @param s pointer on spool
+ * @param id id of the recipient
+ * @param data message to copy
+ * @param len len of the message, less than SPOOL_CHUNK
+ * @return int 0 on success, -1 on error
+ */
+int spool_push(Spool *s, int id, const void *data, size_t len)
+{
+	ListIterator *it;
+	Entry *e, *victim;
+	Message *m;
+	int status = 0;
+
+	if(len == 0 || len + RECORD_HEADER > SPOOL_CHUNK)
+		return -1;
+
+	it = entry_find(s, id);
+	if(listIterator_end(it))
+	{
+		e = malloc(sizeof(Entry));
+		e->id = id;
+		e->messages = createQueue();
+		e->bytes = 0;
+		list_push_front(s->entries, e);
+		listIterator_begin(it);
+	}
+	e = listIterator_value(it);
+
+	m = malloc(sizeof(Message) + len);
+	m->len = len;
+	memcpy(m->data, data, len);
+	pushQueue(e->messages, m);
+	e->bytes += len;
+	e->last = time(NULL);
+	s->bytes += len;
+
+	/* budget of the recipient */
+	if(e->bytes > s->recipient_memory)
+	{
+		status = entry_spill(s, e, e->bytes - s->recipient_memory);
+		if(isEmptyQueue(e->messages))
+		{
+			listIterator_remove(it);
+			entry_delete(s, e);
+		}
+	}
+	listIterator_delete(it);
+
+	/* budget of the spool, the oldest entries are spilled first */
+	while(status == 0 && s->bytes > s->memory)
+	{
+		victim = list_back(s->entries);
+		status = entry_spill(s, victim, s->bytes - s->memory);
+		if(isEmptyQueue(victim->messages))
+		{
+			list_pop_back(s->entries);
+			entry_delete(s, victim);
+		}
+	}
+
+	return status;
+}
+
+
+/**
+ * @brief Look if messages are waiting for a recipient
+ *
+ * @param s pointer on spool
+ * @param id id of the recipient
+ * @return true messages are waiting
+ * @return false no message is waiting
+ */
+bool spool_is_pending(Spool *s, int id)
+{
+	char path[PATH_MAX];
+	ListIterator *it = entry_find(s, id);
+	bool pending = !listIterator_end(it);
+
+	listIterator_delete(it);
+	spill_path(path, s->dir, id);
+	return pending || access(path, F_OK) == 0;
+}
+
+
+/**
+ * @brief Give every message waiting for a recipient to a writer, in order, by batches of iovec
+ *
+ * @param s pointer on spool
+ * @param id id of the recipient
+ * @param writer functor which writes a batch of messages to the recipient, it must not block
+ * @param context user provided data of the writer
+ * @return int number of messages written, -1 on error
+ * @note The queue of the recipient is deleted, even on error.
+ */
+int spool_drain(Spool *s, int id, SpoolWriter writer, void *context)
+{
+	struct iovec iov[SPOOL_IOV];
+	Message *batch[SPOOL_IOV];
+	int count, i;
+	int sent = spill_drain(s, id, writer, context);
+	ListIterator *it = entry_find(s, id);
+	Entry *e;
+
+	if(listIterator_end(it))
+	{
+		listIterator_delete(it);
+		return sent;
+	}
+	e = listIterator_value(it);
+
+	while(sent >= 0 && !isEmptyQueue(e->messages))
+	{
+		for(count = 0 ; count < SPOOL_IOV && !isEmptyQueue(e->messages) ; count++)
+		{
+			batch[count] = topQueue(e->messages);
+			popQueue(e->messages);
+			iov[count].iov_base = batch[count]->data;
+			iov[count].iov_len = batch[count]->len;
+		}
+
+		sent = (writer(iov, count, context) < 0) ? -1 : sent + count;
+
+		for(i = 0 ; i < count ; i++)
+		{
+			e->bytes -= batch[i]->len;
+			s->bytes -= batch[i]->len;
+			free(batch[i]);
+		}
+	}
+	listIterator_remove(it);
+	listIterator_delete(it);
+	entry_delete(s, e);
+
+	return sent;
+}
+
+
+/**
+ * @brief Drop the messages of the recipients which have had no message for the ttl of the spool, in memory and in the spill files
+ *
+ * @param s pointer on spool
+ * @note The directory is scanned at most once by second, the function can be called at each iteration of a loop.
+ */
+void spool_expire(Spool *s)
+{
+	char path[PATH_MAX];
+	time_t now = time(NULL);
+	ListIterator *it;
+	Entry *e;
+
+	if(s->ttl <= 0 || now < s->next_expiry)
+		return;
+	s->next_expiry = now + SPOOL_EXPIRE_INTERVAL;
+
+	it = listIterator_create(s->entries, FORWARD_ITERATOR);
+	for(it = listIterator_begin(it) ; !listIterator_end(it) ; )
+	{
+		e = listIterator_value(it);
+		if(now - e->last < s->ttl)
+		{
+			listIterator_next(it);
+			continue;
+		}
+		listIterator_remove(it);
+		spill_path(path, s->dir, e->id);
+		unlink(path);
+		entry_delete(s, e);
+	}
+	listIterator_delete(it);
+
+	/* the recipients which have only a spill file */
+	spill_remove(s, now - s->ttl, false);
+}
+
+
+/**
+ * @brief Drop every message, in memory and in the spill files of the directory
+ *
+ * @param s pointer on spool
+ * @note The spill files left by a server which is not taken over are for ids which are given again.
+ */
+void spool_clear(Spool *s)
+{
+	while(!list_is_empty(s->entries))
+	{
+		entry_delete(s, list_front(s->entries));
+		list_pop_front(s->entries);
+	}
+	spill_remove(s, 0, true);
+}
+
+
+/**
+ * @brief Give the bytes of messages kept in memory
+ *
+ * @param s pointer on spool
+ * @return size_t bytes in memory
+ */
+size_t spool_memory(Spool *s)
+{
+	return s->bytes;
+}
+
+
+/**
+ * @brief Delete the spool, spill files are kept
+ *
+ * @param s pointer on spool
+ */
+void spool_delete(Spool *s)
+{
+	Entry *e;
+
+	/* messages in memory are spilled, they are not lost by a restart */
+	while(!list_is_empty(s->entries))
+	{
+		e = list_front(s->entries);
+		entry_spill(s, e, 0);
+		list_pop_front(s->entries);
+		entry_delete(s, e);
+	}
+	list_delete(s->entries);
+	free(s->dir);
+	free(s);
+}
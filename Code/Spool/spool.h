@@ -0,0 +1,129 @@
+/**
+ * @file spool.h
+ * @author Alary Dorian
+ * @brief Store-and-forward queues of messages waiting for a disconnected client
+ * @version 0.1
+ * @date 2022-07-22
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef __SPOOL_H__
+#define __SPOOL_H__
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <sys/uio.h>
+
+/*-----------------------------------------------------------------*/
+
+/* Default values */
+#define SPOOL_MEMORY (1024 * 1024) /* bytes of messages kept in memory for every recipient */
+#define SPOOL_RECIPIENT_MEMORY (64 * 1024) /* bytes of messages kept in memory for one recipient */
+#define SPOOL_CHUNK (64 * 1024) /* size of the buffer used to read a spill file, maximal size of a message */
+#define SPOOL_FILE_LIMIT (4 * 1024 * 1024) /* bytes of the spill file of one recipient */
+#define SPOOL_TTL 300 /* seconds a recipient which does not come back keeps its messages */
+
+
+/**
+* @brief 	Opaque definition of type Spool.
+*/
+typedef struct s_Spool Spool;
+
+
+/**
+* @brief 	Writer of the messages drained : a batch of count messages, returns 0 on success, -1 on error.
+*/
+typedef int (*SpoolWriter)(const struct iovec *, int, void *);
+
+
+/*-----------------------------------------------------------------*/
+
+
+/**
+ * @brief Create the spool
+ *
+ * @param dir directory of spill files, it must exist
+ * @param memory bytes of messages kept in memory for every recipient
+ * @param recipient_memory bytes of messages kept in memory for one recipient
+ * @param file_limit bytes of the spill file of one recipient, 0 for no limit
+ * @param ttl seconds after the last message of a recipient before its messages are dropped, 0 to keep them
+ * @return Spool* pointer on spool
+ * @note The most recent messages of a recipient are kept in a Queue,
+ * 		 the oldest are spilled to the file "dir/<id>.spool" when a budget is exceeded.
+ * 		 A message which would make the spill file larger than file_limit is dropped.
+ */
+Spool *spool_create(const char *dir, size_t memory, size_t recipient_memory, size_t file_limit, int ttl);
+
+
+/**
+ * @brief Add a message to the queue of a recipient
+ *
+ * @param s pointer on spool
+ * @param id id of the recipient
+ * @param data message to copy
+ * @param len len of the message, less than SPOOL_CHUNK
+ * @return int 0 on success, -1 on error
+ */
+int spool_push(Spool *s, int id, const void *data, size_t len);
+
+
+/**
+ * @brief Look if messages are waiting for a recipient
+ *
+ * @param s pointer on spool
+ * @param id id of the recipient
+ * @return true messages are waiting
+ * @return false no message is waiting
+ */
+bool spool_is_pending(Spool *s, int id);
+
+
+/**
+ * @brief Give every message waiting for a recipient to a writer, in order, by batches of iovec
+ *
+ * @param s pointer on spool
+ * @param id id of the recipient
+ * @param writer functor which writes a batch of messages to the recipient, it must not block
+ * @param context user provided data of the writer
+ * @return int number of messages written, -1 on error
+ * @note The queue of the recipient is deleted, even on error.
+ */
+int spool_drain(Spool *s, int id, SpoolWriter writer, void *context);
+
+
+/**
+ * @brief Drop the messages of the recipients which have had no message for the ttl of the spool, in memory and in the spill files
+ *
+ * @param s pointer on spool
+ * @note The directory is scanned at most once by second, the function can be called at each iteration of a loop.
+ */
+void spool_expire(Spool *s);
+
+
+/**
+ * @brief Drop every message, in memory and in the spill files of the directory
+ *
+ * @param s pointer on spool
+ * @note The spill files left by a server which is not taken over are for ids which are given again.
+ */
+void spool_clear(Spool *s);
+
+
+/**
+ * @brief Give the bytes of messages kept in memory
+ *
+ * @param s pointer on spool
+ * @return size_t bytes in memory
+ */
+size_t spool_memory(Spool *s);
+
+
+/**
+ * @brief Delete the spool, spill files are kept
+ *
+ * @param s pointer on spool
+ */
+void spool_delete(Spool *s);
+
+#endif
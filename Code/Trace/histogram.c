@@ -0,0 +1,161 @@
+/**
+ * @file histogram.c
+ * @author Alary Dorian
+ * @brief Histogram of latencies, with log-linear buckets
+ * @version 0.1
+ * @date 2022-08-10
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "histogram.h"
+
+/*
+	Values under 16 have their own bucket. Above, a value with its highest bit at position m
+	goes in one of the 16 buckets of [2^m, 2^(m+1)[, chosen by the 4 bits after the highest one.
+*/
+
+#define SUB_BITS 4
+#define SUB_BUCKETS (1 << SUB_BITS)
+#define BUCKETS (64 * SUB_BUCKETS)
+
+
+struct s_Histogram {
+
+	uint64_t count;
+	int64_t max;
+	uint64_t buckets[BUCKETS];
+};
+
+/*-----------------------------------------------------------------*/
+
+/**
+ * @brief Give the bucket of a value
+ *
+ * @param value positive value
+ * @return int index of the bucket
+ */
+static int histogram_index(uint64_t value)
+{
+	int shift;
+
+	if(value < SUB_BUCKETS)
+		return value;
+
+	shift = 63 - __builtin_clzll(value) - SUB_BITS;
+	return (shift + 1) * SUB_BUCKETS + ((value >> shift) & (SUB_BUCKETS - 1));
+}
+
+
+/**
+ * @brief Give the lowest value of a bucket
+ *
+ * @param index index of the bucket
+ * @return int64_t lowest value
+ */
+static int64_t histogram_value(int index)
+{
+	if(index < SUB_BUCKETS)
+		return index;
+
+	return (int64_t)(SUB_BUCKETS + index % SUB_BUCKETS) << (index / SUB_BUCKETS - 1);
+}
+
+/*-----------------------------------------------------------------*/
+
+/**
+ * @brief Create an empty histogram
+ *
+ * @return Histogram* pointer on histogram
+ * @note A power of 2 is split in 16 buckets : a value is known at 1/16 of it.
+ */
+Histogram *histogram_create(void)
+{
+	return calloc(1, sizeof(Histogram));
+}
+
+
+/**
+ * @brief Record a value, in O(1)
+ *
+ * @param h pointer on histogram
+ * @param value value recorded, a negative value is recorded as 0
+ */
+void histogram_record(Histogram *h, int64_t value)
+{
+	if(value < 0)
+		value = 0;
+
+	h->buckets[histogram_index(value)]++;
+	h->count++;
+	h->max = (value > h->max) ? value : h->max;
+}
+
+
+/**
+ * @brief Give the number of values recorded
+ *
+ * @param h pointer on histogram
+ * @return uint64_t number of values
+ */
+uint64_t histogram_count(Histogram *h)
+{
+	return h->count;
+}
+
+
+/**
+ * @brief Give a percentile of the values recorded
+ *
+ * @param h pointer on histogram
+ * @param p percentile, between 0 and 100
+ * @return int64_t lowest value of the bucket of the percentile, 0 if the histogram is empty
+ */
+int64_t histogram_percentile(Histogram *h, double p)
+{
+	uint64_t rank = (uint64_t)(p / 100 * h->count);
+	uint64_t seen = 0;
+	int i;
+
+	if(h->count == 0)
+		return 0;
+	if(rank >= h->count)
+		return h->max;
+
+	for(i = 0 ; i < BUCKETS ; i++)
+	{
+		seen += h->buckets[i];
+		if(seen > rank)
+			return histogram_value(i);
+	}
+
+	return h->max;
+}
+
+
+/**
+ * @brief Print the count and the main percentiles, the values are nanoseconds printed in microseconds
+ *
+ * @param h pointer on histogram
+ * @param name name printed before the values
+ */
+void histogram_print(Histogram *h, const char *name)
+{
+	printf("%-12s : count=%llu p50=%.1fus p90=%.1fus p99=%.1fus p99.9=%.1fus max=%.1fus\n", name,
+		(unsigned long long)h->count,
+		histogram_percentile(h, 50) / 1e3, histogram_percentile(h, 90) / 1e3,
+		histogram_percentile(h, 99) / 1e3, histogram_percentile(h, 99.9) / 1e3, h->max / 1e3);
+}
+
+
+/**
+ * @brief Delete the histogram
+ *
+ * @param h pointer on histogram
+ */
+void histogram_delete(Histogram *h)
+{
+	free(h);
+}
@@ -0,0 +1,81 @@
+/**
+ * @file histogram.h
+ * @author Alary Dorian
+ * @brief Histogram of latencies, with log-linear buckets
+ * @version 0.1
+ * @date 2022-08-10
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef __HISTOGRAM_H__
+#define __HISTOGRAM_H__
+
+#include <stdint.h>
+
+/*-----------------------------------------------------------------*/
+
+
+/**
+* @brief 	Opaque definition of type Histogram.
+*/
+typedef struct s_Histogram Histogram;
+
+
+/*-----------------------------------------------------------------*/
+
+
+/**
+ * @brief Create an empty histogram
+ *
+ * @return Histogram* pointer on histogram
+ * @note A power of 2 is split in 16 buckets : a value is known at 1/16 of it.
+ */
+Histogram *histogram_create(void);
+
+
+/**
+ * @brief Record a value, in O(1)
+ *
+ * @param h pointer on histogram
+ * @param value value recorded, a negative value is recorded as 0
+ */
+void histogram_record(Histogram *h, int64_t value);
+
+
+/**
+ * @brief Give the number of values recorded
+ *
+ * @param h pointer on histogram
+ * @return uint64_t number of values
+ */
+uint64_t histogram_count(Histogram *h);
+
+
+/**
+ * @brief Give a percentile of the values recorded
+ *
+ * @param h pointer on histogram
+ * @param p percentile, between 0 and 100
+ * @return int64_t lowest value of the bucket of the percentile, 0 if the histogram is empty
+ */
+int64_t histogram_percentile(Histogram *h, double p);
+
+
+/**
+ * @brief Print the count and the main percentiles, the values are nanoseconds printed in microseconds
+ *
+ * @param h pointer on histogram
+ * @param name name printed before the values
+ */
+void histogram_print(Histogram *h, const char *name);
+
+
+/**
+ * @brief Delete the histogram
+ *
+ * @param h pointer on histogram
+ */
+void histogram_delete(Histogram *h);
+
+#endif
@@ -0,0 +1,293 @@
+/**
+ * @file trace.c
+ * @author Alary Dorian
+ * @brief Latency of the messages, from the kernel timestamps of the sockets (SO_TIMESTAMPING)
+ * @version 0.1
+ * @date 2022-08-10
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <linux/net_tstamp.h>
+#include <linux/errqueue.h>
+#include "trace.h"
+
+/*
+	The kernel stamps the packets with CLOCK_REALTIME, so the times of the server are taken with the same clock.
+	A TX timestamp comes back in the error queue of the socket, with the offset of the last byte of its send (OPT_ID),
+	which is how it is matched with the time of the send.
+*/
+
+#define TRACE_FLAGS (SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_SOFTWARE \
+	| SOF_TIMESTAMPING_RAW_HARDWARE | SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_TX_ACK \
+	| SOF_TIMESTAMPING_OPT_ID | SOF_TIMESTAMPING_OPT_TSONLY)
+
+#define TRACE_CONTROL 256 /* size of the buffer of the control messages of a read */
+
+
+struct s_Tracer {
+
+	Histogram *nic; /* hardware RX to software RX */
+	Histogram *kernel; /* software RX to read */
+	Histogram *handler; /* read to send of the reply */
+	Histogram *wire; /* send to software TX */
+	Histogram *ack; /* send to acknowledgement */
+};
+
+/*-----------------------------------------------------------------*/
+
+/**
+ * @brief Convert a timestamp in nanoseconds
+ *
+ * @param t timestamp
+ * @return int64_t nanoseconds, 0 if the timestamp is not set
+ */
+static int64_t trace_ns(const struct timespec *t)
+{
+	return (int64_t)t->tv_sec * 1000000000 + t->tv_nsec;
+}
+
+
+/**
+ * @brief Find the timestamps in the control messages
+ *
+ * @param msg message received
+ * @return struct scm_timestamping* timestamps, NULL if none
+ */
+static struct scm_timestamping *trace_timestamps(struct msghdr *msg)
+{
+	struct cmsghdr *cmsg;
+
+	for(cmsg = CMSG_FIRSTHDR(msg) ; cmsg != NULL ; cmsg = CMSG_NXTHDR(msg, cmsg))
+	{
+		if(cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPING)
+			return (struct scm_timestamping *)CMSG_DATA(cmsg);
+	}
+
+	return NULL;
+}
+
+
+/**
+ * @brief Find the description of a TX timestamp in the control messages
+ *
+ * @param msg message of the error queue
+ * @return struct sock_extended_err* description, NULL if none
+ */
+static struct sock_extended_err *trace_error(struct msghdr *msg)
+{
+	struct cmsghdr *cmsg;
+	struct sock_extended_err *err;
+
+	for(cmsg = CMSG_FIRSTHDR(msg) ; cmsg != NULL ; cmsg = CMSG_NXTHDR(msg, cmsg))
+	{
+		if((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR)
+			|| (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR))
+		{
+			err = (struct sock_extended_err *)CMSG_DATA(cmsg);
+			if(err->ee_errno == ENOMSG && err->ee_origin == SO_EE_ORIGIN_TIMESTAMPING)
+				return err;
+		}
+	}
+
+	return NULL;
+}
+
+/*-----------------------------------------------------------------*/
+
+/**
+ * @brief Create a tracer, with empty histograms
+ *
+ * @return Tracer* pointer on tracer
+ * @note The histograms are :
+ * 		 nic->kernel : hardware RX timestamp to software RX timestamp (the PHC must be synchronised, phc2sys),
+ * 		 kernel->read : software RX timestamp to the read of the message,
+ * 		 read->send : read of a message to the send of its reply,
+ * 		 send->wire : send to the software TX timestamp, when the packet goes to the device,
+ * 		 send->ack : send to the acknowledgement of its last byte by the peer.
+ */
+Tracer *trace_create(void)
+{
+	Tracer *t = malloc(sizeof(Tracer));
+
+	t->nic = histogram_create();
+	t->kernel = histogram_create();
+	t->handler = histogram_create();
+	t->wire = histogram_create();
+	t->ack = histogram_create();
+
+	return t;
+}
+
+
+/**
+ * @brief Give the current time of the clock of the kernel timestamps
+ *
+ * @return int64_t time in nanoseconds (CLOCK_REALTIME)
+ */
+int64_t trace_now(void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_REALTIME, &t);
+	return trace_ns(&t);
+}
+
+
+/**
+ * @brief Enable the RX and TX timestamps of a socket
+ *
+ * @param sock TCP socket, before its first send
+ * @param ts variable that stores the sends of the socket
+ * @return int 0 on success, -1 on error
+ */
+int trace_socket(int sock, TraceSocket *ts)
+{
+	int flags = TRACE_FLAGS;
+
+	memset(ts, 0, sizeof(*ts));
+
+	return setsockopt(sock, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags));
+}
+
+
+/**
+ * @brief Read data with its RX timestamps, and record its latencies
+ *
+ * @param t pointer on tracer
+ * @param sock socket with timestamps enabled
+ * @param buffer variable that stores the data
+ * @param len size of the buffer
+ * @param now variable that stores the time of the read
+ * @return ssize_t number of bytes read, as recv
+ */
+ssize_t trace_recv(Tracer *t, int sock, void *buffer, size_t len, int64_t *now)
+{
+	char control[TRACE_CONTROL];
+	struct iovec iov = { buffer, len };
+	struct msghdr msg;
+	struct scm_timestamping *stamps;
+	ssize_t n;
+	int64_t software, hardware;
+
+	memset(&msg, 0, sizeof(msg));
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof(control);
+
+	n = recvmsg(sock, &msg, 0);
+	*now = trace_now();
+
+	if(n > 0 && (stamps = trace_timestamps(&msg)) != NULL)
+	{
+		/* ts[0] software, ts[2] raw hardware, 0 when not stamped */
+		software = trace_ns(&stamps->ts[0]);
+		hardware = trace_ns(&stamps->ts[2]);
+		if(software != 0)
+			histogram_record(t->kernel, *now - software);
+		if(software != 0 && hardware != 0)
+			histogram_record(t->nic, software - hardware);
+	}
+
+	return n;
+}
+
+
+/**
+ * @brief Record a message before it is sent, its TX timestamps are waited
+ *
+ * @param t pointer on tracer
+ * @param ts sends of the socket
+ * @param len len of the message, which will be sent entirely
+ * @param received time of the read of the message which is answered, 0 if unknown
+ */
+void trace_send(Tracer *t, TraceSocket *ts, size_t len, int64_t received)
+{
+	int64_t now = trace_now();
+
+	if(received != 0)
+		histogram_record(t->handler, now - received);
+
+	/* the oldest send is forgotten if its timestamps did not come back */
+	ts->sent += len;
+	ts->ends[ts->next] = ts->sent - 1;
+	ts->times[ts->next] = now;
+	ts->next = (ts->next + 1) % TRACE_SENDS;
+}
+
+
+/**
+ * @brief Record the latencies of a TX timestamp read in the error queue of a socket
+ *
+ * @param t pointer on tracer
+ * @param ts sends of the socket
+ * @param msg message of the error queue, ignored if it is not a timestamp
+ */
+void trace_completion(Tracer *t, TraceSocket *ts, struct msghdr *msg)
+{
+	struct scm_timestamping *stamps;
+	struct sock_extended_err *err;
+	int64_t stamp;
+	int i;
+
+	if((stamps = trace_timestamps(msg)) == NULL || (err = trace_error(msg)) == NULL)
+		return;
+	if((stamp = trace_ns(&stamps->ts[0])) == 0)
+		return;
+
+	for(i = 0 ; i < TRACE_SENDS ; i++)
+	{
+		if(ts->times[i] == 0 || ts->ends[i] != err->ee_data)
+			continue;
+
+		if(err->ee_info == SCM_TSTAMP_SND)
+		{
+			histogram_record(t->wire, stamp - ts->times[i]);
+		}
+		else if(err->ee_info == SCM_TSTAMP_ACK)
+		{
+			histogram_record(t->ack, stamp - ts->times[i]);
+			ts->times[i] = 0; /* the last timestamp of a send */
+		}
+		break;
+	}
+}
+
+
+/**
+ * @brief Print the histograms
+ *
+ * @param t pointer on tracer
+ */
+void trace_print(Tracer *t)
+{
+	histogram_print(t->nic, "nic->kernel");
+	histogram_print(t->kernel, "kernel->read");
+	histogram_print(t->handler, "read->send");
+	histogram_print(t->wire, "send->wire");
+	histogram_print(t->ack, "send->ack");
+}
+
+
+/**
+ * @brief Delete the tracer
+ *
+ * @param t pointer on tracer
+ */
+void trace_delete(Tracer *t)
+{
+	histogram_delete(t->nic);
+	histogram_delete(t->kernel);
+	histogram_delete(t->handler);
+	histogram_delete(t->wire);
+	histogram_delete(t->ack);
+	free(t);
+}
@@ -0,0 +1,130 @@
+/**
+ * @file trace.h
+ * @author Alary Dorian
+ * @brief Latency of the messages, from the kernel timestamps of the sockets (SO_TIMESTAMPING)
+ * @version 0.1
+ * @date 2022-08-10
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include "histogram.h"
+
+/*-----------------------------------------------------------------*/
+
+/* Values */
+#define TRACE_SENDS 16 /* sends of a socket waiting for their TX timestamps */
+
+
+/**
+* @brief 	Sends of a socket waiting for their TX timestamps, embedded in the structure of the client.
+*/
+typedef struct s_TraceSocket {
+
+	uint32_t sent; /* bytes sent, a TX timestamp gives the offset of the last byte of its send */
+	int next; /* next slot of the ring */
+	uint32_t ends[TRACE_SENDS]; /* offset of the last byte of a send */
+	int64_t times[TRACE_SENDS]; /* time of the send, 0 for a free slot */
+} TraceSocket;
+
+
+/**
+* @brief 	Opaque definition of type Tracer : the histograms of the latencies.
+* @note 	A tracer is used by one thread, the thread of the event loop.
+*/
+typedef struct s_Tracer Tracer;
+
+
+/*-----------------------------------------------------------------*/
+
+
+/**
+ * @brief Create a tracer, with empty histograms
+ *
+ * @return Tracer* pointer on tracer
+ * @note The histograms are :
+ * 		 nic->kernel : hardware RX timestamp to software RX timestamp (the PHC must be synchronised, phc2sys),
+ * 		 kernel->read : software RX timestamp to the read of the message,
+ * 		 read->send : read of a message to the send of its reply,
+ * 		 send->wire : send to the software TX timestamp, when the packet goes to the device,
+ * 		 send->ack : send to the acknowledgement of its last byte by the peer.
+ */
+Tracer *trace_create(void);
+
+
+/**
+ * @brief Give the current time of the clock of the kernel timestamps
+ *
+ * @return int64_t time in nanoseconds (CLOCK_REALTIME)
+ */
+int64_t trace_now(void);
+
+
+/**
+ * @brief Enable the RX and TX timestamps of a socket
+ *
+ * @param sock TCP socket, before its first send
+ * @param ts variable that stores the sends of the socket
+ * @return int 0 on success, -1 on error
+ */
+int trace_socket(int sock, TraceSocket *ts);
+
+
+/**
+ * @brief Read data with its RX timestamps, and record its latencies
+ *
+ * @param t pointer on tracer
+ * @param sock socket with timestamps enabled
+ * @param buffer variable that stores the data
+ * @param len size of the buffer
+ * @param now variable that stores the time of the read
+ * @return ssize_t number of bytes read, as recv
+ */
+ssize_t trace_recv(Tracer *t, int sock, void *buffer, size_t len, int64_t *now);
+
+
+/**
+ * @brief Record a message before it is sent, its TX timestamps are waited
+ *
+ * @param t pointer on tracer
+ * @param ts sends of the socket
+ * @param len len of the message, which will be sent entirely
+ * @param received time of the read of the message which is answered, 0 if unknown
+ */
+void trace_send(Tracer *t, TraceSocket *ts, size_t len, int64_t received);
+
+
+/**
+ * @brief Record the latencies of a TX timestamp read in the error queue of a socket
+ *
+ * @param t pointer on tracer
+ * @param ts sends of the socket
+ * @param msg message of the error queue, ignored if it is not a timestamp
+ * @note The error queue is read by the owner of the socket, it also carries the MSG_ZEROCOPY completions.
+ */
+void trace_completion(Tracer *t, TraceSocket *ts, struct msghdr *msg);
+
+
+/**
+ * @brief Print the histograms
+ *
+ * @param t pointer on tracer
+ */
+void trace_print(Tracer *t);
+
+
+/**
+ * @brief Delete the tracer
+ *
+ * @param t pointer on tracer
+ */
+void trace_delete(Tracer *t);
+
+#endif
@@ -0,0 +1,531 @@
+/**
+ * @file worker.c
+ * @author Alary Dorian
+ * @brief Message handlers executed by a pool of threads, in order for each connection
+ * @version 0.1
+ * @date 2022-08-03
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include "worker.h"
+#include "../Pool/pool.h"
+#include "../Queue/queue.h"
+#include "../Numa/numa.h"
+
+/*
+	A strand is scheduled on the pool by only one task at a time, so the messages of a connection
+	are handled one after the other, and their replies are queued in the same order.
+	Different connections are handled in parallel.
+	In NUMA mode, there is a pool of threads by node, pinned on its CPUs : a strand runs on the node
+	of the CPU which receives the packets of its connection, its messages are copied in buffers of this node.
+*/
+
+
+typedef struct s_Job {
+
+	BufferPool *from; /* pool of the buffer, NULL if allocated by malloc */
+	int64_t stamp;
+	size_t len;
+	char data[];
+} Job;
+
+
+struct s_Strand {
+
+	Worker *worker;
+	int id; /* id of the connection */
+	int slot; /* pool of threads which handles the strand */
+	pthread_mutex_t mutex;
+	Queue *jobs; /* Queue of Job */
+	size_t held; /* bytes of the jobs queued */
+	bool running; /* a task of the pool handles the strand */
+	bool closed; /* the connection is closed, the strand is freed when its jobs are done */
+};
+
+
+struct s_Worker {
+
+	int slots; /* number of pools of threads : one, or one by node with CPUs */
+	Pool **pools; /* NULL to handle the messages in worker_submit */
+	int *nodes; /* node of each pool, -1 without NUMA */
+	BufferPool **buffers; /* buffers of the messages of each pool, NULL without NUMA */
+	Budget *budget; /* counts the messages and the replies held, NULL if disabled */
+	MessageHandler handler;
+	void *context;
+
+	int event; /* eventfd, readable when replies are waiting */
+	pthread_mutex_t mutex;
+	Queue *replies; /* Queue of Reply */
+	int inflight; /* messages submitted without reply queued */
+	pthread_cond_t idle; /* signaled when inflight is 0 */
+};
+
+/*-----------------------------------------------------------------*/
+
+/**
+ * @brief Handle a message and queue its reply
+ *
+ * @param w pointer on worker
+ * @param id id of the connection
+ * @param job message
+ */
+static void worker_handle(Worker *w, int id, Job *job)
+{
+	Reply *r = malloc(sizeof(Reply));
+	bool was_empty = false;
+	uint64_t one = 1;
+
+	r->from = id;
+	r->stamp = job->stamp;
+	r->due = 0;
+	if(!w->handler(id, job->data, job->len, r, w->context))
+	{
+		free(r);
+		r = NULL;
+	}
+
+	if(r != NULL)
+		budget_charge(w->budget, sizeof(Reply) + r->len);
+
+	pthread_mutex_lock(&w->mutex);
+	if(r != NULL)
+	{
+		was_empty = isEmptyQueue(w->replies);
+		pushQueue(w->replies, r);
+	}
+	if(--w->inflight == 0)
+		pthread_cond_broadcast(&w->idle);
+	pthread_mutex_unlock(&w->mutex);
+
+	/* one wakeup of the event loop for a batch of replies */
+	if(was_empty && write(w->event, &one, sizeof(one)) < 0)
+		fprintf(stderr, "Error : write()\n");
+}
+
+
+/**
+ * @brief Free a message
+ *
+ * @param w pointer on worker
+ * @param job message
+ */
+static void job_free(Worker *w, Job *job)
+{
+	budget_release(w->budget, sizeof(Job) + job->len);
+	if(job->from != NULL)
+		bufferPool_put(job->from, job);
+	else
+		free(job);
+}
+
+
+/**
+ * @brief Free a strand
+ *
+ * @param s pointer on strand
+ */
+static void strand_free(Strand *s)
+{
+	pthread_mutex_destroy(&s->mutex);
+	deleteQueue(s->jobs);
+	free(s);
+}
+
+
+/**
+ * @brief Task of the pool : handle at most STRAND_BATCH messages of a strand
+ *
+ * @param arg pointer on strand
+ */
+static void strand_run(void *arg)
+{
+	Strand *s = arg;
+	Job *job;
+	bool closed;
+	int n;
+
+	pthread_mutex_lock(&s->mutex);
+	for(n = 0 ; n < STRAND_BATCH && !isEmptyQueue(s->jobs) ; n++)
+	{
+		job = topQueue(s->jobs);
+		popQueue(s->jobs);
+		s->held -= sizeof(Job) + job->len;
+		pthread_mutex_unlock(&s->mutex);
+
+		worker_handle(s->worker, s->id, job);
+		job_free(s->worker, job);
+
+		pthread_mutex_lock(&s->mutex);
+	}
+
+	/* queued again as a new task, a talkative connection does not keep the thread for itself */
+	if(!isEmptyQueue(s->jobs))
+	{
+		pthread_mutex_unlock(&s->mutex);
+		pool_submit(s->worker->pools[s->slot], strand_run, s);
+		return;
+	}
+
+	s->running = false;
+	closed = s->closed;
+	pthread_mutex_unlock(&s->mutex);
+
+	if(closed)
+		strand_free(s);
+}
+
+/*-----------------------------------------------------------------*/
+
+/**
+ * @brief Create one pool of threads by node with CPUs, the threads are spread over the nodes
+ *
+ * @param w pointer on worker
+ * @param threads number of threads
+ */
+static void worker_numa(Worker *w, int threads)
+{
+	int cpus[NUMA_MAX_CPUS];
+	int pinned[NUMA_MAX_CPUS];
+	int nodes = numa_nodes();
+	int node, count, share, i;
+
+	w->pools = malloc(nodes * sizeof(Pool *));
+	w->nodes = malloc(nodes * sizeof(int));
+	w->buffers = malloc(nodes * sizeof(BufferPool *));
+	w->slots = 0;
+
+	for(node = 0 ; node < nodes ; node++)
+	{
+		/* a node of memory only has no thread */
+		if((count = numa_cpus(node, cpus, NUMA_MAX_CPUS)) == 0)
+			continue;
+
+		share = threads / nodes + (node < threads % nodes);
+		share = (share > 0) ? share : 1;
+		for(i = 0 ; i < share && i < NUMA_MAX_CPUS ; i++)
+			pinned[i] = cpus[i % count];
+
+		w->pools[w->slots] = pool_create_pinned(pinned, i);
+		w->nodes[w->slots] = node;
+		w->buffers[w->slots] = bufferPool_create(WORKER_BUFFER, node);
+		w->slots++;
+	}
+
+	/* no topology in sysfs */
+	if(w->slots == 0)
+	{
+		w->pools[0] = pool_create(threads);
+		w->nodes[0] = -1;
+		w->buffers[0] = bufferPool_create(WORKER_BUFFER, -1);
+		w->slots = 1;
+	}
+}
+
+
+/**
+ * @brief Create the worker and its pool of threads
+ *
+ * @param threads number of threads, 0 to call the handler in worker_submit
+ * @param numa true for a pool of threads by NUMA node, pinned on the CPUs of the node
+ * @param budget budget which counts the messages and the replies held, NULL if disabled
+ * @param handler functor which handles a message
+ * @param context user provided data of the handler
+ * @return Worker* pointer on worker
+ */
+Worker *worker_create(int threads, bool numa, Budget *budget, MessageHandler handler, void *context)
+{
+	Worker *w = malloc(sizeof(Worker));
+
+	w->slots = 1;
+	w->pools = NULL;
+	w->nodes = NULL;
+	w->buffers = NULL;
+	if(threads > 0 && numa)
+	{
+		worker_numa(w, threads);
+	}
+	else if(threads > 0)
+	{
+		w->pools = malloc(sizeof(Pool *));
+		w->pools[0] = pool_create(threads);
+	}
+
+	w->budget = budget;
+	w->handler = handler;
+	w->context = context;
+	w->event = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	w->replies = createQueue();
+	w->inflight = 0;
+	pthread_mutex_init(&w->mutex, NULL);
+	pthread_cond_init(&w->idle, NULL);
+
+	return w;
+}
+
+
+/**
+ * @brief Give a file descriptor readable when replies are waiting, to be watched by select
+ *
+ * @param w pointer on worker
+ * @return int file descriptor
+ */
+int worker_fd(Worker *w)
+{
+	return w->event;
+}
+
+
+/**
+ * @brief Create the strand of a connection
+ *
+ * @param w pointer on worker
+ * @param id id of the connection
+ * @param cpu CPU which receives the packets of the connection (SO_INCOMING_CPU), -1 if unknown
+ * @return Strand* pointer on strand
+ */
+Strand *worker_strand(Worker *w, int id, int cpu)
+{
+	Strand *s = malloc(sizeof(Strand));
+	int node = numa_node_of_cpu(cpu);
+	int i;
+
+	s->worker = w;
+	s->id = id;
+
+	/* on the node of the CPU, the connections with no CPU known are spread over the nodes */
+	s->slot = (id < 0) ? 0 : id % w->slots;
+	for(i = 0 ; w->nodes != NULL && node >= 0 && i < w->slots ; i++)
+	{
+		if(w->nodes[i] == node)
+			s->slot = i;
+	}
+	s->jobs = createQueue();
+	s->held = 0;
+	s->running = false;
+	s->closed = false;
+	pthread_mutex_init(&s->mutex, NULL);
+
+	return s;
+}
+
+
+/**
+ * @brief Close the strand of a disconnected connection
+ *
+ * @param w pointer on worker
+ * @param s pointer on strand
+ * @note The messages already submitted are handled, then the strand is freed.
+ */
+void worker_strand_close(Worker *w, Strand *s)
+{
+	bool running;
+
+	(void)w;
+	pthread_mutex_lock(&s->mutex);
+	s->closed = true;
+	running = s->running;
+	pthread_mutex_unlock(&s->mutex);
+
+	if(!running)
+		strand_free(s);
+}
+
+
+/**
+ * @brief Give the bytes of the messages of a strand waiting to be handled
+ *
+ * @param s pointer on strand
+ * @return size_t bytes held
+ */
+size_t worker_strand_held(Strand *s)
+{
+	size_t held;
+
+	pthread_mutex_lock(&s->mutex);
+	held = s->held;
+	pthread_mutex_unlock(&s->mutex);
+
+	return held;
+}
+
+
+/**
+ * @brief Drop the messages of a strand waiting to be handled, the message being handled is finished
+ *
+ * @param w pointer on worker
+ * @param s pointer on strand
+ * @return int number of messages dropped
+ */
+int worker_strand_drop(Worker *w, Strand *s)
+{
+	Job *job;
+	int n;
+
+	pthread_mutex_lock(&s->mutex);
+	for(n = 0 ; !isEmptyQueue(s->jobs) ; n++)
+	{
+		job = topQueue(s->jobs);
+		popQueue(s->jobs);
+		job_free(w, job);
+	}
+	s->held = 0;
+	pthread_mutex_unlock(&s->mutex);
+
+	pthread_mutex_lock(&w->mutex);
+	w->inflight -= n;
+	if(n > 0 && w->inflight == 0)
+		pthread_cond_broadcast(&w->idle);
+	pthread_mutex_unlock(&w->mutex);
+
+	return n;
+}
+
+
+/**
+ * @brief Submit a message of a connection, the messages of a strand are handled in the order of submission
+ *
+ * @param w pointer on worker
+ * @param s strand of the connection
+ * @param data message to copy
+ * @param len len of the message
+ * @param stamp value copied in the reply, as the time the message was read
+ */
+void worker_submit(Worker *w, Strand *s, const char *data, size_t len, int64_t stamp)
+{
+	BufferPool *buffers = (w->buffers != NULL) ? w->buffers[s->slot] : NULL;
+	Job *job = NULL;
+	bool schedule;
+
+	/* copied in the memory of the node which handles the message */
+	if(buffers != NULL && sizeof(Job) + len <= bufferPool_size(buffers))
+		job = bufferPool_get(buffers);
+	if(job != NULL)
+	{
+		job->from = buffers;
+	}
+	else
+	{
+		job = malloc(sizeof(Job) + len);
+		job->from = NULL;
+	}
+
+	job->stamp = stamp;
+	job->len = len;
+	memcpy(job->data, data, len);
+	budget_charge(w->budget, sizeof(Job) + len);
+
+	pthread_mutex_lock(&w->mutex);
+	w->inflight++;
+	pthread_mutex_unlock(&w->mutex);
+
+	if(w->pools == NULL)
+	{
+		worker_handle(w, s->id, job);
+		job_free(w, job);
+		return;
+	}
+
+	pthread_mutex_lock(&s->mutex);
+	pushQueue(s->jobs, job);
+	s->held += sizeof(Job) + len;
+	schedule = !s->running;
+	s->running = true;
+	pthread_mutex_unlock(&s->mutex);
+
+	if(schedule)
+		pool_submit(w->pools[s->slot], strand_run, s);
+}
+
+
+/**
+ * @brief Take the waiting replies, in the order of the messages for each connection
+ *
+ * @param w pointer on worker
+ * @param replies variable that stores the replies
+ * @param max number of elements of replies
+ * @return int number of replies taken
+ * @note The replies taken are not counted by the budget anymore.
+ */
+int worker_replies(Worker *w, Reply *replies, int max)
+{
+	uint64_t count;
+	Reply *r;
+	int n, i;
+
+	/* cleared before the queue is read, a reply queued after is signaled again */
+	if(read(w->event, &count, sizeof(count)) < 0)
+		count = 0;
+
+	pthread_mutex_lock(&w->mutex);
+	for(n = 0 ; n < max && !isEmptyQueue(w->replies) ; n++)
+	{
+		r = topQueue(w->replies);
+		popQueue(w->replies);
+		replies[n] = *r;
+		free(r);
+	}
+	pthread_mutex_unlock(&w->mutex);
+
+	/* the data is owned by the caller now */
+	for(i = 0 ; i < n ; i++)
+		budget_release(w->budget, sizeof(Reply) + replies[i].len);
+
+	return n;
+}
+
+
+/**
+ * @brief Wait until every message submitted has been handled
+ *
+ * @param w pointer on worker
+ */
+void worker_wait(Worker *w)
+{
+	pthread_mutex_lock(&w->mutex);
+	while(w->inflight > 0)
+		pthread_cond_wait(&w->idle, &w->mutex);
+	pthread_mutex_unlock(&w->mutex);
+}
+
+
+/**
+ * @brief Wait the messages submitted, stop the threads and delete the worker
+ *
+ * @param w pointer on worker
+ * @note Replies not taken are freed, the strands must be closed before.
+ */
+void worker_delete(Worker *w)
+{
+	Reply *r;
+	int i;
+
+	for(i = 0 ; w->pools != NULL && i < w->slots ; i++)
+		pool_delete(w->pools[i]);
+	for(i = 0 ; w->buffers != NULL && i < w->slots ; i++)
+		bufferPool_delete(w->buffers[i]);
+	free(w->pools);
+	free(w->nodes);
+	free(w->buffers);
+
+	while(!isEmptyQueue(w->replies))
+	{
+		r = topQueue(w->replies);
+		popQueue(w->replies);
+		budget_release(w->budget, sizeof(Reply) + r->len);
+		free(r->data);
+		free(r);
+	}
+	deleteQueue(w->replies);
+	close(w->event);
+	pthread_mutex_destroy(&w->mutex);
+	pthread_cond_destroy(&w->idle);
+	free(w);
+}
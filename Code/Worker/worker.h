@@ -0,0 +1,170 @@
+/**
+ * @file worker.h
+ * @author Alary Dorian
+ * @brief Message handlers executed by a pool of threads, in order for each connection
+ * @version 0.1
+ * @date 2022-08-03
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef __WORKER_H__
+#define __WORKER_H__
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "../Budget/budget.h"
+
+/*-----------------------------------------------------------------*/
+
+/* Values */
+#define STRAND_BATCH 16 /* messages of one connection handled by a task before the thread goes to another connection */
+#define WORKER_BUFFER 1088 /* buffer of a message in the pool of a node, the bigger messages are allocated by malloc */
+
+
+/**
+* @brief 	Opaque definition of type Worker.
+*/
+typedef struct s_Worker Worker;
+
+
+/**
+* @brief 	Opaque definition of type Strand : the messages of one connection, handled one after the other.
+*/
+typedef struct s_Strand Strand;
+
+
+/**
+* @brief 	Message to send, result of a handler.
+*/
+typedef struct s_Reply {
+
+	int from; /* id of the connection which sent the message */
+	int to; /* id of the recipient */
+	size_t len; /* len of data */
+	char *data; /* message allocated by malloc, freed by the receiver of the reply */
+	int64_t stamp; /* stamp given to worker_submit with the message */
+	int64_t due; /* time before which the reply is not delivered, in nanoseconds, 0 for none */
+} Reply;
+
+
+/**
+* @brief 	Functor which handles a message.
+* @param	(int) Id of the connection which sent the message
+* @param	(const char*) Message
+* @param	(size_t) Len of the message
+* @param	(Reply*) Reply to fill, from and stamp are already filled, due is 0
+* @param	(void*) Opaque pointer to user provided data
+* @return 	(bool) true if the reply is filled
+* @note 	The handler is called by a thread of the pool, it must not use the data of the event loop.
+*/
+typedef bool (*MessageHandler)(int, const char *, size_t, Reply *, void *);
+
+
+/*-----------------------------------------------------------------*/
+
+
+/**
+ * @brief Create the worker and its pool of threads
+ *
+ * @param threads number of threads, 0 to call the handler in worker_submit
+ * @param numa true for a pool of threads by NUMA node, pinned on the CPUs of the node
+ * @param budget budget which counts the messages and the replies held, NULL if disabled
+ * @param handler functor which handles a message
+ * @param context user provided data of the handler
+ * @return Worker* pointer on worker
+ */
+Worker *worker_create(int threads, bool numa, Budget *budget, MessageHandler handler, void *context);
+
+
+/**
+ * @brief Give a file descriptor readable when replies are waiting, to be watched by select
+ *
+ * @param w pointer on worker
+ * @return int file descriptor
+ */
+int worker_fd(Worker *w);
+
+
+/**
+ * @brief Create the strand of a connection
+ *
+ * @param w pointer on worker
+ * @param id id of the connection
+ * @param cpu CPU which receives the packets of the connection (SO_INCOMING_CPU), -1 if unknown
+ * @return Strand* pointer on strand
+ */
+Strand *worker_strand(Worker *w, int id, int cpu);
+
+
+/**
+ * @brief Close the strand of a disconnected connection
+ *
+ * @param w pointer on worker
+ * @param s pointer on strand
+ * @note The messages already submitted are handled, then the strand is freed.
+ */
+void worker_strand_close(Worker *w, Strand *s);
+
+
+/**
+ * @brief Give the bytes of the messages of a strand waiting to be handled
+ *
+ * @param s pointer on strand
+ * @return size_t bytes held
+ */
+size_t worker_strand_held(Strand *s);
+
+
+/**
+ * @brief Drop the messages of a strand waiting to be handled, the message being handled is finished
+ *
+ * @param w pointer on worker
+ * @param s pointer on strand
+ * @return int number of messages dropped
+ */
+int worker_strand_drop(Worker *w, Strand *s);
+
+
+/**
+ * @brief Submit a message of a connection, the messages of a strand are handled in the order of submission
+ *
+ * @param w pointer on worker
+ * @param s strand of the connection
+ * @param data message to copy
+ * @param len len of the message
+ * @param stamp value copied in the reply, as the time the message was read
+ */
+void worker_submit(Worker *w, Strand *s, const char *data, size_t len, int64_t stamp);
+
+
+/**
+ * @brief Take the waiting replies, in the order of the messages for each connection
+ *
+ * @param w pointer on worker
+ * @param replies variable that stores the replies
+ * @param max number of elements of replies
+ * @return int number of replies taken
+ * @note The replies taken are not counted by the budget anymore.
+ */
+int worker_replies(Worker *w, Reply *replies, int max);
+
+
+/**
+ * @brief Wait until every message submitted has been handled
+ *
+ * @param w pointer on worker
+ */
+void worker_wait(Worker *w);
+
+
+/**
+ * @brief Wait the messages submitted, stop the threads and delete the worker
+ *
+ * @param w pointer on worker
+ * @note Replies not taken are freed, the strands must be closed before.
+ */
+void worker_delete(Worker *w);
+
+#endif
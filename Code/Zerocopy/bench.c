@@ -0,0 +1,173 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/resource.h>
+#include <linux/errqueue.h>
+
+/* Copy against MSG_ZEROCOPY for each size of message, on loopback : make bench, then ./bench_zerocopy */
+
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+
+#define TOTAL (512L * 1024 * 1024) /* bytes sent for each size */
+#define MAX_SIZE (4 * 1024 * 1024)
+
+
+static double now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+
+static double cpu(void)
+{
+    struct rusage u;
+    getrusage(RUSAGE_THREAD, &u);
+    return u.ru_utime.tv_sec + u.ru_stime.tv_sec + (u.ru_utime.tv_usec + u.ru_stime.tv_usec) / 1e6;
+}
+
+
+static void *receiver(void *arg)
+{
+    int sock = (long)arg;
+    char *buffer = malloc(MAX_SIZE);
+
+    while(recv(sock, buffer, MAX_SIZE, 0) > 0);
+    free(buffer);
+    close(sock);
+    return NULL;
+}
+
+
+/* completions read, the kernel copied the data if copied is set */
+static long completions(int sock, int *copied)
+{
+    char control[256];
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+    struct sock_extended_err *err;
+    long done = 0;
+
+    while(1)
+    {
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        if(recvmsg(sock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+            break;
+        for(cmsg = CMSG_FIRSTHDR(&msg) ; cmsg != NULL ; cmsg = CMSG_NXTHDR(&msg, cmsg))
+        {
+            err = (struct sock_extended_err *)CMSG_DATA(cmsg);
+            if(err->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+                continue;
+            done += err->ee_data - err->ee_info + 1;
+            *copied |= (err->ee_code & SO_EE_CODE_ZEROCOPY_COPIED) != 0;
+        }
+    }
+
+    return done;
+}
+
+
+/* connected pair of TCP sockets on loopback, the receiver drains the other end */
+static int connection(pthread_t *thread)
+{
+    struct sockaddr_in sin;
+    socklen_t len = sizeof(sin);
+    int server = socket(AF_INET, SOCK_STREAM, 0);
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family = AF_INET;
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(server, (struct sockaddr *)&sin, sizeof(sin));
+    listen(server, 1);
+    getsockname(server, (struct sockaddr *)&sin, &len);
+    connect(sock, (struct sockaddr *)&sin, sizeof(sin));
+    pthread_create(thread, NULL, receiver, (void *)(long)accept(server, NULL, NULL));
+    close(server);
+    setsockopt(sock, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one));
+
+    return sock;
+}
+
+
+static void run(char *data, size_t size, int flags)
+{
+    struct pollfd pfd;
+    pthread_t thread;
+    int sock = connection(&thread);
+    long sends = 0, done = 0;
+    int copied = 0;
+    size_t left;
+    ssize_t n;
+    double t = now(), c = cpu();
+
+    for(left = TOTAL ; left > 0 ; left -= n)
+    {
+        if((n = send(sock, data, (left < size) ? left : size, flags)) < 0)
+        {
+            /* too many pages pinned : wait for completions */
+            if(errno != ENOBUFS)
+                break;
+            pfd.fd = sock;
+            pfd.events = 0;
+            poll(&pfd, 1, 10);
+            done += completions(sock, &copied);
+            n = 0;
+            continue;
+        }
+        sends++;
+        if(flags & MSG_ZEROCOPY)
+            done += completions(sock, &copied);
+    }
+
+    while((flags & MSG_ZEROCOPY) && done < sends)
+    {
+        pfd.fd = sock;
+        pfd.events = 0;
+        poll(&pfd, 1, 10);
+        done += completions(sock, &copied);
+    }
+
+    t = now() - t;
+    c = cpu() - c;
+    printf("%-8s %8zu : %8.0f MB/s, sender cpu %5.3f s%s\n", (flags & MSG_ZEROCOPY) ? "zerocopy" : "copy",
+        size, TOTAL / t / 1e6, c, copied ? " (copied by the kernel)" : "");
+
+    shutdown(sock, SHUT_WR);
+    pthread_join(thread, NULL);
+    close(sock);
+}
+
+
+int main(void)
+{
+    char *data = malloc(MAX_SIZE);
+    size_t size;
+
+    memset(data, 'x', MAX_SIZE);
+    for(size = 4096 ; size <= MAX_SIZE ; size *= 4)
+    {
+        run(data, size, 0);
+        run(data, size, MSG_ZEROCOPY);
+    }
+    free(data);
+
+    return 0;
+}
@@ -0,0 +1,243 @@
+/**
+ * @file zerocopy.c
+ * @author Alary Dorian
+ * @brief Sends of large messages without copy in the kernel (MSG_ZEROCOPY)
+ * @version 0.1
+ * @date 2022-08-15
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <linux/errqueue.h>
+#include "zerocopy.h"
+
+/*
+	Each send with MSG_ZEROCOPY which takes bytes gets the next id of the socket, from 0.
+	The kernel tells in the error queue the range of ids [lo, hi] whose pages are released,
+	so a message is freed when the id of its last send is in a range.
+*/
+
+#ifndef SO_ZEROCOPY
+#define SO_ZEROCOPY 60
+#endif
+#ifndef MSG_ZEROCOPY
+#define MSG_ZEROCOPY 0x4000000
+#endif
+#ifndef SO_EE_ORIGIN_ZEROCOPY
+#define SO_EE_ORIGIN_ZEROCOPY 5
+#endif
+
+
+typedef struct s_Pending {
+
+	uint32_t last; /* id of the last send of the message */
+	size_t len;
+	char *data;
+} Pending;
+
+/*-----------------------------------------------------------------*/
+
+/**
+ * @brief Find the completion in the control messages
+ *
+ * @param msg message of the error queue
+ * @return struct sock_extended_err* completion, NULL if none
+ */
+static struct sock_extended_err *zerocopy_error(struct msghdr *msg)
+{
+	struct cmsghdr *cmsg;
+	struct sock_extended_err *err;
+
+	for(cmsg = CMSG_FIRSTHDR(msg) ; cmsg != NULL ; cmsg = CMSG_NXTHDR(msg, cmsg))
+	{
+		if((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR)
+			|| (cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR))
+		{
+			err = (struct sock_extended_err *)CMSG_DATA(cmsg);
+			if(err->ee_errno == 0 && err->ee_origin == SO_EE_ORIGIN_ZEROCOPY)
+				return err;
+		}
+	}
+
+	return NULL;
+}
+
+/*-----------------------------------------------------------------*/
+
+/**
+ * @brief Enable MSG_ZEROCOPY on a socket
+ *
+ * @param z variable that stores the messages of the socket
+ * @param sock TCP socket
+ * @param threshold size from which a message is sent without copy, 0 for never
+ * @return int 0 on success, -1 if the socket does not support it (every message is copied then)
+ */
+int zerocopy_init(ZeroCopy *z, int sock, size_t threshold)
+{
+	int one = 1;
+
+	z->threshold = threshold;
+	z->next = 0;
+	z->held = 0;
+	z->pending = NULL;
+
+	if(threshold > 0 && setsockopt(sock, SOL_SOCKET, SO_ZEROCOPY, &one, sizeof(one)) < 0)
+	{
+		z->threshold = 0;
+		return -1;
+	}
+
+	return 0;
+}
+
+
+/**
+ * @brief Send a message without copy if it is large enough, without waiting for the socket
+ *
+ * @param z messages of the socket
+ * @param sock non-blocking socket
+ * @param data message allocated by malloc
+ * @param len len of the message
+ * @param sent variable that stores the bytes sent, the caller copies the rest in its own output
+ * @return true pages of the message are pinned, it is owned by z and freed at its completion
+ * @return false the message is too small or nothing could be pinned, the caller keeps it
+ */
+bool zerocopy_send(ZeroCopy *z, int sock, char *data, size_t len, size_t *sent)
+{
+	Pending *p;
+	ssize_t n;
+	bool pinned = false;
+
+	*sent = 0;
+	if(z->threshold == 0 || len < z->threshold)
+		return false;
+
+	/* EAGAIN : the socket is full, ENOBUFS : too many pages pinned (optmem_max), another error is seen by the next send of the caller */
+	while(*sent < len)
+	{
+		if((n = send(sock, data + *sent, len - *sent, MSG_ZEROCOPY | MSG_NOSIGNAL | MSG_DONTWAIT)) >= 0)
+		{
+			*sent += n;
+			z->next++;
+			pinned = true;
+		}
+		else if(errno != EINTR)
+		{
+			break;
+		}
+	}
+
+	if(!pinned)
+		return false;
+
+	if(z->pending == NULL)
+		z->pending = createQueue();
+	p = malloc(sizeof(Pending));
+	p->last = z->next - 1;
+	p->len = len;
+	p->data = data;
+	pushQueue(z->pending, p);
+	z->held += len;
+
+	return true;
+}
+
+
+/**
+ * @brief Free the messages of a completion read in the error queue of the socket
+ *
+ * @param z messages of the socket
+ * @param msg message of the error queue, ignored if it is not a completion
+ * @return int number of messages freed
+ */
+int zerocopy_completion(ZeroCopy *z, struct msghdr *msg)
+{
+	struct sock_extended_err *err = zerocopy_error(msg);
+	Pending *p;
+	int freed = 0;
+
+	if(err == NULL || z->pending == NULL)
+		return 0;
+
+	/* ee_data is the highest id of the range, the completions come in order */
+	while(!isEmptyQueue(z->pending))
+	{
+		p = topQueue(z->pending);
+		if((int32_t)(p->last - err->ee_data) > 0)
+			break;
+		popQueue(z->pending);
+		z->held -= p->len;
+		free(p->data);
+		free(p);
+		freed++;
+	}
+
+	return freed;
+}
+
+
+/**
+ * @brief Read the error queue of the socket and free the messages completed
+ *
+ * @param z messages of the socket
+ * @param sock socket
+ * @note The other messages of the error queue (timestamps) are lost.
+ */
+void zerocopy_drain(ZeroCopy *z, int sock)
+{
+	char control[ZEROCOPY_CONTROL];
+	struct msghdr msg;
+
+	while(1)
+	{
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+		if(recvmsg(sock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+			break;
+		zerocopy_completion(z, &msg);
+	}
+}
+
+
+/**
+ * @brief Forget the messages not completed without freeing them, the socket goes on in another process
+ *
+ * @param z messages of the socket
+ * @note The kernel still reads their pages to send them : they must not be reused, their memory is given back at the exit of the process.
+ */
+void zerocopy_detach(ZeroCopy *z)
+{
+	z->pending = NULL;
+	z->held = 0;
+}
+
+
+/**
+ * @brief Free the messages not completed, the socket is closed
+ *
+ * @param z messages of the socket
+ */
+void zerocopy_release(ZeroCopy *z)
+{
+	Pending *p;
+
+	if(z->pending == NULL)
+		return;
+
+	while(!isEmptyQueue(z->pending))
+	{
+		p = topQueue(z->pending);
+		popQueue(z->pending);
+		free(p->data);
+		free(p);
+	}
+	deleteQueue(z->pending);
+	z->pending = NULL;
+	z->held = 0;
+}
@@ -0,0 +1,104 @@
+/**
+ * @file zerocopy.h
+ * @author Alary Dorian
+ * @brief Sends of large messages without copy in the kernel (MSG_ZEROCOPY)
+ * @version 0.1
+ * @date 2022-08-15
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef __ZEROCOPY_H__
+#define __ZEROCOPY_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/socket.h>
+#include "../Queue/queue.h"
+
+/*-----------------------------------------------------------------*/
+
+/* Default values */
+#define ZEROCOPY_THRESHOLD (16 * 1024) /* smaller messages are copied, the pinning of the pages costs more */
+#define ZEROCOPY_CONTROL 256 /* size of the buffer of the control messages of the error queue */
+
+
+/**
+* @brief 	Messages of a socket sent without copy, embedded in the structure of the client.
+* @note 	A message is freed when the kernel tells it does not use its pages anymore.
+*/
+typedef struct s_ZeroCopy {
+
+	size_t threshold; /* size from which a message is sent without copy, 0 for never */
+	uint32_t next; /* id of the next send with MSG_ZEROCOPY, counted by the kernel */
+	size_t held; /* bytes of the messages not completed */
+	Queue *pending; /* messages not completed, oldest first */
+} ZeroCopy;
+
+
+/*-----------------------------------------------------------------*/
+
+
+/**
+ * @brief Enable MSG_ZEROCOPY on a socket
+ *
+ * @param z variable that stores the messages of the socket
+ * @param sock TCP socket
+ * @param threshold size from which a message is sent without copy, 0 for never
+ * @return int 0 on success, -1 if the socket does not support it (every message is copied then)
+ */
+int zerocopy_init(ZeroCopy *z, int sock, size_t threshold);
+
+
+/**
+ * @brief Send a message without copy if it is large enough, without waiting for the socket
+ *
+ * @param z messages of the socket
+ * @param sock non-blocking socket
+ * @param data message allocated by malloc
+ * @param len len of the message
+ * @param sent variable that stores the bytes sent, the caller copies the rest in its own output
+ * @return true pages of the message are pinned, it is owned by z and freed at its completion
+ * @return false the message is too small or nothing could be pinned, the caller keeps it
+ */
+bool zerocopy_send(ZeroCopy *z, int sock, char *data, size_t len, size_t *sent);
+
+
+/**
+ * @brief Free the messages of a completion read in the error queue of the socket
+ *
+ * @param z messages of the socket
+ * @param msg message of the error queue, ignored if it is not a completion
+ * @return int number of messages freed
+ */
+int zerocopy_completion(ZeroCopy *z, struct msghdr *msg);
+
+
+/**
+ * @brief Read the error queue of the socket and free the messages completed
+ *
+ * @param z messages of the socket
+ * @param sock socket
+ * @note The other messages of the error queue (timestamps) are lost.
+ */
+void zerocopy_drain(ZeroCopy *z, int sock);
+
+
+/**
+ * @brief Forget the messages not completed without freeing them, the socket goes on in another process
+ *
+ * @param z messages of the socket
+ * @note The kernel still reads their pages to send them : they must not be reused, their memory is given back at the exit of the process.
+ */
+void zerocopy_detach(ZeroCopy *z);
+
+
+/**
+ * @brief Free the messages not completed, the socket is closed
+ *
+ * @param z messages of the socket
+ */
+void zerocopy_release(ZeroCopy *z);
+
+#endif
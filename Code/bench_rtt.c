@@ -0,0 +1,95 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include "Trace/histogram.h"
+
+/*
+   Round trip time of a message through the server : make bench, then
+      ./server -H echo -w 0          (loop which blocks in poll)
+      ./server -H echo -w 0 -c 1     (busy-poll loop pinned on CPU 1)
+   and ./bench_rtt [address] [count] for each one. The client should run on another CPU than the server.
+*/
+
+#define PORT 27000
+#define COUNT 100000 /* round trips measured */
+#define WARMUP 1000 /* round trips not measured */
+#define INTERVAL_US 20 /* pause between two round trips, the loop of the server goes idle */
+#define SESSION_WAIT_MS 200 /* wait for the session message sent by the server at the connection */
+
+
+static long long now(void)
+{
+   struct timespec t;
+   clock_gettime(CLOCK_MONOTONIC, &t);
+   return t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+
+int main(int argc, char **argv)
+{
+   const char *address = (argc > 1) ? argv[1] : "127.0.0.1";
+   int count = (argc > 2) ? atoi(argv[2]) : COUNT;
+   const char message[] = "rtt measure of 32 bytes.......\n";
+   char buffer[64];
+   Histogram *h = histogram_create();
+   struct hostent *host = gethostbyname(address);
+   struct sockaddr_in sin;
+   long long t;
+   int sock, one = 1, i, n, got;
+
+   if(host == NULL)
+   {
+      fprintf(stderr, "Error : unknown host %s\n", address);
+      return EXIT_FAILURE;
+   }
+
+   sock = socket(AF_INET, SOCK_STREAM, 0);
+   memset(&sin, 0, sizeof(sin));
+   sin.sin_addr = *(struct in_addr *)host->h_addr;
+   sin.sin_port = htons(PORT);
+   sin.sin_family = AF_INET;
+   if(connect(sock, (struct sockaddr *)&sin, sizeof(sin)) < 0)
+   {
+      fprintf(stderr, "Error : connect()\n");
+      return EXIT_FAILURE;
+   }
+   setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+   /* the session message of the server is not an echo, it is read before the measure (only with -k) */
+   if(poll(&(struct pollfd){ sock, POLLIN, 0 }, 1, SESSION_WAIT_MS) > 0)
+   {
+      do
+         n = recv(sock, buffer, 1, 0);
+      while(n == 1 && buffer[0] != '\n');
+   }
+
+   for(i = 0 ; i < WARMUP + count ; i++)
+   {
+      t = now();
+      send(sock, message, sizeof(message) - 1, 0);
+      for(got = 0 ; got < (int)sizeof(message) - 1 ; got += n)
+      {
+         if((n = recv(sock, buffer, sizeof(buffer), 0)) <= 0)
+         {
+            fprintf(stderr, "Error : recv()\n");
+            return EXIT_FAILURE;
+         }
+      }
+      if(i >= WARMUP)
+         histogram_record(h, now() - t);
+      usleep(INTERVAL_US);
+   }
+
+   histogram_print(h, "rtt");
+   histogram_delete(h);
+   close(sock);
+
+   return EXIT_SUCCESS;
+}
@@ -12,6 +12,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include <poll.h>
+#include <errno.h>
+#include <fcntl.h>
 #include <pthread.h>
 #include "client.h"
 
@@ -20,6 +25,17 @@ struct client_s
 {
    SOCKET sock;
    int *connection;
+   const char *address; //address of the server, to reconnect
+   int id; //id given by the server, -1 before its session message
+   char token[TOKEN_SIZE]; //token of the session, empty if the server has no session
+   RpcTable *calls; //calls in flight, the returns come in any order
+   uint64_t next_call; //id of the next call
+   pthread_mutex_t lock; //calls, socket and send buffer shared by the menu and the thread which reads, recursive
+   bool resilient; //the client reconnects until the server is back, with a session or not
+   bool online; //false while the server is away, the messages go to the send buffer
+   char *pending; //messages kept while the server is away, SEND_BUFFER bytes
+   size_t pending_len;
+   unsigned int seed; //seed of the jitter of the reconnections
 };
 
 
@@ -32,14 +48,29 @@ struct client_s
  */
 int main(int argc, char **argv)
 {
-   if(argc != 2)
+   bool resilient = false;
+   int o;
+
+   while((o = getopt(argc, argv, "r")) != -1)
+   {
+      switch(o)
+      {
+         case 'r':
+            resilient = true;
+            break;
+         default:
+            optind = argc + 1;
+      }
+   }
+
+   if(optind != argc - 1)
    {
-      printf("Usage : %s [address]\n", argv[0]);
+      printf("Usage : %s [-r] [address or host name]\n", argv[0]);
       return EXIT_FAILURE;
    }
 
    init();
-   appC(argv[1]);
+   appC(argv[optind], resilient);
    end();
 
    return EXIT_SUCCESS;
@@ -78,34 +109,258 @@ static void end(void)
 /**
  * @brief Initialisation of connection to the address, with socket
  * 
- * @param address of server
+ * @param address of server, a host name or an IPv4 or IPv6 address
  * @return SOCKET, FD of socket
  */
 static SOCKET initConnection(const char *address)
 {
     SOCKET sock;
-    SOCKADDR_IN sin;
 
-    if((sock = socket(AF_INET, SOCK_STREAM, 0)) == INVALID_SOCKET)
+    if((sock = connectServer(address)) == INVALID_SOCKET)
     {
-        fprintf(stderr, "Error : socket()\n");
-        exit(EXIT_FAILURE_SOCKET);
+        fprintf(stderr, "Error : connect()\n");
+        exit(EXIT_FAILURE_CONNECTION);
     }
 
-    sin.sin_addr.s_addr = inet_addr(address);
-    sin.sin_port = htons(PORT);
-    sin.sin_family = AF_INET;
+    return sock;
+}
+
 
-    if(connect(sock,(SOCKADDR *) &sin, sizeof(SOCKADDR)) == SOCKET_ERROR)
+/**
+ * @brief Connect to the server : each address of the name is tried CONNECT_DELAY_MS after the previous one, the first connected wins (happy eyeballs, RFC 8305)
+ * 
+ * @param address of server, a host name or an IPv4 or IPv6 address
+ * @return SOCKET, FD of a blocking socket connected, INVALID_SOCKET if the server can not be reached
+ */
+static SOCKET connectServer(const char *address)
+{
+    struct addrinfo hints, *list, *ai;
+    struct addrinfo *order[CONNECT_MAX];
+    struct pollfd pfds[CONNECT_MAX];
+    SOCKET sock = INVALID_SOCKET;
+    char port[8];
+    int count, started = 0, pending = 0, i, err;
+    socklen_t len = sizeof(err);
+    int64_t deadline = now() + CONNECT_TIMEOUT_MS * 1000000LL;
+    int64_t next = 0; //time of the next attempt
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    snprintf(port, sizeof(port), "%d", PORT);
+    if(getaddrinfo(address, port, &hints, &list) != 0)
     {
-        fprintf(stderr, "Error : connect()\n");
-        exit(EXIT_FAILURE_CONNECTION);
+        fprintf(stderr, "Error : getaddrinfo()\n");
+        return INVALID_SOCKET;
+    }
+
+    /* the families alternate, from the one the resolver prefers : a broken path costs one delay, not one timeout by address */
+    count = orderAddresses(list, order);
+
+    while(sock == INVALID_SOCKET && (started < count || pending > 0) && now() < deadline)
+    {
+        /* the next address, when the delay is over or when every attempt has failed */
+        if(started < count && (pending == 0 || now() >= next))
+        {
+            ai = order[started];
+            pfds[started].fd = socket(ai->ai_family, ai->ai_socktype | SOCK_NONBLOCK, ai->ai_protocol);
+            pfds[started].events = POLLOUT;
+            pfds[started].revents = 0;
+            if(pfds[started].fd != INVALID_SOCKET && (connect(pfds[started].fd, ai->ai_addr, ai->ai_addrlen) == 0 || errno == EINPROGRESS))
+            {
+                pending++;
+            }
+            else if(pfds[started].fd != INVALID_SOCKET)
+            {
+                closesocket(pfds[started].fd);
+                pfds[started].fd = INVALID_SOCKET; //ignored by poll
+            }
+            started++;
+            next = now() + CONNECT_DELAY_MS * 1000000LL;
+            continue;
+        }
+
+        if(poll(pfds, started, ((started < count) ? next - now() : deadline - now()) / 1000000 + 1) <= 0)
+            continue;
+
+        for(i = 0 ; i < started ; i++)
+        {
+            if(pfds[i].fd == INVALID_SOCKET || pfds[i].revents == 0)
+                continue;
+
+            /* writable : connected, or refused */
+            if(getsockopt(pfds[i].fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0 && sock == INVALID_SOCKET)
+                sock = pfds[i].fd;
+            else
+                closesocket(pfds[i].fd);
+            pfds[i].fd = INVALID_SOCKET;
+            pending--;
+        }
+    }
+
+    /* the attempts which lost */
+    for(i = 0 ; i < started ; i++)
+    {
+        if(pfds[i].fd != INVALID_SOCKET)
+            closesocket(pfds[i].fd);
     }
+    freeaddrinfo(list);
+
+    /* the reads and the writes of the client block */
+    if(sock != INVALID_SOCKET)
+        fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) & ~O_NONBLOCK);
 
     return sock;
 }
 
 
+/**
+ * @brief Order the addresses of the server for the attempts : IPv6 and IPv4 in turn, from the family of the first address
+ * 
+ * @param list addresses given by getaddrinfo
+ * @param order variable that stores the addresses, CONNECT_MAX at most
+ * @return int number of addresses
+ */
+static int orderAddresses(struct addrinfo *list, struct addrinfo **order)
+{
+    struct addrinfo *first = list, *second = list;
+    int count = 0, family = list->ai_family;
+
+    while(count < CONNECT_MAX && (first != NULL || second != NULL))
+    {
+        /* next address of the first family, then of the other */
+        for( ; first != NULL && first->ai_family != family ; first = first->ai_next);
+        if(first != NULL && count < CONNECT_MAX)
+        {
+            order[count++] = first;
+            first = first->ai_next;
+        }
+        for( ; second != NULL && second->ai_family == family ; second = second->ai_next);
+        if(second != NULL && count < CONNECT_MAX)
+        {
+            order[count++] = second;
+            second = second->ai_next;
+        }
+    }
+
+    return count;
+}
+
+
+/**
+ * @brief Reconnect to the server after a jittered backoff and resume the session : the client gets back its id and the messages sent while it was away
+ * 
+ * @param c Client connection
+ * @return int 0 on success, -1 if the server does not come back or if the client has no session and is not resilient
+ * @note The messages kept in the send buffer are sent after the session is resumed.
+ */
+static int reconnectServer(Client *c)
+{
+    char buffer[BUF_SIZE];
+    SOCKET sock;
+    int tries;
+    int backoff = RECONNECT_BASE_MS;
+    bool online;
+
+    if(c->token[0] == '\0' && !c->resilient)
+        return -1;
+
+    for(tries = 0 ; c->resilient || tries < RECONNECT_TRIES ; tries++)
+    {
+        /* full jitter : the clients of a server which restarts come back spread over the whole backoff, not at once */
+        usleep((rand_r(&c->seed) % backoff + 1) * 1000);
+        backoff = (backoff < RECONNECT_MAX_MS / 2) ? backoff * 2 : RECONNECT_MAX_MS;
+        if((sock = connectServer(c->address)) == INVALID_SOCKET)
+            continue;
+
+        /* one round trip : the answer is the session message with the old id, the calls in flight are lost with the connection */
+        if(c->token[0] != '\0')
+            snprintf(buffer, BUF_SIZE, "#resume %s\n#rpc\n", c->token);
+        else
+            snprintf(buffer, BUF_SIZE, "#rpc\n");
+
+        pthread_mutex_lock(&c->lock);
+        endConnection(c->sock);
+        c->sock = sock;
+        c->online = writeServer(sock, buffer) == 0 && flushPending(c) == 0;
+        online = c->online;
+        pthread_mutex_unlock(&c->lock);
+
+        if(online)
+        {
+            printf("\nReconnected..\n");
+            return 0;
+        }
+    }
+
+    return -1;
+}
+
+
+/**
+ * @brief Send the messages kept while the server was away, by batches of SEND_BATCH bytes
+ * 
+ * @param c Client connection, its lock is held
+ * @return int 0 on success, -1 if the connection is lost again : the messages not sent are kept
+ */
+static int flushPending(Client *c)
+{
+    size_t sent = 0;
+    ssize_t n;
+
+    while(sent < c->pending_len)
+    {
+        n = (c->pending_len - sent < SEND_BATCH) ? c->pending_len - sent : SEND_BATCH;
+        if((n = send(c->sock, c->pending + sent, n, MSG_NOSIGNAL)) <= 0)
+            break;
+        sent += n;
+    }
+
+    memmove(c->pending, c->pending + sent, c->pending_len - sent);
+    c->pending_len -= sent;
+
+    return (c->pending_len == 0) ? 0 : -1;
+}
+
+
+/**
+ * @brief Send a message to the server, it is kept in the send buffer while the server is away
+ * 
+ * @param c Client connection
+ * @param message message, terminated by 0
+ * @return int 0 if it is sent, 1 if it is kept until the reconnection, -1 if the send buffer is full
+ * @note Only the part of the message the connection lost has not taken is kept : its start is not sent twice.
+ */
+static int sendServer(Client *c, const char *message)
+{
+    size_t len = strlen(message);
+    ssize_t n = 0;
+    int status = 0;
+
+    pthread_mutex_lock(&c->lock);
+    if(c->online && (n = send(c->sock, message, len, MSG_NOSIGNAL)) < 0)
+    {
+        fprintf(stderr, "Error : send()\n");
+        n = 0;
+    }
+    if((size_t)n < len)
+    {
+        /* the thread which reads sees the end of the connection and reconnects */
+        c->online = false;
+        status = -1;
+        if(c->pending_len + len - n <= SEND_BUFFER)
+        {
+            memcpy(c->pending + c->pending_len, message + n, len - n);
+            c->pending_len += len - n;
+            status = 1;
+        }
+    }
+    pthread_mutex_unlock(&c->lock);
+
+    return status;
+}
+
+
 /**
  * @brief Close socket connection
  * 
@@ -129,10 +384,11 @@ static int readServer(SOCKET sock, char *buffer, int len)
 {
    int n = 0;
 
+   /* a connection reset is a disconnection, the session may be resumed */
    if((n = recv(sock, buffer, len-1, 0)) < 0)
    {
       fprintf(stderr, "Error : recv()\n");
-      exit(EXIT_FAILURE_RECV);
+      n = 0;
    }
 
    buffer[n] = '\0';
@@ -147,14 +403,186 @@ static int readServer(SOCKET sock, char *buffer, int len)
  * 
  * @param sock socket
  * @param buffer variable that stores the message
+ * @return int 0 on success, -1 if the connection is lost
  */
-static void writeServer(SOCKET sock, const char *buffer)
+static int writeServer(SOCKET sock, const char *buffer)
 {
-   if(send(sock, buffer, strlen(buffer), 0) < (ssize_t)strlen(buffer))
+   /* no SIGPIPE on a lost connection, the session is resumed by the thread which reads */
+   if(send(sock, buffer, strlen(buffer), MSG_NOSIGNAL) < (ssize_t)strlen(buffer))
    {
       fprintf(stderr, "Error : send()\n");
-      exit(EXIT_FAILURE_SEND);
+      return -1;
    }
+
+   return 0;
+}
+
+
+/**
+ * @brief Give the current time
+ * 
+ * @return int64_t monotonic time in nanoseconds
+ */
+static int64_t now(void)
+{
+   struct timespec t;
+
+   clock_gettime(CLOCK_MONOTONIC, &t);
+   return t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+
+/**
+ * @brief Call a method of the server : "#call id method timeout args", its return is printed by the thread which reads
+ * 
+ * @param c Client connection
+ * @param buffer "method args"
+ * @return int id of the call, -1 if it is not sent
+ */
+static int callServer(Client *c, char *buffer)
+{
+   char method[RPC_METHOD_SIZE];
+   char message[BUF_SIZE + 64];
+   int64_t t = now();
+   int skip = 0;
+   uint64_t id;
+
+   buffer[strcspn(buffer, "\n")] = '\0';
+   if(sscanf(buffer, "%31s %n", method, &skip) != 1)
+      return -1;
+
+   pthread_mutex_lock(&c->lock);
+   id = c->next_call++;
+   if(rpc_insert(c->calls, id, t, t + RPC_TIMEOUT_MS * 1000000LL) < 0)
+   {
+      pthread_mutex_unlock(&c->lock);
+      return -1;
+   }
+   pthread_mutex_unlock(&c->lock);
+
+   snprintf(message, sizeof(message), "#call %" PRIu64 " %s %d %s\n", id, method, RPC_TIMEOUT_MS, buffer + skip);
+   if(sendServer(c, message) < 0)
+   {
+      pthread_mutex_lock(&c->lock);
+      rpc_remove(c->calls, id, NULL);
+      pthread_mutex_unlock(&c->lock);
+      return -1;
+   }
+
+   return id;
+}
+
+
+/**
+ * @brief Cancel a call in flight : "#cancel id", its return will be ignored
+ * 
+ * @param c Client connection
+ * @param id id of the call
+ * @return int 0 on success, -1 if the call is not in flight
+ */
+static int cancelCall(Client *c, uint64_t id)
+{
+   char message[BUF_SIZE];
+   bool found;
+
+   pthread_mutex_lock(&c->lock);
+   found = rpc_remove(c->calls, id, NULL);
+   pthread_mutex_unlock(&c->lock);
+
+   if(!found)
+      return -1;
+
+   snprintf(message, BUF_SIZE, "#cancel %" PRIu64 "\n", id);
+   sendServer(c, message);
+
+   return 0;
+}
+
+
+/**
+ * @brief Print the return of a call : "#ret id status result", the return of a call expired or cancelled is ignored
+ * 
+ * @param c Client connection
+ * @param line line of the return
+ * @param len len of the line
+ */
+static void returnCall(Client *c, const char *line, int len)
+{
+   RpcCall call;
+   uint64_t id;
+   bool found;
+   int skip = 0;
+
+   if(sscanf(line, "#ret %" SCNu64 " %n", &id, &skip) != 1)
+      return;
+
+   pthread_mutex_lock(&c->lock);
+   found = rpc_remove(c->calls, id, &call);
+   pthread_mutex_unlock(&c->lock);
+
+   if(found)
+      printf("\nReturn of call %" PRIu64 " (%.1f ms) : %.*s", id, (now() - call.start) / 1e6, len - skip, line + skip);
+}
+
+
+/**
+ * @brief Tell the user that a call has expired, the server drops it
+ * 
+ * @param call call expired
+ * @param context Client connection
+ */
+static void expireCall(const RpcCall *call, void *context)
+{
+   char message[BUF_SIZE];
+
+   printf("\nCall %" PRIu64 " timed out..\n", call->id);
+   snprintf(message, BUF_SIZE, "#cancel %" PRIu64 "\n", call->id);
+   sendServer((Client *)context, message);
+}
+
+
+/**
+ * @brief Wait until the server sends something, the calls whose deadline is past expire meanwhile
+ * 
+ * @param c Client connection
+ */
+static void waitServer(Client *c)
+{
+   struct pollfd pfd = { c->sock, POLLIN, 0 };
+   int timeout;
+
+   do
+   {
+      pthread_mutex_lock(&c->lock);
+      rpc_expire(c->calls, now(), expireCall, c);
+      timeout = rpc_timeout(c->calls, now());
+      pthread_mutex_unlock(&c->lock);
+
+      /* a call made during the wait is seen after CALL_TICK_MS at worst */
+      timeout = (timeout < 0 || timeout > CALL_TICK_MS) ? CALL_TICK_MS : timeout;
+   }
+   while(poll(&pfd, 1, timeout) == 0);
+}
+
+
+/**
+ * @brief Handle a line sent by the server : its session, a return of a call or a message
+ * 
+ * @param c Client connection
+ * @param line the line, with its end of line
+ * @param len len of the line
+ */
+static void readLine(Client *c, const char *line, int len)
+{
+    /* "#session id token" comes first, at the connection and when a session is resumed */
+    if(strncmp(line, "#session ", 9) == 0 && sscanf(line, "#session %d %" TOKEN_SCAN "s", &c->id, c->token) == 2)
+        printf("\nSession.. Id client=%d\n", c->id);
+    else if(strncmp(line, "#error resume", 13) == 0)
+        printf("\nSession not resumed..\n");
+    else if(strncmp(line, "#ret ", 5) == 0)
+        returnCall(c, line, len);
+    else
+        printf("\n%.*s", len, line);
 }
 
 
@@ -162,8 +590,9 @@ static void writeServer(SOCKET sock, const char *buffer)
  * @brief Application of client
  * 
  * @param address Adress of server 
+ * @param resilient the client reconnects until the server is back, with a session or not
  */
-static void appC(const char *address)
+static void appC(const char *address, bool resilient)
 {
 
     SOCKET sock = initConnection(address);
@@ -174,6 +603,27 @@ static void appC(const char *address)
     Client c; //the client connection
     c.connection = &connection;
     c.sock = sock;
+    c.address = address;
+    c.id = -1;
+    c.token[0] = '\0';
+    c.calls = rpc_create(RPC_INFLIGHT);
+    c.next_call = 1;
+    c.resilient = resilient;
+    c.online = true;
+    c.pending = malloc(SEND_BUFFER);
+    c.pending_len = 0;
+    c.seed = time(NULL) ^ getpid();
+    int id; //id of a call
+
+    /* the functor of the expired calls sends their cancel with the lock held */
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(&c.lock, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    /* the lines can be calls */
+    writeServer(sock, "#rpc\n");
 
     pthread_t wait_disconnection_message;
     pthread_create(&wait_disconnection_message, NULL, wait_server_disconnection, &c);
@@ -184,6 +634,8 @@ static void appC(const char *address)
         printf("Menu :\n");
         printf("\t[0] Send a message to the server\n");
         printf("\t[1] Deconnexion\n");
+        printf("\t[2] Call a method of the server\n");
+        printf("\t[3] Cancel a call\n");
         printf("\nGive your choice : ");
         if(fgets(buffer, BUF_SIZE-1, stdin) == NULL)
         {
@@ -194,14 +646,48 @@ static void appC(const char *address)
         { 
             if(strcmp(buffer, "0\n") == 0)
             {
-                printf("\nYou're message :\n\n\t");
+                printf("\nYou're message (\"@id text\" to send it to the client id) :\n\n\t");
                 if(fgets(buffer, BUF_SIZE-1, stdin) == NULL)
                 {
                     printf("\nAn error occurs..\n");
                     continue;
                 }
                 if(connection) //logout message sent from the server may happen during fgets
-                    writeServer(sock, buffer);
+                {
+                    switch(sendServer(&c, buffer))
+                    {
+                        case 1:
+                            printf("\nMessage kept until the server is back..\n");
+                            break;
+                        case -1:
+                            printf("\nMessage not sent, the send buffer is full..\n");
+                            break;
+                    }
+                }
+            }
+            else if(strcmp(buffer, "2\n") == 0)
+            {
+                printf("\nYour call (\"echo text\", \"sum 1 2 3\" or \"sleep ms\") :\n\n\t");
+                if(fgets(buffer, BUF_SIZE-1, stdin) == NULL)
+                {
+                    printf("\nAn error occurs..\n");
+                    continue;
+                }
+                if(connection && (id = callServer(&c, buffer)) >= 0)
+                    printf("\nCall %d sent..\n", id);
+                else if(connection)
+                    printf("\nCall not sent..\n");
+            }
+            else if(strcmp(buffer, "3\n") == 0)
+            {
+                printf("\nId of the call :\n\n\t");
+                if(fgets(buffer, BUF_SIZE-1, stdin) == NULL)
+                {
+                    printf("\nAn error occurs..\n");
+                    continue;
+                }
+                if(connection && cancelCall(&c, strtoull(buffer, NULL, 10)) < 0)
+                    printf("\nThe call is not in flight..\n");
             }
             else if(strcmp(buffer, "1\n") == 0)
             {
@@ -216,12 +702,15 @@ static void appC(const char *address)
         }
     }
 
-    endConnection(sock);
+    endConnection(c.sock);
+    rpc_delete(c.calls);
+    free(c.pending);
+    pthread_mutex_destroy(&c.lock);
 }
 
 
 /**
- * @brief Wait server logout
+ * @brief Print messages forwarded by the server and wait server logout
  * 
  * @param arg Client connection {socket, connection}
  * @return void* 
@@ -230,15 +719,62 @@ void *wait_server_disconnection(void *arg)
 {
 
     Client *c = (Client *) arg;
-    char buffer[2];
+    char buffer[BUF_SIZE];
+    char line[BUF_SIZE]; //line cut between two reads, kept until its end
+    char *message;
+    int len, line_len, copy;
 
-    int n = readServer(c->sock, buffer, 2); //wait to '\0' message
-    /* server down */
-    if(n == 0)
+    /* messages sent by other clients, "[id] : text", and returns of the calls, until the server is lost for good */
+    do
     {
-        printf("\n\nServer disconnected !\n");
-        *(c->connection) = 0;
-        pthread_exit(NULL);
+        /* a line cut by the connection lost does not end on the new one */
+        line_len = 0;
+        waitServer(c);
+        while(readServer(c->sock, buffer, BUF_SIZE) > 0)
+        {
+            /* a read may have several lines, its last one may be cut */
+            for(message = buffer ; *message != '\0' ; message += len)
+            {
+                len = strcspn(message, "\n");
+
+                /* a line longer than the buffer is handled in parts */
+                if(message[len] != '\n' && line_len + len < BUF_SIZE - 1)
+                {
+                    memcpy(line + line_len, message, len);
+                    line_len += len;
+                    break;
+                }
+                len += (message[len] == '\n');
+
+                if(line_len > 0)
+                {
+                    copy = (line_len + len < BUF_SIZE - 1) ? len : BUF_SIZE - 1 - line_len;
+                    memcpy(line + line_len, message, copy);
+                    line[line_len + copy] = '\0';
+                    readLine(c, line, line_len + copy);
+                    line_len = 0;
+                    len = copy;
+                }
+                else
+                {
+                    readLine(c, message, len);
+                }
+            }
+            fflush(stdout);
+            waitServer(c);
+        }
+
+        /* the messages written from now are kept in the send buffer */
+        pthread_mutex_lock(&c->lock);
+        c->online = false;
+        pthread_mutex_unlock(&c->lock);
+        printf("\nServer lost, reconnection..\n");
+        fflush(stdout);
     }
+    while(*(c->connection) && reconnectServer(c) == 0);
+
+    /* server down */
+    printf("\n\nServer disconnected !\n");
+    *(c->connection) = 0;
     pthread_exit(NULL);
 }
@@ -22,7 +22,7 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h> /* close */
-#include <netdb.h> /* gethostbyname */
+#include <netdb.h> /* getaddrinfo */
 
 #define INVALID_SOCKET -1
 #define SOCKET_ERROR -1
@@ -36,6 +36,10 @@ typedef struct in_addr IN_ADDR;
 #error not defined for this platform
 #endif
 
+#include <stdint.h>
+#include <stdbool.h>
+#include "Rpc/rpc.h"
+
 
 /* Exit defines */
 #define EXIT_FAILLURE_INIT 1
@@ -49,6 +53,17 @@ typedef struct in_addr IN_ADDR;
 /* Value defines */
 #define PORT 27000
 #define BUF_SIZE 1024
+#define TOKEN_SIZE 32 //size of a session token with its terminating 0
+#define TOKEN_SCAN "31" //max len of a token read by sscanf
+#define RECONNECT_TRIES 10 //attempts to reconnect when the server is lost, no limit for a resilient client
+#define RECONNECT_BASE_MS 100 //backoff before the first attempt, doubled at each attempt
+#define RECONNECT_MAX_MS 30000 //max backoff, the delay is drawn between 0 and the backoff
+#define SEND_BUFFER (64 * 1024) //bytes of messages kept while the server is away
+#define SEND_BATCH (16 * 1024) //bytes by write when the send buffer is flushed
+#define CALL_TICK_MS 100 //the deadlines of the calls are checked at least this often
+#define CONNECT_DELAY_MS 250 //delay before the next address of the server is tried, while the others are still pending (RFC 8305)
+#define CONNECT_TIMEOUT_MS 10000 //time given to the attempts to connect
+#define CONNECT_MAX 16 //addresses of the server tried
 
 
 /* Structures */
@@ -57,11 +72,23 @@ typedef struct client_s Client;
 /* Functions */
 static void init(void);
 static void end(void);
-static void appC(const char *address);
+static void appC(const char *address, bool resilient);
 static SOCKET initConnection(const char *address);
+static SOCKET connectServer(const char *address);
+static int orderAddresses(struct addrinfo *list, struct addrinfo **order);
+static int reconnectServer(Client *c);
+static int flushPending(Client *c);
+static int sendServer(Client *c, const char *message);
 static void endConnection(SOCKET sock);
 static int readServer(SOCKET sock, char *buffer, int len);
-static void writeServer(SOCKET sock, const char *buffer);
+static int writeServer(SOCKET sock, const char *buffer);
+static int64_t now(void);
+static int callServer(Client *c, char *buffer);
+static int cancelCall(Client *c, uint64_t id);
+static void returnCall(Client *c, const char *line, int len);
+static void expireCall(const RpcCall *call, void *context);
+static void waitServer(Client *c);
+static void readLine(Client *c, const char *line, int len);
 void *wait_server_disconnection(void *arg);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,325 @@
+/**
+ * @file replay.c
+ * @author Alary Dorian
+ * @brief Replay of a capture of the server (-C) : the connections and their messages are sent again with the same timing
+ * @version 0.1
+ * @date 2022-08-17
+ * 
+ * @copyright Copyright (c) 2022
+ * 
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <poll.h>
+#include "replay.h"
+
+/*
+   The server gives the ids in the order of the connections : started fresh, it gives the ids of the capture,
+   so the messages "@id text" reach the same recipients.
+   The replies are read and dropped, the server never waits for the replay.
+*/
+
+/* Structures */
+struct replay_s
+{
+   SOCKET *socks; //socket of each id of the capture, INVALID_SOCKET if not connected
+   int slots; //number of elements of socks
+   int connections; //connections opened
+   long messages; //messages sent
+   long bytes; //bytes sent
+   int64_t lag_max; //latest message after its time, in nanoseconds
+   int64_t lag_sum; //sum of the lateness of the messages
+};
+
+
+/**
+ * @brief Main function
+ * 
+ * @param argc number of arguments
+ * @param argv list of arguments
+ * @return int exit value
+ */
+int main(int argc, char **argv)
+{
+   double speed = 1; //1 for the original timing, 10 for 10 times faster, 0 for no wait
+   int o;
+
+   while((o = getopt(argc, argv, "x:")) != -1)
+   {
+      switch(o)
+      {
+         case 'x':
+            speed = atof(optarg);
+            break;
+         default:
+            printf("Usage : %s [-x speed] [address] [capture_file]\n", argv[0]);
+            return EXIT_FAILURE;
+      }
+   }
+
+   if(argc - optind != 2)
+   {
+      printf("Usage : %s [-x speed] [address] [capture_file]\n", argv[0]);
+      return EXIT_FAILURE;
+   }
+
+   init();
+   appR(argv[optind], argv[optind + 1], speed);
+   end();
+
+   return EXIT_SUCCESS;
+}
+
+
+/**
+ * @brief Initialisation of dll in windows to use socket
+ * 
+ */
+static void init(void){
+#ifdef WIN32
+   WSADATA wsa;
+   int err = WSAStartup(MAKEWORD(2, 2), &wsa);
+   if(err < 0)
+   {
+      fprintf(stderr, "Error : WSAStartup()\n");
+      exit(EXIT_FAILURE_INIT);
+   }
+#endif
+}
+
+
+/**
+ * @brief Kill dll in windows
+ * 
+ */
+static void end(void)
+{
+#ifdef WIN32
+   WSACleanup();
+#endif
+}
+
+
+/**
+ * @brief Initialisation of connection to the address, with socket
+ * 
+ * @param address of server
+ * @return SOCKET, FD of socket
+ */
+static SOCKET initConnection(const char *address)
+{
+    SOCKET sock;
+    SOCKADDR_IN sin;
+
+    if((sock = socket(AF_INET, SOCK_STREAM, 0)) == INVALID_SOCKET)
+    {
+        fprintf(stderr, "Error : socket()\n");
+        exit(EXIT_FAILURE_SOCKET);
+    }
+
+    sin.sin_addr.s_addr = inet_addr(address);
+    sin.sin_port = htons(PORT);
+    sin.sin_family = AF_INET;
+
+    if(connect(sock,(SOCKADDR *) &sin, sizeof(SOCKADDR)) == SOCKET_ERROR)
+    {
+        fprintf(stderr, "Error : connect()\n");
+        exit(EXIT_FAILURE_CONNECTION);
+    }
+
+    return sock;
+}
+
+
+/**
+ * @brief Close socket connection
+ * 
+ * @param sock the socket to close
+ */
+static void endConnection(SOCKET sock)
+{
+    closesocket(sock);
+}
+
+
+/**
+ * @brief Sends message to the server
+ * 
+ * @param sock socket
+ * @param buffer variable that stores the message
+ * @param len len of the message, it may contain 0
+ */
+static void writeServer(SOCKET sock, const char *buffer, size_t len)
+{
+   if(send(sock, buffer, len, 0) < (ssize_t)len)
+   {
+      fprintf(stderr, "Error : send()\n");
+      exit(EXIT_FAILURE_SEND);
+   }
+}
+
+
+/**
+ * @brief Give the time of the monotonic clock
+ * 
+ * @return int64_t time in nanoseconds
+ */
+static int64_t now(void)
+{
+   struct timespec t;
+
+   clock_gettime(CLOCK_MONOTONIC, &t);
+   return t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+
+/**
+ * @brief Give the socket of an id of the capture
+ * 
+ * @param r pointer on replay
+ * @param id id of the connection in the capture
+ * @return SOCKET* variable that stores the socket, INVALID_SOCKET if it is not connected
+ */
+static SOCKET *connectionSlot(Replay *r, int id)
+{
+   int slots = r->slots;
+
+   if(id >= r->slots)
+   {
+      r->slots = (id + 1 > 2 * slots) ? id + 1 : 2 * slots;
+      r->socks = realloc(r->socks, r->slots * sizeof(SOCKET));
+      for( ; slots < r->slots ; slots++)
+         r->socks[slots] = INVALID_SOCKET;
+   }
+
+   return &r->socks[id];
+}
+
+
+/**
+ * @brief Read and drop the replies of the server
+ * 
+ * @param r pointer on replay
+ * @param timeout milliseconds to wait for a reply, 0 to return at once
+ */
+static void drainServer(Replay *r, int timeout)
+{
+   struct pollfd *fds = malloc((r->slots + 1) * sizeof(struct pollfd));
+   char buffer[BUF_SIZE];
+   int count = 0;
+   int i, j;
+
+   for(i = 0 ; i < r->slots ; i++)
+   {
+      if(r->socks[i] != INVALID_SOCKET)
+      {
+         fds[count].fd = r->socks[i];
+         fds[count].events = POLLIN;
+         count++;
+      }
+   }
+
+   if(poll(fds, count, timeout) > 0)
+   {
+      for(i = 0 ; i < count ; i++)
+      {
+         /* the server closes the connection : the next messages of this id open a new one */
+         if((fds[i].revents & (POLLIN | POLLHUP)) && recv(fds[i].fd, buffer, BUF_SIZE, MSG_DONTWAIT) == 0)
+         {
+            for(j = 0 ; j < r->slots ; j++)
+            {
+               if(r->socks[j] == fds[i].fd)
+                  r->socks[j] = INVALID_SOCKET;
+            }
+            endConnection(fds[i].fd);
+         }
+      }
+   }
+
+   free(fds);
+}
+
+
+/**
+ * @brief Application of replay
+ * 
+ * @param address Adress of server
+ * @param path path of the capture
+ * @param speed factor of the speed of the capture, 0 to send without waiting
+ */
+static void appR(const char *address, const char *path, double speed)
+{
+   CaptureReader *reader = captureReader_open(path);
+   CaptureRecord record;
+   Replay r = { NULL, 0, 0, 0, 0, 0, 0 };
+   char buffer[BUF_SIZE]; //to store message
+   SOCKET *sock;
+   int64_t start, due, t, late;
+   long late_records = 0; //records sent after their time
+   int status, i;
+
+   if(reader == NULL)
+   {
+      fprintf(stderr, "Error : captureReader_open()\n");
+      exit(EXIT_FAILURE_CAPTURE);
+   }
+
+   record.time = 0;
+   start = now();
+   while((status = captureReader_next(reader, &record, buffer, BUF_SIZE)) == 1)
+   {
+      /* the replies are read while waiting for the time of the record */
+      due = start + ((speed > 0) ? (int64_t)(record.time / speed) : 0);
+      while((t = now()) < due)
+         drainServer(&r, (due - t + 999999) / 1000000);
+      if(due < t && ++late_records % REPLAY_DRAIN == 0)
+         drainServer(&r, 0);
+      late = (speed > 0) ? t - due : 0;
+
+      sock = connectionSlot(&r, record.id);
+      if(record.type == CAPTURE_DISCONNECT)
+      {
+         if(*sock != INVALID_SOCKET)
+            endConnection(*sock);
+         *sock = INVALID_SOCKET;
+         continue;
+      }
+
+      /* a capture of a server taken over starts with connections already open */
+      if(*sock == INVALID_SOCKET)
+      {
+         *sock = initConnection(address);
+         r.connections++;
+      }
+
+      if(record.type == CAPTURE_MESSAGE)
+      {
+         writeServer(*sock, buffer, record.len);
+         r.lag_max = (late > r.lag_max) ? late : r.lag_max;
+         r.lag_sum += late;
+         r.messages++;
+         r.bytes += record.len;
+      }
+   }
+
+   if(status < 0)
+      fprintf(stderr, "Error : captureReader_next()\n");
+
+   t = now() - start;
+   printf("Replayed.. %d connections, %ld messages, %ld bytes in %.3f s (capture of %.3f s)\n",
+      r.connections, r.messages, r.bytes, t / 1e9, record.time / 1e9);
+   if(speed > 0 && r.messages > 0)
+      printf("Lag.. max %.3f ms, mean %.3f ms\n", r.lag_max / 1e6, r.lag_sum / 1e6 / r.messages);
+
+   for(i = 0 ; i < r.slots ; i++)
+   {
+      if(r.socks[i] != INVALID_SOCKET)
+         endConnection(r.socks[i]);
+   }
+   free(r.socks);
+   captureReader_close(reader);
+}
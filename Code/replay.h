@@ -0,0 +1,72 @@
+/**
+ * @file replay.h
+ * @author Alary Dorian
+ * @brief 
+ * @version 0.1
+ * @date 2022-08-17
+ * 
+ * @copyright Copyright (c) 2022
+ * 
+ */
+#ifndef __REPLAY_H__
+#define __REPLAY_H__
+
+#ifdef WIN32 /* windows environment */
+
+#include <winsock2.h>
+
+#elif defined (linux) /* linux environment */
+
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h> /* close */
+#include <netdb.h> /* gethostbyname */
+
+#define INVALID_SOCKET -1
+#define SOCKET_ERROR -1
+#define closesocket(s) close(s)
+typedef int SOCKET;
+typedef struct sockaddr_in SOCKADDR_IN;
+typedef struct sockaddr SOCKADDR;
+typedef struct in_addr IN_ADDR;
+
+#else
+#error not defined for this platform
+#endif
+
+#include <stdint.h>
+#include "Capture/capture.h"
+
+
+/* Exit defines */
+#define EXIT_FAILLURE_INIT 1
+#define EXIT_FAILURE_SOCKET 2
+#define EXIT_FAILURE_CONNECTION 3
+#define EXIT_FAILURE_RECV 4
+#define EXIT_FAILURE_SEND 5
+#define EXIT_FAILURE_CAPTURE 11
+
+
+/* Value defines */
+#define PORT 27000
+#define BUF_SIZE 1024
+#define REPLAY_DRAIN 64 //records sent between two reads of the replies when the replay is late
+
+
+/* Structures */
+typedef struct replay_s Replay;
+
+/* Functions */
+static void init(void);
+static void end(void);
+static void appR(const char *address, const char *path, double speed);
+static SOCKET initConnection(const char *address);
+static void endConnection(SOCKET sock);
+static void writeServer(SOCKET sock, const char *buffer, size_t len);
+static int64_t now(void);
+static SOCKET *connectionSlot(Replay *r, int id);
+static void drainServer(Replay *r, int timeout);
+
+#endif
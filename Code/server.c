@@ -10,10 +10,20 @@
  */
 
 
+#define _GNU_SOURCE /* accept4 */
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <errno.h>
 #include <string.h>
+#include <inttypes.h>
+#include <getopt.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/time.h>
+#include <sched.h>
+#include <pthread.h>
+#include <signal.h>
 
 #include "server.h"
 
@@ -21,8 +31,123 @@
 /* Structure */
 struct client_s
 {
+   ListNode node; //links in the list of connected clients
    SOCKET sock;
    int id;
+   int capture_id; //id of the connection in the capture, it does not change when the client resumes a session
+   int cpu; //CPU which receives the packets of the connection, -1 if unknown
+   Strand *strand; //messages handled in order by the worker
+   TokenBucket messages; //messages by second
+   TokenBucket bytes; //bytes by second
+   TraceSocket trace; //sends waiting for their kernel timestamps
+   Tracer *tracer; //tracer of the latencies, NULL if disabled
+   ZeroCopy zc; //large messages sent without copy, waiting for their completion
+   Mux *mux; //logical streams of the connection, NULL if it is not multiplexed
+   Connected *streams; //clients of the streams of a multiplexed connection, NULL if it is not
+   Client *carrier; //connection of a stream client, NULL for a connection
+   uint32_t stream; //stream of a stream client
+   RpcTable *calls; //calls in flight of the client, NULL if it does not call methods
+   char *line; //line of the calls cut between two reads, BUF_SIZE bytes
+   size_t line_len;
+   char *out; //bytes the kernel has not taken yet, sent when the socket is writable, NULL if none
+   size_t out_off; //bytes of out already sent
+   size_t out_len; //0 if nothing waits
+   size_t out_capacity; //bytes allocated for out, counted in the budget
+   Budget *budget; //memory budget of the server
+   bool broken; //a send has failed, the client is removed at the end of the iteration
+   int slot; //slot of the socket in the sockets watched by poll, -1 if it is not watched
+};
+
+struct options_s
+{
+   const char *journal_dir; /* directory of the message journal, NULL if disabled */
+   const char *spool_dir; /* directory of the messages spilled for disconnected clients, NULL if disabled */
+   const char *handoff_path; /* UNIX socket used to hand off the server to a new process, NULL if disabled */
+   int threads; /* threads of the worker, 0 to handle the messages on the thread of the loop */
+   MessageHandler handler; /* handler of the messages of the clients */
+   double messages_rate; /* messages by second of a client, 0 for no limit (the default) */
+   double bytes_rate; /* bytes by second of a client, 0 for no limit (the default) */
+   bool trace; /* kernel timestamps of the messages, latencies printed at exit */
+   int cpu; /* CPU of the busy-poll loop, -1 for the loop which blocks in poll */
+   bool numa; /* threads of the worker by NUMA node, a client is handled on the node of its packets */
+   size_t zerocopy; /* messages from this size are sent with MSG_ZEROCOPY, 0 to always copy */
+   size_t memory; /* bytes held by the server in its buffers, 0 for no limit */
+   size_t client_memory; /* bytes held for a client before its reads are paused, 0 for no limit */
+   const char *capture_path; /* file of the capture of the traffic received, NULL if disabled */
+   bool sessions; /* a session token is sent at connect, a client which comes back resumes its id with it, false by default */
+};
+
+/* Sockets watched by poll, the fixed slots first then the clients */
+struct watched_s
+{
+   struct pollfd *fds;
+   int count;
+   int capacity;
+};
+
+/* Handler which can be chosen with -H */
+struct handler_s
+{
+   const char *name;
+   MessageHandler f;
+};
+
+static const Handler handlers[] = {
+   { "forward", handleForward },
+   { "echo", handleEcho },
+};
+
+/* Method which can be called with "#call" */
+struct method_s
+{
+   const char *name;
+   RpcMethod f;
+};
+
+static const Method methods[] = {
+   { "echo", methodEcho },
+   { "sum", methodSum },
+   { "sleep", methodSleep },
+};
+
+/* Message of the handoff, the first one carries the connection socket, the last one no socket */
+struct handoff_s
+{
+   int next_id; /* id which will be given to the next client */
+   SessionKey key; /* key of the session tokens, they stay valid in the new server */
+   int count; /* number of clients in the message, the state of each one follows the message */
+   int ids[HANDOFF_MAX_FDS]; /* ids of the clients, in the order of the sockets */
+   int replies; /* replies kept until their time, they follow the last message */
+};
+
+/* State of a client handed off, followed by its output, its line, its calls, its mux and its streams */
+struct handoff_client_s
+{
+   size_t out_len; /* output the kernel has not taken yet */
+   bool rpc; /* the client calls methods */
+   size_t line_len; /* line of the calls cut between two reads */
+   size_t calls; /* calls in flight */
+   size_t mux_len; /* state of the mux, 0 if the connection is not multiplexed */
+   size_t streams; /* clients of the streams of the connection */
+   uint32_t sent; /* bytes counted for the TX timestamps, the kernel goes on from there */
+};
+
+/* Client of a stream handed off with its connection */
+struct handoff_stream_s
+{
+   int id;
+   uint32_t stream;
+};
+
+/* Context of the frames read on a multiplexed connection */
+struct demux_s
+{
+   Client *carrier; /* connection of the frames */
+   Worker *worker;
+   Budget *budget;
+   Journal *journal; /* NULL if disabled */
+   int *id; /* id which will be given to the next client, a new stream is a new client */
+   int64_t stamp; /* time of the read */
 };
 
 
@@ -33,10 +158,81 @@ struct client_s
  * @param argv list of arguments
  * @return int exit value
  */
-int main()
+int main(int argc, char **argv)
 {
+   Options opt = { NULL, NULL, NULL, sysconf(_SC_NPROCESSORS_ONLN), handleForward, 0, 0, false, -1, false, ZEROCOPY_THRESHOLD, BUDGET_MEMORY, BUDGET_CLIENT, NULL, false };
+   int o, i;
+
+   while((o = getopt(argc, argv, "j:s:u:w:H:r:b:tc:nz:m:M:C:k")) != -1)
+   {
+      switch(o)
+      {
+         case 'j':
+            opt.journal_dir = optarg;
+            break;
+         case 's':
+            opt.spool_dir = optarg;
+            break;
+         case 'u':
+            opt.handoff_path = optarg;
+            break;
+         case 'w':
+            opt.threads = atoi(optarg);
+            break;
+         case 'H':
+            for(i = 0 ; i < (int)(sizeof(handlers) / sizeof(handlers[0])) && strcmp(handlers[i].name, optarg) != 0 ; i++);
+            if(i == (int)(sizeof(handlers) / sizeof(handlers[0])))
+            {
+               fprintf(stderr, "Error : unknown handler %s\n", optarg);
+               return EXIT_FAILURE;
+            }
+            opt.handler = handlers[i].f;
+            break;
+         case 'r':
+            opt.messages_rate = atof(optarg);
+            break;
+         case 'b':
+            opt.bytes_rate = atof(optarg);
+            break;
+         case 't':
+            opt.trace = true;
+            break;
+         case 'c':
+            opt.cpu = atoi(optarg);
+            break;
+         case 'n':
+            opt.numa = true;
+            break;
+         case 'z':
+            opt.zerocopy = atol(optarg);
+            break;
+         case 'm':
+            opt.memory = atol(optarg);
+            break;
+         case 'M':
+            opt.client_memory = atol(optarg);
+            break;
+         case 'C':
+            opt.capture_path = optarg;
+            break;
+         case 'k':
+            opt.sessions = true;
+            break;
+         default:
+            printf("Usage : %s [-j journal_dir] [-s spool_dir] [-u handoff_path] [-w threads] [-H forward|echo] [-r messages_rate] [-b bytes_rate] [-t] [-c busy_poll_cpu] [-n] [-z zerocopy_threshold] [-m memory_limit] [-M client_memory_limit] [-C capture_file] [-k]\n", argv[0]);
+            return EXIT_FAILURE;
+      }
+   }
+
+   /* the spooled messages are given to a client which resumes its session, a new connection has a new id */
+   if(opt.spool_dir != NULL && !opt.sessions)
+   {
+      fprintf(stderr, "Error : the spool (-s) needs the sessions (-k)\n");
+      return EXIT_FAILURE;
+   }
+
    init();
-   appS();
+   appS(&opt);
    end();
 
    return EXIT_SUCCESS;
@@ -74,14 +270,20 @@ static void end(void)
 
 
 /**
- * @brief Init connection, creation of a socket
+ * @brief Init connection, creation of a socket which listens in IPv6 and in IPv4
  * 
  * @return SOCKET, FD of socket connection
  */
 static SOCKET initConnection(void)
 {
-   SOCKET sock = socket(AF_INET, SOCK_STREAM, 0);
+   SOCKET sock = socket(AF_INET6, SOCK_STREAM, 0);
    SOCKADDR_IN sin;
+   struct sockaddr_in6 sin6;
+   int one = 1, zero = 0;
+
+   /* a kernel without IPv6 : IPv4 only */
+   if(sock == INVALID_SOCKET && errno == EAFNOSUPPORT)
+      sock = socket(AF_INET, SOCK_STREAM, 0);
 
    if(sock == INVALID_SOCKET)
    {
@@ -89,17 +291,34 @@ static SOCKET initConnection(void)
       exit(EXIT_FAILURE_SOCKET);
    }
 
+   /* a restarted server binds while the connections of the old one are in TIME_WAIT, its clients resume at once */
+   setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+   /* dual-stack : the IPv4 clients come on the same socket as ::ffff:a.b.c.d, whatever net.ipv6.bindv6only says */
+   memset(&sin6, 0, sizeof(sin6));
+   sin6.sin6_addr = in6addr_any;
+   sin6.sin6_port = htons(PORT);
+   sin6.sin6_family = AF_INET6;
+
    sin.sin_addr.s_addr = htonl(INADDR_ANY);
    sin.sin_port = htons(PORT);
    sin.sin_family = AF_INET;
 
-   if(bind(sock,(SOCKADDR *) &sin, sizeof sin) == SOCKET_ERROR)
+   if(setsockopt(sock, IPPROTO_IPV6, IPV6_V6ONLY, &zero, sizeof(zero)) == 0)
+   {
+      if(bind(sock, (SOCKADDR *) &sin6, sizeof sin6) == SOCKET_ERROR)
+      {
+         fprintf(stderr, "Error : bind()\n");
+         exit(EXIT_FAILURE_BIND);
+      }
+   }
+   else if(bind(sock,(SOCKADDR *) &sin, sizeof sin) == SOCKET_ERROR)
    {
       fprintf(stderr, "Error : bind()\n");
       exit(EXIT_FAILURE_BIND);
    }
 
-   if(listen(sock, MAX_CLIENTS) == SOCKET_ERROR)
+   if(listen(sock, BACKLOG) == SOCKET_ERROR)
    {
       fprintf(stderr, "Error : listen()\n");
       exit(EXIT_FAILURE_LISTEN);
@@ -112,155 +331,2185 @@ static SOCKET initConnection(void)
 
 
 /**
- * @brief Close connection socket
+ * @brief Take over the connection socket, the clients and the replies kept of the server which listens on path
  * 
- * @param sock socket
+ * @param path path of the UNIX socket of the old server
+ * @param client_list list which stores the clients received
+ * @param deferred heap which stores the replies kept until their time
+ * @param worker worker which handles the messages of the clients
+ * @param budget memory budget of the server
+ * @param tracer tracer of the latencies, NULL if disabled
+ * @param opt options of the server
+ * @param key variable that stores the key of the session tokens
+ * @param id variable that stores the id which will be given to the next client
+ * @return SOCKET, FD of socket connection, INVALID_SOCKET if no server listens on path or if it does not run as the same user
  */
-static void endConnection(SOCKET sock)
+static SOCKET takeOver(const char *path, Connected *client_list, Heap *deferred, Worker *worker, Budget *budget, Tracer *tracer, const Options *opt, SessionKey *key, int *id)
 {
-   closesocket(sock);
+   SOCKET handoff_sock = handoff_connect(path);
+   SOCKET sock;
+   SOCKET fds[HANDOFF_MAX_FDS];
+   Handoff msg;
+   Client *c;
+   Reply *r;
+   int count, i;
+
+   if(handoff_sock == INVALID_SOCKET)
+      return INVALID_SOCKET;
+
+   if(handoff_recv(handoff_sock, &msg, sizeof(msg), fds, &count) != sizeof(msg) || count != 1 || !validSocket(fds[0], true))
+   {
+      fprintf(stderr, "Error : handoff_recv()\n");
+      exit(EXIT_FAILURE_HANDOFF);
+   }
+   sock = fds[0];
+
+   /* clients keep their socket, their id, their output and their streams, nothing is seen by them */
+   while((handoff_recv(handoff_sock, &msg, sizeof(msg), fds, &count)) == sizeof(msg) && count > 0)
+   {
+      /* the states follow the message, one by socket */
+      if(msg.count != count)
+      {
+         fprintf(stderr, "Error : handoff_recv()\n");
+         exit(EXIT_FAILURE_HANDOFF);
+      }
+
+      for(i = 0 ; i < count ; i++)
+      {
+         /* a socket without a valid id, or which is not a connection, would leak : it is closed, its state is read */
+         if(msg.ids[i] < 0 || msg.ids[i] >= msg.next_id || !validSocket(fds[i], false))
+         {
+            fprintf(stderr, "Error : takeOver() socket %d dropped\n", fds[i]);
+            closesocket(fds[i]);
+            fds[i] = INVALID_SOCKET;
+         }
+         if((c = takeOverClient(handoff_sock, fds[i], msg.ids[i], msg.next_id, worker, budget, tracer, opt)) != NULL)
+            ilist_push_back(client_list, &c->node);
+      }
+   }
+
+   if(count != 0)
+   {
+      fprintf(stderr, "Error : handoff_recv()\n");
+      exit(EXIT_FAILURE_HANDOFF);
+   }
+
+   /* the replies which were not due yet */
+   for(i = 0 ; i < msg.replies ; i++)
+   {
+      r = malloc(sizeof(Reply));
+      takeOverBytes(handoff_sock, r, sizeof(Reply));
+      r->data = malloc(r->len);
+      takeOverBytes(handoff_sock, r->data, r->len);
+      budget_charge(budget, sizeof(Reply) + r->len);
+      heap_push(deferred, r);
+   }
+
+   *id = msg.next_id;
+   *key = msg.key;
+   closesocket(handoff_sock);
+   printf("Server taken over.. %d clients\n", ilist_size(client_list));
+
+   return sock;
 }
 
 
 /**
- * @brief Read data of client and store data in buffer
+ * @brief Read bytes of the handoff, the new server can not go on without them
  * 
- * @param sock socket of client
- * @param buffer variable that stores the message
- * @param len len of the buffer, less than or equal to the size of the buffer
- * @return int number of characters read
+ * @param handoff_sock UNIX socket of the old server
+ * @param data variable that stores the bytes
+ * @param len len of the bytes, nothing is read for 0
  */
-static int readClient(SOCKET sock, char *buffer, int len)
+static void takeOverBytes(SOCKET handoff_sock, void *data, size_t len)
 {
-   int n = 0;
+   SOCKET fds[HANDOFF_MAX_FDS];
+   int count;
 
-   if((n = recv(sock, buffer, len-1, 0)) < 0)
+   if(len > 0 && (handoff_recv(handoff_sock, data, len, fds, &count) != (int)len || count != 0))
    {
-      fprintf(stderr, "Error : recv()\n");
-      /* if recv error we disonnect the client */
-      n = 0;
+      fprintf(stderr, "Error : handoff_recv()\n");
+      exit(EXIT_FAILURE_HANDOFF);
    }
-
-   buffer[n] = 0;
-   return n;
 }
 
 
 /**
- * @brief Write data to the client
+ * @brief Read the state of a client handed off and create the client : its output, its calls in flight and its streams
  * 
- * @param sock socket of client
- * @param buffer variable that stores the message
+ * @param handoff_sock UNIX socket of the old server
+ * @param sock socket of client, INVALID_SOCKET if it is dropped : its state is read and thrown away
+ * @param id id of client
+ * @param next_id id which will be given to the next client, the ids of the streams are below it
+ * @param worker worker which handles the messages of the clients
+ * @param budget memory budget of the server, the client is counted in it
+ * @param tracer tracer of the latencies, NULL if disabled
+ * @param opt options of the server
+ * @return Client* pointer on client, NULL if it is dropped
  */
-static void writeClient(SOCKET sock, const char *buffer)
+static Client *takeOverClient(SOCKET handoff_sock, SOCKET sock, int id, int next_id, Worker *worker, Budget *budget, Tracer *tracer, const Options *opt)
 {
-   if(send(sock, buffer, strlen(buffer), 0) < 0)
+   HandoffClient state;
+   HandoffStream *streams;
+   RpcCall *calls;
+   Client *c, *s;
+   Mux *mux = NULL;
+   char line[BUF_SIZE];
+   char *out, *saved;
+   size_t i;
+
+   takeOverBytes(handoff_sock, &state, sizeof(state));
+   if(state.line_len >= BUF_SIZE || state.calls > RPC_INFLIGHT || (!state.rpc && state.line_len + state.calls > 0)
+      || (state.mux_len == 0 && state.streams > 0) || state.streams > (size_t)next_id)
+   {
+      fprintf(stderr, "Error : takeOverClient()\n");
+      exit(EXIT_FAILURE_HANDOFF);
+   }
+
+   out = malloc(state.out_len);
+   calls = malloc(state.calls * sizeof(RpcCall));
+   saved = malloc(state.mux_len);
+   streams = malloc(state.streams * sizeof(HandoffStream));
+   takeOverBytes(handoff_sock, out, state.out_len);
+   takeOverBytes(handoff_sock, line, state.line_len);
+   takeOverBytes(handoff_sock, calls, state.calls * sizeof(RpcCall));
+   takeOverBytes(handoff_sock, saved, state.mux_len);
+   takeOverBytes(handoff_sock, streams, state.streams * sizeof(HandoffStream));
+
+   if(sock != INVALID_SOCKET && state.mux_len > 0 && (mux = mux_load(saved, state.mux_len)) == NULL)
    {
-      fprintf(stderr, "Error : send()\n");
-      exit(EXIT_FAILURE_SEND);
+      fprintf(stderr, "Error : takeOver() socket %d dropped\n", sock);
+      closesocket(sock);
+      sock = INVALID_SOCKET;
    }
+
+   c = (sock != INVALID_SOCKET) ? createClient(sock, id, worker, budget, tracer, opt) : NULL;
+   if(c != NULL)
+   {
+      c->trace.sent = state.sent;
+
+      /* the bytes the old server had not sent go before the next replies */
+      queueClient(c, out, state.out_len);
+
+      if(state.rpc)
+      {
+         c->calls = rpc_create(RPC_INFLIGHT);
+         for(i = 0 ; i < state.calls ; i++)
+            rpc_insert(c->calls, calls[i].id, calls[i].start, calls[i].deadline);
+         c->line = malloc(BUF_SIZE);
+         memcpy(c->line, line, state.line_len);
+         c->line_len = state.line_len;
+         budget_charge(budget, rpc_memory(c->calls) + BUF_SIZE);
+      }
+
+      if(mux != NULL)
+      {
+         c->mux = mux;
+         c->streams = ilist_create();
+         budget_charge(budget, mux_held(mux));
+         for(i = 0 ; i < state.streams ; i++)
+         {
+            if(streams[i].id < 0 || streams[i].id >= next_id)
+               continue;
+            s = createStream(c, streams[i].stream, streams[i].id, worker, budget);
+            ilist_push_back(c->streams, &s->node);
+         }
+      }
+   }
+
+   free(out);
+   free(calls);
+   free(saved);
+   free(streams);
+
+   return c;
 }
 
 
 /**
- * @brief Server application
+ * @brief Check a socket received from the old server : a TCP stream socket, which listens or not
  * 
+ * @param sock socket received
+ * @param listening true for the connection socket, false for a client
+ * @return true if the socket can be used
  */
-static void appS(void)
+static bool validSocket(SOCKET sock, bool listening)
 {
-   SOCKET sock = initConnection();
-   fd_set rdfs; //variable which is used to use select
-   Connected *client_list = list_create();
-   ListIterator *iterator_client_list = listIterator_create(client_list, FORWARD_ITERATOR);
-   Client *c;
+   int type = 0, accepting = 0;
+   socklen_t len = sizeof(type);
 
-   int connection = 1; //keep the application alive
-   char buffer[BUF_SIZE];
-   int max = sock; //max socket number which is used to use select
-   int id = 0; //id of client
-   int i; //follow element in iterator list
+   if(getsockopt(sock, SOL_SOCKET, SO_TYPE, &type, &len) < 0 || type != SOCK_STREAM)
+      return false;
+   len = sizeof(accepting);
+   if(getsockopt(sock, SOL_SOCKET, SO_ACCEPTCONN, &accepting, &len) < 0)
+      return false;
 
-   while(connection)
+   return (accepting != 0) == listening;
+}
+
+
+/**
+ * @brief Hand off the connection socket, the clients and the replies kept to a new server
+ * 
+ * @param new_sock connection of the new server, accepted by handoff_accept, closed by the function
+ * @param sock connection socket
+ * @param client_list list of connected clients
+ * @param deferred heap of the replies kept until their time, the replies handed off are removed from it
+ * @param budget memory budget of the server
+ * @param key key of the session tokens
+ * @param id id which will be given to the next client
+ * @return int 0 on success, -1 on error
+ */
+static int handOff(SOCKET new_sock, SOCKET sock, Connected *client_list, Heap *deferred, Budget *budget, const SessionKey *key, int id)
+{
+   ListNode *node = client_list->sentinel.next, *first;
+   SOCKET fds[HANDOFF_MAX_FDS];
+   Handoff msg;
+   Reply *r;
+   int status = 0;
+
+   memset(&msg, 0, sizeof(msg));
+   msg.next_id = id;
+   msg.key = *key;
+   status = handoff_send(new_sock, &msg, sizeof(msg), &sock, 1);
+
+   /* clients by batch of HANDOFF_MAX_FDS sockets */
+   while(status == 0 && node != &client_list->sentinel)
    {
-      FD_ZERO(&rdfs);
+      first = node;
+      for(msg.count = 0 ; msg.count < HANDOFF_MAX_FDS && node != &client_list->sentinel ; msg.count++, node = node->next)
+      {
+         fds[msg.count] = ilist_entry(node, Client, node)->sock;
+         msg.ids[msg.count] = ilist_entry(node, Client, node)->id;
+      }
+      status = handoff_send(new_sock, &msg, sizeof(msg), fds, msg.count);
 
-      /* add STDIN_FILENO */
-      FD_SET(STDIN_FILENO, &rdfs);
+      /* the state of each client of the batch */
+      for( ; status == 0 && first != node ; first = first->next)
+         status = handOffClient(new_sock, ilist_entry(first, Client, node));
+   }
 
-      /* add the connection socket to see new connection */
-      FD_SET(sock, &rdfs);
+   /* end of the handoff, the replies kept follow it */
+   msg.count = 0;
+   msg.replies = heap_size(deferred);
+   if(status == 0)
+      status = handoff_send(new_sock, &msg, sizeof(msg), NULL, 0);
 
-      /* add the clients socket to see new message of clients*/
-      for(iterator_client_list=listIterator_begin(iterator_client_list) ; !listIterator_end(iterator_client_list) ; iterator_client_list=listIterator_next(iterator_client_list))
-      { 
-         FD_SET(((Client*)listIterator_value(iterator_client_list))->sock, &rdfs);
+   /* a reply is removed once it is sent, the others stay if the handoff fails */
+   while(status == 0 && !heap_empty(deferred))
+   {
+      r = heap_top(deferred);
+      if((status = handOffBytes(new_sock, r, sizeof(Reply))) == 0 && (status = handOffBytes(new_sock, r->data, r->len)) == 0)
+      {
+         heap_pop(deferred);
+         budget_release(budget, sizeof(Reply) + r->len);
+         free(r->data);
+         free(r);
       }
+   }
+
+   if(status < 0)
+      fprintf(stderr, "Error : handoff_send()\n");
+   else
+      printf("Server handed off.. %d clients\n", ilist_size(client_list));
+
+   closesocket(new_sock);
+
+   return status;
+}
+
+
+/**
+ * @brief Send bytes of the handoff
+ * 
+ * @param new_sock connection of the new server
+ * @param data bytes
+ * @param len len of the bytes, nothing is sent for 0
+ * @return int 0 on success, -1 on error
+ */
+static int handOffBytes(SOCKET new_sock, const void *data, size_t len)
+{
+   return (len > 0) ? handoff_send(new_sock, data, len, NULL, 0) : 0;
+}
 
-      if(select(max + 1, &rdfs, NULL, NULL, NULL) == -1)
+
+/**
+ * @brief Send the state of a client to the new server : its output not sent, its calls in flight and its streams
+ * 
+ * @param new_sock connection of the new server
+ * @param c pointer on client
+ * @return int 0 on success, -1 on error
+ * @note The messages sent with MSG_ZEROCOPY are already in the socket, the kernel sends them whoever owns it.
+ */
+static int handOffClient(SOCKET new_sock, Client *c)
+{
+   HandoffClient state;
+   HandoffStream stream;
+   RpcCall *calls = NULL;
+   ListNode *node;
+   char *mux = NULL;
+   int status;
+
+   memset(&state, 0, sizeof(state));
+   state.out_len = c->out_len - c->out_off;
+   state.sent = (c->tracer != NULL) ? c->trace.sent : 0;
+   state.rpc = (c->calls != NULL);
+   if(c->calls != NULL)
+   {
+      state.line_len = c->line_len;
+      calls = malloc(rpc_count(c->calls) * sizeof(RpcCall));
+      state.calls = rpc_calls(c->calls, calls);
+   }
+   if(c->mux != NULL)
+   {
+      mux = mux_save(c->mux, &state.mux_len);
+      state.streams = ilist_size(c->streams);
+   }
+
+   status = handOffBytes(new_sock, &state, sizeof(state));
+   if(status == 0)
+      status = handOffBytes(new_sock, c->out + c->out_off, state.out_len);
+   if(status == 0)
+      status = handOffBytes(new_sock, c->line, state.line_len);
+   if(status == 0)
+      status = handOffBytes(new_sock, calls, state.calls * sizeof(RpcCall));
+   if(status == 0)
+      status = handOffBytes(new_sock, mux, state.mux_len);
+   if(c->streams != NULL)
+   {
+      ilist_for_each(node, c->streams)
       {
-         fprintf(stderr, "Error : select()\n");
-         exit(EXIT_FAILURE_SELECT);
+         stream.id = ilist_entry(node, Client, node)->id;
+         stream.stream = ilist_entry(node, Client, node)->stream;
+         if(status == 0)
+            status = handOffBytes(new_sock, &stream, sizeof(stream));
       }
+   }
+
+   free(calls);
+   free(mux);
+
+   return status;
+}
 
-      if(FD_ISSET(STDIN_FILENO, &rdfs)) /* something from standard input : i.e keyboard -> leave */
+
+/**
+ * @brief Wait for the zerocopy completions of the clients before a handoff, at most HANDOFF_FLUSH_MS
+ * 
+ * @param client_list list of connected clients
+ * @param tracer tracer of the latencies, NULL if disabled
+ * @param budget memory budget of the server, the messages completed are released from it
+ * @note The messages still not completed after it are left to the kernel, see zerocopy_detach.
+ */
+static void awaitCompletions(Connected *client_list, Tracer *tracer, Budget *budget)
+{
+   Watched watched = { NULL, 0, 0 };
+   int64_t deadline = bucket_now() + HANDOFF_FLUSH_MS * 1000000LL;
+   int64_t now;
+   ListNode *node;
+   Client *c;
+
+   while((now = bucket_now()) < deadline)
+   {
+      /* a completion is an error of the socket, seen by poll without any event asked */
+      watched.count = 0;
+      ilist_for_each(node, client_list)
       {
-         /* stop process when type on keyboard */
-         connection = 0;
-         break;
+         c = ilist_entry(node, Client, node);
+         c->slot = (c->zc.held > 0) ? watchSocket(&watched, c->sock, 0) : -1;
       }
-      else if(FD_ISSET(sock, &rdfs)) /* new client */
+      if(watched.count == 0)
+         break;
+
+      if(poll(watched.fds, watched.count, (deadline - now + 999999) / 1000000) < 0 && errno != EINTR)
+         break;
+
+      ilist_for_each(node, client_list)
       {
-         
-         SOCKADDR_IN client_sin;
-         socklen_t client_sin_size = sizeof(client_sin);
-         int client_sock;
+         c = ilist_entry(node, Client, node);
+         if(readyEvents(&watched, c->slot))
+            readErrors(c, tracer, budget);
+      }
+   }
+
+   free(watched.fds);
+}
+
+
+/**
+ * @brief Create a client, its rate is limited as set in the options
+ * 
+ * @param sock socket of client
+ * @param id id of client
+ * @param worker worker which handles the messages of the clients
+ * @param budget memory budget of the server, the client is counted in it
+ * @param tracer tracer of the latencies, NULL if disabled
+ * @param opt options of the server
+ * @return Client* pointer on client
+ */
+static Client *createClient(SOCKET sock, int id, Worker *worker, Budget *budget, Tracer *tracer, const Options *opt)
+{
+   Client *c = malloc(sizeof(Client));
+   int64_t now = bucket_now();
+   socklen_t len = sizeof(int);
+   int cpu = -1;
+
+   /* CPU which received the packets of the connection, the strand is handled on its node */
+   if(opt->numa && getsockopt(sock, SOL_SOCKET, SO_INCOMING_CPU, &cpu, &len) < 0)
+      cpu = -1;
+
+   c->sock = sock;
+   c->id = id;
+   c->capture_id = id;
+   c->cpu = cpu;
+   c->strand = worker_strand(worker, id, cpu);
+   bucket_init(&c->messages, opt->messages_rate, opt->messages_rate * RATE_BURST, now);
+   bucket_init(&c->bytes, opt->bytes_rate, opt->bytes_rate * RATE_BURST, now);
+   c->tracer = tracer;
+   if(tracer != NULL && trace_socket(sock, &c->trace) < 0)
+      fprintf(stderr, "Error : trace_socket()\n");
+   if(opt->cpu >= 0)
+      busyPollSocket(sock);
+   zerocopy_init(&c->zc, sock, opt->zerocopy);
+   c->mux = NULL;
+   c->streams = NULL;
+   c->carrier = NULL;
+   c->stream = 0;
+   c->calls = NULL;
+   c->line = NULL;
+   c->line_len = 0;
+   c->out = NULL;
+   c->out_off = 0;
+   c->out_len = 0;
+   c->out_capacity = 0;
+   c->budget = budget;
+   c->broken = false;
+   c->slot = -1;
+   budget_charge(budget, sizeof(Client));
+
+   return c;
+}
+
+
+/**
+ * @brief Create the client of a stream opened on a multiplexed connection, its messages are handled on the node of the connection
+ * 
+ * @param carrier connection of the stream
+ * @param stream stream
+ * @param id id of client
+ * @param worker worker which handles the messages of the clients
+ * @param budget memory budget of the server, the client is counted in it
+ * @return Client* pointer on client
+ * @note The rates are limited on the connection, its streams share them.
+ */
+static Client *createStream(Client *carrier, uint32_t stream, int id, Worker *worker, Budget *budget)
+{
+   Client *c = calloc(1, sizeof(Client));
+
+   c->sock = INVALID_SOCKET;
+   c->id = id;
+   c->capture_id = id;
+   c->cpu = carrier->cpu;
+   c->strand = worker_strand(worker, id, c->cpu);
+   zerocopy_init(&c->zc, INVALID_SOCKET, 0);
+   c->carrier = carrier;
+   c->stream = stream;
+   c->budget = budget;
+   c->slot = -1;
+   budget_charge(budget, sizeof(Client));
+
+   return c;
+}
+
+
+/**
+ * @brief Close the connection of a client and free it, the messages it has sent are still handled
+ * 
+ * @param client_list list of connected clients
+ * @param c pointer on client
+ * @param worker worker which handles the messages of the clients
+ * @param budget memory budget of the server
+ * @param capture capture of the traffic, NULL if disabled
+ */
+static void removeClient(Connected *client_list, Client *c, Worker *worker, Budget *budget, Capture *capture)
+{
+   ListNode *node, *next;
+
+   /* the capture has the bytes of the connection, the frames of its streams in them, the end of a connection resumed is already recorded */
+   if(c->id >= 0 && c->carrier == NULL)
+      capture_record(capture, CAPTURE_DISCONNECT, c->capture_id, bucket_now(), NULL, 0);
+
+   if(c->streams != NULL)
+   {
+      ilist_for_each_safe(node, next, c->streams)
+         removeClient(c->streams, ilist_entry(node, Client, node), worker, budget, capture);
+      ilist_delete(c->streams);
+   }
+   if(c->mux != NULL)
+   {
+      budget_release(budget, mux_held(c->mux));
+      mux_delete(c->mux);
+   }
+   if(c->calls != NULL)
+   {
+      budget_release(budget, rpc_memory(c->calls) + BUF_SIZE);
+      rpc_delete(c->calls);
+      free(c->line);
+   }
+
+   /* the messages the kernel has completed are freed before the socket and its error queue are gone */
+   if(c->carrier == NULL)
+   {
+      zerocopy_drain(&c->zc, c->sock);
+      closesocket(c->sock);
+   }
+   free(c->out);
+   ilist_remove(client_list, &c->node);
+   worker_strand_close(worker, c->strand);
+   budget_release(budget, sizeof(Client) + c->zc.held + c->out_capacity);
+   zerocopy_release(&c->zc);
+   free(c);
+}
+
+
+/**
+ * @brief Give the bytes held for a client : its structure, its messages not handled, its output not sent and its messages not completed, with its streams
+ * 
+ * @param c pointer on client
+ * @return size_t bytes held
+ */
+static size_t clientMemory(Client *c)
+{
+   ListNode *node;
+   size_t held = sizeof(Client) + worker_strand_held(c->strand) + c->out_capacity + c->zc.held + mux_held(c->mux);
+
+   if(c->streams != NULL)
+   {
+      ilist_for_each(node, c->streams)
+         held += sizeof(Client) + worker_strand_held(ilist_entry(node, Client, node)->strand);
+   }
+
+   return held;
+}
+
+
+/**
+ * @brief Close the connections which hold the most memory until the server is under its limit
+ * 
+ * @param client_list list of connected clients
+ * @param worker worker which handles the messages of the clients
+ * @param budget memory budget of the server
+ * @param capture capture of the traffic, NULL if disabled
+ * @return int number of messages dropped with the clients
+ */
+static int evictClients(Connected *client_list, Worker *worker, Budget *budget, Capture *capture)
+{
+   ListNode *node;
+   Client *c, *biggest;
+   size_t held, most;
+   int dropped = 0;
 
-         if((client_sock = accept(sock, (SOCKADDR *)&client_sin, &client_sin_size)) == SOCKET_ERROR)
+   while(budget_stage(budget) == BUDGET_EVICTING)
+   {
+      biggest = NULL;
+      most = sizeof(Client);
+      ilist_for_each(node, client_list)
+      {
+         c = ilist_entry(node, Client, node);
+         if((held = clientMemory(c)) > most)
          {
-            fprintf(stderr, "Error : accept()\n");
-            continue;
+            biggest = c;
+            most = held;
          }
+      }
 
-         /* what is the new maximum fd ? */
-         max = (client_sock > max) ? client_sock : max;
+      /* the rest is held by the handlers and the replies, not by a client */
+      if(biggest == NULL)
+         break;
 
-         c = malloc(sizeof(Client));
-         c->sock = client_sock;
-         c->id = id;
-         id++;
-         list_push_front(client_list, c);
-         printf("Client connexion.. Id client=%d\n", c->id);
-      }
-      else
+      dropped += worker_strand_drop(worker, biggest->strand);
+      if(biggest->streams != NULL)
       {
-         i = 0;
-         for(iterator_client_list=listIterator_begin(iterator_client_list) ; !listIterator_end(iterator_client_list) ; iterator_client_list=listIterator_next(iterator_client_list))
-         { 
-            c = ((Client *)listIterator_value(iterator_client_list));
-            if(FD_ISSET(c->sock, &rdfs))
-            {
-               if(readClient(c->sock, buffer, BUF_SIZE) == 0)
-               {
-                  closesocket(c->sock);
-                  list_remove_at(client_list, i);
-                  printf("Client deconnexion.. Id client=%d\n", c->id);
-                  break; //break everytime when a value is remove or pop in the list, listIterator_begin puts the iterator at the right value, after we can start new loop
-               }
-               else
-               {
-                  printf("[%d] : %s", c->id, buffer);
-               }
-            }
-            i++;
-         }
+         ilist_for_each(node, biggest->streams)
+            dropped += worker_strand_drop(worker, ilist_entry(node, Client, node)->strand);
       }
+      printf("Client evicted.. Id client=%d (%zu bytes)\n", biggest->id, most);
+      removeClient(client_list, biggest, worker, budget, capture);
    }
-   
-   for(iterator_client_list=listIterator_begin(iterator_client_list) ; !listIterator_end(iterator_client_list) ; iterator_client_list=listIterator_next(iterator_client_list))
-   { 
-      closesocket(((Client *)listIterator_value(iterator_client_list))->sock);
+
+   return dropped;
+}
+
+
+/**
+ * @brief Give the time before a client can be read again
+ * 
+ * @param c pointer on client
+ * @param now current time in nanoseconds
+ * @return int milliseconds to wait, 0 if the client can be read
+ */
+static int throttleClient(Client *c, int64_t now)
+{
+   int messages = bucket_delay(&c->messages, 1, now);
+   int bytes = bucket_delay(&c->bytes, 1, now);
+
+   return (messages > bytes) ? messages : bytes;
+}
+
+
+/**
+ * @brief Pin the calling thread to a CPU
+ * 
+ * @param cpu number of the CPU
+ */
+static void pinLoop(int cpu)
+{
+   cpu_set_t set;
+
+   CPU_ZERO(&set);
+   CPU_SET(cpu, &set);
+   if(pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0)
+      fprintf(stderr, "Error : pthread_setaffinity_np()\n");
+}
+
+
+/**
+ * @brief Ask the kernel to busy poll the device queue when the socket is read
+ * 
+ * @param sock socket
+ */
+static void busyPollSocket(SOCKET sock)
+{
+   int usec = BUSY_POLL_US;
+   int prefer = 1;
+
+   /* over net.core.busy_read, CAP_NET_ADMIN is needed : the loop still spins without it */
+   if(setsockopt(sock, SOL_SOCKET, SO_BUSY_POLL, &usec, sizeof(usec)) < 0)
+      return;
+   setsockopt(sock, SOL_SOCKET, SO_PREFER_BUSY_POLL, &prefer, sizeof(prefer));
+}
+
+
+/**
+ * @brief Give the timeout of poll in busy-poll mode : 0 while the loop spins, then longer and longer sleeps
+ * 
+ * @param ready number of sockets ready at the last poll
+ * @param now current time in nanoseconds
+ * @param last_event variable that stores the time of the last event
+ * @param backoff variable that stores the last sleep, in microseconds
+ * @return long timeout in microseconds
+ */
+static long busyTimeout(int ready, int64_t now, int64_t *last_event, long *backoff)
+{
+   if(ready > 0)
+   {
+      *last_event = now;
+      *backoff = 0;
+      return 0;
+   }
+
+   if(now - *last_event < BUSY_SPIN_US * 1000L)
+      return 0;
+
+   /* idle : an event still wakes poll at once, only the cost of the wakeup comes back */
+   *backoff = (*backoff == 0) ? 1 : *backoff * 2;
+   *backoff = (*backoff > BUSY_BACKOFF_MAX_US) ? BUSY_BACKOFF_MAX_US : *backoff;
+   return *backoff;
+}
+
+
+/**
+ * @brief Watch a socket in the next poll
+ * 
+ * @param w sockets watched
+ * @param sock socket, INVALID_SOCKET for a slot which poll ignores
+ * @param events events watched
+ * @return int slot of the socket
+ */
+static int watchSocket(Watched *w, SOCKET sock, short events)
+{
+   if(w->count == w->capacity)
+   {
+      w->capacity = (w->capacity > 0) ? 2 * w->capacity : WATCHED_CAPACITY;
+      w->fds = realloc(w->fds, w->capacity * sizeof(struct pollfd));
+   }
+
+   /* poll skips a negative fd */
+   w->fds[w->count].fd = sock;
+   w->fds[w->count].events = events;
+   w->fds[w->count].revents = 0;
+
+   return w->count++;
+}
+
+
+/**
+ * @brief Give the events of a socket returned by poll
+ * 
+ * @param w sockets watched
+ * @param slot slot of the socket, -1 if it is not watched
+ * @return short events returned, 0 if the socket is not watched
+ */
+static short readyEvents(const Watched *w, int slot)
+{
+   return (slot >= 0) ? w->fds[slot].revents : 0;
+}
+
+
+/**
+ * @brief Read the error queue of a client : kernel timestamps and zerocopy completions
+ * 
+ * @param c pointer on client
+ * @param tracer tracer of the latencies, NULL if disabled
+ * @param budget memory budget of the server, the messages completed are released from it
+ */
+static void readErrors(Client *c, Tracer *tracer, Budget *budget)
+{
+   char control[ZEROCOPY_CONTROL];
+   struct msghdr msg;
+   size_t held = c->zc.held;
+
+   if(tracer == NULL && c->zc.pending == NULL)
+      return;
+
+   while(1)
+   {
+      memset(&msg, 0, sizeof(msg));
+      msg.msg_control = control;
+      msg.msg_controllen = sizeof(control);
+      if(recvmsg(c->sock, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0)
+         break;
+
+      if(zerocopy_completion(&c->zc, &msg) == 0 && tracer != NULL)
+         trace_completion(tracer, &c->trace, &msg);
+   }
+
+   budget_update(budget, held, c->zc.held);
+}
+
+
+/**
+ * @brief Close connection socket
+ * 
+ * @param sock socket
+ */
+static void endConnection(SOCKET sock)
+{
+   closesocket(sock);
+}
+
+
+/**
+ * @brief Read data of client and store data in buffer
+ * 
+ * @param sock socket of client
+ * @param buffer variable that stores the message
+ * @param len len of the buffer, less than or equal to the size of the buffer
+ * @param tracer tracer of the latencies, NULL if disabled
+ * @param stamp variable that stores the time of the read, 0 if the tracer is disabled
+ * @return int number of characters read, 0 if the client is disconnected, -1 if nothing is ready
+ */
+static int readClient(SOCKET sock, char *buffer, int len, Tracer *tracer, int64_t *stamp)
+{
+   int n = 0;
+
+   *stamp = 0;
+   n = (tracer != NULL) ? trace_recv(tracer, sock, buffer, len-1, stamp) : recv(sock, buffer, len-1, 0);
+   if(n < 0)
+   {
+      /* the socket is non-blocking */
+      if(errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+         return -1;
+
+      fprintf(stderr, "Error : recv()\n");
+      /* if recv error we disonnect the client */
+      n = 0;
+   }
+
+   buffer[n] = 0;
+   return n;
+}
+
+
+/**
+ * @brief Write data to the client
+ * 
+ * @param c pointer on client
+ * @param buffer variable that stores the message
+ */
+static void writeClient(Client *c, const char *buffer)
+{
+   sendClient(c, buffer, strlen(buffer));
+}
+
+
+/**
+ * @brief Write bytes to the client, a send which fails marks the client broken
+ * 
+ * @param c pointer on client
+ * @param buffer variable that stores the bytes
+ * @param len len of the bytes
+ */
+static void sendClient(Client *c, const char *buffer, size_t len)
+{
+   struct iovec iov = { (void *)buffer, len };
+
+   sendClientv(c, &iov, 1, 0, 0);
+}
+
+
+/**
+ * @brief Write a vector of bytes to the client, what the kernel does not take is queued until the socket is writable
+ * 
+ * @param c pointer on client
+ * @param iov vector of bytes
+ * @param count number of iovec
+ * @param sent bytes at the start of the vector the kernel has already taken without copy, the rest is queued after them
+ * @param received time of the read of the message answered, 0 if the bytes do not answer a message
+ * @note The loop never waits for a client : a client which does not read grows its queue, counted in its memory.
+ *       Every byte written to the client goes through here, so the offsets of the TX timestamps are counted here.
+ */
+static void sendClientv(Client *c, const struct iovec *iov, int count, size_t sent, int64_t received)
+{
+   struct msghdr msg;
+   ssize_t n = sent;
+   size_t len = 0;
+   int i;
+
+   if(c->broken)
+      return;
+
+   for(i = 0 ; i < count ; i++)
+      len += iov[i].iov_len;
+   if(c->tracer != NULL && len > 0)
+      trace_send(c->tracer, &c->trace, len, received);
+
+   /* nothing waits before these bytes : the kernel takes what it can at once */
+   if(c->out_len == 0 && sent == 0)
+   {
+      memset(&msg, 0, sizeof(msg));
+      msg.msg_iov = (struct iovec *)iov;
+      msg.msg_iovlen = count;
+
+      /* a peer which has reset the connection gives EPIPE, not SIGPIPE */
+      if((n = sendmsg(c->sock, &msg, MSG_NOSIGNAL | MSG_DONTWAIT)) < 0)
+      {
+         /* the error of one client is its disconnection, not the end of the server */
+         if(errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+         {
+            c->broken = true;
+            return;
+         }
+         n = 0;
+      }
+   }
+
+   for(i = 0 ; i < count ; i++)
+   {
+      if((size_t)n >= iov[i].iov_len)
+      {
+         n -= iov[i].iov_len;
+         continue;
+      }
+      queueClient(c, (const char *)iov[i].iov_base + n, iov[i].iov_len - n);
+      n = 0;
+   }
+}
+
+
+/**
+ * @brief Queue bytes after the output of the client
+ * 
+ * @param c pointer on client
+ * @param data bytes
+ * @param len len of the bytes
+ * @note The buffer is counted in the budget of the client, a client which does not read pushes the server to its limit.
+ */
+static void queueClient(Client *c, const char *data, size_t len)
+{
+   size_t capacity = c->out_capacity;
+
+   if(len == 0)
+      return;
+
+   /* the bytes already sent are dropped before the buffer grows */
+   if(c->out_len + len > c->out_capacity && c->out_off > 0)
+   {
+      memmove(c->out, c->out + c->out_off, c->out_len - c->out_off);
+      c->out_len -= c->out_off;
+      c->out_off = 0;
+   }
+   if(c->out_len + len > c->out_capacity)
+   {
+      c->out_capacity = (c->out_len + len > 2 * c->out_capacity) ? c->out_len + len : 2 * c->out_capacity;
+      c->out = realloc(c->out, c->out_capacity);
+      budget_update(c->budget, capacity, c->out_capacity);
+   }
+   memcpy(c->out + c->out_len, data, len);
+   c->out_len += len;
+}
+
+
+/**
+ * @brief Send the output queued for the client, as much as the kernel takes
+ * 
+ * @param c pointer on client, its socket is writable
+ */
+static void flushClient(Client *c)
+{
+   ssize_t n;
+
+   while(c->out_off < c->out_len)
+   {
+      if((n = send(c->sock, c->out + c->out_off, c->out_len - c->out_off, MSG_NOSIGNAL | MSG_DONTWAIT)) < 0)
+      {
+         if(errno == EINTR)
+            continue;
+         if(errno != EAGAIN && errno != EWOULDBLOCK)
+            c->broken = true;
+         return;
+      }
+      c->out_off += n;
+   }
+
+   /* everything is sent : a client which is idle holds no buffer */
+   budget_release(c->budget, c->out_capacity);
+   free(c->out);
+   c->out = NULL;
+   c->out_off = 0;
+   c->out_len = 0;
+   c->out_capacity = 0;
+}
+
+
+/**
+ * @brief Remove the clients whose send has failed
+ * 
+ * @param client_list list of connected clients
+ * @param worker worker which handles the messages of the clients
+ * @param budget memory budget of the server
+ * @param capture capture of the traffic, NULL if disabled
+ */
+static void removeBroken(Connected *client_list, Worker *worker, Budget *budget, Capture *capture)
+{
+   ListNode *node, *next;
+   Client *c;
+
+   ilist_for_each_safe(node, next, client_list)
+   {
+      c = ilist_entry(node, Client, node);
+      if(c->broken)
+      {
+         printf("Client deconnexion.. Id client=%d (send failed)\n", c->id);
+         removeClient(client_list, c, worker, budget, capture);
+      }
+   }
+}
+
+
+/**
+ * @brief Accept the pending connections, at most ACCEPT_BUDGET
+ * 
+ * @param sock connection socket, non-blocking
+ * @param client_list list of connected clients
+ * @param worker worker which handles the messages of the clients
+ * @param budget memory budget of the server
+ * @param tracer tracer of the latencies, NULL if disabled
+ * @param capture capture of the traffic, NULL if disabled
+ * @param key key of the session tokens, NULL if the sessions are disabled
+ * @param opt options of the server
+ * @param id variable that stores the id which will be given to the next client
+ * @return int number of clients accepted
+ * @note A new client has a new id, nothing is spooled for it : the spooled messages go to a client which resumes its session.
+ */
+static int acceptClients(SOCKET sock, Connected *client_list, Worker *worker, Budget *budget, Tracer *tracer, Capture *capture, const SessionKey *key, const Options *opt, int *id)
+{
+   SOCKET client_sock;
+   Client *c;
+   int accepted = 0;
+   int tries;
+
+   /* the rest of the backlog is accepted at the next iteration, after the clients are read, or when the memory is back under the budget */
+   for(tries = 0 ; tries < ACCEPT_BUDGET && budget_stage(budget) == BUDGET_OK ; tries++)
+   {
+      if((client_sock = accept4(sock, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) == SOCKET_ERROR)
+      {
+         if(errno == ECONNABORTED || errno == EINTR)
+            continue;
+         /* EAGAIN : the backlog is empty */
+         if(errno != EAGAIN && errno != EWOULDBLOCK)
+            fprintf(stderr, "Error : accept4()\n");
+         break;
+      }
+
+      c = createClient(client_sock, *id, worker, budget, tracer, opt);
+      (*id)++;
+      ilist_push_front(client_list, &c->node);
+      accepted++;
+      printf("Client connexion.. Id client=%d\n", c->id);
+      capture_record(capture, CAPTURE_CONNECT, c->capture_id, bucket_now(), NULL, 0);
+
+      if(key != NULL)
+         sendSession(c, key);
+   }
+
+   return accepted;
+}
+
+
+/**
+ * @brief Send its id and its session token to a client : "#session id token"
+ * 
+ * @param c pointer on client
+ * @param key key of the session tokens
+ */
+static void sendSession(Client *c, const SessionKey *key)
+{
+   char token[SESSION_TOKEN_SIZE];
+   char buffer[BUF_SIZE];
+
+   session_token(key, c->id, token);
+   snprintf(buffer, BUF_SIZE, "#session %d %s\n", c->id, token);
+   writeClient(c, buffer);
+}
+
+
+/**
+ * @brief Send to a client the messages spooled while it was away
+ * 
+ * @param c pointer on client
+ * @param spool spool of disconnected clients, NULL if disabled
+ * @param budget memory budget of the server
+ */
+static void drainSpool(Client *c, Spool *spool, Budget *budget)
+{
+   size_t spooled;
+
+   if(spool == NULL || !spool_is_pending(spool, c->id))
+      return;
+
+   spooled = spool_memory(spool);
+   if(spool_drain(spool, c->id, spoolWriter, c) < 0)
+      c->broken = true;
+   budget_update(budget, spooled, spool_memory(spool));
+}
+
+
+/**
+ * @brief Writer of the spool : the messages are queued in the output of the client
+ * 
+ * @param iov vector of messages
+ * @param count number of iovec
+ * @param context client
+ * @return int 0 on success, -1 if the client is broken
+ */
+static int spoolWriter(const struct iovec *iov, int count, void *context)
+{
+   Client *c = context;
+
+   sendClientv(c, iov, count, 0, 0);
+
+   return c->broken ? -1 : 0;
+}
+
+
+/**
+ * @brief Resume a session : "#resume token", the client gets back the id of the token and its spooled messages
+ * 
+ * @param client_list list of connected clients
+ * @param c pointer on client, it has the new id given at its connection
+ * @param token token sent by the client
+ * @param key key of the session tokens
+ * @param worker worker which handles the messages of the clients
+ * @param spool spool of disconnected clients, NULL if disabled
+ * @param budget memory budget of the server
+ * @param capture capture of the traffic, NULL if disabled
+ * @return true if the session is resumed, false if the token is not valid
+ */
+static bool resumeClient(Connected *client_list, Client *c, const char *token, const SessionKey *key, Worker *worker, Spool *spool, Budget *budget, Capture *capture)
+{
+   ListNode *node;
+   Client *old;
+   int id = session_resume(key, token);
+
+   if(id < 0)
+      return false;
+
+   /* the old connection is half-open : it is closed by the loop when it reads its end, it does not get the replies anymore */
+   ilist_for_each(node, client_list)
+   {
+      old = ilist_entry(node, Client, node);
+      if(old != c && old->id == id)
+      {
+         shutdown(old->sock, SHUT_RDWR);
+         capture_record(capture, CAPTURE_DISCONNECT, old->capture_id, bucket_now(), NULL, 0);
+         old->id = -1;
+      }
+   }
+
+   /* the replies of the handlers carry the id of the strand */
+   worker_strand_close(worker, c->strand);
+   c->strand = worker_strand(worker, id, c->cpu);
+   printf("Client resumed.. Id client=%d (was %d)\n", id, c->id);
+   c->id = id;
+
+   sendSession(c, key);
+   drainSpool(c, spool, budget);
+
+   return true;
+}
+
+
+/**
+ * @brief Find a client by its id, among the connections and their streams
+ * 
+ * @param client_list list of connected clients
+ * @param id id of client
+ * @return Client* pointer on client, NULL if it is not connected
+ */
+static Client *findClient(Connected *client_list, int id)
+{
+   ListNode *node, *s;
+   Client *c;
+
+   ilist_for_each(node, client_list)
+   {
+      c = ilist_entry(node, Client, node);
+      if(c->id == id)
+         return c;
+
+      if(c->streams != NULL)
+      {
+         ilist_for_each(s, c->streams)
+         {
+            if(ilist_entry(s, Client, node)->id == id)
+               return ilist_entry(s, Client, node);
+         }
+      }
+   }
+
+   return NULL;
+}
+
+
+/**
+ * @brief Multiplex the connection of a client : "#mux", the bytes which follow are frames in both directions
+ * 
+ * @param c pointer on client
+ * @note The stream 0 is the client itself, each other stream opened by the client is a new client which gets "#stream id".
+ */
+static void muxClient(Client *c)
+{
+   int one = 1;
+
+   /* a small frame must not wait behind the ACK of a large one, mux_output already batches the frames */
+   setsockopt(c->sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+   c->mux = mux_create(MUX_WINDOW);
+   c->streams = ilist_create();
+   writeClient(c, "#mux\n");
+   printf("Client multiplexed.. Id client=%d\n", c->id);
+}
+
+
+/**
+ * @brief Send the frames of a multiplexed connection which its credits allow, while its socket takes them
+ * 
+ * @param c pointer on client, multiplexed
+ */
+static void flushStreams(Client *c)
+{
+   char frames[MUX_HEADER + MUX_FRAME_MAX];
+   size_t n;
+
+   /* while the output of the connection waits for the socket, the frames wait in the mux where the credits bound them */
+   while(c->out_len == 0 && !c->broken && (n = mux_output(c->mux, frames, sizeof(frames))) > 0)
+      sendClient(c, frames, n);
+}
+
+
+/**
+ * @brief Read the frames of a multiplexed connection, the messages of its streams are submitted to the worker
+ * 
+ * @param c pointer on client, multiplexed
+ * @param data bytes read
+ * @param len len of the bytes
+ * @param demux context of the frames : worker, budget, journal and ids
+ * @return int 0 on success, -1 if the client breaks the protocol
+ */
+static int readStreams(Client *c, const char *data, size_t len, Demux *demux)
+{
+   size_t held = mux_held(c->mux);
+   int status = mux_input(c->mux, data, len, handleStream, demux);
+
+   /* the credits given back, and the frames which were waiting for the credits of the client */
+   flushStreams(c);
+   budget_update(demux->budget, held, mux_held(c->mux));
+
+   return status;
+}
+
+
+/**
+ * @brief Handle a frame of a stream : the first frame of a stream opens its client, the end of the stream closes it
+ * 
+ * @param stream stream of the frame
+ * @param data message, NULL when the stream is closed
+ * @param len len of the message
+ * @param context context of the frames (Demux)
+ */
+static void handleStream(uint32_t stream, const char *data, size_t len, void *context)
+{
+   Demux *d = context;
+   Client *c = d->carrier;
+   ListNode *node;
+   char buffer[BUF_SIZE];
+
+   if(stream != 0)
+   {
+      ilist_for_each(node, d->carrier->streams)
+      {
+         if(ilist_entry(node, Client, node)->stream == stream)
+            break;
+      }
+
+      if(node != &d->carrier->streams->sentinel)
+      {
+         c = ilist_entry(node, Client, node);
+      }
+      else if(data != NULL)
+      {
+         c = createStream(d->carrier, stream, *d->id, d->worker, d->budget);
+         (*d->id)++;
+         ilist_push_front(d->carrier->streams, &c->node);
+         printf("Stream opened.. Id client=%d (stream %u of %d)\n", c->id, stream, d->carrier->id);
+         snprintf(buffer, BUF_SIZE, "#stream %d\n", c->id);
+         mux_write(d->carrier->mux, stream, buffer, strlen(buffer));
+      }
+      else
+      {
+         return;
+      }
+   }
+
+   if(data == NULL)
+   {
+      if(c != d->carrier)
+      {
+         printf("Stream closed.. Id client=%d\n", c->id);
+         removeClient(d->carrier->streams, c, d->worker, d->budget, NULL);
+      }
+      return;
+   }
+
+   printf("[%d] : %.*s", c->id, (int)len, data);
+   if(d->journal != NULL)
+      journal_append(d->journal, data, len);
+   worker_submit(d->worker, c->strand, data, len, d->stamp);
+
+   /* the message is held by the worker now, counted in the budget : the client can send more */
+   mux_consumed(d->carrier->mux, stream, len);
+}
+
+
+/**
+ * @brief Send a message on a stream, or on the stream 0 of a multiplexed connection
+ * 
+ * @param c pointer on client, a stream or a multiplexed connection
+ * @param data message
+ * @param len len of the message
+ * @param budget memory budget of the server, the data waiting for credits is counted in it
+ */
+static void sendStream(Client *c, const char *data, size_t len, Budget *budget)
+{
+   Client *carrier = (c->carrier != NULL) ? c->carrier : c;
+   size_t held = mux_held(carrier->mux);
+
+   mux_write(carrier->mux, c->stream, data, len);
+   flushStreams(carrier);
+   budget_update(budget, held, mux_held(carrier->mux));
+}
+
+
+/**
+ * @brief The client calls methods : "#rpc", the bytes which follow are lines, a call or a message by line
+ * 
+ * @param c pointer on client
+ * @param budget memory budget of the server, the table of the calls is counted in it
+ */
+static void rpcClient(Client *c, Budget *budget)
+{
+   int one = 1;
+
+   /* the returns are small and each one is waited for */
+   setsockopt(c->sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+   c->calls = rpc_create(RPC_INFLIGHT);
+   c->line = malloc(BUF_SIZE);
+   c->line_len = 0;
+   budget_charge(budget, rpc_memory(c->calls) + BUF_SIZE);
+   printf("Client calls.. Id client=%d\n", c->id);
+}
+
+
+/**
+ * @brief Cut the bytes read from a client which calls methods in lines, a line cut is kept until its end
+ * 
+ * @param c pointer on client
+ * @param data bytes read
+ * @param len len of the bytes
+ * @param worker worker which handles the messages of the clients
+ * @param journal journal of the messages, NULL if disabled
+ * @param stamp time of the read
+ */
+static void readCalls(Client *c, const char *data, size_t len, Worker *worker, Journal *journal, int64_t stamp)
+{
+   const char *eol;
+   size_t n;
+
+   while((eol = memchr(data, '\n', len)) != NULL)
+   {
+      n = eol + 1 - data;
+      if(c->line_len == 0)
+      {
+         /* the whole line is in the read, no copy */
+         handleLine(c, data, n, worker, journal, stamp);
+      }
+      else if(c->line_len + n < BUF_SIZE)
+      {
+         memcpy(c->line + c->line_len, data, n);
+         handleLine(c, c->line, c->line_len + n, worker, journal, stamp);
+      }
+      else
+      {
+         writeClient(c, "#error line\n");
+      }
+      c->line_len = 0;
+      data += n;
+      len -= n;
+   }
+
+   /* a line longer than BUF_SIZE is dropped */
+   if(c->line_len + len < BUF_SIZE)
+      memcpy(c->line + c->line_len, data, len);
+   c->line_len += len;
+}
+
+
+/**
+ * @brief Handle a line of a client which calls methods : a call enters the table of the client and goes to the worker, as a message
+ * 
+ * @param c pointer on client
+ * @param line line, ended by '\n'
+ * @param len len of the line
+ * @param worker worker which handles the messages of the clients
+ * @param journal journal of the messages, NULL if disabled
+ * @param stamp time of the read
+ */
+static void handleLine(Client *c, const char *line, size_t len, Worker *worker, Journal *journal, int64_t stamp)
+{
+   char buffer[BUF_SIZE];
+   char text[BUF_SIZE]; //the line terminated by 0, sscanf reads until the 0
+   int64_t now = bucket_now();
+   uint64_t call = 0;
+   int timeout;
+
+   /* the line is not terminated, it is in the read or in c->line */
+   memcpy(text, line, (len < BUF_SIZE) ? len : BUF_SIZE - 1);
+   text[(len < BUF_SIZE) ? len : BUF_SIZE - 1] = 0;
+
+   if(strncmp(text, "#call ", 6) == 0)
+   {
+      /* the deadline is counted from the reception, the clocks of the client and of the server differ */
+      if(sscanf(text, "#call %" SCNu64 " %*s %d", &call, &timeout) != 2 || rpc_insert(c->calls, call, now, (timeout > 0) ? now + timeout * 1000000LL : 0) < 0)
+      {
+         snprintf(buffer, BUF_SIZE, "#ret %" PRIu64 " error busy\n", call);
+         writeClient(c, buffer);
+         return;
+      }
+   }
+   else if(strncmp(text, "#cancel ", 8) == 0)
+   {
+      /* the handler may still run, its return is dropped */
+      if(sscanf(text, "#cancel %" SCNu64, &call) == 1 && rpc_remove(c->calls, call, NULL))
+      {
+         snprintf(buffer, BUF_SIZE, "#ret %" PRIu64 " cancelled\n", call);
+         writeClient(c, buffer);
+      }
+      return;
+   }
+
+   printf("[%d] : %s", c->id, text);
+   if(journal != NULL)
+      journal_append(journal, line, len);
+   worker_submit(worker, c->strand, line, len, stamp);
+}
+
+
+/**
+ * @brief Answer "timeout" to a call expired, its return will be dropped
+ * 
+ * @param call call expired
+ * @param context client of the call
+ */
+static void expireCall(const RpcCall *call, void *context)
+{
+   char buffer[BUF_SIZE];
+
+   snprintf(buffer, BUF_SIZE, "#ret %" PRIu64 " timeout\n", call->id);
+   writeClient(context, buffer);
+}
+
+
+/**
+ * @brief Handler of the calls : "#call id method timeout args" is dispatched to its method, the other messages to the handler of the server
+ * 
+ * @param from id of the client which sends the message
+ * @param data message received
+ * @param len len of the message
+ * @param reply variable that stores the return "#ret id status result"
+ * @param context options of the server
+ * @return true if there is a reply
+ */
+static bool handleCall(int from, const char *data, size_t len, Reply *reply, void *context)
+{
+   const Options *opt = context;
+   char buffer[BUF_SIZE];
+   char method[RPC_METHOD_SIZE];
+   char result[BUF_SIZE];
+   uint64_t call;
+   int skip = -1, i;
+   int delay = 0; //milliseconds before the return is sent
+   bool ok = false;
+
+   if(len < 6 || strncmp(data, "#call ", 6) != 0)
+      return opt->handler(from, data, len, reply, NULL);
+
+   /* data is not terminated */
+   len = (len < BUF_SIZE) ? len : BUF_SIZE - 1;
+   memcpy(buffer, data, len);
+   buffer[len] = 0;
+   buffer[strcspn(buffer, "\n")] = 0;
+
+   if(sscanf(buffer, "#call %" SCNu64 " %31s %*d %n", &call, method, &skip) != 2)
+      return false;
+
+   for(i = 0 ; i < (int)(sizeof(methods) / sizeof(methods[0])) && strcmp(methods[i].name, method) != 0 ; i++);
+   if(i < (int)(sizeof(methods) / sizeof(methods[0])))
+      ok = methods[i].f((skip >= 0) ? buffer + skip : "", result, BUF_SIZE, &delay);
+   else
+      snprintf(result, BUF_SIZE, "unknown method %s", method);
+
+   /* the event loop keeps the return until its time, the thread of the pool goes on with the next message */
+   if(delay > 0)
+      reply->due = bucket_now() + delay * 1000000LL;
+   reply->to = from;
+   reply->data = malloc(BUF_SIZE + 64);
+   reply->len = snprintf(reply->data, BUF_SIZE + 64, "#ret %" PRIu64 " %s %s\n", call, ok ? "ok" : "error", result);
+
+   return true;
+}
+
+
+/**
+ * @brief Method "echo" : the arguments are returned
+ * 
+ * @param args arguments
+ * @param result variable that stores the result
+ * @param len size of the result
+ * @param delay unused
+ * @return true
+ */
+static bool methodEcho(const char *args, char *result, size_t len, int *delay)
+{
+   (void)delay;
+
+   snprintf(result, len, "%s", args);
+
+   return true;
+}
+
+
+/**
+ * @brief Method "sum" : the sum of the integers of the arguments
+ * 
+ * @param args arguments, integers separated by spaces
+ * @param result variable that stores the sum
+ * @param len size of the result
+ * @param delay unused
+ * @return true on success, false if an argument is not an integer
+ */
+static bool methodSum(const char *args, char *result, size_t len, int *delay)
+{
+   long long sum = 0;
+   char *end;
+
+   (void)delay;
+
+   while(*args != 0)
+   {
+      sum += strtoll(args, &end, 10);
+      if(end == args)
+      {
+         snprintf(result, len, "not an integer : %s", args);
+         return false;
+      }
+      for(args = end ; *args == ' ' ; args++);
+   }
+   snprintf(result, len, "%lld", sum);
+
+   return true;
+}
+
+
+/**
+ * @brief Method "sleep" : the return comes after a delay, to try the deadlines
+ * 
+ * @param args milliseconds to wait
+ * @param result variable that stores the delay
+ * @param len size of the result
+ * @param delay variable that stores the delay of the return
+ * @return true
+ * @note Nothing sleeps : the return is kept by the event loop until its time, the strands of the thread go on.
+ */
+static bool methodSleep(const char *args, char *result, size_t len, int *delay)
+{
+   int ms = atoi(args);
+
+   *delay = (ms > 0) ? ms : 0;
+   snprintf(result, len, "%d", ms);
+
+   return true;
+}
+
+
+/**
+ * @brief Handler "forward" : a message "@id text" is sent to the client id
+ * 
+ * @param from id of the client which sends the message
+ * @param data message received
+ * @param len len of the message
+ * @param reply variable that stores the message "[from] : text"
+ * @param context unused
+ * @return true if the message is for a client
+ */
+static bool handleForward(int from, const char *data, size_t len, Reply *reply, void *context)
+{
+   char buffer[BUF_SIZE];
+   int to, skip;
+
+   (void)context;
+
+   /* data is not terminated */
+   len = (len < BUF_SIZE) ? len : BUF_SIZE - 1;
+   memcpy(buffer, data, len);
+   buffer[len] = 0;
+
+   if(sscanf(buffer, "@%d %n", &to, &skip) != 1 || to < 0)
+      return false;
+
+   reply->to = to;
+   reply->data = malloc(len + 16);
+   reply->len = snprintf(reply->data, len + 16, "[%d] : %s", from, buffer + skip);
+
+   return true;
+}
+
+
+/**
+ * @brief Handler "echo" : the message is sent back to the client
+ * 
+ * @param from id of the client which sends the message
+ * @param data message received
+ * @param len len of the message
+ * @param reply variable that stores the message
+ * @param context unused
+ * @return true
+ */
+static bool handleEcho(int from, const char *data, size_t len, Reply *reply, void *context)
+{
+   (void)context;
+
+   reply->to = from;
+   reply->len = len;
+   reply->data = malloc(len + 1);
+   memcpy(reply->data, data, len);
+   reply->data[len] = 0;
+
+   return true;
+}
+
+
+/**
+ * @brief Send the replies of the worker to the clients, or to their spool if they are disconnected
+ * 
+ * @param worker worker which handles the messages of the clients
+ * @param deferred heap of the replies kept until their time, by due
+ * @param client_list list of connected clients
+ * @param spool spool of disconnected clients, NULL if disabled
+ * @param budget memory budget of the server, replies of lowest priority are dropped when it sheds
+ * @param next_id id which will be given to the next client
+ * @return int number of replies dropped
+ * @note A reply with a due is kept in deferred and counted in the budget, it is sent by the first call past its time.
+ */
+static int deliverReplies(Worker *worker, Heap *deferred, Connected *client_list, Spool *spool, Budget *budget, int next_id)
+{
+   Reply replies[REPLY_BATCH];
+   Reply *r;
+   int64_t now = bucket_now();
+   int count, i;
+   int dropped = 0;
+   bool shed;
+
+   while((count = worker_replies(worker, replies, REPLY_BATCH)) > 0)
+   {
+      /* lowest priority : the messages of the clients away, and of the clients which do not read their output */
+      shed = budget_stage(budget) >= BUDGET_SHEDDING;
+
+      for(i = 0 ; i < count ; i++)
+      {
+         if(replies[i].due > now)
+         {
+            r = malloc(sizeof(Reply));
+            *r = replies[i];
+            budget_charge(budget, sizeof(Reply) + r->len);
+            heap_push(deferred, r);
+            continue;
+         }
+         if(!deliverReply(&replies[i], client_list, spool, budget, next_id, shed))
+            dropped++;
+         free(replies[i].data);
+      }
+   }
+
+   /* the replies whose time has come */
+   shed = budget_stage(budget) >= BUDGET_SHEDDING;
+   while(!heap_empty(deferred) && ((Reply *)heap_top(deferred))->due <= now)
+   {
+      r = heap_pop(deferred);
+      budget_release(budget, sizeof(Reply) + r->len);
+      if(!deliverReply(r, client_list, spool, budget, next_id, shed))
+         dropped++;
+      free(r->data);
+      free(r);
+   }
+
+   return dropped;
+}
+
+
+/**
+ * @brief Give the time before the next reply kept by deliverReplies, for the timeout of the event loop
+ * 
+ * @param deferred heap of the replies kept until their time, by due
+ * @param now current time in nanoseconds
+ * @return int milliseconds to wait, rounded up, 0 if a reply is due, -1 if no reply is kept
+ */
+static int deferredTimeout(Heap *deferred, int64_t now)
+{
+   int64_t due;
+
+   if(heap_empty(deferred))
+      return -1;
+   if((due = ((Reply *)heap_top(deferred))->due) <= now)
+      return 0;
+
+   return (due - now + 999999) / 1000000;
+}
+
+
+/**
+ * @brief Order of the replies kept by deliverReplies : the first due comes out first
+ * 
+ * @param a first reply
+ * @param b second reply
+ * @return int < 0 if a is due before b, 0 if they are due at the same time, > 0 otherwise
+ */
+static int compareDue(const void *a, const void *b)
+{
+   const Reply *x = a, *y = b;
+
+   return (x->due > y->due) - (x->due < y->due);
+}
+
+
+/**
+ * @brief Send a reply of the worker to its client, or to its spool if it is disconnected, nothing waits for the socket
+ * 
+ * @param r reply, its data is set to NULL when it is kept until the kernel has sent its pages
+ * @param client_list list of connected clients
+ * @param spool spool of disconnected clients, NULL if disabled
+ * @param budget memory budget of the server
+ * @param next_id id which will be given to the next client
+ * @param shed true if the replies of lowest priority are dropped
+ * @return false if the reply is dropped to stay in the memory budget
+ */
+static bool deliverReply(Reply *r, Connected *client_list, Spool *spool, Budget *budget, int next_id, bool shed)
+{
+   struct iovec iov = { r->data, r->len };
+   Client *c;
+   size_t held, sent = 0;
+
+   if(r->to < 0 || r->to >= next_id)
+      return true;
+
+   if((c = findClient(client_list, r->to)) == NULL)
+   {
+      if(spool == NULL)
+         return true;
+      if(shed)
+         return false;
+
+      /* the client will get it when it comes back */
+      held = spool_memory(spool);
+      if(spool_push(spool, r->to, r->data, r->len) < 0)
+         fprintf(stderr, "Error : spool_push()\n");
+      budget_update(budget, held, spool_memory(spool));
+      return true;
+   }
+
+   /* the return of a call expired or cancelled is late, the client has its answer */
+   if(c->calls != NULL && strncmp(r->data, "#ret ", 5) == 0 && !rpc_remove(c->calls, strtoull(r->data + 5, NULL, 10), NULL))
+      return true;
+
+   /* the client does not read what it has already */
+   if(shed && (c->zc.held > 0 || c->out_len > 0))
+      return false;
+
+   /* framed, the stream waits for the credits of the client */
+   if(c->carrier != NULL || c->mux != NULL)
+   {
+      sendStream(c, r->data, r->len, budget);
+      return true;
+   }
+
+   /* a large message is kept until the kernel has sent its pages, it can not pass the output queued before it */
+   held = c->zc.held;
+   if(c->out_len == 0 && zerocopy_send(&c->zc, c->sock, r->data, r->len, &sent))
+   {
+      budget_update(budget, held, c->zc.held);
+      sendClientv(c, &iov, 1, sent, r->stamp);
+      r->data = NULL;
+      return true;
+   }
+
+   /* the rest is copied in the output of the client */
+   sendClientv(c, &iov, 1, 0, r->stamp);
+   return true;
+}
+
+
+/**
+ * @brief Server application
+ * 
+ * @param opt options of the server
+ */
+static void appS(const Options *opt)
+{
+   SOCKET sock = INVALID_SOCKET;
+   SOCKET handoff_sock = INVALID_SOCKET; //UNIX socket on which a new server takes over
+   SOCKET new_sock; //connection of the new server
+   Watched watched = { NULL, 0, 0 }; //sockets watched by poll, any number of them
+   struct timespec timeout; //poll timeout, used by the group commit of the journal
+   Journal *journal = NULL;
+   Spool *spool = NULL;
+   Budget *budget = budget_create(opt->memory); //bytes held in the buffers of the server
+   Worker *worker = worker_create(opt->threads, opt->numa, budget, handleCall, (void *)opt);
+   Tracer *tracer = opt->trace ? trace_create() : NULL;
+   Capture *capture = NULL;
+   SessionKey session; //key of the session tokens, handed off with the clients
+   const SessionKey *key = NULL; //NULL if the sessions are disabled
+   Connected *client_list = ilist_create();
+   Heap *deferred = heap_create(compareDue); //replies kept until their time, by due
+   Reply *r;
+   ListNode *node, *next; //follow element in client list, next is kept when node is removed
+   ListNode *resume; //first client ready but not read in the iteration, the next iteration starts with it
+   Client *c;
+   Demux demux; //context of the frames of a multiplexed client
+
+   int connection = 1; //keep the application alive
+   bool taken_over; //the sockets, the ids and the session key come from an old server
+   char buffer[BUF_SIZE];
+   int id = 0; //id of client
+   int n; //len of the message read
+   int skip; //len of the control message at the start of a read
+   int wait; //milliseconds before the next timer, -1 if none
+   int delay; //milliseconds before a throttled client can be read
+   int served; //clients read in the iteration
+   short events; //events of the socket of a client
+   int64_t now; //time of the iteration, in nanoseconds
+   int64_t stamp; //time of the read of a message, when it is traced
+   int ready = 1; //sockets ready at the last poll
+   long usec; //timeout of poll in microseconds, -1 to block
+   long busy; //timeout of the busy-poll loop, in microseconds
+   long backoff = 0; //last sleep of the busy-poll loop, in microseconds
+   int64_t last_event = 0; //time of the last event of the busy-poll loop
+   BudgetStage stage; //response to the memory held in the iteration
+   BudgetStage last_stage = BUDGET_OK; //stage of the last iteration, a change is printed
+   size_t held; //bytes held for a client
+   long shed = 0; //messages dropped to stay in the memory budget
+
+   /* a running server hands off its sockets, else a new connection socket is opened */
+   if(opt->handoff_path != NULL)
+      sock = takeOver(opt->handoff_path, client_list, deferred, worker, budget, tracer, opt, &session, &id);
+   taken_over = (sock != INVALID_SOCKET);
+   if(sock == INVALID_SOCKET)
+   {
+      sock = initConnection();
+      if(session_key(&session) < 0)
+         exit(EXIT_FAILURE_SESSION);
+   }
+   if(opt->sessions)
+      key = &session;
+
+   /* a client which resets its connection must not kill the server, the sends see EPIPE */
+   signal(SIGPIPE, SIG_IGN);
+
+   /* the backlog is drained by acceptClients until EAGAIN */
+   fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) | O_NONBLOCK);
+
+   /* a core is burnt to save the wakeup latency */
+   if(opt->cpu >= 0)
+   {
+      pinLoop(opt->cpu);
+      busyPollSocket(sock);
+   }
+
+   if(opt->handoff_path != NULL)
+   {
+      if((handoff_sock = handoff_listen(opt->handoff_path)) == INVALID_SOCKET)
+      {
+         fprintf(stderr, "Error : handoff_listen()\n");
+         exit(EXIT_FAILURE_HANDOFF);
+      }
+   }
+
+   /* opened after the takeover, the old server has closed them */
+   if(opt->spool_dir != NULL)
+   {
+      spool = spool_create(opt->spool_dir, SPOOL_MEMORY, SPOOL_RECIPIENT_MEMORY, SPOOL_FILE_LIMIT, SPOOL_TTL);
+
+      /* a new server has a new session key and gives the ids again from 0 : the spill files of the last one can not be resumed */
+      if(!taken_over)
+         spool_clear(spool);
+   }
+
+   if(opt->journal_dir != NULL && (journal = journal_open(opt->journal_dir, JOURNAL_SEGMENT_SIZE, JOURNAL_COMMIT_BYTES, JOURNAL_COMMIT_MS)) == NULL)
+   {
+      fprintf(stderr, "Error : journal_open()\n");
+      exit(EXIT_FAILURE_JOURNAL);
+   }
+
+   if(opt->capture_path != NULL && (capture = capture_open(opt->capture_path)) == NULL)
+   {
+      fprintf(stderr, "Error : capture_open()\n");
+      exit(EXIT_FAILURE_CAPTURE);
+   }
+
+   while(connection)
+   {
+      watched.count = 0;
+
+      if((stage = budget_stage(budget)) != last_stage)
+         printf("Memory stage.. %d, bytes held=%zu\n", stage, budget_held(budget));
+
+      /* over the memory limit, the connections which hold the most are closed */
+      if(stage == BUDGET_EVICTING)
+      {
+         shed += evictClients(client_list, worker, budget, capture);
+         stage = budget_stage(budget);
+      }
+      last_stage = stage;
+
+      /* add STDIN_FILENO */
+      watchSocket(&watched, STDIN_FILENO, POLLIN);
+
+      /* add the connection socket to see new connection, a new client waits in the backlog while the reads are paused */
+      watchSocket(&watched, (stage == BUDGET_OK) ? sock : INVALID_SOCKET, POLLIN);
+
+      /* add the handoff socket to see a new server */
+      watchSocket(&watched, handoff_sock, POLLIN);
+
+      /* add the worker to see the replies of the handlers */
+      watchSocket(&watched, worker_fd(worker), POLLIN);
+
+      wait = (journal != NULL) ? journal_timeout(journal) : -1;
+
+      /* add the clients socket to see new message of clients, a throttled client is left in the kernel until it has tokens */
+      now = bucket_now();
+      ilist_for_each(node, client_list)
+      { 
+         c = ilist_entry(node, Client, node);
+         delay = throttleClient(c, now);
+
+         /* TCP pushes back on a paused client, the memory is checked again after BUDGET_RETRY_MS */
+         held = clientMemory(c);
+         if((stage != BUDGET_OK && held > sizeof(Client)) || (opt->client_memory > 0 && held > opt->client_memory))
+            delay = (delay > BUDGET_RETRY_MS) ? delay : BUDGET_RETRY_MS;
+
+         if(delay != 0 && (wait < 0 || delay < wait))
+            wait = delay;
+
+         /* the output queued is sent when the socket is writable, even for a client paused, a client which does not read its replies is not read */
+         events = (delay == 0 && c->out_len - c->out_off <= OUTPUT_PAUSE) ? POLLIN : 0;
+         events |= (c->out_len > 0) ? POLLOUT : 0;
+         c->slot = (events != 0) ? watchSocket(&watched, c->sock, events) : -1;
+
+         /* deadline of the calls in flight */
+         if(c->calls != NULL && (delay = rpc_timeout(c->calls, now)) >= 0 && (wait < 0 || delay < wait))
+            wait = delay;
+      }
+
+      /* the replies kept until their time */
+      if((delay = deferredTimeout(deferred, now)) >= 0 && (wait < 0 || delay < wait))
+         wait = delay;
+      usec = (wait < 0) ? -1 : wait * 1000L;
+      if(opt->cpu >= 0)
+      {
+         /* busy-poll : poll does not block while the loop spins */
+         busy = busyTimeout(ready, bucket_now(), &last_event, &backoff);
+         usec = (usec < 0 || busy < usec) ? busy : usec;
+      }
+      timeout.tv_sec = usec / 1000000;
+      timeout.tv_nsec = (usec % 1000000) * 1000;
+
+      /* ppoll : the busy-poll loop sleeps microseconds, poll counts in milliseconds */
+      if((ready = ppoll(watched.fds, watched.count, (usec < 0) ? NULL : &timeout, NULL)) == -1)
+      {
+         if(errno != EINTR)
+         {
+            fprintf(stderr, "Error : ppoll()\n");
+            exit(EXIT_FAILURE_POLL);
+         }
+         ready = 0;
+      }
+
+      /* group commit of the messages journaled since the last flush */
+      if(journal != NULL)
+         journal_tick(journal);
+
+      if(readyEvents(&watched, SLOT_STDIN)) /* something from standard input : i.e keyboard -> leave */
+      {
+         /* stop process when type on keyboard */
+         connection = 0;
+         break;
+      }
+      else if(readyEvents(&watched, SLOT_HANDOFF)) /* a new server takes over */
+      {
+         /* the sockets and the session key are only given to a process of the same user, this server goes on else */
+         if((new_sock = handoff_accept(handoff_sock)) == INVALID_SOCKET)
+         {
+            fprintf(stderr, "Error : handoff_accept()\n");
+         }
+         else
+         {
+            /* the messages read are handled and delivered by this server */
+            worker_wait(worker);
+            shed += deliverReplies(worker, deferred, client_list, spool, budget, id);
+            awaitCompletions(client_list, tracer, budget);
+
+            /* the new server opens the journal and the spool after the handoff */
+            if(journal != NULL)
+               journal_close(journal);
+            if(spool != NULL)
+            {
+               budget_release(budget, spool_memory(spool));
+               spool_delete(spool);
+            }
+            journal = NULL;
+            spool = NULL;
+
+            if(handOff(new_sock, sock, client_list, deferred, budget, &session, id) == 0)
+            {
+               /* the messages not completed are still read by the kernel, their memory must not be reused */
+               ilist_for_each(node, client_list)
+               {
+                  c = ilist_entry(node, Client, node);
+                  budget_release(budget, c->zc.held);
+                  zerocopy_detach(&c->zc);
+               }
+
+               /* closing our copy of the sockets does not close them in the new server */
+               connection = 0;
+               break;
+            }
+
+            if(opt->spool_dir != NULL)
+               spool = spool_create(opt->spool_dir, SPOOL_MEMORY, SPOOL_RECIPIENT_MEMORY, SPOOL_FILE_LIMIT, SPOOL_TTL);
+            if(opt->journal_dir != NULL && (journal = journal_open(opt->journal_dir, JOURNAL_SEGMENT_SIZE, JOURNAL_COMMIT_BYTES, JOURNAL_COMMIT_MS)) == NULL)
+            {
+               fprintf(stderr, "Error : journal_open()\n");
+               exit(EXIT_FAILURE_JOURNAL);
+            }
+         }
+      }
+
+      /* messages of the clients, one read by client, at most READ_BUDGET clients */
+      now = bucket_now();
+      served = 0;
+      resume = NULL;
+      ilist_for_each_safe(node, next, client_list)
+      { 
+         c = ilist_entry(node, Client, node);
+
+         /* the calls past their deadline get "timeout", read or not */
+         if(c->calls != NULL)
+            rpc_expire(c->calls, now, expireCall, c);
+
+         /* the output which the kernel refused, an error or a hang up is seen by the send */
+         events = readyEvents(&watched, c->slot);
+         if(c->out_len > 0 && (events & (POLLOUT | POLLERR | POLLHUP)))
+         {
+            flushClient(c);
+
+            /* the frames which were waiting for the socket */
+            if(c->mux != NULL)
+            {
+               held = mux_held(c->mux);
+               flushStreams(c);
+               budget_update(budget, held, mux_held(c->mux));
+            }
+         }
+
+         /* an error or a hang up is seen by the read, a paused client is not read */
+         if(c->slot < 0 || !(watched.fds[c->slot].events & POLLIN))
+            events = 0;
+
+         /* round robin : the clients not read are the first ones of the next iteration, their timers and completions are still handled */
+         if(events && resume == NULL && served == READ_BUDGET)
+            resume = node;
+         if(resume != NULL)
+            events = 0;
+
+         /* its completions are still read to free its messages */
+         if(!events && c->zc.held > 0)
+            readErrors(c, tracer, budget);
+
+         if(events)
+         {
+            served++;
+
+            /* the TX timestamps and the zerocopy completions make the socket readable too */
+            readErrors(c, tracer, budget);
+
+            if((n = readClient(c->sock, buffer, BUF_SIZE, tracer, &stamp)) == 0)
+            {
+               /* O(1) removal, the loop goes on with the next client */
+               printf("Client deconnexion.. Id client=%d\n", c->id);
+               removeClient(client_list, c, worker, budget, capture);
+            }
+            else if(n > 0)
+            {
+               bucket_take(&c->messages, 1, now);
+               bucket_take(&c->bytes, n, now);
+               /* a connection keeps its id in the capture after a resume : the replay sends its bytes on the same connection */
+               capture_record(capture, CAPTURE_MESSAGE, c->capture_id, bucket_now(), buffer, n);
+
+               /* a session resumed, its messages may follow in the same read */
+               skip = 0;
+               if(key != NULL && strncmp(buffer, "#resume ", 8) == 0)
+               {
+                  if(!resumeClient(client_list, c, buffer + 8, key, worker, spool, budget, capture))
+                     writeClient(c, "#error resume\n");
+                  skip = strcspn(buffer, "\n");
+                  skip += (buffer[skip] == '\n');
+               }
+
+               /* the connection is multiplexed, the rest of the read is frames */
+               if(c->mux == NULL && strncmp(buffer + skip, "#mux\n", 5) == 0)
+               {
+                  muxClient(c);
+                  skip += 5;
+               }
+
+               /* the client calls methods, the rest of the read is lines */
+               if(c->calls == NULL && c->mux == NULL && strncmp(buffer + skip, "#rpc\n", 5) == 0)
+               {
+                  rpcClient(c, budget);
+                  skip += 5;
+               }
+
+               if(c->calls != NULL)
+               {
+                  if(n > skip)
+                     readCalls(c, buffer + skip, n - skip, worker, journal, stamp);
+               }
+               else if(c->mux != NULL)
+               {
+                  demux.carrier = c;
+                  demux.worker = worker;
+                  demux.budget = budget;
+                  demux.journal = journal;
+                  demux.id = &id;
+                  demux.stamp = stamp;
+                  if(n > skip && readStreams(c, buffer + skip, n - skip, &demux) < 0)
+                  {
+                     printf("Client deconnexion.. Id client=%d (bad frame)\n", c->id);
+                     removeClient(client_list, c, worker, budget, capture);
+                  }
+               }
+               else if(n > skip)
+               {
+                  printf("[%d] : %s", c->id, buffer + skip);
+                  if(journal != NULL)
+                     journal_append(journal, buffer + skip, n - skip);
+                  worker_submit(worker, c->strand, buffer + skip, n - skip, stamp);
+               }
+            }
+         }
+      }
+
+      if(resume != NULL)
+         ilist_rotate(client_list, resume);
+
+      /* results of the handlers, the worker may have replied since poll returned */
+      shed += deliverReplies(worker, deferred, client_list, spool, budget, id);
+
+      /* the messages of the clients which have not come back in time */
+      if(spool != NULL)
+      {
+         held = spool_memory(spool);
+         spool_expire(spool);
+         budget_update(budget, held, spool_memory(spool));
+      }
+
+      /* new clients, in the same iteration as the messages so a storm of connections does not starve the clients */
+      if(readyEvents(&watched, SLOT_SOCK))
+         acceptClients(sock, client_list, worker, budget, tracer, capture, key, opt, &id);
+
+      /* the clients whose send has failed in the iteration, the new ones included */
+      removeBroken(client_list, worker, budget, capture);
+   }
+   
+   ilist_for_each_safe(node, next, client_list)
+   { 
+      c = ilist_entry(node, Client, node);
+      removeClient(client_list, c, worker, budget, capture);
+   }
+   worker_delete(worker);
+   while(!heap_empty(deferred))
+   {
+      r = heap_pop(deferred);
+      budget_release(budget, sizeof(Reply) + r->len);
+      free(r->data);
+      free(r);
+   }
+   heap_delete(deferred);
+   if(shed > 0)
+      printf("Messages shed.. %ld\n", shed);
+   if(capture != NULL)
+      capture_close(capture);
+   if(tracer != NULL)
+   {
+      trace_print(tracer);
+      trace_delete(tracer);
    }
-   list_delete(client_list);
-   listIterator_delete(iterator_client_list);
+   ilist_delete(client_list);
+   if(journal != NULL)
+      journal_close(journal);
+   if(spool != NULL)
+      spool_delete(spool);
+   budget_delete(budget);
+   free(watched.fds);
+   if(handoff_sock != INVALID_SOCKET)
+      closesocket(handoff_sock);
    endConnection(sock);
 }
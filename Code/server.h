@@ -21,6 +21,7 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h> /* TCP_NODELAY */
 #include <arpa/inet.h>
 #include <unistd.h> /* close */
 #include <netdb.h> /* gethostbyname */
@@ -31,6 +32,9 @@ typedef int SOCKET;
 typedef struct sockaddr_in SOCKADDR_IN;
 typedef struct sockaddr SOCKADDR;
 typedef struct in_addr IN_ADDR;
+#ifndef SO_PREFER_BUSY_POLL
+#define SO_PREFER_BUSY_POLL 69 //linux 5.11, missing in older headers
+#endif
 
 #else
 #error not defined for this platform
@@ -39,7 +43,21 @@ typedef struct in_addr IN_ADDR;
 
 /* Includes */
 #include "List/list.h"
+#include "List/ilist.h"
 #include "Queue/queue.h"
+#include "Journal/journal.h"
+#include "Spool/spool.h"
+#include "Handoff/handoff.h"
+#include "Worker/worker.h"
+#include "Limit/bucket.h"
+#include "Trace/trace.h"
+#include "Zerocopy/zerocopy.h"
+#include "Budget/budget.h"
+#include "Capture/capture.h"
+#include "Session/session.h"
+#include "Mux/mux.h"
+#include "Rpc/rpc.h"
+#include "Heap/heap.h"
 
 /* Exit values */
 #define EXIT_FAILLURE_INIT 1
@@ -47,20 +65,49 @@ typedef struct in_addr IN_ADDR;
 #define EXIT_FAILURE_CONNECTION 3
 #define EXIT_FAILURE_RECV 4
 #define EXIT_FAILURE_SEND 5
-#define EXIT_FAILURE_SELECT 6
+#define EXIT_FAILURE_POLL 6
 #define EXIT_FAILURE_BIND 7
 #define EXIT_FAILURE_LISTEN 8
+#define EXIT_FAILURE_JOURNAL 9
+#define EXIT_FAILURE_HANDOFF 10
+#define EXIT_FAILURE_CAPTURE 11
+#define EXIT_FAILURE_SESSION 12
 
 
 /* Values */
 #define PORT 27000
-#define MAX_CLIENTS 10
+#define BACKLOG SOMAXCONN //pending connections, a storm of reconnections waits here
+#define ACCEPT_BUDGET 64 //connections accepted by iteration, clients are read between two batches
 #define BUF_SIZE 1024
+#define REPLY_BATCH 64 //replies of the worker delivered by call of worker_replies
+#define READ_BUDGET 64 //clients read by iteration, the next iteration starts after the last one read
+#define RATE_BURST 2 //seconds of traffic a client can send at once, when its rates are limited with -r and -b
+#define OUTPUT_PAUSE (64 * 1024) //bytes queued for a client before its reads are paused, it reads its replies first
+#define BUSY_POLL_US 50 //SO_BUSY_POLL of the sockets in busy-poll mode
+#define BUSY_SPIN_US 2000 //the busy-poll loop spins this long after the last event, then it backs off
+#define BUSY_BACKOFF_MAX_US 1000 //longest sleep in poll of an idle busy-poll loop
+#define BUDGET_RETRY_MS 10 //a client paused by the memory budget is checked again after this delay
+#define WATCHED_CAPACITY 64 //sockets watched by poll at first, the array doubles when it is full
+#define HANDOFF_FLUSH_MS 100 //a handoff waits this long for the zerocopy completions of the clients
+
+/* Slots of poll, the clients follow */
+#define SLOT_STDIN 0
+#define SLOT_SOCK 1
+#define SLOT_HANDOFF 2
+#define SLOT_WORKER 3
 
 
 /* Structures */
 typedef struct client_s Client;
-typedef List Connected;
+typedef struct options_s Options;
+typedef struct handoff_s Handoff;
+typedef struct handoff_client_s HandoffClient;
+typedef struct handoff_stream_s HandoffStream;
+typedef struct handler_s Handler;
+typedef struct demux_s Demux;
+typedef struct method_s Method;
+typedef struct watched_s Watched;
+typedef IntrusiveList Connected; //Client embeds its node, no allocation by the list
 typedef Queue Waiting;
 
 
@@ -80,13 +127,244 @@ static void end(void);
 
 
 /**
- * @brief Init connection, creation of a socket
+ * @brief Init connection, creation of a socket which listens in IPv6 and in IPv4
  * 
  * @return SOCKET, FD of socket connection
  */
 static SOCKET initConnection(void);
 
 
+/**
+ * @brief Take over the connection socket, the clients and the replies kept of the server which listens on path
+ * 
+ * @param path path of the UNIX socket of the old server
+ * @param client_list list which stores the clients received
+ * @param deferred heap which stores the replies kept until their time
+ * @param worker worker which handles the messages of the clients
+ * @param budget memory budget of the server
+ * @param tracer tracer of the latencies, NULL if disabled
+ * @param opt options of the server
+ * @param key variable that stores the key of the session tokens
+ * @param id variable that stores the id which will be given to the next client
+ * @return SOCKET, FD of socket connection, INVALID_SOCKET if no server listens on path or if it does not run as the same user
+ */
+static SOCKET takeOver(const char *path, Connected *client_list, Heap *deferred, Worker *worker, Budget *budget, Tracer *tracer, const Options *opt, SessionKey *key, int *id);
+
+
+/**
+ * @brief Read bytes of the handoff, the new server can not go on without them
+ * 
+ * @param handoff_sock UNIX socket of the old server
+ * @param data variable that stores the bytes
+ * @param len len of the bytes, nothing is read for 0
+ */
+static void takeOverBytes(SOCKET handoff_sock, void *data, size_t len);
+
+
+/**
+ * @brief Read the state of a client handed off and create the client : its output, its calls in flight and its streams
+ * 
+ * @param handoff_sock UNIX socket of the old server
+ * @param sock socket of client, INVALID_SOCKET if it is dropped : its state is read and thrown away
+ * @param id id of client
+ * @param next_id id which will be given to the next client, the ids of the streams are below it
+ * @param worker worker which handles the messages of the clients
+ * @param budget memory budget of the server, the client is counted in it
+ * @param tracer tracer of the latencies, NULL if disabled
+ * @param opt options of the server
+ * @return Client* pointer on client, NULL if it is dropped
+ */
+static Client *takeOverClient(SOCKET handoff_sock, SOCKET sock, int id, int next_id, Worker *worker, Budget *budget, Tracer *tracer, const Options *opt);
+
+
+/**
+ * @brief Check a socket received from the old server : a TCP stream socket, which listens or not
+ * 
+ * @param sock socket received
+ * @param listening true for the connection socket, false for a client
+ * @return true if the socket can be used
+ */
+static bool validSocket(SOCKET sock, bool listening);
+
+
+/**
+ * @brief Hand off the connection socket, the clients and the replies kept to a new server
+ * 
+ * @param new_sock connection of the new server, accepted by handoff_accept, closed by the function
+ * @param sock connection socket
+ * @param client_list list of connected clients
+ * @param deferred heap of the replies kept until their time, the replies handed off are removed from it
+ * @param budget memory budget of the server
+ * @param key key of the session tokens
+ * @param id id which will be given to the next client
+ * @return int 0 on success, -1 on error
+ */
+static int handOff(SOCKET new_sock, SOCKET sock, Connected *client_list, Heap *deferred, Budget *budget, const SessionKey *key, int id);
+
+
+/**
+ * @brief Send bytes of the handoff
+ * 
+ * @param new_sock connection of the new server
+ * @param data bytes
+ * @param len len of the bytes, nothing is sent for 0
+ * @return int 0 on success, -1 on error
+ */
+static int handOffBytes(SOCKET new_sock, const void *data, size_t len);
+
+
+/**
+ * @brief Send the state of a client to the new server : its output not sent, its calls in flight and its streams
+ * 
+ * @param new_sock connection of the new server
+ * @param c pointer on client
+ * @return int 0 on success, -1 on error
+ * @note The messages sent with MSG_ZEROCOPY are already in the socket, the kernel sends them whoever owns it.
+ */
+static int handOffClient(SOCKET new_sock, Client *c);
+
+
+/**
+ * @brief Wait for the zerocopy completions of the clients before a handoff, at most HANDOFF_FLUSH_MS
+ * 
+ * @param client_list list of connected clients
+ * @param tracer tracer of the latencies, NULL if disabled
+ * @param budget memory budget of the server, the messages completed are released from it
+ * @note The messages still not completed after it are left to the kernel, see zerocopy_detach.
+ */
+static void awaitCompletions(Connected *client_list, Tracer *tracer, Budget *budget);
+
+
+/**
+ * @brief Create a client, its rate is limited as set in the options
+ * 
+ * @param sock socket of client
+ * @param id id of client
+ * @param worker worker which handles the messages of the clients
+ * @param budget memory budget of the server, the client is counted in it
+ * @param tracer tracer of the latencies, NULL if disabled
+ * @param opt options of the server
+ * @return Client* pointer on client
+ */
+static Client *createClient(SOCKET sock, int id, Worker *worker, Budget *budget, Tracer *tracer, const Options *opt);
+
+
+/**
+ * @brief Create the client of a stream opened on a multiplexed connection, its messages are handled on the node of the connection
+ * 
+ * @param carrier connection of the stream
+ * @param stream stream
+ * @param id id of client
+ * @param worker worker which handles the messages of the clients
+ * @param budget memory budget of the server, the client is counted in it
+ * @return Client* pointer on client
+ * @note The rates are limited on the connection, its streams share them.
+ */
+static Client *createStream(Client *carrier, uint32_t stream, int id, Worker *worker, Budget *budget);
+
+
+/**
+ * @brief Close the connection of a client and free it, the messages it has sent are still handled
+ * 
+ * @param client_list list of connected clients
+ * @param c pointer on client
+ * @param worker worker which handles the messages of the clients
+ * @param budget memory budget of the server
+ * @param capture capture of the traffic, NULL if disabled
+ */
+static void removeClient(Connected *client_list, Client *c, Worker *worker, Budget *budget, Capture *capture);
+
+
+/**
+ * @brief Give the bytes held for a client : its structure, its messages not handled, its output not sent and its messages not completed, with its streams
+ * 
+ * @param c pointer on client
+ * @return size_t bytes held
+ */
+static size_t clientMemory(Client *c);
+
+
+/**
+ * @brief Close the connections which hold the most memory until the server is under its limit
+ * 
+ * @param client_list list of connected clients
+ * @param worker worker which handles the messages of the clients
+ * @param budget memory budget of the server
+ * @param capture capture of the traffic, NULL if disabled
+ * @return int number of messages dropped with the clients
+ */
+static int evictClients(Connected *client_list, Worker *worker, Budget *budget, Capture *capture);
+
+
+/**
+ * @brief Give the time before a client can be read again
+ * 
+ * @param c pointer on client
+ * @param now current time in nanoseconds
+ * @return int milliseconds to wait, 0 if the client can be read
+ */
+static int throttleClient(Client *c, int64_t now);
+
+
+/**
+ * @brief Pin the calling thread to a CPU
+ * 
+ * @param cpu number of the CPU
+ */
+static void pinLoop(int cpu);
+
+
+/**
+ * @brief Ask the kernel to busy poll the device queue when the socket is read
+ * 
+ * @param sock socket
+ */
+static void busyPollSocket(SOCKET sock);
+
+
+/**
+ * @brief Give the timeout of poll in busy-poll mode : 0 while the loop spins, then longer and longer sleeps
+ * 
+ * @param ready number of sockets ready at the last poll
+ * @param now current time in nanoseconds
+ * @param last_event variable that stores the time of the last event
+ * @param backoff variable that stores the last sleep, in microseconds
+ * @return long timeout in microseconds
+ */
+static long busyTimeout(int ready, int64_t now, int64_t *last_event, long *backoff);
+
+
+/**
+ * @brief Watch a socket in the next poll
+ * 
+ * @param w sockets watched
+ * @param sock socket, INVALID_SOCKET for a slot which poll ignores
+ * @param events events watched
+ * @return int slot of the socket
+ */
+static int watchSocket(Watched *w, SOCKET sock, short events);
+
+
+/**
+ * @brief Give the events of a socket returned by poll
+ * 
+ * @param w sockets watched
+ * @param slot slot of the socket, -1 if it is not watched
+ * @return short events returned, 0 if the socket is not watched
+ */
+static short readyEvents(const Watched *w, int slot);
+
+
+/**
+ * @brief Read the error queue of a client : kernel timestamps and zerocopy completions
+ * 
+ * @param c pointer on client
+ * @param tracer tracer of the latencies, NULL if disabled
+ * @param budget memory budget of the server, the messages completed are released from it
+ */
+static void readErrors(Client *c, Tracer *tracer, Budget *budget);
+
+
 /**
  * @brief Close connection socket
  * 
@@ -101,24 +379,375 @@ static void endConnection(SOCKET sock);
  * @param sock socket of client
  * @param buffer variable that stores the message
  * @param len len of the buffer, less than or equal to the size of the buffer
- * @return int number of characters read
+ * @param tracer tracer of the latencies, NULL if disabled
+ * @param stamp variable that stores the time of the read, 0 if the tracer is disabled
+ * @return int number of characters read, 0 if the client is disconnected, -1 if nothing is ready
  */
-static int readClient(SOCKET sock, char *buffer, int len);
+static int readClient(SOCKET sock, char *buffer, int len, Tracer *tracer, int64_t *stamp);
 
 
 /**
  * @brief Write data to the client
  * 
- * @param sock socket of client
+ * @param c pointer on client
  * @param buffer variable that stores the message
  */
-static void writeClient(SOCKET sock, const char *buffer);
+static void writeClient(Client *c, const char *buffer);
+
+
+/**
+ * @brief Write bytes to the client, a send which fails marks the client broken
+ * 
+ * @param c pointer on client
+ * @param buffer variable that stores the bytes
+ * @param len len of the bytes
+ */
+static void sendClient(Client *c, const char *buffer, size_t len);
+
+
+/**
+ * @brief Write a vector of bytes to the client, what the kernel does not take is queued until the socket is writable
+ * 
+ * @param c pointer on client
+ * @param iov vector of bytes
+ * @param count number of iovec
+ * @param sent bytes at the start of the vector the kernel has already taken without copy, the rest is queued after them
+ * @param received time of the read of the message answered, 0 if the bytes do not answer a message
+ * @note The loop never waits for a client : a client which does not read grows its queue, counted in its memory.
+ *       Every byte written to the client goes through here, so the offsets of the TX timestamps are counted here.
+ */
+static void sendClientv(Client *c, const struct iovec *iov, int count, size_t sent, int64_t received);
+
+
+/**
+ * @brief Queue bytes after the output of the client
+ * 
+ * @param c pointer on client
+ * @param data bytes
+ * @param len len of the bytes
+ * @note The buffer is counted in the budget of the client, a client which does not read pushes the server to its limit.
+ */
+static void queueClient(Client *c, const char *data, size_t len);
+
+
+/**
+ * @brief Send the output queued for the client, as much as the kernel takes
+ * 
+ * @param c pointer on client, its socket is writable
+ */
+static void flushClient(Client *c);
+
+
+/**
+ * @brief Remove the clients whose send has failed
+ * 
+ * @param client_list list of connected clients
+ * @param worker worker which handles the messages of the clients
+ * @param budget memory budget of the server
+ * @param capture capture of the traffic, NULL if disabled
+ */
+static void removeBroken(Connected *client_list, Worker *worker, Budget *budget, Capture *capture);
+
+
+/**
+ * @brief Accept the pending connections, at most ACCEPT_BUDGET
+ * 
+ * @param sock connection socket, non-blocking
+ * @param client_list list of connected clients
+ * @param worker worker which handles the messages of the clients
+ * @param budget memory budget of the server
+ * @param tracer tracer of the latencies, NULL if disabled
+ * @param capture capture of the traffic, NULL if disabled
+ * @param key key of the session tokens, NULL if the sessions are disabled
+ * @param opt options of the server
+ * @param id variable that stores the id which will be given to the next client
+ * @return int number of clients accepted
+ * @note A new client has a new id, nothing is spooled for it : the spooled messages go to a client which resumes its session.
+ */
+static int acceptClients(SOCKET sock, Connected *client_list, Worker *worker, Budget *budget, Tracer *tracer, Capture *capture, const SessionKey *key, const Options *opt, int *id);
+
+
+/**
+ * @brief Send its id and its session token to a client : "#session id token"
+ * 
+ * @param c pointer on client
+ * @param key key of the session tokens
+ */
+static void sendSession(Client *c, const SessionKey *key);
+
+
+/**
+ * @brief Send to a client the messages spooled while it was away
+ * 
+ * @param c pointer on client
+ * @param spool spool of disconnected clients, NULL if disabled
+ * @param budget memory budget of the server
+ */
+static void drainSpool(Client *c, Spool *spool, Budget *budget);
+
+
+/**
+ * @brief Writer of the spool : the messages are queued in the output of the client
+ * 
+ * @param iov vector of messages
+ * @param count number of iovec
+ * @param context client
+ * @return int 0 on success, -1 if the client is broken
+ */
+static int spoolWriter(const struct iovec *iov, int count, void *context);
+
+
+/**
+ * @brief Resume a session : "#resume token", the client gets back the id of the token and its spooled messages
+ * 
+ * @param client_list list of connected clients
+ * @param c pointer on client, it has the new id given at its connection
+ * @param token token sent by the client
+ * @param key key of the session tokens
+ * @param worker worker which handles the messages of the clients
+ * @param spool spool of disconnected clients, NULL if disabled
+ * @param budget memory budget of the server
+ * @param capture capture of the traffic, NULL if disabled
+ * @return true if the session is resumed, false if the token is not valid
+ */
+static bool resumeClient(Connected *client_list, Client *c, const char *token, const SessionKey *key, Worker *worker, Spool *spool, Budget *budget, Capture *capture);
+
+
+/**
+ * @brief Find a client by its id, among the connections and their streams
+ * 
+ * @param client_list list of connected clients
+ * @param id id of client
+ * @return Client* pointer on client, NULL if it is not connected
+ */
+static Client *findClient(Connected *client_list, int id);
+
+
+/**
+ * @brief Multiplex the connection of a client : "#mux", the bytes which follow are frames in both directions
+ * 
+ * @param c pointer on client
+ * @note The stream 0 is the client itself, each other stream opened by the client is a new client which gets "#stream id".
+ */
+static void muxClient(Client *c);
+
+
+/**
+ * @brief Send the frames of a multiplexed connection which its credits allow, while its socket takes them
+ * 
+ * @param c pointer on client, multiplexed
+ */
+static void flushStreams(Client *c);
+
+
+/**
+ * @brief Read the frames of a multiplexed connection, the messages of its streams are submitted to the worker
+ * 
+ * @param c pointer on client, multiplexed
+ * @param data bytes read
+ * @param len len of the bytes
+ * @param demux context of the frames : worker, budget, journal and ids
+ * @return int 0 on success, -1 if the client breaks the protocol
+ */
+static int readStreams(Client *c, const char *data, size_t len, Demux *demux);
+
+
+/**
+ * @brief Handle a frame of a stream : the first frame of a stream opens its client, the end of the stream closes it
+ * 
+ * @param stream stream of the frame
+ * @param data message, NULL when the stream is closed
+ * @param len len of the message
+ * @param context context of the frames (Demux)
+ */
+static void handleStream(uint32_t stream, const char *data, size_t len, void *context);
+
+
+/**
+ * @brief Send a message on a stream, or on the stream 0 of a multiplexed connection
+ * 
+ * @param c pointer on client, a stream or a multiplexed connection
+ * @param data message
+ * @param len len of the message
+ * @param budget memory budget of the server, the data waiting for credits is counted in it
+ */
+static void sendStream(Client *c, const char *data, size_t len, Budget *budget);
+
+
+/**
+ * @brief The client calls methods : "#rpc", the bytes which follow are lines, a call or a message by line
+ * 
+ * @param c pointer on client
+ * @param budget memory budget of the server, the table of the calls is counted in it
+ */
+static void rpcClient(Client *c, Budget *budget);
+
+
+/**
+ * @brief Cut the bytes read from a client which calls methods in lines, a line cut is kept until its end
+ * 
+ * @param c pointer on client
+ * @param data bytes read
+ * @param len len of the bytes
+ * @param worker worker which handles the messages of the clients
+ * @param journal journal of the messages, NULL if disabled
+ * @param stamp time of the read
+ */
+static void readCalls(Client *c, const char *data, size_t len, Worker *worker, Journal *journal, int64_t stamp);
+
+
+/**
+ * @brief Handle a line of a client which calls methods : a call enters the table of the client and goes to the worker, as a message
+ * 
+ * @param c pointer on client
+ * @param line line, ended by '\n'
+ * @param len len of the line
+ * @param worker worker which handles the messages of the clients
+ * @param journal journal of the messages, NULL if disabled
+ * @param stamp time of the read
+ */
+static void handleLine(Client *c, const char *line, size_t len, Worker *worker, Journal *journal, int64_t stamp);
+
+
+/**
+ * @brief Answer "timeout" to a call expired, its return will be dropped
+ * 
+ * @param call call expired
+ * @param context client of the call
+ */
+static void expireCall(const RpcCall *call, void *context);
+
+
+/**
+ * @brief Handler of the calls : "#call id method timeout args" is dispatched to its method, the other messages to the handler of the server
+ * 
+ * @param from id of the client which sends the message
+ * @param data message received
+ * @param len len of the message
+ * @param reply variable that stores the return "#ret id status result"
+ * @param context options of the server
+ * @return true if there is a reply
+ */
+static bool handleCall(int from, const char *data, size_t len, Reply *reply, void *context);
+
+
+/**
+ * @brief Method "echo" : the arguments are returned
+ * 
+ * @param args arguments
+ * @param result variable that stores the result
+ * @param len size of the result
+ * @param delay unused
+ * @return true
+ */
+static bool methodEcho(const char *args, char *result, size_t len, int *delay);
+
+
+/**
+ * @brief Method "sum" : the sum of the integers of the arguments
+ * 
+ * @param args arguments, integers separated by spaces
+ * @param result variable that stores the sum
+ * @param len size of the result
+ * @param delay unused
+ * @return true on success, false if an argument is not an integer
+ */
+static bool methodSum(const char *args, char *result, size_t len, int *delay);
+
+
+/**
+ * @brief Method "sleep" : the return comes after a delay, to try the deadlines
+ * 
+ * @param args milliseconds to wait
+ * @param result variable that stores the delay
+ * @param len size of the result
+ * @param delay variable that stores the delay of the return
+ * @return true
+ * @note Nothing sleeps : the return is kept by the event loop until its time, the strands of the thread go on.
+ */
+static bool methodSleep(const char *args, char *result, size_t len, int *delay);
+
+
+/**
+ * @brief Handler "forward" : a message "@id text" is sent to the client id
+ * 
+ * @param from id of the client which sends the message
+ * @param data message received
+ * @param len len of the message
+ * @param reply variable that stores the message "[from] : text"
+ * @param context unused
+ * @return true if the message is for a client
+ */
+static bool handleForward(int from, const char *data, size_t len, Reply *reply, void *context);
+
+
+/**
+ * @brief Handler "echo" : the message is sent back to the client
+ * 
+ * @param from id of the client which sends the message
+ * @param data message received
+ * @param len len of the message
+ * @param reply variable that stores the message
+ * @param context unused
+ * @return true
+ */
+static bool handleEcho(int from, const char *data, size_t len, Reply *reply, void *context);
+
+
+/**
+ * @brief Send the replies of the worker to the clients, or to their spool if they are disconnected
+ * 
+ * @param worker worker which handles the messages of the clients
+ * @param deferred heap of the replies kept until their time, by due
+ * @param client_list list of connected clients
+ * @param spool spool of disconnected clients, NULL if disabled
+ * @param budget memory budget of the server, replies of lowest priority are dropped when it sheds
+ * @param next_id id which will be given to the next client
+ * @return int number of replies dropped
+ * @note A reply with a due is kept in deferred and counted in the budget, it is sent by the first call past its time.
+ */
+static int deliverReplies(Worker *worker, Heap *deferred, Connected *client_list, Spool *spool, Budget *budget, int next_id);
+
+
+/**
+ * @brief Give the time before the next reply kept by deliverReplies, for the timeout of the event loop
+ * 
+ * @param deferred heap of the replies kept until their time, by due
+ * @param now current time in nanoseconds
+ * @return int milliseconds to wait, rounded up, 0 if a reply is due, -1 if no reply is kept
+ */
+static int deferredTimeout(Heap *deferred, int64_t now);
+
+
+/**
+ * @brief Order of the replies kept by deliverReplies : the first due comes out first
+ * 
+ * @param a first reply
+ * @param b second reply
+ * @return int < 0 if a is due before b, 0 if they are due at the same time, > 0 otherwise
+ */
+static int compareDue(const void *a, const void *b);
+
+
+/**
+ * @brief Send a reply of the worker to its client, or to its spool if it is disconnected, nothing waits for the socket
+ * 
+ * @param r reply, its data is set to NULL when it is kept until the kernel has sent its pages
+ * @param client_list list of connected clients
+ * @param spool spool of disconnected clients, NULL if disabled
+ * @param budget memory budget of the server
+ * @param next_id id which will be given to the next client
+ * @param shed true if the replies of lowest priority are dropped
+ * @return false if the reply is dropped to stay in the memory budget
+ */
+static bool deliverReply(Reply *r, Connected *client_list, Spool *spool, Budget *budget, int next_id, bool shed);
 
 
 /**
  * @brief Server application
  * 
+ * @param opt options of the server
  */
-static void appS(void);
+static void appS(const Options *opt);
 
 #endif
\ No newline at end of file